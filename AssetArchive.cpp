@@ -0,0 +1,342 @@
+#include "AssetArchive.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+
+#include "LZCompression.h"
+
+static const char ARCHIVE_MAGIC[4] = { 'P', 'A', 'C', 'K' };
+static const uint32_t ARCHIVE_VERSION = 1;
+static const uint32_t EMPTY_BUCKET = 0xFFFFFFFF;
+
+// Layout of the archive header, one cache line
+struct ArchiveHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t bucketCount;    // power of two, at least twice the entry count so probe sequences stay short
+	uint64_t entriesOffset;  // entryCount ArchiveEntry
+	uint64_t bucketsOffset;  // bucketCount entry indices, EMPTY_BUCKET where unused
+	uint64_t namesOffset;    // names, not terminated
+	uint64_t namesSize;
+	uint64_t reserved[2];
+};
+
+static_assert(sizeof(ArchiveHeader) == ARCHIVE_ALIGNMENT, "ArchiveHeader must fill one cache line");
+
+// Function to check that a range lies within a file without overflowing
+static bool InFile(uint64_t offset, uint64_t size, uint64_t fileSize) {
+	return offset <= fileSize && size <= fileSize - offset;
+}
+
+// Function to round an offset up to the payload alignment
+static uint64_t AlignOffset(uint64_t offset) {
+	return (offset + ARCHIVE_ALIGNMENT - 1) & ~(ARCHIVE_ALIGNMENT - 1);
+}
+
+// Function to hash an asset name
+uint64_t HashAssetName(const std::string& name) {
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : name) {
+		hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+	}
+	return hash;
+}
+
+// Function to read 8 unaligned little-endian bytes
+static uint64_t Read64(const unsigned char* pointer) {
+	uint64_t value = 0;
+	for (int i = 7; i >= 0; --i) {
+		value = value << 8 | pointer[i];
+	}
+	return value;
+}
+
+// Function to mix one word into a lane
+static uint64_t HashRound(uint64_t lane, uint64_t word) {
+	const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+	const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+	lane += word * PRIME2;
+	lane = lane << 31 | lane >> 33;
+	return lane * PRIME1;
+}
+
+// Function to hash asset contents
+uint64_t HashAssetData(const unsigned char* data, size_t size) {
+	uint64_t lanes[4] = { 0x60EA27EEADC0B5D6ull, 0xC2B2AE3D27D4EB4Full, 0, 0x61C8864E7A143579ull };
+	size_t position = 0;
+	for (; position + 32 <= size; position += 32) {
+		for (int lane = 0; lane < 4; ++lane) {
+			lanes[lane] = HashRound(lanes[lane], Read64(data + position + lane * 8));
+		}
+	}
+
+	uint64_t hash = static_cast<uint64_t>(size);
+	for (int lane = 0; lane < 4; ++lane) {
+		hash = HashRound(hash ^ HashRound(0, lanes[lane]), lane);
+	}
+	for (; position < size; ++position) {
+		hash = HashRound(hash, data[position]);
+	}
+
+	// Final avalanche so every input bit reaches every output bit
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+// Function to guess the format of a file from its extension
+AssetFormat GetAssetFormat(const std::string& filePath) {
+	size_t dot = filePath.find_last_of('.');
+	if (dot == std::string::npos) {
+		return AssetFormat::Raw;
+	}
+	std::string extension = filePath.substr(dot + 1);
+	for (char& c : extension) {
+		if (c >= 'A' && c <= 'Z') {
+			c = static_cast<char>(c - 'A' + 'a');
+		}
+	}
+
+	if (extension == "cso") {
+		return AssetFormat::Shader;
+	}
+	if (extension == "jpg" || extension == "jpeg" || extension == "png" || extension == "bmp" || extension == "tga") {
+		return AssetFormat::Image;
+	}
+	if (extension == "mesh" || extension == "obj") {
+		return AssetFormat::Mesh;
+	}
+	return AssetFormat::Raw;
+}
+
+// Function to map an archive and locate its tables
+bool AssetArchive::Open(const std::string& filePath) {
+	entries = nullptr;
+	buckets = nullptr;
+	names = nullptr;
+	entryCount = 0;
+	bucketCount = 0;
+	namesSize = 0;
+	if (!file.Open(filePath, FileAccess::Random)) {
+		return false;
+	}
+
+	ArchiveHeader header;
+	uint64_t fileSize = file.Size();
+	if (fileSize < sizeof(header)) {
+		std::cerr << "Invalid asset archive: " << filePath << std::endl;
+		file.Close();
+		return false;
+	}
+	std::memcpy(&header, file.Data(), sizeof(header));
+
+	bool valid = std::memcmp(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) == 0 && header.version == ARCHIVE_VERSION &&
+		header.bucketCount > 0 && (header.bucketCount & (header.bucketCount - 1)) == 0 &&
+		header.entriesOffset % alignof(ArchiveEntry) == 0 && header.bucketsOffset % alignof(uint32_t) == 0 &&
+		InFile(header.entriesOffset, static_cast<uint64_t>(header.entryCount) * sizeof(ArchiveEntry), fileSize) &&
+		InFile(header.bucketsOffset, static_cast<uint64_t>(header.bucketCount) * sizeof(uint32_t), fileSize) &&
+		InFile(header.namesOffset, header.namesSize, fileSize);
+	if (!valid) {
+		std::cerr << "Invalid asset archive: " << filePath << std::endl;
+		file.Close();
+		return false;
+	}
+
+	entries = reinterpret_cast<const ArchiveEntry*>(file.Data() + header.entriesOffset);
+	buckets = reinterpret_cast<const uint32_t*>(file.Data() + header.bucketsOffset);
+	names = reinterpret_cast<const char*>(file.Data() + header.namesOffset);
+	entryCount = header.entryCount;
+	bucketCount = header.bucketCount;
+	namesSize = header.namesSize;
+	return true;
+}
+
+// Function to find an asset by probing the hash table from the bucket of its name
+const ArchiveEntry* AssetArchive::Find(const std::string& name) const {
+	if (!IsOpen()) {
+		return nullptr;
+	}
+
+	uint64_t hash = HashAssetName(name);
+	uint32_t mask = bucketCount - 1;
+	for (uint32_t probe = 0, bucket = static_cast<uint32_t>(hash) & mask; probe < bucketCount; ++probe, bucket = (bucket + 1) & mask) {
+		uint32_t index = buckets[bucket];
+		if (index == EMPTY_BUCKET || index >= entryCount) {
+			return nullptr;
+		}
+		const ArchiveEntry& entry = entries[index];
+		if (entry.nameHash == hash && entry.nameLength == name.size() && InFile(entry.nameOffset, entry.nameLength, namesSize) &&
+			std::memcmp(names + entry.nameOffset, name.data(), name.size()) == 0) {
+			return &entry;
+		}
+	}
+	return nullptr;
+}
+
+// Function to read the name of an entry
+std::string AssetArchive::GetName(const ArchiveEntry& entry) const {
+	if (!InFile(entry.nameOffset, entry.nameLength, namesSize)) {
+		return std::string();
+	}
+	return std::string(names + entry.nameOffset, entry.nameLength);
+}
+
+// Function to fetch an asset, in place when it is stored uncompressed
+bool AssetArchive::Load(const std::string& name, AssetData& asset) const {
+	asset = AssetData();
+	const ArchiveEntry* entry = Find(name);
+	if (entry == nullptr) {
+		std::cerr << "Asset not in archive: " << name << std::endl;
+		return false;
+	}
+	if (!InFile(entry->offset, entry->storedSize, file.Size())) {
+		std::cerr << "Corrupt asset in archive: " << name << std::endl;
+		return false;
+	}
+
+	const unsigned char* payload = file.Data() + entry->offset;
+	if (entry->compression == AssetCompression::None && entry->storedSize == entry->size) {
+		asset.data = payload;
+	}
+	else if (entry->compression == AssetCompression::LZ && entry->size <= SIZE_MAX) {
+		asset.buffer.resize(static_cast<size_t>(entry->size));
+		if (!DecompressLZ(payload, static_cast<size_t>(entry->storedSize), asset.buffer.data(), asset.buffer.size())) {
+			std::cerr << "Corrupt asset in archive: " << name << std::endl;
+			asset = AssetData();
+			return false;
+		}
+		asset.data = asset.buffer.data();
+	}
+	else {
+		std::cerr << "Corrupt asset in archive: " << name << std::endl;
+		return false;
+	}
+
+	asset.size = static_cast<size_t>(entry->size);
+	asset.format = entry->format;
+	asset.loaded = true;
+	return true;
+}
+
+// Function to load an asset from the archive, or from its loose file
+bool LoadAsset(const AssetArchive& archive, const std::string& name, AssetData& asset) {
+	if (archive.Find(name) != nullptr) {
+		return archive.Load(name, asset);
+	}
+
+	asset = AssetData();
+	if (!asset.file.Open(name, FileAccess::Sequential)) {
+		return false;
+	}
+	asset.data = asset.file.Data();
+	asset.size = asset.file.Size();
+	asset.format = GetAssetFormat(name);
+	asset.loaded = true;
+	return true;
+}
+
+// Function to write an archive
+bool WriteAssetArchive(const std::string& filePath, const std::vector<AssetArchiveInput>& inputs) {
+	if (inputs.size() >= EMPTY_BUCKET / 2) {
+		std::cerr << "Too many assets for one archive!" << std::endl;
+		return false;
+	}
+
+	ArchiveHeader header = {};
+	std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+	header.version = ARCHIVE_VERSION;
+	header.entryCount = static_cast<uint32_t>(inputs.size());
+	header.bucketCount = 1;
+	while (header.bucketCount < 2 * header.entryCount) {
+		header.bucketCount *= 2;
+	}
+
+	// Index and names
+	std::vector<ArchiveEntry> entries(inputs.size());
+	std::vector<uint32_t> buckets(header.bucketCount, EMPTY_BUCKET);
+	std::string names;
+	std::unordered_set<std::string> seenNames;
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		const AssetArchiveInput& input = inputs[i];
+		if (!seenNames.insert(input.name).second) {
+			std::cerr << "Duplicate asset name: " << input.name << std::endl;
+			return false;
+		}
+
+		ArchiveEntry& entry = entries[i];
+		entry.nameHash = HashAssetName(input.name);
+		entry.size = input.size;
+		entry.format = input.format;
+		entry.nameOffset = static_cast<uint32_t>(names.size());
+		entry.nameLength = static_cast<uint32_t>(input.name.size());
+		names += input.name;
+
+		uint32_t mask = header.bucketCount - 1;
+		uint32_t bucket = static_cast<uint32_t>(entry.nameHash) & mask;
+		while (buckets[bucket] != EMPTY_BUCKET) {
+			bucket = (bucket + 1) & mask;
+		}
+		buckets[bucket] = static_cast<uint32_t>(i);
+	}
+
+	// Compress where it pays off
+	std::vector<std::vector<unsigned char>> compressed(inputs.size());
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		const AssetArchiveInput& input = inputs[i];
+		entries[i].compression = AssetCompression::None;
+		entries[i].storedSize = input.size;
+		if (input.compress) {
+			CompressLZ(input.data, input.size, compressed[i]);
+			if (compressed[i].size() < input.size - input.size / 8) {
+				entries[i].compression = AssetCompression::LZ;
+				entries[i].storedSize = compressed[i].size();
+			}
+			else {
+				compressed[i] = std::vector<unsigned char>();
+			}
+		}
+	}
+
+	// Layout: header, index, hash table, names, then the aligned payloads
+	header.entriesOffset = sizeof(ArchiveHeader);
+	header.bucketsOffset = header.entriesOffset + entries.size() * sizeof(ArchiveEntry);
+	header.namesOffset = header.bucketsOffset + buckets.size() * sizeof(uint32_t);
+	header.namesSize = names.size();
+	uint64_t offset = header.namesOffset + header.namesSize;
+	for (ArchiveEntry& entry : entries) {
+		offset = AlignOffset(offset);
+		entry.offset = offset;
+		offset += entry.storedSize;
+	}
+
+	std::ofstream writer(filePath, std::ios::binary);
+	if (!writer.is_open()) {
+		std::cerr << "Could not open file: " << filePath << std::endl;
+		return false;
+	}
+	writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	writer.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ArchiveEntry));
+	writer.write(reinterpret_cast<const char*>(buckets.data()), buckets.size() * sizeof(uint32_t));
+	writer.write(names.data(), names.size());
+
+	static const char PADDING[ARCHIVE_ALIGNMENT] = {};
+	uint64_t written = header.namesOffset + header.namesSize;
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		writer.write(PADDING, static_cast<std::streamsize>(entries[i].offset - written));
+		const unsigned char* payload = entries[i].compression == AssetCompression::LZ ? compressed[i].data() : inputs[i].data;
+		writer.write(reinterpret_cast<const char*>(payload), static_cast<std::streamsize>(entries[i].storedSize));
+		written = entries[i].offset + entries[i].storedSize;
+	}
+
+	if (!writer) {
+		std::cerr << "Failed to write file: " << filePath << std::endl;
+		return false;
+	}
+	return true;
+}
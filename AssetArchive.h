@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FileView.h"
+
+// What an archived asset holds, set by the packer from the file extension
+enum class AssetFormat : uint32_t {
+	Raw,     // anything else
+	Shader,  // compiled shader bytecode, .cso
+	Image,   // encoded image the texture loader decodes, .jpg .png .bmp .tga
+	Mesh     // .mesh or .obj
+};
+
+// How an asset is stored in the archive
+enum class AssetCompression : uint32_t {
+	None,  // the payload is the asset, readers use it in place
+	LZ     // CompressLZ() block
+};
+
+// Index entry of one asset, the index is an array of these after the header
+struct ArchiveEntry {
+	uint64_t nameHash;       // HashAssetName() of the name
+	uint64_t offset;         // payload offset from the start of the archive, a multiple of ARCHIVE_ALIGNMENT
+	uint64_t storedSize;     // payload size in the archive
+	uint64_t size;           // asset size once decompressed
+	AssetFormat format;
+	AssetCompression compression;
+	uint32_t nameOffset;     // into the name table
+	uint32_t nameLength;
+};
+
+static_assert(sizeof(ArchiveEntry) == 48, "ArchiveEntry must be 48 bytes");
+
+// Payloads start on cache line boundaries so mapped assets can be read with aligned SIMD loads
+const uint64_t ARCHIVE_ALIGNMENT = 64;
+
+// Bytes of one asset. Stored assets point into a mapping, either the archive's or the loose file's,
+// compressed ones own their decompressed bytes. Moving keeps data valid.
+struct AssetData {
+	FileView file;                        // the loose file when the asset did not come from an archive
+	std::vector<unsigned char> buffer;    // decompressed bytes
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+	AssetFormat format = AssetFormat::Raw;
+	bool loaded = false;
+};
+
+// One file going into an archive
+struct AssetArchiveInput {
+	std::string name;
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+	AssetFormat format = AssetFormat::Raw;
+	bool compress = false;  // stored uncompressed anyway when compression saves less than an eighth
+};
+
+// Read-only asset archive: a header, the entry index, a hash table of entry indices, the name table, then the payloads.
+// Lookups hash the name and probe the mapped hash table, so nothing is scanned or parsed when the archive opens.
+class AssetArchive {
+public:
+	/// <summary>
+	/// Maps an archive and checks that its header, index and hash table lie within the file.
+	/// </summary>
+	/// <param name="filePath">- Path of the archive.</param>
+	/// <returns>True if the archive was opened, otherwise false.</returns>
+	bool Open(const std::string& filePath);
+
+	bool IsOpen() const { return file.IsOpen(); }
+
+	/// <summary>
+	/// Finds an asset by name with a single hash table probe sequence.
+	/// </summary>
+	/// <param name="name">- The name the asset was packed with.</param>
+	/// <returns>The asset's index entry, or nullptr if the archive has no such asset.</returns>
+	const ArchiveEntry* Find(const std::string& name) const;
+
+	/// <summary>
+	/// Fetches an asset. Uncompressed assets point into the archive's mapping, compressed ones are decompressed.
+	/// The archive must stay open while uncompressed assets are in use.
+	/// </summary>
+	/// <param name="name">- The name the asset was packed with.</param>
+	/// <param name="asset">- Receives the asset.</param>
+	/// <returns>True if the asset was found and is intact, otherwise false.</returns>
+	bool Load(const std::string& name, AssetData& asset) const;
+
+	/// <summary>
+	/// Returns the index, one entry per asset in packing order.
+	/// </summary>
+	const ArchiveEntry* Entries() const { return entries; }
+	uint32_t EntryCount() const { return entryCount; }
+
+	/// <summary>
+	/// Returns the name of an entry.
+	/// </summary>
+	std::string GetName(const ArchiveEntry& entry) const;
+
+private:
+	FileView file;
+	const ArchiveEntry* entries = nullptr;
+	const uint32_t* buckets = nullptr;
+	const char* names = nullptr;
+	uint32_t entryCount = 0;
+	uint32_t bucketCount = 0;
+	uint64_t namesSize = 0;
+};
+
+/// <summary>
+/// Hashes an asset name with 64-bit FNV-1a, the key of the archive's hash table.
+/// </summary>
+uint64_t HashAssetName(const std::string& name);
+
+/// <summary>
+/// Hashes asset contents, 64 bits from four independent multiply-rotate lanes so large files hash at several GB/s.
+/// </summary>
+/// <param name="data">- The bytes to hash.</param>
+/// <param name="size">- Number of bytes.</param>
+/// <returns>The hash, the same on every platform.</returns>
+uint64_t HashAssetData(const unsigned char* data, size_t size);
+
+/// <summary>
+/// Guesses the format of a file from its extension.
+/// </summary>
+AssetFormat GetAssetFormat(const std::string& filePath);
+
+/// <summary>
+/// Loads an asset from an archive if it holds one by that name, otherwise maps the loose file from the working directory.
+/// </summary>
+/// <param name="archive">- The archive to look in first, may be closed.</param>
+/// <param name="name">- Asset name, which is also its loose file path.</param>
+/// <param name="asset">- Receives the asset.</param>
+/// <returns>True if the asset was loaded from either, otherwise false.</returns>
+bool LoadAsset(const AssetArchive& archive, const std::string& name, AssetData& asset);
+
+/// <summary>
+/// Writes an archive. Payloads are written in input order, each padded to ARCHIVE_ALIGNMENT.
+/// </summary>
+/// <param name="filePath">- Path of the archive to write.</param>
+/// <param name="inputs">- The assets, names must be unique.</param>
+/// <returns>True if the archive was written, otherwise false.</returns>
+bool WriteAssetArchive(const std::string& filePath, const std::vector<AssetArchiveInput>& inputs);
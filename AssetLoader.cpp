@@ -0,0 +1,101 @@
+#include "AssetLoader.h"
+
+AssetLoader::AssetLoader(uint32_t threadCount)
+	: pool(threadCount) {
+}
+
+// Function to open the archive assets are looked up in first
+bool AssetLoader::OpenArchive(const std::string& filePath) {
+	return archive.Open(filePath);
+}
+
+// Function to turn on the texture cache
+void AssetLoader::EnableTextureCache(const std::string& directory) {
+	textureCache.reset(new TextureCache(directory));
+}
+
+// Function to read the texture cache counters
+TextureCacheStats AssetLoader::GetTextureCacheStats() const {
+	return textureCache != nullptr ? textureCache->GetStats() : TextureCacheStats();
+}
+
+// Function to fetch an asset on a worker thread
+std::future<AssetData> AssetLoader::LoadFile(const std::string& name) {
+	return std::async(std::launch::async, [this, name]() {
+		AssetData asset;
+		LoadAsset(archive, name, asset);
+		return asset;
+	});
+}
+
+// Function to decode a mapped image on the loader's pool
+TextureData AssetLoader::DecodeTexture(const AssetData& file, const std::string& filePath) {
+	TextureData texture;
+	if (!file.loaded) {
+		return texture;
+	}
+
+	std::lock_guard<std::mutex> lock(poolMutex);
+	if (!LoadTextureData(pool, file.data, file.size, filePath, texture)) {
+		texture = TextureData();
+	}
+	return texture;
+}
+
+// Function to fetch then decode an image
+std::future<TextureData> AssetLoader::LoadTexture(const std::string& filePath) {
+	return Then(LoadFile(filePath), [this, filePath](AssetData file) {
+		return DecodeTexture(file, filePath);
+	});
+}
+
+// Function to fetch, decode, then build the mips of an image, or read all of it from the texture cache
+std::future<TextureData> AssetLoader::LoadTexture(const std::string& filePath, const MipChainOptions& mipOptions) {
+	if (textureCache != nullptr) {
+		return std::async(std::launch::async, [this, filePath, mipOptions]() {
+			TextureData texture;
+			std::lock_guard<std::mutex> lock(poolMutex);
+			if (!textureCache->Load(pool, archive, filePath, mipOptions, texture)) {
+				texture = TextureData();
+			}
+			return texture;
+		});
+	}
+
+	return Then(LoadTexture(filePath), [this, mipOptions](TextureData texture) {
+		if (!texture.pixels.empty()) {
+			std::lock_guard<std::mutex> lock(poolMutex);
+			BuildMipChain(pool, mipOptions, texture);
+		}
+		return texture;
+	});
+}
+
+// Function to load an image with its mips, then compress them, or read the blocks from the texture cache
+std::future<TextureData> AssetLoader::LoadTexture(const std::string& filePath, const MipChainOptions& mipOptions, const BlockCompressionOptions& compressionOptions) {
+	if (textureCache != nullptr) {
+		return std::async(std::launch::async, [this, filePath, mipOptions, compressionOptions]() {
+			TextureData texture;
+			std::lock_guard<std::mutex> lock(poolMutex);
+			if (!textureCache->Load(pool, archive, filePath, mipOptions, compressionOptions, texture)) {
+				texture = TextureData();
+			}
+			return texture;
+		});
+	}
+
+	return Then(LoadTexture(filePath), [this, mipOptions, compressionOptions](TextureData texture) {
+		TextureData compressed;
+		if (texture.pixels.empty()) {
+			return compressed;
+		}
+
+		std::lock_guard<std::mutex> lock(poolMutex);
+		PadToBlocks(texture);
+		BuildMipChain(pool, mipOptions, texture);
+		if (!CompressTexture(pool, compressionOptions, texture, compressed)) {
+			compressed = TextureData();
+		}
+		return compressed;
+	});
+}
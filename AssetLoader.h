@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "AssetArchive.h"
+#include "BlockCompression.h"
+#include "MipChain.h"
+#include "TextureCache.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+/// <summary>
+/// Checks whether a future holds its value without blocking. Futures whose value was taken are never ready.
+/// </summary>
+template <typename T>
+bool IsReady(const std::future<T>& future) {
+	return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+/// <summary>
+/// Chains work onto a future, continuation(previous.get()) runs on a worker thread as soon as previous is ready.
+/// </summary>
+/// <param name="previous">- The future the continuation consumes.</param>
+/// <param name="continuation">- The work to run on its value.</param>
+/// <returns>A future for the value returned by the continuation.</returns>
+template <typename T, typename Function>
+auto Then(std::future<T> previous, Function continuation) -> std::future<decltype(continuation(std::declval<T>()))> {
+	return std::async(std::launch::async, [previous = std::move(previous), continuation = std::move(continuation)]() mutable {
+		return continuation(previous.get());
+	});
+}
+
+// Loads assets on worker threads so startup does not wait for them. Every load returns a future and stages chain
+// with Then(), a failed stage prints why and passes on an empty result: an AssetData not loaded, a TextureData without pixels.
+// Assets come from the archive when one is open and holds them, otherwise from loose files in the working directory.
+// Image decoding and mip building share the loader's own pool, so they do not compete with the renderer's pool for jobs.
+// The loader must outlive the futures it returned.
+class AssetLoader {
+public:
+	/// <summary>
+	/// Starts the loader's pool.
+	/// </summary>
+	/// <param name="threadCount">- Threads decoding images, including the loading thread, 0 uses all hardware threads.</param>
+	explicit AssetLoader(uint32_t threadCount = 0);
+
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	/// <summary>
+	/// Opens the archive later loads look in first. Call it before starting any load.
+	/// </summary>
+	/// <param name="filePath">- Path of the archive.</param>
+	/// <returns>True if the archive was opened, otherwise false.</returns>
+	bool OpenArchive(const std::string& filePath);
+
+	/// <summary>
+	/// Keeps decoded textures with their mips in a TextureCache, both LoadTexture() overloads building mips read them,
+	/// compressed or not, from it when the image has not changed. Call it before starting any load.
+	/// </summary>
+	/// <param name="directory">- Directory of the cache files.</param>
+	void EnableTextureCache(const std::string& directory);
+
+	/// <summary>
+	/// Returns the texture cache counters, all zero when the cache is not enabled.
+	/// </summary>
+	TextureCacheStats GetTextureCacheStats() const;
+
+	/// <summary>
+	/// Fetches an asset on a worker thread, see LoadAsset().
+	/// </summary>
+	/// <param name="name">- Asset name, which is also its loose file path.</param>
+	/// <returns>The asset, not loaded if it could not be found.</returns>
+	std::future<AssetData> LoadFile(const std::string& name);
+
+	/// <summary>
+	/// Fetches and decodes an image to RGBA on worker threads, see LoadTextureData().
+	/// </summary>
+	/// <param name="filePath">- Asset name of the image.</param>
+	/// <returns>The texture, without pixels if it could not be loaded.</returns>
+	std::future<TextureData> LoadTexture(const std::string& filePath);
+
+	/// <summary>
+	/// Fetches and decodes an image like LoadTexture(filePath), then builds its mip chain with BuildMipChain().
+	/// </summary>
+	/// <param name="filePath">- Asset name of the image.</param>
+	/// <param name="mipOptions">- How the mip levels are filtered.</param>
+	/// <returns>The texture with its mips, without pixels if it could not be loaded.</returns>
+	std::future<TextureData> LoadTexture(const std::string& filePath, const MipChainOptions& mipOptions);
+
+	/// <summary>
+	/// Loads an image with its mips like LoadTexture(filePath, mipOptions), then block compresses every level with CompressTexture().
+	/// The base level is padded to whole blocks before the mips are built, as Direct3D requires. With the texture cache enabled
+	/// the compressed levels are read from it when the image has not changed.
+	/// </summary>
+	/// <param name="filePath">- Asset name of the image.</param>
+	/// <param name="mipOptions">- How the mip levels are filtered.</param>
+	/// <param name="compressionOptions">- Format and quality of the blocks.</param>
+	/// <returns>The compressed texture with its mips, without pixels if it could not be loaded or compressed.</returns>
+	std::future<TextureData> LoadTexture(const std::string& filePath, const MipChainOptions& mipOptions, const BlockCompressionOptions& compressionOptions);
+
+private:
+	TextureData DecodeTexture(const AssetData& file, const std::string& filePath);
+
+	AssetArchive archive;
+	std::unique_ptr<TextureCache> textureCache;
+	ThreadPool pool;
+	std::mutex poolMutex; // the pool runs one ParallelFor() at a time
+};
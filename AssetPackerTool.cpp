@@ -0,0 +1,85 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "AssetArchive.h"
+#include "FileView.h"
+
+// Offline tool packing loose asset files into one archive, names are the paths as given
+int main(int argc, char** argv) {
+	bool compress = false;
+	std::string outputPath;
+	std::vector<std::string> inputPaths;
+
+	// Parse command line options
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--compress") == 0) {
+			compress = true;
+		}
+		else if (argv[i][0] != '-' && outputPath.empty()) {
+			outputPath = argv[i];
+		}
+		else if (argv[i][0] != '-') {
+			inputPaths.push_back(argv[i]);
+		}
+		else {
+			outputPath.clear();
+			break;
+		}
+	}
+
+	if (outputPath.empty() || inputPaths.empty()) {
+		std::cerr << "Usage: " << argv[0] << " output.pack [--compress] file..." << std::endl;
+		return -1;
+	}
+
+	// Map every input, the archive is written straight from the mappings
+	std::vector<FileView> files(inputPaths.size());
+	std::vector<AssetArchiveInput> inputs(inputPaths.size());
+	for (size_t i = 0; i < inputPaths.size(); ++i) {
+		if (!files[i].Open(inputPaths[i], FileAccess::Sequential)) {
+			return -1;
+		}
+		inputs[i].name = inputPaths[i];
+		for (char& c : inputs[i].name) {
+			if (c == '\\') {
+				c = '/';
+			}
+		}
+		inputs[i].data = files[i].Data();
+		inputs[i].size = files[i].Size();
+		inputs[i].format = GetAssetFormat(inputPaths[i]);
+		inputs[i].compress = compress;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	if (!WriteAssetArchive(outputPath, inputs)) {
+		std::cerr << "Failed to write archive!" << std::endl;
+		return -1;
+	}
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	// Report what went in by reading the archive back
+	AssetArchive archive;
+	if (!archive.Open(outputPath)) {
+		return -1;
+	}
+	const char* FORMAT_NAMES[] = { "raw", "shader", "image", "mesh" };
+	uint64_t totalSize = 0;
+	uint64_t totalStored = 0;
+	for (uint32_t i = 0; i < archive.EntryCount(); ++i) {
+		const ArchiveEntry& entry = archive.Entries()[i];
+		std::printf("%-32s %-6s %10llu bytes, stored %10llu (%s) at %llu\n", archive.GetName(entry).c_str(), FORMAT_NAMES[static_cast<uint32_t>(entry.format)],
+			static_cast<unsigned long long>(entry.size), static_cast<unsigned long long>(entry.storedSize),
+			entry.compression == AssetCompression::LZ ? "lz" : "none", static_cast<unsigned long long>(entry.offset));
+		totalSize += entry.size;
+		totalStored += entry.storedSize;
+	}
+	std::printf("%u assets, %llu bytes stored as %llu in %.1f ms\n", archive.EntryCount(), static_cast<unsigned long long>(totalSize),
+		static_cast<unsigned long long>(totalStored), elapsed.count());
+
+	return 0;
+}
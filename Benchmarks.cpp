@@ -0,0 +1,1560 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AssetArchive.h"
+#include "AssetLoader.h"
+#include "BlockCompression.h"
+#include "FileView.h"
+#include "Geometry.h"
+#include "HardwareCounters.h"
+#include "MeshFile.h"
+#include "MipChain.h"
+#include "PackedVertex.h"
+#include "PixelShading.h"
+#include "ShaderCache.h"
+#include "ShaderConstants.h"
+#include "SoftwareRenderer.h"
+#include "SoftwareShader.h"
+#include "TexelCache.h"
+#include "TextureCache.h"
+#include "TextureLayout.h"
+#include "TextureLoader.h"
+#include "TextureSampler.h"
+#include "VertexProcessing.h"
+#include "stb_image.h"
+
+// Function to measure the vertex stage throughput of every available SIMD level on a large random buffer
+static void BenchmarkVertices(ThreadPool& pool, uint32_t vertexCount, const VertexShaderConstants& constants) {
+	const int ITERATIONS = 10;
+
+	// Fixed seed so runs are comparable
+	std::vector<SimpleVertex> vertices;
+	vertices.reserve(vertexCount);
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	for (uint32_t i = 0; i < vertexCount; ++i) {
+		vertices.emplace_back(std::array<float, 3>{ distribution(random), distribution(random), distribution(random) },
+			std::array<float, 3>{ distribution(random), distribution(random), distribution(random) },
+			std::array<float, 2>{ distribution(random), distribution(random) });
+	}
+
+	std::vector<ShadedVertex> reference(vertexCount);
+	std::vector<ShadedVertex> shaded(vertexCount);
+	ProcessVertices(pool, ShadeVerticesScalar, vertices.data(), vertexCount, constants, reference.data());
+
+	for (int level = 0; level <= static_cast<int>(DetectSimdLevel()); ++level) {
+		ShadeVerticesFunction kernel = SelectShadeVertices(static_cast<SimdLevel>(level));
+		ProcessVertices(pool, kernel, vertices.data(), vertexCount, constants, shaded.data());
+		bool identical = std::memcmp(shaded.data(), reference.data(), sizeof(ShadedVertex) * vertexCount) == 0;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < ITERATIONS; ++i) {
+			ProcessVertices(pool, kernel, vertices.data(), vertexCount, constants, shaded.data());
+		}
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+		double verticesPerSecond = static_cast<double>(vertexCount) * ITERATIONS / elapsed.count();
+		std::printf("Vertex stage %-6s: %8.1f M vertices/s on %u threads (%s scalar output)\n", SimdLevelName(static_cast<SimdLevel>(level)),
+			verticesPerSecond * 1e-6, pool.WorkerCount(), identical ? "matches" : "differs from");
+	}
+
+	// The same vertices in the packed layout, decoded right before the transform
+	std::vector<PackedVertex> packed;
+	PackedVertexBounds bounds;
+	PackVertices(vertices, packed, bounds);
+	std::vector<ShadedVertex> packedReference(vertexCount);
+	ProcessPackedVertices(pool, UnpackVerticesScalar, ShadeVerticesScalar, packed.data(), vertexCount, bounds, constants, packedReference.data());
+
+	float maxError = 0.0f;
+	for (uint32_t i = 0; i < vertexCount; ++i) {
+		for (int axis = 0; axis < 3; ++axis) {
+			maxError = std::max(maxError, std::fabs(packedReference[i].worldPosition[axis] - reference[i].worldPosition[axis]));
+		}
+	}
+	std::printf("Packed layout: %zu bytes per vertex instead of %zu (%.1f MB instead of %.1f MB), max world position error %g\n",
+		sizeof(PackedVertex), sizeof(SimpleVertex), sizeof(PackedVertex) * vertexCount / 1048576.0, sizeof(SimpleVertex) * vertexCount / 1048576.0, maxError);
+
+	for (int level = 0; level <= static_cast<int>(DetectSimdLevel()); ++level) {
+		UnpackVerticesFunction unpack = SelectUnpackVertices(static_cast<SimdLevel>(level));
+		ShadeVerticesFunction kernel = SelectShadeVertices(static_cast<SimdLevel>(level));
+		ProcessPackedVertices(pool, unpack, kernel, packed.data(), vertexCount, bounds, constants, shaded.data());
+		bool identical = std::memcmp(shaded.data(), packedReference.data(), sizeof(ShadedVertex) * vertexCount) == 0;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < ITERATIONS; ++i) {
+			ProcessPackedVertices(pool, unpack, kernel, packed.data(), vertexCount, bounds, constants, shaded.data());
+		}
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+		double verticesPerSecond = static_cast<double>(vertexCount) * ITERATIONS / elapsed.count();
+		std::printf("Vertex stage %-6s packed: %8.1f M vertices/s on %u threads (%s scalar output)\n", SimdLevelName(static_cast<SimdLevel>(level)),
+			verticesPerSecond * 1e-6, pool.WorkerCount(), identical ? "matches" : "differs from");
+	}
+}
+
+// Function to measure the mip chain build time of every filter, color space and SIMD level
+static void BenchmarkMipChain(ThreadPool& pool, TextureData& texture) {
+	const int ITERATIONS = 5;
+	double megapixels = static_cast<double>(texture.width) * texture.height * 1e-6;
+
+	for (int filter = 0; filter <= static_cast<int>(MipFilter::Kaiser); ++filter) {
+		for (int gamma = 0; gamma <= 1; ++gamma) {
+			MipChainOptions options;
+			options.filter = static_cast<MipFilter>(filter);
+			options.gammaCorrect = gamma != 0;
+			options.simdLevel = SimdLevel::Scalar;
+			BuildMipChain(pool, options, texture);
+			std::vector<TextureMipLevel> reference = texture.mips;
+
+			for (int level = 0; level <= static_cast<int>(std::min(DetectSimdLevel(), SimdLevel::AVX2)); ++level) {
+				options.simdLevel = static_cast<SimdLevel>(level);
+				auto start = std::chrono::high_resolution_clock::now();
+				for (int i = 0; i < ITERATIONS; ++i) {
+					BuildMipChain(pool, options, texture);
+				}
+				std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+				bool identical = texture.mips.size() == reference.size();
+				for (size_t mip = 0; identical && mip < reference.size(); ++mip) {
+					identical = texture.mips[mip].pixels == reference[mip].pixels;
+				}
+
+				double milliseconds = elapsed.count() / ITERATIONS;
+				std::printf("Mip chain %-6s %-6s %-6s: %zu levels in %6.2f ms, %6.2f ms per megapixel on %u threads (%s scalar output)\n",
+					options.filter == MipFilter::Box ? "box" : "kaiser", options.gammaCorrect ? "srgb" : "linear", SimdLevelName(options.simdLevel),
+					texture.mips.size() + 1, milliseconds, milliseconds / megapixels, pool.WorkerCount(), identical ? "matches" : "differs from");
+			}
+		}
+	}
+}
+
+// Function to compare the decode of the old load path, decode then repack into RGBA, against decoding straight into the texture
+// on the calling thread and across the pool
+static void BenchmarkTextureLoad(ThreadPool& pool, const std::string& filePath) {
+	const int ITERATIONS = 3;
+
+	int width, height, channels;
+	if (!stbi_info(filePath.c_str(), &width, &height, &channels)) {
+		std::cerr << "Failed to load image: " << filePath << std::endl;
+		return;
+	}
+	size_t textureBytes = static_cast<size_t>(width) * height * 4;
+	std::printf("%s: %dx%d, %d channels, %.1f MB as RGBA\n", filePath.c_str(), width, height, channels, textureBytes / 1048576.0);
+
+	// Decode to the file's channel count, then expand into a separate RGBA buffer
+	double repackMilliseconds = 0.0;
+	size_t repackPeak = 0;
+	std::vector<unsigned char> repackPixels;
+	for (int i = 0; i < ITERATIONS; ++i) {
+		repackPixels = std::vector<unsigned char>();
+		ResetDecoderPeakMemory();
+		size_t baseline = GetDecoderMemory().currentBytes;
+		auto start = std::chrono::high_resolution_clock::now();
+
+		unsigned char* imageData = stbi_load(filePath.c_str(), &width, &height, &channels, 0);
+		if (imageData == nullptr) {
+			std::cerr << "Failed to load image: " << filePath << std::endl;
+			return;
+		}
+		size_t decodedBytes = GetDecoderMemory().currentBytes - baseline;
+		repackPixels.resize(textureBytes);
+		for (size_t texel = 0, source = 0; texel < textureBytes; texel += 4, source += channels) {
+			repackPixels[texel + 0] = imageData[source];
+			repackPixels[texel + 1] = imageData[source + (channels >= 3 ? 1 : 0)];
+			repackPixels[texel + 2] = imageData[source + (channels >= 3 ? 2 : 0)];
+			repackPixels[texel + 3] = 255;
+		}
+		stbi_image_free(imageData);
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		repackMilliseconds += elapsed.count();
+		repackPeak = std::max(GetDecoderMemory().peakBytes - baseline, decodedBytes + textureBytes);
+	}
+
+	// Decode straight into the texture
+	double directMilliseconds = 0.0;
+	size_t directPeak = 0;
+	TextureData texture;
+	for (int i = 0; i < ITERATIONS; ++i) {
+		texture = TextureData();
+		ResetDecoderPeakMemory();
+		size_t baseline = GetDecoderMemory().currentBytes;
+		auto start = std::chrono::high_resolution_clock::now();
+
+		if (!LoadTextureData(filePath, texture)) {
+			return;
+		}
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		directMilliseconds += elapsed.count();
+		directPeak = GetDecoderMemory().peakBytes - baseline + textureBytes;
+	}
+
+	// Decode straight into the texture with restart intervals and row bands spread across the pool
+	double parallelMilliseconds = 0.0;
+	size_t parallelPeak = 0;
+	TextureData parallelTexture;
+	for (int i = 0; i < ITERATIONS; ++i) {
+		parallelTexture = TextureData();
+		ResetDecoderPeakMemory();
+		size_t baseline = GetDecoderMemory().currentBytes;
+		auto start = std::chrono::high_resolution_clock::now();
+
+		if (!LoadTextureData(pool, filePath, parallelTexture)) {
+			return;
+		}
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		parallelMilliseconds += elapsed.count();
+		parallelPeak = GetDecoderMemory().peakBytes - baseline + textureBytes;
+	}
+
+	bool identical = std::memcmp(repackPixels.data(), texture.pixels.data(), textureBytes) == 0;
+	bool parallelIdentical = parallelTexture.pixels == texture.pixels;
+	std::printf("Decode and repack: %8.1f ms, peak %7.1f MB\n", repackMilliseconds / ITERATIONS, repackPeak / 1048576.0);
+	std::printf("Decode in place:   %8.1f ms, peak %7.1f MB (%s repacked texels)\n", directMilliseconds / ITERATIONS, directPeak / 1048576.0,
+		identical ? "matches" : "differs from");
+	std::printf("Decode parallel:   %8.1f ms, peak %7.1f MB on %u threads (%s serial texels)\n", parallelMilliseconds / ITERATIONS, parallelPeak / 1048576.0,
+		pool.WorkerCount(), parallelIdentical ? "matches" : "differs from");
+}
+
+// Function to measure JPEG decode throughput over a corpus with each kernel set, checked against the SSE2 output
+static void BenchmarkJpegKernels(const std::vector<std::string>& corpus) {
+	const int ITERATIONS = 3;
+	const int LEVELS[] = { 1, 0, 2 }; // SSE2 first, it is the reference
+	const char* LEVEL_NAMES[] = { "c", "sse2", "avx2" };
+
+	// Keep the whole corpus in memory so only decoding is timed
+	std::vector<std::string> files(corpus.size());
+	for (size_t i = 0; i < corpus.size(); ++i) {
+		std::ifstream file(corpus[i], std::ios::binary);
+		if (!file) {
+			std::cerr << "Could not open file: " << corpus[i] << std::endl;
+			return;
+		}
+		files[i].assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	std::vector<TexelBuffer> reference(files.size());
+	for (int level : LEVELS) {
+		stbi_set_jpeg_simd_level(level);
+		double totalSeconds = 0.0;
+		double totalBytes = 0.0;
+		double totalPixels = 0.0;
+		bool identical = true;
+
+		for (size_t i = 0; i < files.size(); ++i) {
+			const stbi_uc* data = reinterpret_cast<const stbi_uc*>(files[i].data());
+			int length = static_cast<int>(files[i].size());
+			int width, height, channels;
+			if (!stbi_info_from_memory(data, length, &width, &height, &channels)) {
+				std::cerr << "Failed to load image: " << corpus[i] << std::endl;
+				continue;
+			}
+
+			TexelBuffer pixels(static_cast<size_t>(width) * height * 4);
+			auto start = std::chrono::high_resolution_clock::now();
+			for (int iteration = 0; iteration < ITERATIONS; ++iteration) {
+				if (!stbi_load_from_memory_into(data, length, pixels.data(), pixels.size(), &width, &height, &channels, 4)) {
+					std::cerr << "Failed to load image: " << corpus[i] << std::endl;
+					break;
+				}
+			}
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+			if (reference[i].empty()) {
+				reference[i] = pixels;
+			}
+			identical = identical && pixels == reference[i];
+			totalSeconds += elapsed.count();
+			totalBytes += static_cast<double>(length) * ITERATIONS;
+			totalPixels += static_cast<double>(width) * height * ITERATIONS;
+			std::printf("%-40s %-4s: %8.1f MB/s, %7.1f Mpixels/s\n", corpus[i].c_str(), LEVEL_NAMES[level],
+				length * ITERATIONS / elapsed.count() / 1048576.0, static_cast<double>(width) * height * ITERATIONS / elapsed.count() * 1e-6);
+		}
+
+		std::printf("Corpus of %zu JPEGs %-4s: %8.1f MB/s compressed, %7.1f Mpixels/s (%s SSE2 output)\n", files.size(), LEVEL_NAMES[level],
+			totalBytes / totalSeconds / 1048576.0, totalPixels / totalSeconds * 1e-6, identical ? "matches" : "differs from");
+	}
+	stbi_set_jpeg_simd_level(2);
+}
+
+// Function to measure the reduced-size JPEG decode at every scale against the full decode, with the PSNR
+// against a box-filtered downsample of the full size image
+static void BenchmarkScaledLoad(const std::string& filePath) {
+	const int ITERATIONS = 5;
+	double fullMilliseconds = 0.0;
+	TextureData full;
+
+	for (int scaleShift = 0; scaleShift <= 3; ++scaleShift) {
+		TextureData texture;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < ITERATIONS; ++i) {
+			if (!LoadTextureDataScaled(filePath, scaleShift, texture)) {
+				return;
+			}
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		double milliseconds = elapsed.count() / ITERATIONS;
+
+		if (scaleShift == 0) {
+			full = texture;
+			fullMilliseconds = milliseconds;
+			std::printf("Scale 1/1: %5dx%-5d %8.2f ms\n", texture.width, texture.height, milliseconds);
+			continue;
+		}
+
+		// Box filter the full decode over the same footprint, edge texels average what is left
+		int scale = 1 << scaleShift;
+		double squaredError = 0.0;
+		for (int y = 0; y < texture.height; ++y) {
+			for (int x = 0; x < texture.width; ++x) {
+				for (int channel = 0; channel < 3; ++channel) {
+					int sum = 0;
+					int count = 0;
+					for (int sy = y * scale; sy < std::min((y + 1) * scale, full.height); ++sy) {
+						for (int sx = x * scale; sx < std::min((x + 1) * scale, full.width); ++sx) {
+							sum += full.pixels[(static_cast<size_t>(sy) * full.width + sx) * 4 + channel];
+							++count;
+						}
+					}
+					double difference = static_cast<double>(sum) / count - texture.pixels[(static_cast<size_t>(y) * texture.width + x) * 4 + channel];
+					squaredError += difference * difference;
+				}
+			}
+		}
+		double meanSquaredError = squaredError / (3.0 * texture.width * texture.height);
+		double psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+
+		std::printf("Scale 1/%d: %5dx%-5d %8.2f ms, %5.1fx faster than full size, %5.1f dB PSNR against a box filtered full decode\n",
+			scale, texture.width, texture.height, milliseconds, fullMilliseconds / milliseconds, psnr);
+	}
+}
+
+// Kernel read counters of the process, /proc/self/io on Linux, unavailable elsewhere
+struct ProcessReadCounters {
+	uint64_t readCalls = 0;  // read-type system calls
+	uint64_t bytesRead = 0;  // bytes the kernel copied out to user buffers
+	bool available = false;
+};
+
+// Function to sample the process read counters
+static ProcessReadCounters ReadProcessCounters() {
+	ProcessReadCounters counters;
+	std::ifstream io("/proc/self/io");
+	std::string name;
+	uint64_t value;
+	while (io >> name >> value) {
+		if (name == "syscr:") {
+			counters.readCalls = value;
+			counters.available = true;
+		}
+		else if (name == "rchar:") {
+			counters.bytesRead = value;
+		}
+	}
+	return counters;
+}
+
+// Function to measure the system calls and byte copies of loading files through streams and stdio against mapping them.
+// Shaders were read into a string and copied for the input layout, images were decoded through stbi's stdio callbacks,
+// which copy every byte from the kernel into the FILE buffer and again into the decoder's buffer.
+static void BenchmarkFileLoad(const std::vector<std::string>& paths) {
+	const int ITERATIONS = 10;
+
+	// Sampling the counters reads a file itself, measure that once and leave it out
+	ProcessReadCounters first = ReadProcessCounters();
+	ProcessReadCounters second = ReadProcessCounters();
+	uint64_t sampleCalls = second.readCalls - first.readCalls;
+	uint64_t sampleBytes = second.bytesRead - first.bytesRead;
+	if (!first.available) {
+		std::printf("/proc/self/io is unavailable, stream and stdio system calls are not counted\n");
+	}
+
+	for (const std::string& path : paths) {
+		// Old shader path: read the file into a string through a stream and copy it for the input layout
+		uint64_t streamChecksum = 0;
+		size_t fileSize = 0;
+		ProcessReadCounters before = ReadProcessCounters();
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < ITERATIONS; ++i) {
+			std::ifstream reader(path, std::ios::binary | std::ios::ate);
+			if (!reader.is_open()) {
+				std::cerr << "Could not open file: " << path << std::endl;
+				return;
+			}
+			std::string fileData(static_cast<size_t>(reader.tellg()), '\0');
+			reader.seekg(0, std::ios::beg);
+			reader.read(&fileData[0], fileData.size());
+			std::string byteCode = fileData;
+			fileSize = byteCode.size();
+			streamChecksum = 0;
+			for (char byte : byteCode) {
+				streamChecksum = streamChecksum * 31 + static_cast<unsigned char>(byte);
+			}
+		}
+		std::chrono::duration<double, std::milli> streamElapsed = std::chrono::high_resolution_clock::now() - start;
+		ProcessReadCounters after = ReadProcessCounters();
+		double streamCalls = static_cast<double>(after.readCalls - before.readCalls - sampleCalls) / ITERATIONS;
+		double streamCopied = static_cast<double>(after.bytesRead - before.bytesRead - sampleBytes) / ITERATIONS + fileSize;
+
+		// Mapped: the bytes are read in place
+		uint64_t viewChecksum = 0;
+		FileViewStats viewBefore = GetFileViewStats();
+		before = ReadProcessCounters();
+		start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < ITERATIONS; ++i) {
+			FileView view;
+			if (!view.Open(path, FileAccess::Sequential)) {
+				return;
+			}
+			viewChecksum = 0;
+			for (size_t byte = 0; byte < view.Size(); ++byte) {
+				viewChecksum = viewChecksum * 31 + view.Data()[byte];
+			}
+		}
+		std::chrono::duration<double, std::milli> viewElapsed = std::chrono::high_resolution_clock::now() - start;
+		after = ReadProcessCounters();
+		FileViewStats viewAfter = GetFileViewStats();
+		double viewCalls = static_cast<double>(viewAfter.systemCalls - viewBefore.systemCalls + after.readCalls - before.readCalls - sampleCalls) / ITERATIONS;
+		double viewCopied = static_cast<double>(after.bytesRead - before.bytesRead - sampleBytes) / ITERATIONS;
+
+		std::printf("%s: %zu bytes\n", path.c_str(), fileSize);
+		std::printf("  Stream read and copy: %8.3f ms, %6.0f read calls,   %9.1f KB copied\n", streamElapsed.count() / ITERATIONS, streamCalls, streamCopied / 1024.0);
+		std::printf("  Mapped view:          %8.3f ms, %6.0f system calls, %9.1f KB copied (%s stream bytes)\n", viewElapsed.count() / ITERATIONS, viewCalls, viewCopied / 1024.0,
+			viewChecksum == streamChecksum ? "matches" : "differs from");
+
+		// Images also go through the decoder, the old loader read them with stdio
+		int width, height, channels;
+		if (!stbi_info(path.c_str(), &width, &height, &channels)) {
+			continue;
+		}
+		TexelBuffer stdioPixels(static_cast<size_t>(width) * height * 4);
+		before = ReadProcessCounters();
+		start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < ITERATIONS; ++i) {
+			if (!stbi_info(path.c_str(), &width, &height, &channels) ||
+				!stbi_load_into(path.c_str(), stdioPixels.data(), stdioPixels.size(), &width, &height, &channels, 4)) {
+				std::cerr << "Failed to load image: " << path << std::endl;
+				return;
+			}
+		}
+		std::chrono::duration<double, std::milli> stdioElapsed = std::chrono::high_resolution_clock::now() - start;
+		after = ReadProcessCounters();
+		double stdioCalls = static_cast<double>(after.readCalls - before.readCalls - sampleCalls) / ITERATIONS;
+		double stdioCopied = 2.0 * static_cast<double>(after.bytesRead - before.bytesRead - sampleBytes) / ITERATIONS;
+
+		TextureData texture;
+		viewBefore = GetFileViewStats();
+		before = ReadProcessCounters();
+		start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < ITERATIONS; ++i) {
+			if (!LoadTextureData(path, texture)) {
+				return;
+			}
+		}
+		std::chrono::duration<double, std::milli> mappedElapsed = std::chrono::high_resolution_clock::now() - start;
+		after = ReadProcessCounters();
+		viewAfter = GetFileViewStats();
+		double mappedCalls = static_cast<double>(viewAfter.systemCalls - viewBefore.systemCalls + after.readCalls - before.readCalls - sampleCalls) / ITERATIONS;
+		double mappedCopied = static_cast<double>(after.bytesRead - before.bytesRead - sampleBytes) / ITERATIONS;
+
+		// Alpha is forced opaque by the loader only
+		for (size_t texel = 3; texel < stdioPixels.size(); texel += 4) {
+			stdioPixels[texel] = 255;
+		}
+		std::printf("  Decode through stdio: %8.3f ms, %6.0f read calls,   %9.1f KB copied\n", stdioElapsed.count() / ITERATIONS, stdioCalls, stdioCopied / 1024.0);
+		std::printf("  Decode mapped:        %8.3f ms, %6.0f system calls, %9.1f KB copied (%s stdio texels)\n", mappedElapsed.count() / ITERATIONS, mappedCalls, mappedCopied / 1024.0,
+			texture.pixels == stdioPixels ? "matches" : "differs from");
+	}
+}
+
+// Function to compare time to first frame and total load time of loading the texture before rendering against loading it
+// in the background while frames render with a placeholder, with the file evicted from the page cache and cached.
+// Frames are paced to 60 Hz like a presented swap chain, so the render loop leaves the loader the rest of each frame.
+static void BenchmarkStartup(SoftwareContext& context, SoftwareFramebuffer& framebuffer, const SoftwareViewport& viewport, const Mesh& mesh,
+	VertexShaderConstants& vsConstants, const PixelShaderConstants& psConstants, const std::string& filePath) {
+	typedef std::chrono::steady_clock Clock;
+	const std::chrono::microseconds FRAME_TIME(16667);
+	AssetLoader loader;
+	TextureData placeholder;
+	placeholder.width = 1;
+	placeholder.height = 1;
+	placeholder.pixels.assign(4, 128);
+	placeholder.pixels[3] = 255;
+
+	for (int cold = 1; cold >= 0; --cold) {
+		const char* cache = cold ? "Cold" : "Warm";
+		if (cold && !EvictFileCache(filePath)) {
+			std::printf("Could not evict %s from the page cache, the cold run is warm\n", filePath.c_str());
+		}
+
+		// Blocking: read, decode and build the mips, then render
+		auto start = Clock::now();
+		TextureData texture;
+		if (!LoadTextureData(*context.pool, filePath, texture)) {
+			return;
+		}
+		BuildMipChain(*context.pool, MipChainOptions(), texture);
+		std::chrono::duration<double, std::milli> blockingLoad = Clock::now() - start;
+		SoftwareRender(context, framebuffer, viewport, mesh, vsConstants, psConstants, texture);
+		std::chrono::duration<double, std::milli> blockingFirstFrame = Clock::now() - start;
+
+		if (cold) {
+			EvictFileCache(filePath);
+		}
+
+		// Asynchronous: render the placeholder until the loader delivers the texture
+		start = Clock::now();
+		std::future<TextureData> pending = loader.LoadTexture(filePath, MipChainOptions());
+		std::chrono::duration<double, std::milli> asyncFirstFrame{ 0.0 };
+		std::chrono::duration<double, std::milli> asyncLoad{ 0.0 };
+		uint32_t placeholderFrames = 0;
+		while (true) {
+			bool ready = IsReady(pending);
+			if (ready) {
+				texture = pending.get();
+				if (texture.pixels.empty()) {
+					return;
+				}
+				asyncLoad = Clock::now() - start;
+			}
+			SoftwareRender(context, framebuffer, viewport, mesh, vsConstants, psConstants, ready ? texture : placeholder);
+			if (placeholderFrames == 0 && !ready) {
+				asyncFirstFrame = Clock::now() - start;
+			}
+			if (ready) {
+				break;
+			}
+			++placeholderFrames;
+			std::this_thread::sleep_until(start + FRAME_TIME * placeholderFrames);
+		}
+		if (placeholderFrames == 0) {
+			asyncFirstFrame = Clock::now() - start;
+		}
+
+		std::printf("%s cache, blocking:     first frame %8.2f ms, texture loaded %8.2f ms\n", cache, blockingFirstFrame.count(), blockingLoad.count());
+		std::printf("%s cache, asynchronous: first frame %8.2f ms, texture loaded %8.2f ms, %u placeholder frames\n", cache, asyncFirstFrame.count(),
+			asyncLoad.count(), placeholderFrames);
+	}
+}
+
+// Function to measure opening an archive, looking up every asset and fetching it, against mapping the loose files
+static void BenchmarkArchive(const std::string& filePath) {
+	typedef std::chrono::high_resolution_clock Clock;
+	const int ITERATIONS = 1000;
+
+	auto start = Clock::now();
+	AssetArchive archive;
+	if (!archive.Open(filePath)) {
+		return;
+	}
+	std::chrono::duration<double, std::micro> openTime = Clock::now() - start;
+	std::printf("%s: %u assets, opened in %.1f us\n", filePath.c_str(), archive.EntryCount(), openTime.count());
+
+	std::vector<std::string> names(archive.EntryCount());
+	for (uint32_t i = 0; i < archive.EntryCount(); ++i) {
+		names[i] = archive.GetName(archive.Entries()[i]);
+	}
+
+	// Lookups only, the hash table probe
+	start = Clock::now();
+	size_t found = 0;
+	for (int iteration = 0; iteration < ITERATIONS; ++iteration) {
+		for (const std::string& name : names) {
+			found += archive.Find(name) != nullptr;
+		}
+	}
+	std::chrono::duration<double, std::nano> findTime = Clock::now() - start;
+	std::printf("Lookup: %.1f ns per asset (%zu of %zu found)\n", findTime.count() / (static_cast<double>(ITERATIONS) * names.size()),
+		found, static_cast<size_t>(ITERATIONS) * names.size());
+
+	for (const std::string& name : names) {
+		const ArchiveEntry* entry = archive.Find(name);
+		AssetData asset;
+		int fetches = entry->compression == AssetCompression::LZ ? 20 : ITERATIONS;
+		start = Clock::now();
+		for (int iteration = 0; iteration < fetches; ++iteration) {
+			if (!archive.Load(name, asset)) {
+				return;
+			}
+		}
+		std::chrono::duration<double, std::micro> fetchTime = Clock::now() - start;
+
+		// The same asset as a loose file, when it is next to the archive
+		std::string looseResult = "no loose file";
+		FileView loose;
+		if (std::ifstream(name).good()) {
+			start = Clock::now();
+			for (int iteration = 0; iteration < ITERATIONS; ++iteration) {
+				loose.Open(name, FileAccess::Sequential);
+			}
+			std::chrono::duration<double, std::micro> looseTime = Clock::now() - start;
+			char text[96];
+			std::snprintf(text, sizeof(text), "loose file mapped in %.2f us, %s", looseTime.count() / ITERATIONS,
+				loose.Size() == asset.size && std::memcmp(loose.Data(), asset.data, asset.size) == 0 ? "identical" : "different");
+			looseResult = text;
+		}
+
+		double microseconds = fetchTime.count() / fetches;
+		if (entry->compression == AssetCompression::LZ) {
+			std::printf("  %-28s %10zu bytes lz   fetched in %9.2f us, %7.1f MB/s decompressed, %s\n", name.c_str(), asset.size,
+				microseconds, asset.size / microseconds / 1.048576, looseResult.c_str());
+		}
+		else {
+			std::printf("  %-28s %10zu bytes none fetched in %9.2f us, in place, %s\n", name.c_str(), asset.size, microseconds, looseResult.c_str());
+		}
+	}
+}
+
+// Function to measure the texture cache: a miss that decodes and fills it, hits that map it, and a hit after the source
+// was touched, which has to hash the source to revalidate the entry
+static void BenchmarkTextureCache(ThreadPool& pool, const std::string& filePath) {
+	const int HITS = 5;
+	TextureCache cache("TextureCache");
+	AssetArchive archive;
+	MipChainOptions options;
+	std::error_code error;
+	std::filesystem::remove(cache.GetEntryPath(filePath, options), error);
+
+	TextureData decoded;
+	if (!cache.Load(pool, archive, filePath, options, decoded)) {
+		return;
+	}
+
+	TextureData cached;
+	bool identical = true;
+	for (int i = 0; i < HITS; ++i) {
+		cached = TextureData();
+		if (!cache.Load(pool, archive, filePath, options, cached)) {
+			return;
+		}
+		identical = identical && cached.pixels == decoded.pixels && cached.mips.size() == decoded.mips.size();
+		for (size_t level = 0; identical && level < cached.mips.size(); ++level) {
+			identical = cached.mips[level].pixels == decoded.mips[level].pixels;
+		}
+	}
+
+	// A new write time with the same content
+	std::filesystem::last_write_time(filePath, std::filesystem::file_time_type::clock::now(), error);
+	if (!cache.Load(pool, archive, filePath, options, cached)) {
+		return;
+	}
+
+	TextureCacheStats stats = cache.GetStats();
+	uint64_t loads = stats.hits + stats.misses;
+	double missMilliseconds = stats.missMilliseconds / std::max<uint64_t>(stats.misses, 1);
+	double hitMilliseconds = stats.hitMilliseconds / std::max<uint64_t>(stats.hits, 1);
+	std::printf("%s: %dx%d with %zu mips, %.1f MB cache entry\n", filePath.c_str(), decoded.width, decoded.height, decoded.mips.size(),
+		stats.bytesWritten / 1048576.0);
+	std::printf("Miss (decode, mips, write): %8.2f ms\n", missMilliseconds);
+	std::printf("Hit (map, copy levels):     %8.2f ms, %.1fx faster (%s decoded texels)\n", hitMilliseconds, missMilliseconds / hitMilliseconds,
+		identical ? "matches" : "differs from");
+	std::printf("%llu loads: %llu hits (%llu revalidated by hash), %llu misses (%llu stale), hit rate %.0f%%, %.1f ms saved\n",
+		static_cast<unsigned long long>(loads), static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.revalidated),
+		static_cast<unsigned long long>(stats.misses), static_cast<unsigned long long>(stats.stale), 100.0 * stats.hits / loads,
+		stats.hits * missMilliseconds - stats.hitMilliseconds);
+}
+
+// Function to measure the block compressor in every format and quality at every SIMD level, with the PSNR of the decoded
+// base level against the source and the decode speed
+static void BenchmarkBlockCompression(ThreadPool& pool, const std::string& filePath) {
+	TextureData source;
+	if (!LoadTextureData(pool, filePath, source)) {
+		return;
+	}
+	double megapixels = static_cast<double>(source.width) * source.height * 1e-6;
+	std::printf("%s: %dx%d, %.1f MB as RGBA, %u threads\n", filePath.c_str(), source.width, source.height, source.pixels.size() / 1048576.0, pool.WorkerCount());
+
+	const TexelFormat formats[] = { TexelFormat::BC1, TexelFormat::BC3, TexelFormat::BC7 };
+	const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::AVX2 };
+	for (TexelFormat format : formats) {
+		for (int highQuality = 0; highQuality <= 1; ++highQuality) {
+			TextureData reference;
+			for (SimdLevel level : levels) {
+				if (level > DetectSimdLevel()) {
+					continue;
+				}
+				BlockCompressionOptions options;
+				options.format = format;
+				options.highQuality = highQuality != 0;
+				options.simdLevel = level;
+
+				const int iterations = highQuality ? 1 : 3;
+				TextureData compressed;
+				auto start = std::chrono::high_resolution_clock::now();
+				for (int i = 0; i < iterations; ++i) {
+					if (!CompressTexture(pool, options, source, compressed)) {
+						return;
+					}
+				}
+				std::chrono::duration<double> encodeTime = std::chrono::high_resolution_clock::now() - start;
+
+				TextureData decoded;
+				start = std::chrono::high_resolution_clock::now();
+				for (int i = 0; i < iterations; ++i) {
+					DecompressTexture(pool, compressed, decoded);
+				}
+				std::chrono::duration<double> decodeTime = std::chrono::high_resolution_clock::now() - start;
+
+				double squaredError = 0.0;
+				for (size_t texel = 0; texel < source.pixels.size(); texel += 4) {
+					for (int channel = 0; channel < 3; ++channel) {
+						double difference = static_cast<double>(decoded.pixels[texel + channel]) - source.pixels[texel + channel];
+						squaredError += difference * difference;
+					}
+				}
+				double meanSquaredError = squaredError / (3.0 * source.width * source.height);
+				double psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+
+				if (level == SimdLevel::Scalar) {
+					reference = compressed;
+				}
+				std::printf("%s %-4s %-6s: encode %7.2f Mpixels/s, decode %7.1f Mpixels/s, %5.2f dB PSNR, %.2f MB (%s scalar blocks)\n",
+					TexelFormatName(format), highQuality ? "high" : "fast", SimdLevelName(level), megapixels * iterations / encodeTime.count(),
+					megapixels * iterations / decodeTime.count(), psnr, compressed.pixels.size() / 1048576.0,
+					compressed.pixels == reference.pixels ? "matches" : "differs from");
+			}
+		}
+	}
+}
+
+// Set-associative cache with least recently used replacement and 64-byte lines, replays texel addresses
+// to estimate misses where hardware counters are unavailable
+struct CacheModel {
+	static const uint32_t WAYS = 8;
+
+	std::vector<uint64_t> lines; // WAYS lines per set, most recently used first
+	uint64_t setMask;
+	uint64_t accesses = 0;
+	uint64_t misses = 0;
+
+	explicit CacheModel(uint32_t bytes)
+		: lines(bytes / 64, UINT64_MAX), setMask(bytes / 64 / WAYS - 1) {
+	}
+
+	void Access(uint64_t address) {
+		uint64_t line = address >> 6;
+		uint64_t* set = &lines[(line & setMask) * WAYS];
+		uint32_t way = 0;
+		while (way < WAYS && set[way] != line) {
+			++way;
+		}
+		++accesses;
+		if (way == WAYS) {
+			++misses;
+			way = WAYS - 1;
+		}
+		for (; way > 0; --way) {
+			set[way] = set[way - 1];
+		}
+		set[0] = line;
+	}
+};
+
+// Function to replay the bilinear footprints of a textured quad spinning in the screen plane, one texel per pixel with wrap addressing.
+// The screen is walked in 8x8 pixel blocks like the rasterizer's batches. Returns the distinct cache lines summed over the footprints.
+static uint64_t ReplayRotatedFootprints(const TextureData& texture, uint32_t width, uint32_t height, float angle, CacheModel& l1, CacheModel& l2) {
+	float cosine = std::cos(angle);
+	float sine = std::sin(angle);
+	uint64_t footprintLines = 0;
+	for (uint32_t blockY = 0; blockY < height; blockY += 8) {
+		for (uint32_t blockX = 0; blockX < width; blockX += 8) {
+			for (uint32_t py = blockY; py < blockY + 8; ++py) {
+				for (uint32_t px = blockX; px < blockX + 8; ++px) {
+					float sx = px + 0.5f - width * 0.5f;
+					float sy = py + 0.5f - height * 0.5f;
+					float tx = sx * cosine - sy * sine + texture.width * 0.5f - 0.5f;
+					float ty = sx * sine + sy * cosine + texture.height * 0.5f - 0.5f;
+					int x0 = static_cast<int>(std::floor(tx)) % texture.width;
+					int y0 = static_cast<int>(std::floor(ty)) % texture.height;
+					x0 += x0 < 0 ? texture.width : 0;
+					y0 += y0 < 0 ? texture.height : 0;
+					int x1 = x0 + 1 == texture.width ? 0 : x0 + 1;
+					int y1 = y0 + 1 == texture.height ? 0 : y0 + 1;
+
+					const int xs[4] = { x0, x1, x0, x1 };
+					const int ys[4] = { y0, y0, y1, y1 };
+					uint64_t footprint[4];
+					for (int tap = 0; tap < 4; ++tap) {
+						uint64_t address = GetTexelIndex(texture.layout, texture.width, xs[tap], ys[tap]) * 4;
+						footprint[tap] = address >> 6;
+						l1.Access(address);
+						l2.Access(address);
+						footprintLines += std::find(footprint, footprint + tap, footprint[tap]) == footprint + tap ? 1 : 0;
+					}
+				}
+			}
+		}
+	}
+	return footprintLines;
+}
+
+// Function to compare the linear and tiled texel layouts under rotating quad access: bilinear footprints of a quad spinning in the
+// screen plane replayed through cache models, then a full turn of the rendered quad timed with hardware cache counters where available
+static void BenchmarkTextureLayout(uint32_t threadCount, SimdLevel simdLevel, SoftwareFramebuffer& framebuffer, const SoftwareViewport& viewport,
+	const Mesh& mesh, VertexShaderConstants& vsConstants, const PixelShaderConstants& psConstants, const std::string& filePath) {
+	const uint32_t ANGLES = 36;
+	const uint32_t FRAMES = 360;
+	const float TWO_PI = 6.283185307f;
+	ThreadPool pool(threadCount);
+	TextureData textures[2];
+	if (!LoadTextureData(pool, filePath, textures[0])) {
+		return;
+	}
+	auto start = std::chrono::high_resolution_clock::now();
+	ConvertTextureLayout(pool, TexelLayout::Tiled, textures[0], textures[1]);
+	std::chrono::duration<double, std::milli> tiling = std::chrono::high_resolution_clock::now() - start;
+	std::printf("%s: %dx%d, tiled in %.2f ms (%.1f Mpixels/s), %.1f%% padding\n", filePath.c_str(), textures[0].width, textures[0].height,
+		tiling.count(), textures[0].width * static_cast<double>(textures[0].height) * 1e-3 / tiling.count(),
+		100.0 * (textures[1].pixels.size() - textures[0].pixels.size()) / textures[0].pixels.size());
+
+	std::printf("Footprints of a quad spinning in the screen plane, %u angles at %ux%u:\n", ANGLES, framebuffer.width, framebuffer.height);
+	for (const TextureData& texture : textures) {
+		CacheModel l1(32 * 1024);
+		CacheModel l2(1024 * 1024);
+		uint64_t footprintLines = 0;
+		for (uint32_t angle = 0; angle < ANGLES; ++angle) {
+			footprintLines += ReplayRotatedFootprints(texture, framebuffer.width, framebuffer.height, TWO_PI * angle / ANGLES, l1, l2);
+		}
+		std::printf("%-6s: %.3f cache lines per bilinear footprint, modeled misses: 32 KB L1 %.2f%%, 1 MB L2 %.2f%% of texel fetches\n",
+			TexelLayoutName(texture.layout), 4.0 * footprintLines / l1.accesses, 100.0 * l1.misses / l1.accesses, 100.0 * l2.misses / l2.accesses);
+	}
+
+	// The renderer's own threads start after the counters open, so joining them folds their counts in
+	std::printf("Rendered full turn of the quad, %u frames:\n", FRAMES);
+	std::vector<uint32_t> reference;
+	for (const TextureData& texture : textures) {
+		HardwareCounters counters;
+		counters.Open();
+		std::chrono::duration<double, std::milli> elapsed{ 0.0 };
+		std::vector<uint32_t> pixels;
+		{
+			SoftwareContext context;
+			if (!CreateSoftwareContext(threadCount, context)) {
+				return;
+			}
+			context.simdLevel = std::min(simdLevel, context.simdLevel);
+			start = std::chrono::high_resolution_clock::now();
+			for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+				CreateSoftwareWorldMatrix(TWO_PI * frame / FRAMES, vsConstants.worldMatrix);
+				SoftwareRender(context, framebuffer, viewport, mesh, vsConstants, psConstants, texture);
+			}
+			elapsed = std::chrono::high_resolution_clock::now() - start;
+			ResolveSoftwareFramebuffer(framebuffer, pixels);
+		}
+		if (reference.empty()) {
+			reference = pixels;
+		}
+
+		std::printf("%-6s: %7.3f ms per frame (%s linear frame)", TexelLayoutName(texture.layout), elapsed.count() / FRAMES,
+			pixels == reference ? "matches" : "differs from");
+		if (counters.IsOpen()) {
+			HardwareCounterValues values = counters.Read();
+			std::printf(", per frame: %llu LLC references, %llu LLC misses, %llu L1D read misses, %llu dTLB read misses\n",
+				static_cast<unsigned long long>(values.cacheReferences / FRAMES), static_cast<unsigned long long>(values.cacheMisses / FRAMES),
+				static_cast<unsigned long long>(values.l1dReadMisses / FRAMES), static_cast<unsigned long long>(values.dtlbReadMisses / FRAMES));
+		}
+		else {
+			std::printf(", hardware cache counters unavailable\n");
+		}
+	}
+}
+
+// Function to time the software sampler's filters on the footprints of a rotated, anisotropically stretched screen
+static void BenchmarkTextureSampler(ThreadPool& pool, const std::string& filePath) {
+	const uint32_t QUADS_X = 128;
+	const uint32_t QUADS_Y = 128;
+	const uint32_t ANGLES = 8;
+	const float TWO_PI = 6.283185307f;
+	TextureData texture;
+	if (!LoadTextureData(pool, filePath, texture)) {
+		return;
+	}
+	BuildMipChain(pool, MipChainOptions(), texture);
+
+	// Every pixel covers 1.5 texels across and 6 texels down the texture, a 4:1 footprint that needs anisotropic filtering
+	std::vector<SampleBatch> batches;
+	for (uint32_t angle = 0; angle < ANGLES; ++angle) {
+		float cosine = std::cos(TWO_PI * angle / ANGLES);
+		float sine = std::sin(TWO_PI * angle / ANGLES);
+		for (uint32_t quadY = 0; quadY < QUADS_Y; ++quadY) {
+			for (uint32_t quadX = 0; quadX < QUADS_X; quadX += 2) {
+				SampleBatch batch;
+				for (uint32_t lane = 0; lane < SAMPLE_BATCH; ++lane) {
+					float x = static_cast<float>(2 * (quadX + lane / 4) + (lane & 1)) + 0.5f;
+					float y = static_cast<float>(2 * quadY + ((lane >> 1) & 1)) + 0.5f;
+					batch.u[lane] = (cosine * x - sine * y) * 1.5f / texture.width;
+					batch.v[lane] = (sine * x + cosine * y) * 6.0f / texture.height;
+				}
+				SetQuadDerivatives(batch);
+				batches.push_back(batch);
+			}
+		}
+	}
+	std::printf("%s: %dx%d with %zu mips, %zu samples over %u angles\n", filePath.c_str(), texture.width, texture.height, texture.mips.size(),
+		batches.size() * SAMPLE_BATCH, ANGLES);
+
+	const SamplerFilter filters[] = { SamplerFilter::Point, SamplerFilter::Bilinear, SamplerFilter::Trilinear, SamplerFilter::Anisotropic };
+	const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::AVX2 };
+	for (SamplerFilter filter : filters) {
+		SamplerDesc sampler;
+		sampler.filter = filter;
+		std::vector<float> reference;
+		for (SimdLevel level : levels) {
+			if (level > DetectSimdLevel()) {
+				continue;
+			}
+			SampleBatchFunction sample = SelectSampleBatch(level);
+			std::vector<float> colors(batches.size() * 4 * SAMPLE_BATCH);
+			auto start = std::chrono::high_resolution_clock::now();
+			for (size_t batch = 0; batch < batches.size(); ++batch) {
+				sample(texture, sampler, batches[batch], reinterpret_cast<float(*)[SAMPLE_BATCH]>(&colors[batch * 4 * SAMPLE_BATCH]));
+			}
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			if (reference.empty()) {
+				reference = colors;
+			}
+			std::printf("%-11s %-6s: %7.2f Msamples/s (%s scalar samples)\n", SamplerFilterName(filter), SimdLevelName(level),
+				batches.size() * SAMPLE_BATCH * 1e-6 / elapsed.count(), colors == reference ? "matches" : "differs from");
+		}
+	}
+
+	// The coordinates run several periods past [0, 1], so every address mode is exercised
+	const TextureAddressMode modes[] = { TextureAddressMode::Wrap, TextureAddressMode::Mirror, TextureAddressMode::Clamp, TextureAddressMode::Border };
+	const char* modeNames[] = { "wrap", "mirror", "clamp", "border" };
+	if (DetectSimdLevel() >= SimdLevel::AVX2) {
+		for (size_t mode = 0; mode < std::size(modes); ++mode) {
+			SamplerDesc sampler;
+			sampler.addressU = modes[mode];
+			sampler.addressV = modes[mode];
+			sampler.borderColor[0] = 1.0f;
+			SampleBatchFunction scalar = SelectSampleBatch(SimdLevel::Scalar);
+			SampleBatchFunction vector = SelectSampleBatch(SimdLevel::AVX2);
+			size_t differing = 0;
+			for (const SampleBatch& batch : batches) {
+				float expected[4][SAMPLE_BATCH], actual[4][SAMPLE_BATCH];
+				scalar(texture, sampler, batch, expected);
+				vector(texture, sampler, batch, actual);
+				differing += std::memcmp(expected, actual, sizeof(expected)) != 0;
+			}
+			std::printf("%-6s addressing: %zu of %zu anisotropic batches differ between scalar and avx2\n", modeNames[mode], differing, batches.size());
+		}
+	}
+}
+
+// Function to render a full turn of the quad with and without the texel caches, for RGBA8 in both layouts and block compressed textures.
+// Bytes read count what the fetches take from the texture: a texel or a whole block per fetch uncached, one block per miss cached.
+static void BenchmarkTexelCache(SoftwareContext& context, SoftwareFramebuffer& framebuffer, const SoftwareViewport& viewport, const Mesh& mesh,
+	VertexShaderConstants& vsConstants, const PixelShaderConstants& psConstants, const std::string& filePath) {
+	const uint32_t FRAMES = 360;
+	const float TWO_PI = 6.283185307f;
+	TextureData textures[4];
+	if (!LoadTextureData(*context.pool, filePath, textures[0])) {
+		return;
+	}
+	PadToBlocks(textures[0]);
+	ConvertTextureLayout(*context.pool, TexelLayout::Tiled, textures[0], textures[1]);
+	BlockCompressionOptions options;
+	options.simdLevel = context.simdLevel;
+	options.format = TexelFormat::BC1;
+	CompressTexture(*context.pool, options, textures[0], textures[2]);
+	options.format = TexelFormat::BC7;
+	CompressTexture(*context.pool, options, textures[0], textures[3]);
+	std::printf("%s: %dx%d, full turn of the quad in %u frames at %ux%u, %u threads\n", filePath.c_str(), textures[0].width, textures[0].height,
+		FRAMES, framebuffer.width, framebuffer.height, context.pool->WorkerCount());
+
+	TexelCacheMode savedMode = context.texelCacheMode;
+	for (const TextureData& texture : textures) {
+		double frameTime[2] = { 0.0, 0.0 };
+		uint64_t frameHashes[2] = { 0, 0 };
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		const TexelCacheMode modes[2] = { TexelCacheMode::Off, TexelCacheMode::All };
+		for (int mode = 0; mode < 2; ++mode) {
+			context.texelCacheMode = modes[mode];
+			std::vector<uint32_t> pixels;
+			uint64_t hash = 14695981039346656037ull;
+			for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+				CreateSoftwareWorldMatrix(TWO_PI * frame / FRAMES, vsConstants.worldMatrix);
+				auto start = std::chrono::high_resolution_clock::now();
+				SoftwareRender(context, framebuffer, viewport, mesh, vsConstants, psConstants, texture);
+				frameTime[mode] += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+				hits += context.stats.texelCacheHits;
+				misses += context.stats.texelCacheMisses;
+
+				ResolveSoftwareFramebuffer(framebuffer, pixels);
+				for (uint32_t pixel : pixels) {
+					hash = (hash ^ pixel) * 1099511628211ull;
+				}
+			}
+			frameHashes[mode] = hash;
+		}
+
+		const char* name = texture.format == TexelFormat::RGBA8 ? TexelLayoutName(texture.layout) : TexelFormatName(texture.format);
+		double uncachedBytes = static_cast<double>(hits + misses) * GetFetchBytes(texture.format) / FRAMES;
+		double cachedBytes = static_cast<double>(misses) * GetCachedBlockBytes(texture.format) / FRAMES;
+		std::printf("%-6s uncached: %7.3f ms per frame, %6.2f MB read per frame\n", name, frameTime[0] / FRAMES, uncachedBytes / 1048576.0);
+
+		// Whole blocks cost more than single fetches when the cache hits too rarely, that is more read rather than a negative saving
+		char saving[32];
+		if (cachedBytes <= uncachedBytes) {
+			std::snprintf(saving, sizeof(saving), "%.1f%% saved", 100.0 * (1.0 - cachedBytes / std::max(uncachedBytes, 1.0)));
+		}
+		else {
+			std::snprintf(saving, sizeof(saving), "%.2fx more read", cachedBytes / std::max(uncachedBytes, 1.0));
+		}
+		std::printf("%-6s cached  : %7.3f ms per frame, %6.2f MB read per frame (%s), %.2f%% hit rate, %s uncached frames\n",
+			name, frameTime[1] / FRAMES, cachedBytes / 1048576.0, saving,
+			100.0 * hits / std::max<uint64_t>(hits + misses, 1), frameHashes[0] == frameHashes[1] ? "matches" : "differs from");
+	}
+	context.texelCacheMode = savedMode;
+}
+
+// Function to render a full turn of the quad with the native kernels, the JIT compiled shaders and the interpreter, with load times,
+// the largest channel difference of the frames against the native ones and whether the shaded vertices match bit for bit.
+// The backends take turns on every frame and count the fastest of a few renders, so a busy moment of the machine cannot decide the comparison.
+static void BenchmarkShaders(SoftwareContext& context, SoftwareFramebuffer& framebuffer, const SoftwareViewport& viewport, const Mesh& mesh,
+	VertexShaderConstants& vsConstants, const PixelShaderConstants& psConstants, const std::string& filePath) {
+	const uint32_t FRAMES = 360;
+	const uint32_t PASSES = 3;
+	const int BACKENDS = 3;
+	const float TWO_PI = 6.283185307f;
+	TextureData texture;
+	if (!LoadTextureData(*context.pool, filePath, texture)) {
+		return;
+	}
+	std::printf("%s: %dx%d, full turn of the quad in %u frames at %ux%u, %u threads, %s, fastest of %u renders per frame\n", filePath.c_str(),
+		texture.width, texture.height, FRAMES, framebuffer.width, framebuffer.height, context.pool->WorkerCount(), SimdLevelName(context.simdLevel), PASSES);
+
+	// Shaders of every backend, swapped into the context for its renders
+	const ShaderBackend backends[BACKENDS] = { ShaderBackend::Native, ShaderBackend::Jit, ShaderBackend::Interpreter };
+	std::unique_ptr<SoftwareShader> vertexShaders[BACKENDS];
+	std::unique_ptr<SoftwareShader> pixelShaders[BACKENDS];
+	double loadTime[BACKENDS];
+	for (int backend = 0; backend < BACKENDS; ++backend) {
+		auto loadStart = std::chrono::high_resolution_clock::now();
+		if (!LoadSoftwareShaders(context, backends[backend], nullptr)) {
+			std::cerr << "Failed to load shaders!" << std::endl;
+			return;
+		}
+		loadTime[backend] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+		vertexShaders[backend] = std::move(context.vertexShader);
+		pixelShaders[backend] = std::move(context.pixelShader);
+	}
+
+	double frameTime[BACKENDS] = { 0.0, 0.0, 0.0 };
+	uint32_t maxDifference[BACKENDS] = { 0, 0, 0 };
+	uint64_t differentPixels[BACKENDS] = { 0, 0, 0 };
+	std::vector<uint32_t> nativePixels;
+	std::vector<uint32_t> pixels;
+	for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+		CreateSoftwareWorldMatrix(TWO_PI * frame / FRAMES, vsConstants.worldMatrix);
+		for (int backend = 0; backend < BACKENDS; ++backend) {
+			context.vertexShader = std::move(vertexShaders[backend]);
+			context.pixelShader = std::move(pixelShaders[backend]);
+			double fastest = 0.0;
+			for (uint32_t pass = 0; pass < PASSES; ++pass) {
+				auto start = std::chrono::high_resolution_clock::now();
+				SoftwareRender(context, framebuffer, viewport, mesh, vsConstants, psConstants, texture);
+				double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+				fastest = pass == 0 ? elapsed : std::min(fastest, elapsed);
+			}
+			frameTime[backend] += fastest;
+			vertexShaders[backend] = std::move(context.vertexShader);
+			pixelShaders[backend] = std::move(context.pixelShader);
+
+			if (backend == 0) {
+				ResolveSoftwareFramebuffer(framebuffer, nativePixels);
+				continue;
+			}
+			ResolveSoftwareFramebuffer(framebuffer, pixels);
+			for (size_t pixel = 0; pixel < pixels.size(); ++pixel) {
+				uint32_t difference = 0;
+				for (uint32_t shift = 0; shift < 32; shift += 8) {
+					int a = (pixels[pixel] >> shift) & 0xFF;
+					int b = (nativePixels[pixel] >> shift) & 0xFF;
+					difference = std::max<uint32_t>(difference, static_cast<uint32_t>(std::abs(a - b)));
+				}
+				maxDifference[backend] = std::max(maxDifference[backend], difference);
+				differentPixels[backend] += difference > 0 ? 1 : 0;
+			}
+		}
+	}
+
+	std::vector<ShadedVertex> nativeVertices(mesh.vertices.size());
+	std::vector<ShadedVertex> shaderVertices(mesh.vertices.size());
+	ProcessVertices(*context.pool, SelectShadeVertices(context.simdLevel), mesh.vertices.data(), static_cast<uint32_t>(mesh.vertices.size()),
+		vsConstants, nativeVertices.data());
+	std::printf("%-11s: %7.3f ms per frame\n", ShaderBackendName(backends[0]), frameTime[0] / FRAMES);
+	for (int backend = 1; backend < BACKENDS; ++backend) {
+		ProcessVertices(*context.pool, *vertexShaders[backend], mesh.vertices.data(), static_cast<uint32_t>(mesh.vertices.size()),
+			vsConstants, shaderVertices.data());
+		bool verticesMatch = std::memcmp(nativeVertices.data(), shaderVertices.data(), shaderVertices.size() * sizeof(ShadedVertex)) == 0;
+		const SoftwareShader& vertexShader = *vertexShaders[backend];
+		const SoftwareShader& pixelShader = *pixelShaders[backend];
+		std::printf("%-11s: %7.3f ms per frame (%+.1f%%), loaded in %.3f ms, %s, %zu and %zu instructions, %zu and %zu code bytes\n",
+			ShaderBackendName(backends[backend]), frameTime[backend] / FRAMES, 100.0 * (frameTime[backend] / std::max(frameTime[0], 1e-9) - 1.0),
+			loadTime[backend], pixelShader.IsJit() ? "native code" : "interpreted", vertexShader.Program().code.size(), pixelShader.Program().code.size(),
+			vertexShader.Code().code.size(), pixelShader.Code().code.size());
+		std::printf("%-11s  max channel difference %u, %.4f%% of pixels differ, vertices %s\n", "", maxDifference[backend],
+			100.0 * differentPixels[backend] / (static_cast<double>(FRAMES) * framebuffer.width * framebuffer.height), verticesMatch ? "match" : "differ");
+	}
+	LoadSoftwareShaders(context, ShaderBackend::Native, nullptr);
+}
+
+// Function to measure the shader cache: misses that compile, translate and write the entries, hits that map them, and
+// eviction under a size limit that only holds the largest entry
+static void BenchmarkShaderCache(SimdLevel simdLevel) {
+	const int HITS = 5;
+	const std::string DIRECTORY = "ShaderCacheBenchmark";
+	const char* paths[2] = { "VertexShader.hlsl", "PixelShader.hlsl" };
+	const ShaderStage stages[2] = { ShaderStage::Vertex, ShaderStage::Pixel };
+	std::error_code error;
+	std::filesystem::remove_all(DIRECTORY, error);
+
+	ShaderCache cache(DIRECTORY, SHADER_CACHE_DEFAULT_LIMIT);
+	SoftwareShader compiled[2];
+	for (int i = 0; i < 2; ++i) {
+		if (!compiled[i].LoadFile(paths[i], stages[i], ShaderBackend::Jit, simdLevel, &cache)) {
+			return;
+		}
+	}
+
+	bool identical = true;
+	for (int hit = 0; hit < HITS; ++hit) {
+		for (int i = 0; i < 2; ++i) {
+			SoftwareShader cached;
+			if (!cached.LoadFile(paths[i], stages[i], ShaderBackend::Jit, simdLevel, &cache)) {
+				return;
+			}
+			identical = identical && cached.Code().code == compiled[i].Code().code && cached.Program().code.size() == compiled[i].Program().code.size();
+		}
+	}
+
+	ShaderCacheStats stats = cache.GetStats();
+	double missMilliseconds = stats.missMilliseconds / std::max<uint64_t>(stats.misses, 1);
+	double hitMilliseconds = stats.hitMilliseconds / std::max<uint64_t>(stats.hits, 1);
+	std::printf("%s and %s: %llu bytes of cache entries, %s\n", paths[0], paths[1], static_cast<unsigned long long>(stats.bytesWritten),
+		compiled[1].IsJit() ? "native code" : "IR only");
+	std::printf("Miss (compile, translate, write): %7.3f ms per shader\n", missMilliseconds);
+	std::printf("Hit (map, copy):                  %7.3f ms per shader, %.1fx faster (%s compiled code)\n", hitMilliseconds,
+		missMilliseconds / hitMilliseconds, identical ? "matches" : "differs from");
+
+	// The interpreter entries are new, each one pushes the least recently used entries out
+	uint64_t limit = 0;
+	for (std::filesystem::directory_iterator file(DIRECTORY, error), end; !error && file != end; file.increment(error)) {
+		limit = std::max<uint64_t>(limit, file->file_size(error));
+	}
+	ShaderCache limited(DIRECTORY, limit);
+	for (int i = 0; i < 2; ++i) {
+		SoftwareShader interpreted;
+		if (!interpreted.LoadFile(paths[i], stages[i], ShaderBackend::Interpreter, simdLevel, &limited)) {
+			return;
+		}
+	}
+	uint64_t directorySize = 0;
+	for (std::filesystem::directory_iterator file(DIRECTORY, error), end; !error && file != end; file.increment(error)) {
+		directorySize += file->file_size(error);
+	}
+	ShaderCacheStats limitedStats = limited.GetStats();
+	std::printf("Limit of %llu bytes: %llu misses, %llu entries (%llu bytes) evicted, %llu bytes left\n", static_cast<unsigned long long>(limit),
+		static_cast<unsigned long long>(limitedStats.misses), static_cast<unsigned long long>(limitedStats.evictions),
+		static_cast<unsigned long long>(limitedStats.bytesEvicted), static_cast<unsigned long long>(directorySize));
+	std::filesystem::remove_all(DIRECTORY, error);
+}
+
+// Function to time every specialized pixel pipeline against the per-batch dispatching and scalar reference kernels.
+// A 256x256 pixel triangle pair facing the camera maps 1.5 texture repeats, so filtered sampling minifies about 5 times.
+static void BenchmarkPixelPipelines(ThreadPool& pool, const std::string& filePath) {
+	const uint32_t SIZE = 256;
+	const uint32_t PASSES = 4;
+	TextureData texture;
+	if (!LoadTextureData(pool, filePath, texture)) {
+		return;
+	}
+	BuildMipChain(pool, MipChainOptions(), texture);
+	TextureData untextured;
+
+	// World position from (-1, 1) to (1, -1) at z = 0 and uv from 0 to 1.5, linear in x and y
+	ShadedVertex vertices[3] = {};
+	const float corners[3][2] = { { -1.0f, 1.0f }, { 1.0f, 1.0f }, { -1.0f, -1.0f } };
+	for (int v = 0; v < 3; ++v) {
+		vertices[v].worldPosition[0] = corners[v][0];
+		vertices[v].worldPosition[1] = corners[v][1];
+		vertices[v].worldPosition[3] = 1.0f;
+		vertices[v].normal[2] = -1.0f;
+		vertices[v].uv[0] = (corners[v][0] + 1.0f) * 0.75f;
+		vertices[v].uv[1] = (1.0f - corners[v][1]) * 0.75f;
+	}
+	const ShadedVertex* triangleVertices[3] = { &vertices[0], &vertices[1], &vertices[2] };
+	const float invW[3] = { 1.0f, 0.0f, 0.0f };
+	const float b1OverW[3] = { 0.0f, 1.0f / SIZE, 0.0f };
+	const float b2OverW[3] = { 0.0f, 0.0f, 1.0f / SIZE };
+	ShadingTriangle triangle;
+	SetupShadingTriangle(triangleVertices, invW, b1OverW, b2OverW, triangle);
+
+	// Batches of two quads walking the square
+	std::vector<float> batchX, batchY;
+	for (uint32_t quadY = 0; quadY < SIZE; quadY += 2) {
+		for (uint32_t quadX = 0; quadX < SIZE; quadX += 4) {
+			for (uint32_t lane = 0; lane < SHADING_BATCH; ++lane) {
+				batchX.push_back(static_cast<float>(quadX + (lane / 4) * 2 + (lane & 1)) + 0.5f);
+				batchY.push_back(static_cast<float>(quadY + ((lane >> 1) & 1)) + 0.5f);
+			}
+		}
+	}
+	size_t batchCount = batchX.size() / SHADING_BATCH;
+	double megapixels = batchCount * SHADING_BATCH * PASSES * 1e-6;
+	std::printf("%s: %dx%d with %zu mips, %zu batches of %u pixels per pass, %u passes\n", filePath.c_str(), texture.width, texture.height,
+		texture.mips.size(), batchCount, SHADING_BATCH, PASSES);
+
+	// Function to shade every batch, returns seconds
+	auto shadeAll = [&](ShadeQuadsFunction shade, const PixelShaderConstants& constants, const TextureData& bound, const SamplerDesc& sampler,
+		uint32_t passes, std::vector<uint32_t>& colors) {
+		colors.resize(batchX.size());
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t pass = 0; pass < passes; ++pass) {
+			for (size_t batch = 0; batch < batchCount; ++batch) {
+				shade(triangle, &batchX[batch * SHADING_BATCH], &batchY[batch * SHADING_BATCH], constants, bound, sampler, nullptr, &colors[batch * SHADING_BATCH]);
+			}
+		}
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	SamplerDesc baseSampler;
+	baseSampler.filter = SamplerFilter::Bilinear;
+	baseSampler.maxLod = 0.0f;
+	SamplerDesc filteredSampler;
+	bool avx2 = DetectSimdLevel() >= SimdLevel::AVX2;
+	for (uint32_t variant = 0; variant < PIXEL_PIPELINE_VARIANTS; ++variant) {
+		PixelPipelineKey key;
+		key.textured = (variant & 1) != 0;
+		key.specular = (variant & 2) != 0;
+		key.filtered = (variant & 4) != 0;
+		if (key.filtered && !key.textured) {
+			continue;
+		}
+
+		// Constants, texture and sampler that call for exactly this variant
+		PixelShaderConstants constants;
+		if (!key.specular) {
+			std::fill_n(constants.lightColor, 4, 0.001f);
+		}
+		const TextureData& bound = key.textured ? texture : untextured;
+		const SamplerDesc& sampler = key.filtered ? filteredSampler : baseSampler;
+		PixelPipelineKey derived = GetPixelPipelineKey(constants, bound, sampler);
+		if (PixelPipelineName(derived) != PixelPipelineName(key)) {
+			std::printf("%-40s: derived as %s\n", PixelPipelineName(key).c_str(), PixelPipelineName(derived).c_str());
+			continue;
+		}
+
+		std::vector<uint32_t> reference, colors;
+		double scalarTime = shadeAll(SelectPixelPipeline(SimdLevel::Scalar, key), constants, bound, sampler, 1, reference) * PASSES;
+		std::printf("%-40s: scalar %6.1f Mpixels/s", PixelPipelineName(key).c_str(), megapixels / scalarTime);
+		if (avx2) {
+			double dispatchTime = shadeAll(SelectShadeQuads(SimdLevel::AVX2), constants, bound, sampler, PASSES, colors);
+			double specializedTime = shadeAll(SelectPixelPipeline(SimdLevel::AVX2, key), constants, bound, sampler, PASSES, colors);
+			int maxDifference = 0;
+			for (size_t pixel = 0; pixel < colors.size(); ++pixel) {
+				for (int shift = 0; shift < 32; shift += 8) {
+					int difference = std::abs(static_cast<int>((colors[pixel] >> shift) & 0xFF) - static_cast<int>((reference[pixel] >> shift) & 0xFF));
+					maxDifference = std::max(maxDifference, difference);
+				}
+			}
+			std::printf(", avx2 dispatched per batch %6.1f Mpixels/s, specialized %6.1f Mpixels/s, max %d LSB from scalar",
+				megapixels / dispatchTime, megapixels / specializedTime, maxDifference);
+		}
+		std::printf("\n");
+	}
+
+	// Draws derive their features and pick the pipeline once
+	const uint32_t DISPATCHES = 1000000;
+	PixelShaderConstants constants;
+	uint32_t checksum = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t dispatch = 0; dispatch < DISPATCHES; ++dispatch) {
+		constants.ambientLightIntensity = static_cast<float>(dispatch & 1);
+		ShadeQuadsFunction shade = SelectPixelPipeline(SimdLevel::AVX2, GetPixelPipelineKey(constants, texture, baseSampler));
+		checksum += static_cast<uint32_t>(reinterpret_cast<uintptr_t>(shade) & 0xFF);
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+	std::printf("Dispatch: %.1f ns per draw to derive the features and pick the pipeline (checksum %u)\n", elapsed.count() / DISPATCHES, checksum);
+}
+
+// Benchmark entry point, runs one of the measurements of the software renderer and its asset pipeline
+int main(int argc, char** argv) {
+	const uint32_t WIDTH = 1024;
+	const uint32_t HEIGHT = 576;
+	uint32_t tileSize = 64;
+	uint32_t threadCount = 0;
+	uint32_t benchVertices = 0;
+	uint32_t gridSize = 0;
+	bool benchMips = false;
+	std::string benchLoadPath;
+	std::vector<std::string> benchJpegPaths;
+	std::string benchScaledPath;
+	std::vector<std::string> benchFilePaths;
+	std::string benchStartupPath;
+	std::string benchArchivePath;
+	std::string benchTextureCachePath;
+	std::string benchBlockCompressionPath;
+	std::string benchLayoutPath;
+	std::string benchSamplerPath;
+	std::string benchTexelCachePath;
+	std::string benchPipelinesPath;
+	std::string benchShadersPath;
+	bool benchShaderCache = false;
+	ShaderBackend shaderBackend = ShaderBackend::Native;
+	bool samplerFiltered = false;
+	SamplerFilter samplerFilter = SamplerFilter::Bilinear;
+	TexelCacheMode texelCacheMode = TexelCacheMode::Compressed;
+	SimdLevel simdLevel = DetectSimdLevel();
+	float rotation = 300.0f;
+	std::string meshPath;
+
+	// Parse command line options
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--tile-size") == 0 && i + 1 < argc) {
+			tileSize = static_cast<uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threadCount = static_cast<uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--simd") == 0 && i + 1 < argc) {
+			if (!ParseSimdLevel(argv[++i], simdLevel)) {
+				std::cerr << "Unknown SIMD level: " << argv[i] << std::endl;
+				return -1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--bench-vertices") == 0 && i + 1 < argc) {
+			benchVertices = static_cast<uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-mips") == 0) {
+			benchMips = true;
+		}
+		else if (std::strcmp(argv[i], "--bench-load") == 0 && i + 1 < argc) {
+			benchLoadPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--bench-jpeg") == 0 && i + 1 < argc) {
+			benchJpegPaths.push_back(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--bench-scaled") == 0 && i + 1 < argc) {
+			benchScaledPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--bench-file") == 0 && i + 1 < argc) {
+			benchFilePaths.push_back(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--bench-startup") == 0 && i + 1 < argc) {
+			benchStartupPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--bench-archive") == 0 && i + 1 < argc) {
+			benchArchivePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--bench-texture-cache") == 0 && i + 1 < argc) {
+			benchTextureCachePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--bench-bc") == 0 && i + 1 < argc) {
+			benchBlockCompressionPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--bench-layout") == 0 && i + 1 < argc) {
+			benchLayoutPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--bench-sampler") == 0 && i + 1 < argc) {
+			benchSamplerPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--bench-texel-cache") == 0 && i + 1 < argc) {
+			benchTexelCachePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--bench-pipelines") == 0 && i + 1 < argc) {
+			benchPipelinesPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--bench-shaders") == 0 && i + 1 < argc) {
+			benchShadersPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--bench-shader-cache") == 0) {
+			benchShaderCache = true;
+		}
+		else if (std::strcmp(argv[i], "--shaders") == 0 && i + 1 < argc) {
+			if (!ParseShaderBackend(argv[++i], shaderBackend)) {
+				std::cerr << "Unknown shader backend: " << argv[i] << std::endl;
+				return -1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--sampler-filter") == 0 && i + 1 < argc) {
+			if (!ParseSamplerFilter(argv[++i], samplerFilter)) {
+				std::cerr << "Unknown sampler filter: " << argv[i] << std::endl;
+				return -1;
+			}
+			samplerFiltered = true;
+		}
+		else if (std::strcmp(argv[i], "--texel-cache") == 0 && i + 1 < argc) {
+			if (!ParseTexelCacheMode(argv[++i], texelCacheMode)) {
+				std::cerr << "Unknown texel cache mode: " << argv[i] << std::endl;
+				return -1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+			gridSize = static_cast<uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--mesh") == 0 && i + 1 < argc) {
+			meshPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--rotation") == 0 && i + 1 < argc) {
+			rotation = static_cast<float>(std::atof(argv[++i]));
+		}
+		else {
+			std::cerr << "Usage: " << argv[0] << " [--tile-size N] [--threads N] [--simd scalar|avx2|avx512] [--bench-vertices N] [--bench-mips] [--bench-load image.jpg] [--bench-jpeg image.jpg]... [--bench-scaled image.jpg] [--bench-file file]... [--bench-startup image.jpg] [--bench-archive file.pack] [--bench-texture-cache image.jpg] [--bench-bc image.jpg] [--bench-layout image.jpg] [--bench-sampler image.jpg] [--bench-texel-cache image.jpg] [--texel-cache off|compressed|all] [--bench-pipelines image.jpg] [--bench-shaders image.jpg] [--bench-shader-cache] [--shaders native|jit|interpreter] [--sampler-filter point|bilinear|trilinear|anisotropic] [--grid N] [--mesh file.mesh|file.obj] [--rotation R]" << std::endl;
+			return -1;
+		}
+	}
+
+	SoftwareContext context;
+	if (!CreateSoftwareContext(threadCount, context)) {
+		std::cerr << "Failed to setup software context!" << std::endl;
+		return -1;
+	}
+	context.simdLevel = std::min(simdLevel, context.simdLevel);
+	context.texelCacheMode = texelCacheMode;
+
+	if (!benchBlockCompressionPath.empty()) {
+		BenchmarkBlockCompression(*context.pool, benchBlockCompressionPath);
+		return 0;
+	}
+
+	if (benchShaderCache) {
+		BenchmarkShaderCache(context.simdLevel);
+		return 0;
+	}
+
+	if (!benchPipelinesPath.empty()) {
+		BenchmarkPixelPipelines(*context.pool, benchPipelinesPath);
+		return 0;
+	}
+
+	if (!benchSamplerPath.empty()) {
+		BenchmarkTextureSampler(*context.pool, benchSamplerPath);
+		return 0;
+	}
+
+	if (!benchTextureCachePath.empty()) {
+		BenchmarkTextureCache(*context.pool, benchTextureCachePath);
+		return 0;
+	}
+
+	if (!benchArchivePath.empty()) {
+		BenchmarkArchive(benchArchivePath);
+		return 0;
+	}
+
+	if (!benchFilePaths.empty()) {
+		BenchmarkFileLoad(benchFilePaths);
+		return 0;
+	}
+
+	if (!benchScaledPath.empty()) {
+		BenchmarkScaledLoad(benchScaledPath);
+		return 0;
+	}
+
+	if (!benchJpegPaths.empty()) {
+		BenchmarkJpegKernels(benchJpegPaths);
+		return 0;
+	}
+
+	if (!benchLoadPath.empty()) {
+		BenchmarkTextureLoad(*context.pool, benchLoadPath);
+		return 0;
+	}
+
+	// The scene of the headless renderer: the quad, an N x N grid over the same area or a mesh file
+	Mesh mesh;
+	if (!meshPath.empty()) {
+		if (!LoadMesh(meshPath, mesh)) {
+			std::cerr << "Failed to load mesh!" << std::endl;
+			return -1;
+		}
+	}
+	else if (gridSize > 0) {
+		CreateGridMesh(gridSize, gridSize, mesh);
+	}
+	else {
+		CreateQuadMesh(mesh);
+	}
+
+	VertexShaderConstants vsConstants;
+	PixelShaderConstants psConstants;
+	CreateSoftwareMatrices(WIDTH, HEIGHT, rotation, vsConstants);
+
+	SoftwareViewport viewport;
+	SetSoftwareViewport(viewport, WIDTH, HEIGHT);
+
+	if (benchVertices > 0) {
+		BenchmarkVertices(*context.pool, benchVertices, vsConstants);
+		return 0;
+	}
+
+	if (benchMips) {
+		TextureData texture;
+		if (!LoadTextureData(*context.pool, "image.jpg", texture)) {
+			std::cerr << "Failed to load texture!" << std::endl;
+			return -1;
+		}
+		BenchmarkMipChain(*context.pool, texture);
+		return 0;
+	}
+
+	// A sampler filter samples the mips like the Direct3D sampler, otherwise the base level is sampled bilinearly
+	if (samplerFiltered) {
+		context.sampler = SamplerDesc();
+		context.sampler.filter = samplerFilter;
+	}
+
+	SoftwareFramebuffer framebuffer;
+	if (!CreateSoftwareFramebuffer(WIDTH, HEIGHT, tileSize, framebuffer)) {
+		std::cerr << "Failed to setup software framebuffer!" << std::endl;
+		return -1;
+	}
+
+	if (!benchLayoutPath.empty()) {
+		BenchmarkTextureLayout(threadCount, context.simdLevel, framebuffer, viewport, mesh, vsConstants, psConstants, benchLayoutPath);
+		return 0;
+	}
+
+	if (!benchTexelCachePath.empty()) {
+		BenchmarkTexelCache(context, framebuffer, viewport, mesh, vsConstants, psConstants, benchTexelCachePath);
+		return 0;
+	}
+
+	if (!benchShadersPath.empty()) {
+		BenchmarkShaders(context, framebuffer, viewport, mesh, vsConstants, psConstants, benchShadersPath);
+		return 0;
+	}
+
+	if (!benchStartupPath.empty()) {
+		// The startup is measured with the shaders the renderer would run, compiled without a cache
+		if (!LoadSoftwareShaders(context, shaderBackend, nullptr)) {
+			std::cerr << "Failed to load shaders!" << std::endl;
+			return -1;
+		}
+		BenchmarkStartup(context, framebuffer, viewport, mesh, vsConstants, psConstants, benchStartupPath);
+		return 0;
+	}
+
+	std::cerr << "No benchmark selected, run " << argv[0] << " with one of the --bench options" << std::endl;
+	return -1;
+}
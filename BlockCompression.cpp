@@ -0,0 +1,856 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+// BC7 interpolation weights out of 64 for 2, 3 and 4-bit indices
+static const int32_t BC7_WEIGHTS2[4] = { 0, 21, 43, 64 };
+static const int32_t BC7_WEIGHTS3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const int32_t BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Where each palette index lies on the segment from endpoint 0 to endpoint 1
+static const float BC1_POSITIONS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+static const float BC4_POSITIONS[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+// BC7 mode 6: 7 mode bits, 8 endpoint channels of 7 bits, 2 p-bits, then the indices
+static const uint32_t BC7_MODE6_INDEX_BASE = 65;
+
+// Least squares refinements of the high quality mode, each one stops early once the error no longer drops
+static const int REFINE_ITERATIONS = 4;
+
+// Function to read bits of a 128-bit block, least significant bit first
+static uint32_t ReadBits(const uint64_t bits[2], uint32_t position, uint32_t count) {
+	uint64_t value = position >= 64 ? bits[1] >> (position - 64) : bits[0] >> position;
+	if (position < 64 && position + count > 64) {
+		value |= bits[1] << (64 - position);
+	}
+	return static_cast<uint32_t>(value & ((uint64_t(1) << count) - 1));
+}
+
+// Function to append bits to a 128-bit block, least significant bit first
+static void WriteBits(uint64_t bits[2], uint32_t& position, uint32_t value, uint32_t count) {
+	if (position < 64) {
+		bits[0] |= static_cast<uint64_t>(value) << position;
+		if (position + count > 64) {
+			bits[1] |= static_cast<uint64_t>(value) >> (64 - position);
+		}
+	}
+	else {
+		bits[1] |= static_cast<uint64_t>(value) << (position - 64);
+	}
+	position += count;
+}
+
+// Function to read the index of a texel, the first texel is the anchor and leaves out its most significant bit
+static uint32_t ReadIndex(const uint64_t bits[2], uint32_t base, uint32_t indexBits, int texel) {
+	if (texel == 0) {
+		return ReadBits(bits, base, indexBits - 1);
+	}
+	return ReadBits(bits, base + texel * indexBits - 1, indexBits);
+}
+
+// Function to expand a 5:6:5 color to 8 bits per channel
+static void Expand565(uint16_t color, int32_t rgb[3]) {
+	int32_t r = (color >> 11) & 31;
+	int32_t g = (color >> 5) & 63;
+	int32_t b = color & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Function to build the palette of a BC1 color block, four opaque colors or three and transparent black
+static void BuildBC1Palette(uint16_t color0, uint16_t color1, bool fourColors, BlockColors& palette) {
+	int32_t c0[3], c1[3];
+	Expand565(color0, c0);
+	Expand565(color1, c1);
+	for (int c = 0; c < 3; ++c) {
+		palette.channel[c][0] = c0[c];
+		palette.channel[c][1] = c1[c];
+		if (fourColors) {
+			palette.channel[c][2] = (2 * c0[c] + c1[c] + 1) / 3;
+			palette.channel[c][3] = (c0[c] + 2 * c1[c] + 1) / 3;
+		}
+		else {
+			palette.channel[c][2] = (c0[c] + c1[c] + 1) / 2;
+			palette.channel[c][3] = 0;
+		}
+	}
+	palette.channel[3][0] = 255;
+	palette.channel[3][1] = 255;
+	palette.channel[3][2] = 255;
+	palette.channel[3][3] = fourColors ? 255 : 0;
+}
+
+// Function to build the palette of a BC4 block, eight interpolated values or six and the extremes 0 and 255
+static void BuildBC4Palette(int32_t value0, int32_t value1, int32_t palette[8]) {
+	palette[0] = value0;
+	palette[1] = value1;
+	if (value0 > value1) {
+		for (int i = 1; i <= 6; ++i) {
+			palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+		}
+	}
+	else {
+		for (int i = 1; i <= 4; ++i) {
+			palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+// Function to interpolate two BC7 endpoint channels
+static int32_t InterpolateBC7(int32_t endpoint0, int32_t endpoint1, int32_t weight) {
+	return ((64 - weight) * endpoint0 + weight * endpoint1 + 32) >> 6;
+}
+
+// Function to expand a BC7 endpoint channel to 8 bits by replicating its high bits
+static int32_t ExpandBC7(uint32_t value, uint32_t bitCount) {
+	return static_cast<int32_t>((value << (8 - bitCount)) | (value >> (2 * bitCount - 8)));
+}
+
+// Function to look up the weight of a BC7 index
+static int32_t WeightBC7(uint32_t indexBits, uint32_t index) {
+	return indexBits == 2 ? BC7_WEIGHTS2[index] : indexBits == 3 ? BC7_WEIGHTS3[index] : BC7_WEIGHTS4[index];
+}
+
+// Function to decode texels [first, first + count) of a BC1 color block
+static void DecodeBC1(const unsigned char* block, bool forceFourColors, int first, int count, unsigned char* rgba) {
+	uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+	uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+	uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+
+	BlockColors palette;
+	BuildBC1Palette(color0, color1, forceFourColors || color0 > color1, palette);
+	for (int texel = first; texel < first + count; ++texel) {
+		uint32_t index = (indices >> (2 * texel)) & 3;
+		for (int c = 0; c < 4; ++c) {
+			*rgba++ = static_cast<unsigned char>(palette.channel[c][index]);
+		}
+	}
+}
+
+// Function to decode the alpha of texels [first, first + count) from a BC4 block
+static void DecodeBC4Alpha(const unsigned char* block, int first, int count, unsigned char* rgba) {
+	int32_t palette[8];
+	BuildBC4Palette(block[0], block[1], palette);
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; ++i) {
+		indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+	}
+	for (int texel = first; texel < first + count; ++texel) {
+		rgba[(texel - first) * 4 + 3] = static_cast<unsigned char>(palette[(indices >> (3 * texel)) & 7]);
+	}
+}
+
+// Function to decode texels [first, first + count) of a BC7 block, the single subset modes 4, 5 and 6
+static void DecodeBC7(const unsigned char* block, int first, int count, unsigned char* rgba) {
+	uint64_t bits[2];
+	std::memcpy(bits, block, sizeof(bits));
+	uint32_t mode = 0;
+	while (mode < 8 && (block[0] & (1 << mode)) == 0) {
+		++mode;
+	}
+
+	int32_t endpoints[2][4];
+	if (mode == 6) {
+		uint32_t position = 7;
+		for (int c = 0; c < 4; ++c) {
+			for (int e = 0; e < 2; ++e, position += 7) {
+				endpoints[e][c] = static_cast<int32_t>(ReadBits(bits, position, 7) << 1);
+			}
+		}
+		for (int e = 0; e < 2; ++e) {
+			int32_t pBit = static_cast<int32_t>(ReadBits(bits, position++, 1));
+			for (int c = 0; c < 4; ++c) {
+				endpoints[e][c] |= pBit;
+			}
+		}
+
+		for (int texel = first; texel < first + count; ++texel) {
+			int32_t weight = BC7_WEIGHTS4[ReadIndex(bits, BC7_MODE6_INDEX_BASE, 4, texel)];
+			for (int c = 0; c < 4; ++c) {
+				*rgba++ = static_cast<unsigned char>(InterpolateBC7(endpoints[0][c], endpoints[1][c], weight));
+			}
+		}
+		return;
+	}
+
+	if (mode == 4 || mode == 5) {
+		// Color and alpha have separate endpoints and indices, the rotation swaps alpha with a color channel afterwards
+		uint32_t position = mode + 1;
+		uint32_t rotation = ReadBits(bits, position, 2);
+		position += 2;
+		uint32_t indexMode = mode == 4 ? ReadBits(bits, position++, 1) : 0;
+		uint32_t colorBits = mode == 4 ? 5 : 7;
+		uint32_t alphaBits = mode == 4 ? 6 : 8;
+		for (int c = 0; c < 3; ++c) {
+			for (int e = 0; e < 2; ++e, position += colorBits) {
+				endpoints[e][c] = ExpandBC7(ReadBits(bits, position, colorBits), colorBits);
+			}
+		}
+		for (int e = 0; e < 2; ++e, position += alphaBits) {
+			endpoints[e][3] = ExpandBC7(ReadBits(bits, position, alphaBits), alphaBits);
+		}
+
+		uint32_t primaryBits = 2;
+		uint32_t secondaryBits = mode == 4 ? 3 : 2;
+		uint32_t primaryBase = position;
+		uint32_t secondaryBase = position + BLOCK_TEXELS * primaryBits - 1;
+		uint32_t colorIndexBits = indexMode ? secondaryBits : primaryBits;
+		uint32_t colorBase = indexMode ? secondaryBase : primaryBase;
+		uint32_t alphaIndexBits = indexMode ? primaryBits : secondaryBits;
+		uint32_t alphaBase = indexMode ? primaryBase : secondaryBase;
+
+		for (int texel = first; texel < first + count; ++texel, rgba += 4) {
+			int32_t colorWeight = WeightBC7(colorIndexBits, ReadIndex(bits, colorBase, colorIndexBits, texel));
+			int32_t alphaWeight = WeightBC7(alphaIndexBits, ReadIndex(bits, alphaBase, alphaIndexBits, texel));
+			for (int c = 0; c < 3; ++c) {
+				rgba[c] = static_cast<unsigned char>(InterpolateBC7(endpoints[0][c], endpoints[1][c], colorWeight));
+			}
+			rgba[3] = static_cast<unsigned char>(InterpolateBC7(endpoints[0][3], endpoints[1][3], alphaWeight));
+			if (rotation > 0) {
+				std::swap(rgba[3], rgba[rotation - 1]);
+			}
+		}
+		return;
+	}
+
+	// Partitioned and reserved modes
+	std::memset(rgba, 0, static_cast<size_t>(count) * 4);
+}
+
+// Function to decode texels [first, first + count) of a block in any block compressed format
+static void DecodeTexels(TexelFormat format, const unsigned char* block, int first, int count, unsigned char* rgba) {
+	switch (format) {
+	case TexelFormat::BC1:
+		DecodeBC1(block, false, first, count, rgba);
+		break;
+	case TexelFormat::BC3:
+		DecodeBC1(block + 8, true, first, count, rgba);
+		DecodeBC4Alpha(block, first, count, rgba);
+		break;
+	case TexelFormat::BC7:
+		DecodeBC7(block, first, count, rgba);
+		break;
+	default:
+		std::memset(rgba, 0, static_cast<size_t>(count) * 4);
+		break;
+	}
+}
+
+// Function to gather a block's texels, texels past the edges of the level repeat the last column and row
+static void LoadBlock(const unsigned char* pixels, int width, int height, int blockX, int blockY, BlockColors& texels) {
+	for (int ty = 0; ty < BLOCK_DIMENSION; ++ty) {
+		int y = std::min(blockY * BLOCK_DIMENSION + ty, height - 1);
+		for (int tx = 0; tx < BLOCK_DIMENSION; ++tx) {
+			int x = std::min(blockX * BLOCK_DIMENSION + tx, width - 1);
+			const unsigned char* texel = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+			for (int c = 0; c < 4; ++c) {
+				texels.channel[c][ty * BLOCK_DIMENSION + tx] = texel[c];
+			}
+		}
+	}
+}
+
+// Function to find the segment covering the texels along their principal axis, over channelCount channels from firstChannel on
+static void FitPrincipalAxis(const BlockColors& texels, uint32_t firstChannel, uint32_t channelCount, float endpoint0[4], float endpoint1[4]) {
+	float mean[4] = {};
+	for (uint32_t c = 0; c < channelCount; ++c) {
+		for (int t = 0; t < BLOCK_TEXELS; ++t) {
+			mean[c] += static_cast<float>(texels.channel[firstChannel + c][t]);
+		}
+		mean[c] *= 1.0f / BLOCK_TEXELS;
+	}
+
+	float covariance[4][4] = {};
+	for (int t = 0; t < BLOCK_TEXELS; ++t) {
+		float offset[4];
+		for (uint32_t c = 0; c < channelCount; ++c) {
+			offset[c] = texels.channel[firstChannel + c][t] - mean[c];
+		}
+		for (uint32_t i = 0; i < channelCount; ++i) {
+			for (uint32_t j = 0; j < channelCount; ++j) {
+				covariance[i][j] += offset[i] * offset[j];
+			}
+		}
+	}
+
+	// Power iteration, starting from the covariance row of the channel that varies most
+	uint32_t widest = 0;
+	for (uint32_t c = 1; c < channelCount; ++c) {
+		if (covariance[c][c] > covariance[widest][widest]) {
+			widest = c;
+		}
+	}
+	float axis[4];
+	std::memcpy(axis, covariance[widest], sizeof(axis));
+	for (int iteration = 0; iteration < 8; ++iteration) {
+		float next[4] = {};
+		float largest = 0.0f;
+		for (uint32_t i = 0; i < channelCount; ++i) {
+			for (uint32_t j = 0; j < channelCount; ++j) {
+				next[i] += covariance[i][j] * axis[j];
+			}
+			largest = std::max(largest, std::fabs(next[i]));
+		}
+		if (largest == 0.0f) {
+			break;
+		}
+		for (uint32_t i = 0; i < channelCount; ++i) {
+			axis[i] = next[i] / largest;
+		}
+	}
+	float lengthSquared = 0.0f;
+	for (uint32_t c = 0; c < channelCount; ++c) {
+		lengthSquared += axis[c] * axis[c];
+	}
+
+	// A flat block collapses to its mean
+	float minimum = 0.0f;
+	float maximum = 0.0f;
+	if (lengthSquared > 0.0f) {
+		float invLength = 1.0f / std::sqrt(lengthSquared);
+		for (uint32_t c = 0; c < channelCount; ++c) {
+			axis[c] *= invLength;
+		}
+		minimum = FLT_MAX;
+		maximum = -FLT_MAX;
+		for (int t = 0; t < BLOCK_TEXELS; ++t) {
+			float projection = 0.0f;
+			for (uint32_t c = 0; c < channelCount; ++c) {
+				projection += (texels.channel[firstChannel + c][t] - mean[c]) * axis[c];
+			}
+			minimum = std::min(minimum, projection);
+			maximum = std::max(maximum, projection);
+		}
+	}
+	for (uint32_t c = 0; c < channelCount; ++c) {
+		endpoint0[c] = std::min(std::max(mean[c] + axis[c] * minimum, 0.0f), 255.0f);
+		endpoint1[c] = std::min(std::max(mean[c] + axis[c] * maximum, 0.0f), 255.0f);
+	}
+}
+
+// Function to solve for the endpoints that best reproduce the texels by least squares, given where each texel's index lies on the segment
+static bool SolveEndpoints(const BlockColors& texels, uint32_t firstChannel, uint32_t channelCount, const float* positions,
+	const uint8_t indices[BLOCK_TEXELS], float endpoint0[4], float endpoint1[4]) {
+	float alphaSquared = 0.0f, betaSquared = 0.0f, alphaBeta = 0.0f;
+	float alphaTexel[4] = {}, betaTexel[4] = {};
+	for (int t = 0; t < BLOCK_TEXELS; ++t) {
+		float beta = positions[indices[t]];
+		float alpha = 1.0f - beta;
+		alphaSquared += alpha * alpha;
+		betaSquared += beta * beta;
+		alphaBeta += alpha * beta;
+		for (uint32_t c = 0; c < channelCount; ++c) {
+			float texel = static_cast<float>(texels.channel[firstChannel + c][t]);
+			alphaTexel[c] += alpha * texel;
+			betaTexel[c] += beta * texel;
+		}
+	}
+
+	// Every texel on the same index leaves the system singular
+	float determinant = alphaSquared * betaSquared - alphaBeta * alphaBeta;
+	if (std::fabs(determinant) < 1e-4f) {
+		return false;
+	}
+	float invDeterminant = 1.0f / determinant;
+	for (uint32_t c = 0; c < channelCount; ++c) {
+		float value0 = (alphaTexel[c] * betaSquared - betaTexel[c] * alphaBeta) * invDeterminant;
+		float value1 = (betaTexel[c] * alphaSquared - alphaTexel[c] * alphaBeta) * invDeterminant;
+		endpoint0[c] = std::min(std::max(value0, 0.0f), 255.0f);
+		endpoint1[c] = std::min(std::max(value1, 0.0f), 255.0f);
+	}
+	return true;
+}
+
+// Function to quantize a color to 5:6:5
+static uint16_t To565(const float color[3]) {
+	int32_t r = static_cast<int32_t>(color[0] * (31.0f / 255.0f) + 0.5f);
+	int32_t g = static_cast<int32_t>(color[1] * (63.0f / 255.0f) + 0.5f);
+	int32_t b = static_cast<int32_t>(color[2] * (31.0f / 255.0f) + 0.5f);
+	return static_cast<uint16_t>((std::min(r, 31) << 11) | (std::min(g, 63) << 5) | std::min(b, 31));
+}
+
+// Function to fit the indices of a BC1 color block, the endpoints are ordered for the four color mode
+static uint32_t FitBC1(const BlockColors& texels, FitBlockIndicesFunction fit, uint16_t& color0, uint16_t& color1, uint8_t indices[BLOCK_TEXELS]) {
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+	BlockColors palette;
+	BuildBC1Palette(color0, color1, true, palette);
+	// Equal endpoints decode in the three color mode, where only index 0 is the endpoint color
+	return fit(texels, palette, color0 == color1 ? 1 : 4, 0, 3, indices);
+}
+
+// Function to encode the RGB of a block as a BC1 color block
+static void EncodeBC1(const BlockColors& texels, bool highQuality, FitBlockIndicesFunction fit, unsigned char* block) {
+	float endpoint0[4], endpoint1[4];
+	FitPrincipalAxis(texels, 0, 3, endpoint0, endpoint1);
+	uint16_t color0 = To565(endpoint0);
+	uint16_t color1 = To565(endpoint1);
+	uint8_t indices[BLOCK_TEXELS];
+	uint32_t error = FitBC1(texels, fit, color0, color1, indices);
+
+	for (int iteration = 0; highQuality && iteration < REFINE_ITERATIONS && error > 0; ++iteration) {
+		if (!SolveEndpoints(texels, 0, 3, BC1_POSITIONS, indices, endpoint0, endpoint1)) {
+			break;
+		}
+		uint16_t refined0 = To565(endpoint0);
+		uint16_t refined1 = To565(endpoint1);
+		uint8_t refinedIndices[BLOCK_TEXELS];
+		uint32_t refinedError = FitBC1(texels, fit, refined0, refined1, refinedIndices);
+		if (refinedError >= error) {
+			break;
+		}
+		color0 = refined0;
+		color1 = refined1;
+		std::memcpy(indices, refinedIndices, sizeof(indices));
+		error = refinedError;
+	}
+
+	uint32_t packedIndices = 0;
+	for (int t = 0; t < BLOCK_TEXELS; ++t) {
+		packedIndices |= static_cast<uint32_t>(indices[t]) << (2 * t);
+	}
+	block[0] = static_cast<unsigned char>(color0);
+	block[1] = static_cast<unsigned char>(color0 >> 8);
+	block[2] = static_cast<unsigned char>(color1);
+	block[3] = static_cast<unsigned char>(color1 >> 8);
+	std::memcpy(block + 4, &packedIndices, sizeof(packedIndices));
+}
+
+// Function to fit the indices of a BC4 alpha block, the endpoints are ordered for the eight value mode
+static uint32_t FitBC4Alpha(const BlockColors& texels, FitBlockIndicesFunction fit, int32_t& value0, int32_t& value1, uint8_t indices[BLOCK_TEXELS]) {
+	if (value0 < value1) {
+		std::swap(value0, value1);
+	}
+	BlockColors palette;
+	BuildBC4Palette(value0, value1, palette.channel[3]);
+	return fit(texels, palette, value0 == value1 ? 1 : 8, 3, 1, indices);
+}
+
+// Function to encode the alpha of a block as a BC4 block
+static void EncodeBC4Alpha(const BlockColors& texels, bool highQuality, FitBlockIndicesFunction fit, unsigned char* block) {
+	const int32_t* alpha = texels.channel[3];
+	int32_t value0 = *std::max_element(alpha, alpha + BLOCK_TEXELS);
+	int32_t value1 = *std::min_element(alpha, alpha + BLOCK_TEXELS);
+	uint8_t indices[BLOCK_TEXELS];
+	uint32_t error = FitBC4Alpha(texels, fit, value0, value1, indices);
+
+	for (int iteration = 0; highQuality && iteration < REFINE_ITERATIONS && error > 0; ++iteration) {
+		float endpoint0[4], endpoint1[4];
+		if (!SolveEndpoints(texels, 3, 1, BC4_POSITIONS, indices, endpoint0, endpoint1)) {
+			break;
+		}
+		int32_t refined0 = static_cast<int32_t>(endpoint0[0] + 0.5f);
+		int32_t refined1 = static_cast<int32_t>(endpoint1[0] + 0.5f);
+		uint8_t refinedIndices[BLOCK_TEXELS];
+		uint32_t refinedError = FitBC4Alpha(texels, fit, refined0, refined1, refinedIndices);
+		if (refinedError >= error) {
+			break;
+		}
+		value0 = refined0;
+		value1 = refined1;
+		std::memcpy(indices, refinedIndices, sizeof(indices));
+		error = refinedError;
+	}
+
+	uint64_t packedIndices = 0;
+	for (int t = 0; t < BLOCK_TEXELS; ++t) {
+		packedIndices |= static_cast<uint64_t>(indices[t]) << (3 * t);
+	}
+	block[0] = static_cast<unsigned char>(value0);
+	block[1] = static_cast<unsigned char>(value1);
+	for (int i = 0; i < 6; ++i) {
+		block[2 + i] = static_cast<unsigned char>(packedIndices >> (8 * i));
+	}
+}
+
+// BC7 mode 6 endpoints, 7 bits per channel plus the p-bit shared by the channels of each endpoint
+struct BC7Endpoints {
+	int32_t color[2][4];
+	int32_t pBit[2];
+};
+
+// Function to quantize an endpoint with a given p-bit, returns the squared error of the 8-bit result
+static float QuantizeBC7Endpoint(const float endpoint[4], int32_t pBit, int32_t color[4]) {
+	float error = 0.0f;
+	for (int c = 0; c < 4; ++c) {
+		color[c] = std::min(std::max(static_cast<int32_t>((endpoint[c] - pBit) * 0.5f + 0.5f), 0), 127);
+		float difference = static_cast<float>((color[c] << 1) | pBit) - endpoint[c];
+		error += difference * difference;
+	}
+	return error;
+}
+
+// Function to quantize both endpoints, picking the p-bits closest to them unless given
+static void QuantizeBC7Endpoints(const float endpoint0[4], const float endpoint1[4], int32_t forcedPBits, BC7Endpoints& endpoints) {
+	const float* source[2] = { endpoint0, endpoint1 };
+	for (int e = 0; e < 2; ++e) {
+		if (forcedPBits >= 0) {
+			endpoints.pBit[e] = (forcedPBits >> e) & 1;
+			QuantizeBC7Endpoint(source[e], endpoints.pBit[e], endpoints.color[e]);
+			continue;
+		}
+		int32_t color[4];
+		float error0 = QuantizeBC7Endpoint(source[e], 0, endpoints.color[e]);
+		float error1 = QuantizeBC7Endpoint(source[e], 1, color);
+		endpoints.pBit[e] = error1 < error0 ? 1 : 0;
+		if (error1 < error0) {
+			std::memcpy(endpoints.color[e], color, sizeof(color));
+		}
+	}
+}
+
+// Function to fit the 4-bit indices of a BC7 mode 6 block
+static uint32_t FitBC7Mode6(const BlockColors& texels, FitBlockIndicesFunction fit, const BC7Endpoints& endpoints, uint8_t indices[BLOCK_TEXELS]) {
+	BlockColors palette;
+	for (int c = 0; c < 4; ++c) {
+		int32_t value0 = (endpoints.color[0][c] << 1) | endpoints.pBit[0];
+		int32_t value1 = (endpoints.color[1][c] << 1) | endpoints.pBit[1];
+		for (int i = 0; i < 16; ++i) {
+			palette.channel[c][i] = InterpolateBC7(value0, value1, BC7_WEIGHTS4[i]);
+		}
+	}
+	return fit(texels, palette, 16, 0, 4, indices);
+}
+
+// Function to encode a block as BC7 mode 6
+static void EncodeBC7Mode6(const BlockColors& texels, bool highQuality, FitBlockIndicesFunction fit, unsigned char* block) {
+	float endpoint0[4], endpoint1[4];
+	FitPrincipalAxis(texels, 0, 4, endpoint0, endpoint1);
+	BC7Endpoints endpoints;
+	QuantizeBC7Endpoints(endpoint0, endpoint1, -1, endpoints);
+	uint8_t indices[BLOCK_TEXELS];
+	uint32_t error = FitBC7Mode6(texels, fit, endpoints, indices);
+
+	if (highQuality) {
+		// Every p-bit pair, then least squares endpoints from the best indices
+		for (int32_t pBits = 0; pBits < 4; ++pBits) {
+			BC7Endpoints candidate;
+			uint8_t candidateIndices[BLOCK_TEXELS];
+			QuantizeBC7Endpoints(endpoint0, endpoint1, pBits, candidate);
+			uint32_t candidateError = FitBC7Mode6(texels, fit, candidate, candidateIndices);
+			if (candidateError < error) {
+				endpoints = candidate;
+				std::memcpy(indices, candidateIndices, sizeof(indices));
+				error = candidateError;
+			}
+		}
+
+		float positions[16];
+		for (int i = 0; i < 16; ++i) {
+			positions[i] = BC7_WEIGHTS4[i] * (1.0f / 64.0f);
+		}
+		for (int iteration = 0; iteration < REFINE_ITERATIONS && error > 0; ++iteration) {
+			if (!SolveEndpoints(texels, 0, 4, positions, indices, endpoint0, endpoint1)) {
+				break;
+			}
+			BC7Endpoints refined;
+			uint8_t refinedIndices[BLOCK_TEXELS];
+			QuantizeBC7Endpoints(endpoint0, endpoint1, -1, refined);
+			uint32_t refinedError = FitBC7Mode6(texels, fit, refined, refinedIndices);
+			if (refinedError >= error) {
+				break;
+			}
+			endpoints = refined;
+			std::memcpy(indices, refinedIndices, sizeof(indices));
+			error = refinedError;
+		}
+	}
+
+	// The anchor index is stored without its most significant bit, so it must be below 8, mirroring the segment
+	// gives the same colors because the weights are symmetric
+	if (indices[0] >= 8) {
+		for (int c = 0; c < 4; ++c) {
+			std::swap(endpoints.color[0][c], endpoints.color[1][c]);
+		}
+		std::swap(endpoints.pBit[0], endpoints.pBit[1]);
+		for (int t = 0; t < BLOCK_TEXELS; ++t) {
+			indices[t] = static_cast<uint8_t>(15 - indices[t]);
+		}
+	}
+
+	uint64_t bits[2] = { 0, 0 };
+	uint32_t position = 0;
+	WriteBits(bits, position, 1 << 6, 7);
+	for (int c = 0; c < 4; ++c) {
+		WriteBits(bits, position, static_cast<uint32_t>(endpoints.color[0][c]), 7);
+		WriteBits(bits, position, static_cast<uint32_t>(endpoints.color[1][c]), 7);
+	}
+	WriteBits(bits, position, static_cast<uint32_t>(endpoints.pBit[0]), 1);
+	WriteBits(bits, position, static_cast<uint32_t>(endpoints.pBit[1]), 1);
+	WriteBits(bits, position, indices[0], 3);
+	for (int t = 1; t < BLOCK_TEXELS; ++t) {
+		WriteBits(bits, position, indices[t], 4);
+	}
+	std::memcpy(block, bits, sizeof(bits));
+}
+
+// Function to encode a block in any block compressed format
+static void EncodeBlock(TexelFormat format, bool highQuality, FitBlockIndicesFunction fit, const BlockColors& texels, unsigned char* block) {
+	switch (format) {
+	case TexelFormat::BC1:
+		EncodeBC1(texels, highQuality, fit, block);
+		break;
+	case TexelFormat::BC3:
+		EncodeBC4Alpha(texels, highQuality, fit, block);
+		EncodeBC1(texels, highQuality, fit, block + 8);
+		break;
+	case TexelFormat::BC7:
+		EncodeBC7Mode6(texels, highQuality, fit, block);
+		break;
+	default:
+		break;
+	}
+}
+
+// Function to compress every level of a texture
+bool CompressTexture(ThreadPool& pool, const BlockCompressionOptions& options, const TextureData& source, TextureData& compressed) {
+	uint32_t blockBytes = GetBlockBytes(options.format);
+	if (blockBytes == 0 || source.format != TexelFormat::RGBA8 || &source == &compressed) {
+		std::cerr << "Unsupported texture compression: " << TexelFormatName(source.format) << " to " << TexelFormatName(options.format) << std::endl;
+		return false;
+	}
+	FitBlockIndicesFunction fit = SelectFitBlockIndices(options.simdLevel);
+
+	compressed.width = source.width;
+	compressed.height = source.height;
+	compressed.format = options.format;
+	compressed.mips.resize(source.mips.size());
+	for (size_t level = 0; level <= source.mips.size(); ++level) {
+		const TexelBuffer& pixels = level == 0 ? source.pixels : source.mips[level - 1].pixels;
+		int width = level == 0 ? source.width : source.mips[level - 1].width;
+		int height = level == 0 ? source.height : source.mips[level - 1].height;
+		TexelBuffer& blocks = level == 0 ? compressed.pixels : compressed.mips[level - 1].pixels;
+		if (level > 0) {
+			compressed.mips[level - 1].width = width;
+			compressed.mips[level - 1].height = height;
+		}
+
+		blocks.resize(GetLevelBytes(options.format, width, height));
+		size_t rowPitch = GetRowPitch(options.format, width);
+		int blocksWide = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+		int blocksHigh = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+		pool.ParallelFor(static_cast<uint32_t>(blocksHigh), [&](uint32_t blockY, uint32_t) {
+			BlockColors texels;
+			unsigned char* row = blocks.data() + blockY * rowPitch;
+			for (int blockX = 0; blockX < blocksWide; ++blockX) {
+				LoadBlock(pixels.data(), width, height, blockX, static_cast<int>(blockY), texels);
+				EncodeBlock(options.format, options.highQuality, fit, texels, row + static_cast<size_t>(blockX) * blockBytes);
+			}
+		});
+	}
+	return true;
+}
+
+// Function to decompress every level of a texture
+bool DecompressTexture(ThreadPool& pool, const TextureData& compressed, TextureData& decoded) {
+	uint32_t blockBytes = GetBlockBytes(compressed.format);
+	if (blockBytes == 0 || &compressed == &decoded) {
+		std::cerr << "Unsupported texture decompression: " << TexelFormatName(compressed.format) << std::endl;
+		return false;
+	}
+
+	decoded.width = compressed.width;
+	decoded.height = compressed.height;
+	decoded.format = TexelFormat::RGBA8;
+	decoded.mips.resize(compressed.mips.size());
+	for (size_t level = 0; level <= compressed.mips.size(); ++level) {
+		const TexelBuffer& blocks = level == 0 ? compressed.pixels : compressed.mips[level - 1].pixels;
+		int width = level == 0 ? compressed.width : compressed.mips[level - 1].width;
+		int height = level == 0 ? compressed.height : compressed.mips[level - 1].height;
+		TexelBuffer& pixels = level == 0 ? decoded.pixels : decoded.mips[level - 1].pixels;
+		if (level > 0) {
+			decoded.mips[level - 1].width = width;
+			decoded.mips[level - 1].height = height;
+		}
+
+		pixels.resize(static_cast<size_t>(width) * height * 4);
+		size_t rowPitch = GetRowPitch(compressed.format, width);
+		int blocksWide = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+		int blocksHigh = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+		pool.ParallelFor(static_cast<uint32_t>(blocksHigh), [&](uint32_t blockY, uint32_t) {
+			unsigned char rgba[BLOCK_TEXELS * 4];
+			for (int blockX = 0; blockX < blocksWide; ++blockX) {
+				DecodeBlock(compressed.format, blocks.data() + blockY * rowPitch + static_cast<size_t>(blockX) * blockBytes, rgba);
+
+				// Only the texels inside the level are kept
+				int x = blockX * BLOCK_DIMENSION;
+				int columns = std::min(BLOCK_DIMENSION, width - x);
+				for (int ty = 0; ty < BLOCK_DIMENSION; ++ty) {
+					int y = static_cast<int>(blockY) * BLOCK_DIMENSION + ty;
+					if (y >= height) {
+						break;
+					}
+					std::memcpy(&pixels[(static_cast<size_t>(y) * width + x) * 4], rgba + ty * BLOCK_DIMENSION * 4, static_cast<size_t>(columns) * 4);
+				}
+			}
+		});
+	}
+	return true;
+}
+
+// Function to decode all texels of a block
+void DecodeBlock(TexelFormat format, const unsigned char* block, unsigned char rgba[BLOCK_TEXELS * 4]) {
+	DecodeTexels(format, block, 0, BLOCK_TEXELS, rgba);
+}
+
+// Function to decode one texel of the base level
+uint32_t FetchBlockTexel(const TextureData& texture, int x, int y) {
+	return FetchBlockTexel(texture.format, texture.pixels.data(), texture.width, x, y);
+}
+
+// Function to decode one texel of a level
+uint32_t FetchBlockTexel(TexelFormat format, const unsigned char* blocks, int width, int x, int y) {
+	const unsigned char* block = blocks + (y / BLOCK_DIMENSION) * GetRowPitch(format, width) + static_cast<size_t>(x / BLOCK_DIMENSION) * GetBlockBytes(format);
+	unsigned char rgba[4];
+	DecodeTexels(format, block, (y % BLOCK_DIMENSION) * BLOCK_DIMENSION + x % BLOCK_DIMENSION, 1, rgba);
+	uint32_t texel;
+	std::memcpy(&texel, rgba, sizeof(texel));
+	return texel;
+}
+
+// Function to pad the base level to whole blocks by repeating its last column and row
+bool PadToBlocks(TextureData& texture) {
+	int width = (texture.width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION * BLOCK_DIMENSION;
+	int height = (texture.height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION * BLOCK_DIMENSION;
+	if (texture.format != TexelFormat::RGBA8 || texture.width == 0 || texture.height == 0 || (width == texture.width && height == texture.height)) {
+		return false;
+	}
+
+	// Rows only move towards the end, so they can be spread out in place starting from the last one
+	size_t rowBytes = static_cast<size_t>(width) * 4;
+	texture.pixels.resize(rowBytes * height);
+	for (int y = texture.height - 1; y >= 0; --y) {
+		unsigned char* row = &texture.pixels[static_cast<size_t>(y) * rowBytes];
+		std::memmove(row, &texture.pixels[static_cast<size_t>(y) * texture.width * 4], static_cast<size_t>(texture.width) * 4);
+		for (int x = texture.width; x < width; ++x) {
+			std::memcpy(row + static_cast<size_t>(x) * 4, row + static_cast<size_t>(texture.width - 1) * 4, 4);
+		}
+	}
+	for (int y = texture.height; y < height; ++y) {
+		std::memcpy(&texture.pixels[static_cast<size_t>(y) * rowBytes], &texture.pixels[static_cast<size_t>(texture.height - 1) * rowBytes], rowBytes);
+	}
+	texture.width = width;
+	texture.height = height;
+	texture.mips.clear();
+	return true;
+}
+
+// Function to get the name of a texel format
+const char* TexelFormatName(TexelFormat format) {
+	switch (format) {
+	case TexelFormat::BC1: return "bc1";
+	case TexelFormat::BC3: return "bc3";
+	case TexelFormat::BC7: return "bc7";
+	default: return "rgba8";
+	}
+}
+
+// Function to parse a texel format name
+bool ParseTexelFormat(const char* name, TexelFormat& format) {
+	const TexelFormat formats[] = { TexelFormat::RGBA8, TexelFormat::BC1, TexelFormat::BC3, TexelFormat::BC7 };
+	for (TexelFormat candidate : formats) {
+		if (std::strcmp(name, TexelFormatName(candidate)) == 0) {
+			format = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Function to fit the indices of a block one texel at a time
+uint32_t FitBlockIndicesScalar(const BlockColors& texels, const BlockColors& palette, uint32_t paletteSize,
+	uint32_t firstChannel, uint32_t channelCount, uint8_t indices[BLOCK_TEXELS]) {
+	uint32_t error = 0;
+	for (int t = 0; t < BLOCK_TEXELS; ++t) {
+		int32_t bestDistance = INT_MAX;
+		uint32_t bestIndex = 0;
+		for (uint32_t p = 0; p < paletteSize; ++p) {
+			int32_t distance = 0;
+			for (uint32_t c = firstChannel; c < firstChannel + channelCount; ++c) {
+				int32_t difference = texels.channel[c][t] - palette.channel[c][p];
+				distance += difference * difference;
+			}
+			if (distance < bestDistance) {
+				bestDistance = distance;
+				bestIndex = p;
+			}
+		}
+		indices[t] = static_cast<uint8_t>(bestIndex);
+		error += static_cast<uint32_t>(bestDistance);
+	}
+	return error;
+}
+
+#ifdef SIMD_X86
+// Function to fit the indices of a block with the 16 texels in two vectors
+SIMD_TARGET_AVX2 uint32_t FitBlockIndicesAVX2(const BlockColors& texels, const BlockColors& palette, uint32_t paletteSize,
+	uint32_t firstChannel, uint32_t channelCount, uint8_t indices[BLOCK_TEXELS]) {
+	__m256i low[4], high[4];
+	for (uint32_t c = 0; c < channelCount; ++c) {
+		low[c] = _mm256_load_si256(reinterpret_cast<const __m256i*>(texels.channel[firstChannel + c]));
+		high[c] = _mm256_load_si256(reinterpret_cast<const __m256i*>(texels.channel[firstChannel + c] + 8));
+	}
+
+	__m256i bestLow = _mm256_set1_epi32(INT_MAX);
+	__m256i bestHigh = _mm256_set1_epi32(INT_MAX);
+	__m256i indexLow = _mm256_setzero_si256();
+	__m256i indexHigh = _mm256_setzero_si256();
+	for (uint32_t p = 0; p < paletteSize; ++p) {
+		__m256i distanceLow = _mm256_setzero_si256();
+		__m256i distanceHigh = _mm256_setzero_si256();
+		for (uint32_t c = 0; c < channelCount; ++c) {
+			__m256i color = _mm256_set1_epi32(palette.channel[firstChannel + c][p]);
+			__m256i differenceLow = _mm256_sub_epi32(low[c], color);
+			__m256i differenceHigh = _mm256_sub_epi32(high[c], color);
+			distanceLow = _mm256_add_epi32(distanceLow, _mm256_mullo_epi32(differenceLow, differenceLow));
+			distanceHigh = _mm256_add_epi32(distanceHigh, _mm256_mullo_epi32(differenceHigh, differenceHigh));
+		}
+
+		// Strictly closer only, so ties keep the lowest index
+		__m256i index = _mm256_set1_epi32(static_cast<int32_t>(p));
+		indexLow = _mm256_blendv_epi8(indexLow, index, _mm256_cmpgt_epi32(bestLow, distanceLow));
+		indexHigh = _mm256_blendv_epi8(indexHigh, index, _mm256_cmpgt_epi32(bestHigh, distanceHigh));
+		bestLow = _mm256_min_epi32(bestLow, distanceLow);
+		bestHigh = _mm256_min_epi32(bestHigh, distanceHigh);
+	}
+
+	// Narrow the indices to bytes, packs interleaves the 128-bit halves so they are put back in order
+	__m256i packed = _mm256_packs_epi32(indexLow, indexHigh);
+	packed = _mm256_packus_epi16(packed, packed);
+	packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 0, 0, 0, 0));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(indices), _mm256_castsi256_si128(packed));
+
+	__m256i error = _mm256_add_epi32(bestLow, bestHigh);
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(error), _mm256_extracti128_si256(error, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+}
+#endif
+
+// Function to pick the index fitting kernel
+FitBlockIndicesFunction SelectFitBlockIndices(SimdLevel level) {
+#ifdef SIMD_X86
+	SimdLevel available = DetectSimdLevel();
+	if (level > available) {
+		level = available;
+	}
+	return level >= SimdLevel::AVX2 ? FitBlockIndicesAVX2 : FitBlockIndicesScalar;
+#else
+	(void)level;
+	return FitBlockIndicesScalar;
+#endif
+}
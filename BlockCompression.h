@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CpuFeatures.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+// Block compressed formats encode 4x4 texels at a time
+const int BLOCK_DIMENSION = 4;
+const int BLOCK_TEXELS = BLOCK_DIMENSION * BLOCK_DIMENSION;
+
+// How CompressTexture() encodes the blocks
+struct BlockCompressionOptions {
+	TexelFormat format = TexelFormat::BC7;
+	bool highQuality = false;                 // refine the endpoints by least squares, several times slower
+	SimdLevel simdLevel = SimdLevel::AVX512;  // lowered to what the CPU supports
+};
+
+// Texels of a block or the colors of a block's palette, one array per RGBA channel
+struct alignas(32) BlockColors {
+	int32_t channel[4][BLOCK_TEXELS];
+};
+
+/// <summary>
+/// Returns the size of one 4x4 block of a texel format.
+/// </summary>
+/// <param name="format">- The texel format.</param>
+/// <returns>8 for BC1, 16 for BC3 and BC7, 0 for formats that are not block compressed.</returns>
+inline uint32_t GetBlockBytes(TexelFormat format) {
+	switch (format) {
+	case TexelFormat::BC1: return 8;
+	case TexelFormat::BC3: return 16;
+	case TexelFormat::BC7: return 16;
+	default: return 0;
+	}
+}
+
+/// <summary>
+/// Returns the size of one row of texels, or of one row of blocks for block compressed formats, as Direct3D expects it in SysMemPitch.
+/// </summary>
+/// <param name="format">- The texel format.</param>
+/// <param name="width">- Width of the level in texels.</param>
+/// <returns>The row pitch in bytes.</returns>
+inline size_t GetRowPitch(TexelFormat format, int width) {
+	uint32_t blockBytes = GetBlockBytes(format);
+	if (blockBytes == 0) {
+		return static_cast<size_t>(width) * 4;
+	}
+	return static_cast<size_t>((width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION) * blockBytes;
+}
+
+/// <summary>
+/// Returns the size of a whole level.
+/// </summary>
+/// <param name="format">- The texel format.</param>
+/// <param name="width">- Width of the level in texels.</param>
+/// <param name="height">- Height of the level in texels.</param>
+/// <returns>The level size in bytes.</returns>
+inline size_t GetLevelBytes(TexelFormat format, int width, int height) {
+	int rows = GetBlockBytes(format) == 0 ? height : (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	return GetRowPitch(format, width) * rows;
+}
+
+/// <summary>
+/// Compresses every level of an RGBA8 texture, block rows are spread across the pool.
+/// BC1 encodes opaque RGB, BC3 adds an alpha block, BC7 always uses mode 6: RGBA with 7-bit endpoints plus a p-bit each.
+/// The fast mode fits endpoints to the principal axis of each block, the high quality mode then refines them by least squares.
+/// </summary>
+/// <param name="pool">- The threads encoding the block rows.</param>
+/// <param name="options">- Format, quality and SIMD level.</param>
+/// <param name="source">- The RGBA8 texture with its mips.</param>
+/// <param name="compressed">- Receives the compressed levels, must not be the source.</param>
+/// <returns>True if the texture was compressed, otherwise false.</returns>
+bool CompressTexture(ThreadPool& pool, const BlockCompressionOptions& options, const TextureData& source, TextureData& compressed);
+
+/// <summary>
+/// Decompresses every level of a block compressed texture to RGBA8, block rows are spread across the pool.
+/// </summary>
+/// <param name="pool">- The threads decoding the block rows.</param>
+/// <param name="compressed">- The block compressed texture with its mips.</param>
+/// <param name="decoded">- Receives the RGBA8 levels, must not be the compressed texture.</param>
+/// <returns>True if the texture was decompressed, otherwise false.</returns>
+bool DecompressTexture(ThreadPool& pool, const TextureData& compressed, TextureData& decoded);
+
+/// <summary>
+/// Decodes the 16 texels of a block to RGBA8 in row order. BC7 blocks in the single subset modes 4, 5 and 6 are decoded,
+/// the partitioned modes are never written by CompressTexture() and decode to transparent black like reserved modes.
+/// </summary>
+/// <param name="format">- The block compressed format.</param>
+/// <param name="block">- The block.</param>
+/// <param name="rgba">- Receives 16 RGBA8 texels.</param>
+void DecodeBlock(TexelFormat format, const unsigned char* block, unsigned char rgba[BLOCK_TEXELS * 4]);
+
+/// <summary>
+/// Decodes a single texel of a block compressed texture's base level, so samplers can read compressed data directly.
+/// </summary>
+/// <param name="texture">- The block compressed texture.</param>
+/// <param name="x">- Column of the texel.</param>
+/// <param name="y">- Row of the texel.</param>
+/// <returns>The texel as RGBA8 in memory order, red in the lowest byte.</returns>
+uint32_t FetchBlockTexel(const TextureData& texture, int x, int y);
+
+/// <summary>
+/// Decodes a single texel of any block compressed level.
+/// </summary>
+/// <param name="format">- The block compressed format.</param>
+/// <param name="blocks">- The blocks of the level.</param>
+/// <param name="width">- Width of the level in texels.</param>
+/// <param name="x">- Column of the texel.</param>
+/// <param name="y">- Row of the texel.</param>
+/// <returns>The texel as RGBA8 in memory order, red in the lowest byte.</returns>
+uint32_t FetchBlockTexel(TexelFormat format, const unsigned char* blocks, int width, int x, int y);
+
+/// <summary>
+/// Pads the base level of an RGBA8 texture to whole blocks, Direct3D requires the base level of a block compressed texture
+/// to be a multiple of 4 texels in both directions. At most 3 columns and rows repeating the right and bottom edges are added,
+/// so no texel is lost. Padding drops the mips, rebuild them with BuildMipChain().
+/// </summary>
+/// <param name="texture">- The texture to pad.</param>
+/// <returns>True if the texture was padded, otherwise false.</returns>
+bool PadToBlocks(TextureData& texture);
+
+/// <summary>
+/// Returns a printable name for a texel format.
+/// </summary>
+/// <param name="format">- The texel format.</param>
+/// <returns>"rgba8", "bc1", "bc3" or "bc7".</returns>
+const char* TexelFormatName(TexelFormat format);
+
+/// <summary>
+/// Parses a texel format name as returned by TexelFormatName().
+/// </summary>
+/// <param name="name">- The name to parse.</param>
+/// <param name="format">- Receives the parsed format.</param>
+/// <returns>True if the name is known, otherwise false.</returns>
+bool ParseTexelFormat(const char* name, TexelFormat& format);
+
+// Picks the closest palette color of every texel, comparing the squared distance over channelCount channels from firstChannel on.
+// Ties go to the lowest index. Every kernel computes exact integer distances, so their outputs are bit-identical.
+// Returns the summed squared error of the block.
+typedef uint32_t (*FitBlockIndicesFunction)(const BlockColors& texels, const BlockColors& palette, uint32_t paletteSize,
+	uint32_t firstChannel, uint32_t channelCount, uint8_t indices[BLOCK_TEXELS]);
+
+/// <summary>
+/// Portable index fitting kernel, one texel at a time.
+/// </summary>
+uint32_t FitBlockIndicesScalar(const BlockColors& texels, const BlockColors& palette, uint32_t paletteSize,
+	uint32_t firstChannel, uint32_t channelCount, uint8_t indices[BLOCK_TEXELS]);
+
+#ifdef SIMD_X86
+/// <summary>
+/// AVX2 index fitting kernel, all 16 texels against one palette color at a time.
+/// </summary>
+uint32_t FitBlockIndicesAVX2(const BlockColors& texels, const BlockColors& palette, uint32_t paletteSize,
+	uint32_t firstChannel, uint32_t channelCount, uint8_t indices[BLOCK_TEXELS]);
+#endif
+
+/// <summary>
+/// Picks the index fitting kernel for a SIMD level, lowered to what the CPU supports. AVX-512 uses the AVX2 kernel.
+/// </summary>
+/// <param name="level">- The requested SIMD level.</param>
+/// <returns>The index fitting kernel.</returns>
+FitBlockIndicesFunction SelectFitBlockIndices(SimdLevel level);
@@ -2,6 +2,8 @@
 #include <Windows.h>
 #include <iostream>
 
+#include "ShaderConstants.h"
+
 namespace DX = DirectX;
 
 // Function to create the world matrix
@@ -64,14 +66,7 @@ static bool CreateVSConstBuffer(ID3D11Device* device, DX::XMFLOAT4X4 matrixArray
 
 // Function to create pixel shader constant buffer
 static bool CreatePSConstBuffer(ID3D11Device* device, ID3D11Buffer*& buffer) {
-	struct constants {
-		DX::XMFLOAT4 lightPosition = { 0.0f, 0.5f, -5.0f, 1.0f };
-		DX::XMFLOAT4 lightColor = { 1.0f, 1.0f, 1.0f, 1.0f };
-		DX::XMFLOAT4 cameraPosition = { 0.0f, 0.0f, -3.0f, 1.0f };
-		float ambientLightIntensity = 0.01f;
-		float shininess = 200.0f;
-		char padding[8];
-	} constants;
+	PixelShaderConstants constants;
 
 	D3D11_BUFFER_DESC bufferDesc = {
 		bufferDesc.ByteWidth = sizeof(constants),
@@ -0,0 +1,103 @@
+#include "CpuFeatures.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(SIMD_X86)
+#include <cpuid.h>
+#endif
+
+#ifdef SIMD_X86
+// Function to query a CPUID leaf, registers are returned as eax, ebx, ecx, edx
+static void CpuId(uint32_t leaf, uint32_t subleaf, uint32_t registers[4]) {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+	for (int i = 0; i < 4; ++i) {
+		registers[i] = static_cast<uint32_t>(info[i]);
+	}
+#else
+	__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// Function to read the extended control register 0, which tells which register states the OS saves
+static uint64_t ReadXCR0() {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32_t low, high;
+	__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+}
+
+// Function to detect the SIMD level, see DetectSimdLevel()
+static SimdLevel QuerySimdLevel() {
+	uint32_t registers[4];
+	CpuId(0, 0, registers);
+	uint32_t maxLeaf = registers[0];
+	if (maxLeaf < 7) {
+		return SimdLevel::Scalar;
+	}
+
+	CpuId(1, 0, registers);
+	bool osxsave = (registers[2] >> 27) & 1;
+	bool fma = (registers[2] >> 12) & 1;
+	bool f16c = (registers[2] >> 29) & 1;
+	if (!osxsave) {
+		return SimdLevel::Scalar;
+	}
+
+	// The OS must save the XMM/YMM state (bits 1-2) for AVX and the opmask/ZMM state (bits 5-7) for AVX-512
+	uint64_t xcr0 = ReadXCR0();
+	bool ymmEnabled = (xcr0 & 0x6) == 0x6;
+	bool zmmEnabled = (xcr0 & 0xE6) == 0xE6;
+
+	CpuId(7, 0, registers);
+	bool avx2 = (registers[1] >> 5) & 1;
+	bool avx512f = (registers[1] >> 16) & 1;
+	bool avx512bw = (registers[1] >> 30) & 1;
+
+	if (avx2 && fma && f16c && avx512f && avx512bw && zmmEnabled) {
+		return SimdLevel::AVX512;
+	}
+	if (avx2 && fma && f16c && ymmEnabled) {
+		return SimdLevel::AVX2;
+	}
+	return SimdLevel::Scalar;
+}
+#else
+static SimdLevel QuerySimdLevel() {
+	return SimdLevel::Scalar;
+}
+#endif
+
+// Function to detect the SIMD level once
+SimdLevel DetectSimdLevel() {
+	static const SimdLevel level = QuerySimdLevel();
+	return level;
+}
+
+// Function to name a SIMD level
+const char* SimdLevelName(SimdLevel level) {
+	switch (level) {
+	case SimdLevel::AVX2: return "avx2";
+	case SimdLevel::AVX512: return "avx512";
+	default: return "scalar";
+	}
+}
+
+// Function to parse a SIMD level name
+bool ParseSimdLevel(const char* name, SimdLevel& level) {
+	const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::AVX2, SimdLevel::AVX512 };
+	for (SimdLevel candidate : levels) {
+		if (std::strcmp(name, SimdLevelName(candidate)) == 0) {
+			level = candidate;
+			return true;
+		}
+	}
+	return false;
+}
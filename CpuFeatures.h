@@ -0,0 +1,44 @@
+#pragma once
+
+// Instruction sets the software renderer has kernels for, ordered from slowest to fastest
+enum class SimdLevel {
+	Scalar,
+	AVX2,  // with FMA and F16C, present on every AVX2 CPU
+	AVX512
+};
+
+// Kernels using wider instruction sets than the build baseline are compiled per function,
+// MSVC accepts the intrinsics without flags while GCC and Clang need a target attribute
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx2,fma,f16c")))
+#else
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_AVX512
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#endif
+
+/// <summary>
+/// Detects the widest instruction set supported by both the CPU (CPUID) and the operating system (XGETBV).
+/// The result is computed once and cached.
+/// </summary>
+/// <returns>The fastest usable SIMD level.</returns>
+SimdLevel DetectSimdLevel();
+
+/// <summary>
+/// Returns a printable name for a SIMD level.
+/// </summary>
+/// <param name="level">- The SIMD level.</param>
+/// <returns>"scalar", "avx2" or "avx512".</returns>
+const char* SimdLevelName(SimdLevel level);
+
+/// <summary>
+/// Parses a SIMD level name as returned by SimdLevelName().
+/// </summary>
+/// <param name="name">- The name to parse.</param>
+/// <param name="level">- Receives the parsed level.</param>
+/// <returns>True if the name is known, otherwise false.</returns>
+bool ParseSimdLevel(const char* name, SimdLevel& level);
@@ -0,0 +1,99 @@
+#include "EdgeKernels.h"
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Function to compute block coverage one pixel at a time
+uint64_t BlockCoverageScalar(const int32_t e[3], const int32_t a[3], const int32_t b[3]) {
+	uint64_t mask = 0;
+	int32_t row0 = e[0], row1 = e[1], row2 = e[2];
+
+	for (uint32_t row = 0; row < 8; ++row) {
+		int32_t e0 = row0, e1 = row1, e2 = row2;
+		for (uint32_t column = 0; column < 8; ++column) {
+			// The sign bit of the OR is set if any edge is negative
+			if ((e0 | e1 | e2) >= 0) {
+				mask |= uint64_t(1) << (row * 8 + column);
+			}
+			e0 += a[0];
+			e1 += a[1];
+			e2 += a[2];
+		}
+		row0 += b[0];
+		row1 += b[1];
+		row2 += b[2];
+	}
+	return mask;
+}
+
+#ifdef SIMD_X86
+// Function to compute block coverage one 8 pixel row at a time
+SIMD_TARGET_AVX2 uint64_t BlockCoverageAVX2(const int32_t e[3], const int32_t a[3], const int32_t b[3]) {
+	const __m256i columns = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i row0 = _mm256_add_epi32(_mm256_set1_epi32(e[0]), _mm256_mullo_epi32(_mm256_set1_epi32(a[0]), columns));
+	__m256i row1 = _mm256_add_epi32(_mm256_set1_epi32(e[1]), _mm256_mullo_epi32(_mm256_set1_epi32(a[1]), columns));
+	__m256i row2 = _mm256_add_epi32(_mm256_set1_epi32(e[2]), _mm256_mullo_epi32(_mm256_set1_epi32(a[2]), columns));
+	const __m256i step0 = _mm256_set1_epi32(b[0]);
+	const __m256i step1 = _mm256_set1_epi32(b[1]);
+	const __m256i step2 = _mm256_set1_epi32(b[2]);
+
+	uint64_t mask = 0;
+	for (uint32_t row = 0; row < 8; ++row) {
+		__m256i any = _mm256_or_si256(_mm256_or_si256(row0, row1), row2);
+		uint32_t outside = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(any)));
+		mask |= static_cast<uint64_t>(~outside & 0xFF) << (row * 8);
+
+		row0 = _mm256_add_epi32(row0, step0);
+		row1 = _mm256_add_epi32(row1, step1);
+		row2 = _mm256_add_epi32(row2, step2);
+	}
+	return mask;
+}
+
+// Function to compute block coverage two 8 pixel rows at a time
+SIMD_TARGET_AVX512 uint64_t BlockCoverageAVX512(const int32_t e[3], const int32_t a[3], const int32_t b[3]) {
+	// Lanes 0-7 hold the even row, lanes 8-15 the odd row
+	const __m512i columns = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7);
+	const __m512i rows = _mm512_setr_epi32(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1);
+
+	__m512i value[3], step[3];
+	for (int i = 0; i < 3; ++i) {
+		value[i] = _mm512_add_epi32(_mm512_set1_epi32(e[i]),
+			_mm512_add_epi32(_mm512_mullo_epi32(_mm512_set1_epi32(a[i]), columns), _mm512_mullo_epi32(_mm512_set1_epi32(b[i]), rows)));
+		step[i] = _mm512_set1_epi32(b[i] * 2);
+	}
+
+	uint64_t mask = 0;
+	for (uint32_t row = 0; row < 8; row += 2) {
+		__m512i any = _mm512_or_si512(_mm512_or_si512(value[0], value[1]), value[2]);
+		__mmask16 inside = _mm512_cmpge_epi32_mask(any, _mm512_setzero_si512());
+		mask |= static_cast<uint64_t>(inside) << (row * 8);
+
+		for (int i = 0; i < 3; ++i) {
+			value[i] = _mm512_add_epi32(value[i], step[i]);
+		}
+	}
+	return mask;
+}
+#endif
+
+// Function to pick the coverage kernel
+BlockCoverageFunction SelectBlockCoverage(SimdLevel level) {
+#ifdef SIMD_X86
+	SimdLevel available = DetectSimdLevel();
+	if (level > available) {
+		level = available;
+	}
+
+	if (level == SimdLevel::AVX512) {
+		return BlockCoverageAVX512;
+	}
+	if (level == SimdLevel::AVX2) {
+		return BlockCoverageAVX2;
+	}
+#else
+	(void)level;
+#endif
+	return BlockCoverageScalar;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+#include "CpuFeatures.h"
+
+// Computes the coverage of an 8x8 pixel block from three edge functions. Bit (row * 8 + column) is set when
+// e[i] + a[i] * column + b[i] * row >= 0 for every edge. All kernels use the same 32-bit integer math,
+// so their masks are bit-identical on every machine.
+typedef uint64_t (*BlockCoverageFunction)(const int32_t e[3], const int32_t a[3], const int32_t b[3]);
+
+/// <summary>
+/// Portable coverage kernel, one pixel at a time with incremental stepping.
+/// </summary>
+uint64_t BlockCoverageScalar(const int32_t e[3], const int32_t a[3], const int32_t b[3]);
+
+#ifdef SIMD_X86
+/// <summary>
+/// AVX2 coverage kernel, evaluates one 8x1 row per step.
+/// </summary>
+uint64_t BlockCoverageAVX2(const int32_t e[3], const int32_t a[3], const int32_t b[3]);
+
+/// <summary>
+/// AVX-512 coverage kernel, evaluates two rows (16 pixels) per step.
+/// </summary>
+uint64_t BlockCoverageAVX512(const int32_t e[3], const int32_t a[3], const int32_t b[3]);
+#endif
+
+/// <summary>
+/// Picks the coverage kernel for a SIMD level, falling back to narrower kernels when the level is not available.
+/// </summary>
+/// <param name="level">- The requested SIMD level.</param>
+/// <returns>The coverage kernel.</returns>
+BlockCoverageFunction SelectBlockCoverage(SimdLevel level);
@@ -0,0 +1,185 @@
+#include "FileView.h"
+
+#include <atomic>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<uint64_t> filesOpened{ 0 };
+static std::atomic<uint64_t> systemCalls{ 0 };
+static std::atomic<uint64_t> bytesMapped{ 0 };
+
+FileView::~FileView() {
+	Close();
+}
+
+FileView::FileView(FileView&& other) noexcept
+	: data(other.data), size(other.size), open(other.open) {
+	other.data = nullptr;
+	other.size = 0;
+	other.open = false;
+}
+
+FileView& FileView::operator=(FileView&& other) noexcept {
+	if (this != &other) {
+		Close();
+		data = other.data;
+		size = other.size;
+		open = other.open;
+		other.data = nullptr;
+		other.size = 0;
+		other.open = false;
+	}
+	return *this;
+}
+
+// Function to map a whole file read-only
+bool FileView::Open(const std::string& filePath, FileAccess access) {
+	Close();
+
+#ifdef _WIN32
+	// The sequential scan and random access flags are the Windows counterparts of the madvise() hints
+	DWORD flags = FILE_ATTRIBUTE_NORMAL;
+	if (access == FileAccess::Sequential) {
+		flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+	}
+	else if (access == FileAccess::Random) {
+		flags |= FILE_FLAG_RANDOM_ACCESS;
+	}
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+	systemCalls.fetch_add(1);
+	if (file == INVALID_HANDLE_VALUE) {
+		std::cerr << "Could not open file: " << filePath << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	systemCalls.fetch_add(1);
+	if (!GetFileSizeEx(file, &fileSize)) {
+		std::cerr << "Could not open file: " << filePath << std::endl;
+		CloseHandle(file);
+		systemCalls.fetch_add(1);
+		return false;
+	}
+
+	// Mapping an empty file fails, so there is nothing to map
+	void* view = nullptr;
+	if (fileSize.QuadPart > 0) {
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		systemCalls.fetch_add(1);
+		if (mapping != nullptr) {
+			view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			// The view keeps the mapping alive
+			CloseHandle(mapping);
+			systemCalls.fetch_add(2);
+		}
+		if (view == nullptr) {
+			std::cerr << "Failed to map file: " << filePath << std::endl;
+			CloseHandle(file);
+			systemCalls.fetch_add(1);
+			return false;
+		}
+	}
+	CloseHandle(file);
+	systemCalls.fetch_add(1);
+	size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int file = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+	systemCalls.fetch_add(1);
+	if (file < 0) {
+		std::cerr << "Could not open file: " << filePath << std::endl;
+		return false;
+	}
+
+	struct stat status;
+	systemCalls.fetch_add(1);
+	if (fstat(file, &status) != 0) {
+		std::cerr << "Could not open file: " << filePath << std::endl;
+		::close(file);
+		systemCalls.fetch_add(1);
+		return false;
+	}
+
+	// Mapping an empty file fails, so there is nothing to map
+	void* view = nullptr;
+	if (status.st_size > 0) {
+		view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		systemCalls.fetch_add(1);
+		if (view == MAP_FAILED) {
+			std::cerr << "Failed to map file: " << filePath << std::endl;
+			::close(file);
+			systemCalls.fetch_add(1);
+			return false;
+		}
+		if (access != FileAccess::Normal) {
+			madvise(view, static_cast<size_t>(status.st_size), access == FileAccess::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+			systemCalls.fetch_add(1);
+		}
+	}
+	// The mapping keeps the file alive
+	::close(file);
+	systemCalls.fetch_add(1);
+	size = static_cast<size_t>(status.st_size);
+#endif
+
+	data = static_cast<const unsigned char*>(view);
+	open = true;
+	filesOpened.fetch_add(1);
+	bytesMapped.fetch_add(size);
+	return true;
+}
+
+// Function to unmap the file
+void FileView::Close() {
+	if (data != nullptr) {
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		munmap(const_cast<unsigned char*>(data), size);
+#endif
+		systemCalls.fetch_add(1);
+	}
+	data = nullptr;
+	size = 0;
+	open = false;
+}
+
+// Function to read the FileView counters
+FileViewStats GetFileViewStats() {
+	FileViewStats stats;
+	stats.filesOpened = filesOpened.load();
+	stats.systemCalls = systemCalls.load();
+	stats.bytesMapped = bytesMapped.load();
+	return stats;
+}
+
+// Function to drop a file from the OS file cache
+bool EvictFileCache(const std::string& filePath) {
+#ifdef _WIN32
+	// Opening a file unbuffered makes the cache manager purge its cached pages
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_NO_BUFFERING, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	CloseHandle(file);
+	return true;
+#else
+	int file = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file < 0) {
+		return false;
+	}
+	bool evicted = posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	::close(file);
+	return evicted;
+#endif
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Totals over every FileView opened by the process
+struct FileViewStats {
+	uint64_t filesOpened = 0;
+	uint64_t systemCalls = 0;  // open, size query, map, hint, unmap and close calls made by FileView
+	uint64_t bytesMapped = 0;
+};
+
+// How a FileView will be read, passed on to the OS to pick its read-ahead
+enum class FileAccess {
+	Normal,      // no hint, the OS default read-ahead
+	Sequential,  // one scan of the whole file front to back, read ahead aggressively and drop pages behind
+	Random       // reads at scattered offsets, no read-ahead beyond the pages touched
+};
+
+// Read-only view of a whole file, memory mapped so readers use the page cache pages without copying them.
+class FileView {
+public:
+	FileView() = default;
+	~FileView();
+
+	FileView(const FileView&) = delete;
+	FileView& operator=(const FileView&) = delete;
+	FileView(FileView&& other) noexcept;
+	FileView& operator=(FileView&& other) noexcept;
+
+	/// <summary>
+	/// Maps a file, closing any file the view already holds. Empty files open as an empty view.
+	/// </summary>
+	/// <param name="filePath">- The file to map.</param>
+	/// <param name="access">- How the view will be read, Sequential only for whole-file scans.</param>
+	/// <returns>True if the file was opened, otherwise false.</returns>
+	bool Open(const std::string& filePath, FileAccess access);
+
+	/// <summary>
+	/// Unmaps the file, the view is empty afterwards.
+	/// </summary>
+	void Close();
+
+	const unsigned char* Data() const { return data; }
+	size_t Size() const { return size; }
+	bool IsOpen() const { return open; }
+
+private:
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+	bool open = false;
+};
+
+/// <summary>
+/// Reads the FileView counters.
+/// </summary>
+FileViewStats GetFileViewStats();
+
+/// <summary>
+/// Drops a file's pages from the OS file cache so the next read comes from disk, for cold start measurements.
+/// Dirty pages are not written back and stay cached.
+/// </summary>
+/// <param name="filePath">- The file to evict.</param>
+/// <returns>True if the OS accepted the request, otherwise false.</returns>
+bool EvictFileCache(const std::string& filePath);
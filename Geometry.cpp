@@ -0,0 +1,71 @@
+#include "Geometry.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Function to create the quad vertices
+void CreateQuadVertices(std::vector<SimpleVertex>& vertices) {
+	vertices = {
+		{{-0.5f, 0.5f, 0.0f}, {0, 0, -1}, {0, 0}},
+		{{0.5f, 0.5f, 0.0f}, {0, 0, -1}, {1, 0}},
+		{{-0.5f, -0.5f, 0.0f}, {0, 0, -1}, {0, 1}},
+		{{0.5f, -0.5f, 0.0f}, {0, 0, -1}, {1, 1}},
+	};
+}
+
+// Function to store the indices in the smallest index format
+void SetMeshIndices(Mesh& mesh, const std::vector<uint32_t>& indices) {
+	uint32_t largest = 0;
+	for (uint32_t index : indices) {
+		largest = std::max(largest, index);
+	}
+
+	// 0xFFFF is the strip cut value of 16-bit index buffers, keep it out of the data
+	mesh.indexFormat = largest < 0xFFFF ? IndexFormat::UInt16 : IndexFormat::UInt32;
+	mesh.indexCount = static_cast<uint32_t>(indices.size());
+	if (mesh.indexFormat == IndexFormat::UInt16) {
+		mesh.indexData.resize(indices.size() * sizeof(uint16_t));
+		uint16_t* destination = reinterpret_cast<uint16_t*>(mesh.indexData.data());
+		for (size_t i = 0; i < indices.size(); ++i) {
+			destination[i] = static_cast<uint16_t>(indices[i]);
+		}
+	}
+	else {
+		mesh.indexData.resize(indices.size() * sizeof(uint32_t));
+		std::memcpy(mesh.indexData.data(), indices.data(), mesh.indexData.size());
+	}
+}
+
+// Function to create the quad mesh
+void CreateQuadMesh(Mesh& mesh) {
+	CreateQuadVertices(mesh.vertices);
+	SetMeshIndices(mesh, { 0, 1, 2, 3 });
+	mesh.topology = PrimitiveTopology::TriangleStrip;
+}
+
+// Function to create the grid mesh
+void CreateGridMesh(uint32_t columns, uint32_t rows, Mesh& mesh) {
+	mesh.vertices.clear();
+	mesh.vertices.reserve(static_cast<size_t>(columns + 1) * (rows + 1));
+	for (uint32_t y = 0; y <= rows; ++y) {
+		for (uint32_t x = 0; x <= columns; ++x) {
+			float u = static_cast<float>(x) / columns;
+			float v = static_cast<float>(y) / rows;
+			mesh.vertices.push_back({ { u - 0.5f, 0.5f - v, 0.0f }, { 0, 0, -1 }, { u, v } });
+		}
+	}
+
+	// Two clockwise triangles per cell, same winding as the quad
+	std::vector<uint32_t> indices;
+	indices.reserve(static_cast<size_t>(columns) * rows * 6);
+	for (uint32_t y = 0; y < rows; ++y) {
+		for (uint32_t x = 0; x < columns; ++x) {
+			uint32_t topLeft = y * (columns + 1) + x;
+			uint32_t bottomLeft = topLeft + columns + 1;
+			indices.insert(indices.end(), { topLeft, topLeft + 1, bottomLeft, topLeft + 1, bottomLeft + 1, bottomLeft });
+		}
+	}
+
+	SetMeshIndices(mesh, indices);
+	mesh.topology = PrimitiveTopology::TriangleList;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+struct SimpleVertex {
+	float pos[3];
+	float rgb[3];
+	float uv[2];
+
+	SimpleVertex(const std::array<float, 3>& pos, const std::array<float, 3>& rgb, const std::array<float, 2>& uv) {
+		for (int i = 0; i < 3; i++)
+		{
+			this->pos[i] = pos[i];
+			this->rgb[i] = rgb[i];
+		}
+
+		this->uv[0] = uv[0];
+		this->uv[1] = uv[1];
+	}
+};
+
+/// <summary>
+/// Creates the textured quad drawn by Render() as a four vertex triangle strip.
+/// </summary>
+/// <param name="vertices">- Receives the quad vertices.</param>
+void CreateQuadVertices(std::vector<SimpleVertex>& vertices);
+
+// Primitive topologies the meshes can use, same meaning as the D3D11 ones
+enum class PrimitiveTopology {
+	TriangleList,
+	TriangleStrip
+};
+
+// Index buffer formats, same as DXGI_FORMAT_R16_UINT and DXGI_FORMAT_R32_UINT
+enum class IndexFormat {
+	UInt16,
+	UInt32
+};
+
+// Vertices and optional indices of a mesh, laid out as they are uploaded to the vertex and index buffers
+struct Mesh {
+	std::vector<SimpleVertex> vertices;
+	std::vector<uint8_t> indexData; // empty for non-indexed meshes
+	IndexFormat indexFormat = IndexFormat::UInt16;
+	uint32_t indexCount = 0;
+	PrimitiveTopology topology = PrimitiveTopology::TriangleList;
+};
+
+/// <summary>
+/// Stores indices in a mesh using 16-bit indices when every index fits, otherwise 32-bit indices.
+/// </summary>
+/// <param name="mesh">- The mesh receiving the indices.</param>
+/// <param name="indices">- The indices to store.</param>
+void SetMeshIndices(Mesh& mesh, const std::vector<uint32_t>& indices);
+
+/// <summary>
+/// Creates the textured quad drawn by Render() as an indexed four vertex triangle strip.
+/// </summary>
+/// <param name="mesh">- Receives the quad mesh.</param>
+void CreateQuadMesh(Mesh& mesh);
+
+/// <summary>
+/// Creates a grid covering the same area as the quad as an indexed triangle list, sharing the vertices between cells.
+/// </summary>
+/// <param name="columns">- Number of cells along x.</param>
+/// <param name="rows">- Number of cells along y.</param>
+/// <param name="mesh">- Receives the grid mesh.</param>
+void CreateGridMesh(uint32_t columns, uint32_t rows, Mesh& mesh);
@@ -1,100 +1,66 @@
-#define STB_IMAGE_IMPLEMENTATION
-
 #include "GraphicsSetup.h"
 
 #include <string>
-#include <fstream>
 #include <iostream>
 #include <vector>
 #include <DirectXMath.h>
 
-#include "stb_image.h"
 #include "ConstantBuffersSetup.h"
 
 namespace DX = DirectX;
 
-// Function to read file content into a string
-static bool readFile(const std::string& filePath, std::string& fileData) {
-	std::ifstream reader(filePath, std::ios::binary | std::ios::ate);
-	if (!reader.is_open()) {
-		std::cerr << "Could not open file: " << filePath << std::endl;
-		return false;
-	}
-
-	std::streamsize size = reader.tellg();
-	reader.seekg(0, std::ios::beg);
-
-	fileData.resize(size);
-	if (!reader.read(&fileData[0], size)) {
-		std::cerr << "Failed to read file: " << filePath << std::endl;
-		reader.close();
-		return false;
-	}
-
-	reader.close();
-	return true;
-}
-
-// Function to load vertex and pixel shaders
-static bool LoadShaders(ID3D11Device* device, ID3D11VertexShader*& vShader, ID3D11PixelShader*& pShader, std::string& vsByteCode) {
-	std::string shaderData;
-
-	// Load Vertex Shader
-	if (!readFile("VertexShader.cso", shaderData)) {
-		return false;
-	}
-
-	// Create Vertex Shader
-	if (FAILED(device->CreateVertexShader(shaderData.c_str(), shaderData.length(), nullptr, &vShader))) {
-		std::cerr << "Failed to create vertex shader!" << std::endl;
-		return false;
-	}
-
-	vsByteCode = shaderData; // Store bytecode for input layout creation
-	shaderData.clear();
-
-	// Load Pixel Shader
-	if (!readFile("PixelShader.cso", shaderData)) {
-		return false;
-	}
-
-	// Create Pixel Shader
-	if (FAILED(device->CreatePixelShader(shaderData.c_str(), shaderData.length(), nullptr, &pShader))) {
-		std::cerr << "Failed to create pixel shader!" << std::endl;
-		return false;
-	}
-
-	return true;
-}
-
 // Function to create input layout
-static bool CreateInputLayout(ID3D11Device* device, ID3D11InputLayout*& inputLayout, const std::string& vShaderByteCode) {
-	// Define input layout description
+static bool CreateInputLayout(ID3D11Device* device, VertexFormat vertexFormat, ID3D11InputLayout*& inputLayout, const AssetData& vShaderByteCode) {
+	// Define input layout description, SimpleVertex
 	D3D11_INPUT_ELEMENT_DESC inputDesc[] = {
 		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
 		{"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
 		{"UV", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0},
 	};
 
+	// PackedVertex, the input assembler converts to float and VertexShaderPacked.hlsl does the rest
+	D3D11_INPUT_ELEMENT_DESC packedInputDesc[] = {
+		{"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{"NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{"UV", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+	};
+
 	// Create input layout
-	HRESULT hr = device->CreateInputLayout(inputDesc, sizeof(inputDesc) / sizeof(*inputDesc), vShaderByteCode.c_str(), vShaderByteCode.length(), &inputLayout);
+	HRESULT hr = vertexFormat == VertexFormat::Packed
+		? device->CreateInputLayout(packedInputDesc, sizeof(packedInputDesc) / sizeof(*packedInputDesc), vShaderByteCode.data, vShaderByteCode.size, &inputLayout)
+		: device->CreateInputLayout(inputDesc, sizeof(inputDesc) / sizeof(*inputDesc), vShaderByteCode.data, vShaderByteCode.size, &inputLayout);
 	return !FAILED(hr);
 }
 
-// Function to create vertex buffer
-static bool CreateVertexBuffer(ID3D11Device* device, ID3D11Buffer*& vertexBuffer) {
-	// Define vertices
-	SimpleVertex vertices[4] =
-	{
-		{{-0.5f, 0.5f, 0.0f}, {0, 0, -1}, {0, 0}},
-		{{0.5f, 0.5f, 0.0f}, {0, 0, -1}, {1, 0}},
-		{{-0.5f, -0.5f, 0.0f}, {0, 0, -1}, {0, 1}},
-		{{0.5f, -0.5f, 0.0f}, {0, 0, -1}, {1, 1}},
-	};
+// Function to create vertex buffer, packed vertices also get the constant buffer with their bounds
+static bool CreateVertexBuffer(ID3D11Device* device, const Mesh& mesh, VertexFormat vertexFormat, ID3D11Buffer*& vertexBuffer, ID3D11Buffer*& boundsBuffer) {
+	boundsBuffer = nullptr;
+	std::vector<PackedVertex> packedVertices;
+	PackedVertexBounds bounds;
+	if (vertexFormat == VertexFormat::Packed) {
+		PackVertices(mesh.vertices, packedVertices, bounds);
+
+		D3D11_BUFFER_DESC boundsDesc = {
+			boundsDesc.ByteWidth = sizeof(PackedVertexBounds),
+			boundsDesc.Usage = D3D11_USAGE_IMMUTABLE,
+			boundsDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER,
+			boundsDesc.CPUAccessFlags = 0,
+			boundsDesc.MiscFlags = 0,
+			boundsDesc.StructureByteStride = 0
+		};
+		D3D11_SUBRESOURCE_DATA boundsData = {
+			boundsData.pSysMem = &bounds,
+			boundsData.SysMemPitch = 0,
+			boundsData.SysMemSlicePitch = 0
+		};
+		if (FAILED(device->CreateBuffer(&boundsDesc, &boundsData, &boundsBuffer))) {
+			return false;
+		}
+	}
 
 	// Define buffer description
 	D3D11_BUFFER_DESC bufferDesc = {
-		bufferDesc.ByteWidth = sizeof(vertices),
+		bufferDesc.ByteWidth = static_cast<UINT>(GetVertexStride(vertexFormat) * mesh.vertices.size()),
 		bufferDesc.Usage = D3D11_USAGE_IMMUTABLE,
 		bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER,
 		bufferDesc.CPUAccessFlags = 0,
@@ -104,7 +70,7 @@ static bool CreateVertexBuffer(ID3D11Device* device, ID3D11Buffer*& vertexBuffer
 
 	// Define subresource data
 	D3D11_SUBRESOURCE_DATA data = {
-		data.pSysMem = vertices,
+		data.pSysMem = vertexFormat == VertexFormat::Packed ? static_cast<const void*>(packedVertices.data()) : mesh.vertices.data(),
 		data.SysMemPitch = 0,
 		data.SysMemSlicePitch = 0
 	};
@@ -114,40 +80,54 @@ static bool CreateVertexBuffer(ID3D11Device* device, ID3D11Buffer*& vertexBuffer
 	return !FAILED(hr);
 }
 
-// Function to create texture and shader resource view
-static bool CreateTexture(ID3D11Device* device, ID3D11Texture2D*& texture, ID3D11ShaderResourceView*& srv, unsigned char*& imageData) {
-	int width, height, channels;
+// Function to create index buffer, non-indexed meshes get none
+static bool CreateIndexBuffer(ID3D11Device* device, const Mesh& mesh, ID3D11Buffer*& indexBuffer) {
+	indexBuffer = nullptr;
+	if (mesh.indexCount == 0) {
+		return true;
+	}
 
-	// Load image data
-	imageData = stbi_load("image.jpg", &width, &height, &channels, 0);
-	channels = 4; // Force 4 channels (RGBA)
+	// Define buffer description
+	D3D11_BUFFER_DESC bufferDesc = {
+		bufferDesc.ByteWidth = static_cast<UINT>(mesh.indexData.size()),
+		bufferDesc.Usage = D3D11_USAGE_IMMUTABLE,
+		bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER,
+		bufferDesc.CPUAccessFlags = 0,
+		bufferDesc.MiscFlags = 0,
+		bufferDesc.StructureByteStride = 0
+	};
 
-	// Prepare texture data
-	std::vector<unsigned char> textureData;
-	textureData.resize(height * width * channels);
+	// Define subresource data
+	D3D11_SUBRESOURCE_DATA data = {
+		data.pSysMem = mesh.indexData.data(),
+		data.SysMemPitch = 0,
+		data.SysMemSlicePitch = 0
+	};
 
-	int index = 0;
-	for (int y = 0; y < height; ++y) {
-		for (int x = 0; x < width; ++x) {
-			unsigned int startPos = (x + width * y) * channels;
+	// Create index buffer
+	HRESULT hr = device->CreateBuffer(&bufferDesc, &data, &indexBuffer);
+	return !FAILED(hr);
+}
 
-			textureData[startPos + 0] = imageData[index++];
-			textureData[startPos + 1] = imageData[index++];
-			textureData[startPos + 2] = imageData[index++];
-			textureData[startPos + 3] = 255; // Set alpha to 255
-		}
+// Function to map a texel format to its DXGI format
+static DXGI_FORMAT GetTextureFormat(TexelFormat format) {
+	switch (format) {
+	case TexelFormat::BC1: return DXGI_FORMAT_BC1_UNORM;
+	case TexelFormat::BC3: return DXGI_FORMAT_BC3_UNORM;
+	case TexelFormat::BC7: return DXGI_FORMAT_BC7_UNORM;
+	default: return DXGI_FORMAT_R8G8B8A8_UNORM;
 	}
+}
 
-	stbi_image_free(imageData);
-	imageData = nullptr;
-
+// Function to create texture and shader resource view with every mip level of the texture data, RGBA8 or block compressed
+static bool CreateTexture(ID3D11Device* device, const TextureData& textureData, ID3D11Texture2D*& texture, ID3D11ShaderResourceView*& srv) {
 	// Define texture description
 	D3D11_TEXTURE2D_DESC textureDesc = {
-		textureDesc.Width = static_cast<UINT>(width),
-		textureDesc.Height = static_cast<UINT>(height),
-		textureDesc.MipLevels = 1,
+		textureDesc.Width = static_cast<UINT>(textureData.width),
+		textureDesc.Height = static_cast<UINT>(textureData.height),
+		textureDesc.MipLevels = static_cast<UINT>(textureData.mips.size() + 1),
 		textureDesc.ArraySize = 1,
-		textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM,
+		textureDesc.Format = GetTextureFormat(textureData.format),
 		textureDesc.SampleDesc = DXGI_SAMPLE_DESC{ 1, 0 },
 		textureDesc.Usage = D3D11_USAGE_IMMUTABLE,
 		textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE,
@@ -155,15 +135,16 @@ static bool CreateTexture(ID3D11Device* device, ID3D11Texture2D*& texture, ID3D1
 		textureDesc.MiscFlags = 0
 	};
 
-	// Define subresource data
-	D3D11_SUBRESOURCE_DATA textureSubData = {
-		textureSubData.pSysMem = &textureData[0],
-		textureSubData.SysMemPitch = static_cast<UINT>(width * channels),
-		textureSubData.SysMemSlicePitch = 0
-	};
+	// Define subresource data, one per mip level, block compressed levels are pitched by rows of blocks
+	std::vector<D3D11_SUBRESOURCE_DATA> textureSubData(textureDesc.MipLevels);
+	textureSubData[0] = { textureData.pixels.data(), static_cast<UINT>(GetRowPitch(textureData.format, textureData.width)), 0 };
+	for (size_t level = 0; level < textureData.mips.size(); ++level) {
+		const TextureMipLevel& mip = textureData.mips[level];
+		textureSubData[level + 1] = { mip.pixels.data(), static_cast<UINT>(GetRowPitch(textureData.format, mip.width)), 0 };
+	}
 
 	// Create texture
-	if (FAILED(device->CreateTexture2D(&textureDesc, &textureSubData, &texture))) {
+	if (FAILED(device->CreateTexture2D(&textureDesc, textureSubData.data(), &texture))) {
 		std::cerr << "Failed to create texture!" << std::endl;
 		return false;
 	}
@@ -173,6 +154,16 @@ static bool CreateTexture(ID3D11Device* device, ID3D11Texture2D*& texture, ID3D1
 	return !FAILED(hr);
 }
 
+// Function to create the mid gray texture sampled until the image has loaded
+static bool CreatePlaceholderTexture(ID3D11Device* device, ID3D11Texture2D*& texture, ID3D11ShaderResourceView*& srv) {
+	TextureData placeholder;
+	placeholder.width = 1;
+	placeholder.height = 1;
+	placeholder.pixels.assign(4, 128);
+	placeholder.pixels[3] = 255;
+	return CreateTexture(device, placeholder, texture, srv);
+}
+
 // Function to create sampler state
 static bool CreateSamplerState(ID3D11Device* device, ID3D11SamplerState*& samplerState)
 {
@@ -199,33 +190,43 @@ static bool CreateSamplerState(ID3D11Device* device, ID3D11SamplerState*& sample
 	return !(FAILED(hr));
 }
 
-// Function to set up the graphics pipeline
-bool SetupPipeline(ID3D11Device* device, ID3D11Buffer*& vertexBuffer, ID3D11VertexShader*& vShader,
+// Function to set up the graphics pipeline, the shaders and the texture load in the background
+bool SetupPipeline(ID3D11Device* device, AssetLoader& loader, const Mesh& mesh, VertexFormat vertexFormat, TexelFormat textureFormat, ID3D11Buffer*& vertexBuffer, ID3D11Buffer*& indexBuffer,
+	ID3D11Buffer*& boundsBuffer, ID3D11VertexShader*& vShader,
 	ID3D11PixelShader*& pShader, ID3D11InputLayout*& inputLayout, ID3D11Texture2D*& texture,
-	ID3D11ShaderResourceView*& srv, ID3D11SamplerState*& samplerState, unsigned char*& imageData)
+	ID3D11ShaderResourceView*& srv, ID3D11SamplerState*& samplerState, PendingAssets& pending)
 {
-	std::string vsByteCode;
-
-	// Load shaders
-	if (!LoadShaders(device, vShader, pShader, vsByteCode)) {
-		std::cerr << "Error loading shaders!" << std::endl;
-		return false;
+	// Start the loads first so they overlap with creating everything else.
+	// The mip chain is built on the loader's threads so minified and anisotropic sampling reads prefiltered texels.
+	// A block compressed format takes a quarter to an eighth of the memory and bandwidth, at the cost of lossy texels.
+	pending.vertexShader = loader.LoadFile(vertexFormat == VertexFormat::Packed ? "VertexShaderPacked.cso" : "VertexShader.cso");
+	pending.pixelShader = loader.LoadFile("PixelShader.cso");
+	if (textureFormat == TexelFormat::RGBA8) {
+		pending.texture = loader.LoadTexture("image.jpg", MipChainOptions());
 	}
-
-	// Create input layout
-	if (!CreateInputLayout(device, inputLayout, vsByteCode)) {
-		std::cerr << "Error creating input layout!" << std::endl;
-		return false;
+	else {
+		BlockCompressionOptions compressionOptions;
+		compressionOptions.format = textureFormat;
+		pending.texture = loader.LoadTexture("image.jpg", MipChainOptions(), compressionOptions);
 	}
+	vShader = nullptr;
+	pShader = nullptr;
+	inputLayout = nullptr;
 
 	// Create vertex buffer
-	if (!CreateVertexBuffer(device, vertexBuffer)) {
+	if (!CreateVertexBuffer(device, mesh, vertexFormat, vertexBuffer, boundsBuffer)) {
 		std::cerr << "Error creating vertex buffer!" << std::endl;
 		return false;
 	}
 
-	// Create texture and shader resource view
-	if (!CreateTexture(device, texture, srv, imageData)) {
+	// Create index buffer
+	if (!CreateIndexBuffer(device, mesh, indexBuffer)) {
+		std::cerr << "Error creating index buffer!" << std::endl;
+		return false;
+	}
+
+	// Create the placeholder texture and shader resource view
+	if (!CreatePlaceholderTexture(device, texture, srv)) {
 		std::cerr << "Error creating texture!" << std::endl;
 		return false;
 	}
@@ -238,3 +239,48 @@ bool SetupPipeline(ID3D11Device* device, ID3D11Buffer*& vertexBuffer, ID3D11Vert
 
 	return true;
 }
+
+// Function to create the resources of the assets that finished loading
+bool UpdatePipeline(ID3D11Device* device, VertexFormat vertexFormat, PendingAssets& pending, ID3D11VertexShader*& vShader,
+	ID3D11PixelShader*& pShader, ID3D11InputLayout*& inputLayout, ID3D11Texture2D*& texture, ID3D11ShaderResourceView*& srv)
+{
+	// Create Vertex Shader and the input layout from its bytecode
+	if (IsReady(pending.vertexShader)) {
+		AssetData vsByteCode = pending.vertexShader.get();
+		if (!vsByteCode.loaded || FAILED(device->CreateVertexShader(vsByteCode.data, vsByteCode.size, nullptr, &vShader))) {
+			std::cerr << "Failed to create vertex shader!" << std::endl;
+			return false;
+		}
+		if (!CreateInputLayout(device, vertexFormat, inputLayout, vsByteCode)) {
+			std::cerr << "Error creating input layout!" << std::endl;
+			return false;
+		}
+	}
+
+	// Create Pixel Shader
+	if (IsReady(pending.pixelShader)) {
+		AssetData shaderData = pending.pixelShader.get();
+		if (!shaderData.loaded || FAILED(device->CreatePixelShader(shaderData.data, shaderData.size, nullptr, &pShader))) {
+			std::cerr << "Failed to create pixel shader!" << std::endl;
+			return false;
+		}
+	}
+
+	// Swap the placeholder for the loaded texture
+	if (IsReady(pending.texture)) {
+		TextureData textureData = pending.texture.get();
+		ID3D11Texture2D* loadedTexture = nullptr;
+		ID3D11ShaderResourceView* loadedSrv = nullptr;
+		if (textureData.pixels.empty() || !CreateTexture(device, textureData, loadedTexture, loadedSrv)) {
+			std::cerr << "Error creating texture!" << std::endl;
+			if (loadedTexture != nullptr) loadedTexture->Release();
+			return false;
+		}
+		srv->Release();
+		texture->Release();
+		texture = loadedTexture;
+		srv = loadedSrv;
+	}
+
+	return true;
+}
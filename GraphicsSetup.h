@@ -1,39 +1,83 @@
 #pragma once
 
-#include <array>
 #include <d3d11.h>
 #include <DirectXMath.h>
+#include <future>
 
-struct SimpleVertex {
-	float pos[3];
-	float rgb[3];
-	float uv[2];
-
-	SimpleVertex(const std::array<float, 3>& pos, const std::array<float, 3>& rgb, const std::array<float, 2>& uv) {
-		for (int i = 0; i < 3; i++)
-		{
-			this->pos[i] = pos[i];
-			this->rgb[i] = rgb[i];
-		}
-
-		this->uv[0] = uv[0];
-		this->uv[1] = uv[1];
-	}
+#include "AssetLoader.h"
+#include "Geometry.h"
+#include "PackedVertex.h"
+
+// Loads SetupPipeline() started, UpdatePipeline() takes each value once it is ready
+struct PendingAssets {
+	std::future<AssetData> vertexShader;
+	std::future<AssetData> pixelShader;
+	std::future<TextureData> texture;
 };
 
+/// <summary>
+/// Checks whether any asset of the pipeline is still loading.
+/// </summary>
+inline bool IsLoading(const PendingAssets& pending) {
+	return pending.vertexShader.valid() || pending.pixelShader.valid() || pending.texture.valid();
+}
+
+/// <summary>
+/// Converts a mesh topology to the Direct3D primitive topology.
+/// </summary>
+/// <param name="topology">- The mesh topology.</param>
+/// <returns>The matching D3D11_PRIMITIVE_TOPOLOGY.</returns>
+inline D3D11_PRIMITIVE_TOPOLOGY ToD3D11Topology(PrimitiveTopology topology) {
+	return topology == PrimitiveTopology::TriangleStrip ? D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP : D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+}
+
+/// <summary>
+/// Converts a mesh index format to the Direct3D index buffer format.
+/// </summary>
+/// <param name="format">- The mesh index format.</param>
+/// <returns>DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT.</returns>
+inline DXGI_FORMAT ToDXGIFormat(IndexFormat format) {
+	return format == IndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
+
 /// <summary>
 /// Sets up the graphics pipeline by creating and initializing the necessary Direct3D 11 resources.
+/// The shaders and the texture load on the loader's threads, the pipeline starts without shaders and with a 1x1 gray
+/// placeholder texture, UpdatePipeline() fills them in as they arrive.
 /// </summary>
 /// <param name="device">- The Direct3D device used to create resources.</param>
+/// <param name="loader">- The loader reading the shaders and decoding the texture, it must outlive pending.</param>
+/// <param name="mesh">- The mesh uploaded to the vertex and index buffers.</param>
+/// <param name="vertexFormat">- Layout of the vertex buffer, packed vertices use VertexShaderPacked.hlsl.</param>
+/// <param name="textureFormat">- Format the texture is uploaded in, block compressed formats are encoded on the loader's threads.</param>
 /// <param name="vertexBuffer">- Reference to the vertex buffer to be created.</param>
-/// <param name="vShader">- Reference to the vertex shader to be created.</param>
-/// <param name="pShader">- Reference to the pixel shader to be created.</param>
-/// <param name="inputLayout">- Reference to the input layout to be created.</param>
-/// <param name="texture">- Reference to the texture to be created.</param>
-/// <param name="srv">- Reference to the shader resource view to be created.</param>
+/// <param name="indexBuffer">- Reference to the index buffer to be created, nullptr for non-indexed meshes.</param>
+/// <param name="boundsBuffer">- Reference to the vertex shader constant buffer (b1) with the packed position bounds, nullptr for float vertices.</param>
+/// <param name="vShader">- Reference to the vertex shader, nullptr until it has loaded.</param>
+/// <param name="pShader">- Reference to the pixel shader, nullptr until it has loaded.</param>
+/// <param name="inputLayout">- Reference to the input layout, nullptr until the vertex shader has loaded.</param>
+/// <param name="texture">- Reference to the texture, the placeholder until the image has loaded.</param>
+/// <param name="srv">- Reference to the shader resource view of the texture.</param>
 /// <param name="samplerState">- Reference to the sampler state to be created.</param>
-/// <param name="imageData">- Pointer to the image data to be used for the texture.</param>
+/// <param name="pending">- Receives the loads in flight.</param>
 /// <returns>Returns true if the pipeline setup is successful, otherwise false.</returns>
-bool SetupPipeline(ID3D11Device* device, ID3D11Buffer*& vertexBuffer, ID3D11VertexShader*& vShader,
+bool SetupPipeline(ID3D11Device* device, AssetLoader& loader, const Mesh& mesh, VertexFormat vertexFormat, TexelFormat textureFormat, ID3D11Buffer*& vertexBuffer, ID3D11Buffer*& indexBuffer,
+	ID3D11Buffer*& boundsBuffer, ID3D11VertexShader*& vShader,
 	ID3D11PixelShader*& pShader, ID3D11InputLayout*& inputLayout, ID3D11Texture2D*& texture,
-	ID3D11ShaderResourceView*& srv, ID3D11SamplerState*& samplerState, unsigned char*& imageData);
\ No newline at end of file
+	ID3D11ShaderResourceView*& srv, ID3D11SamplerState*& samplerState, PendingAssets& pending);
+
+/// <summary>
+/// Creates the resources of the assets that finished loading without waiting for the others, call it every frame while IsLoading(pending).
+/// The loaded texture replaces the placeholder, which is released.
+/// </summary>
+/// <param name="device">- The Direct3D device used to create resources.</param>
+/// <param name="vertexFormat">- Layout of the vertex buffer, selects the input layout.</param>
+/// <param name="pending">- The loads in flight, the finished ones are taken.</param>
+/// <param name="vShader">- Reference to the vertex shader, set once it has loaded.</param>
+/// <param name="pShader">- Reference to the pixel shader, set once it has loaded.</param>
+/// <param name="inputLayout">- Reference to the input layout, set with the vertex shader.</param>
+/// <param name="texture">- Reference to the texture, replaced once the image has loaded.</param>
+/// <param name="srv">- Reference to the shader resource view, replaced with the texture.</param>
+/// <returns>Returns false if a finished asset failed to load or to be created, otherwise true.</returns>
+bool UpdatePipeline(ID3D11Device* device, VertexFormat vertexFormat, PendingAssets& pending, ID3D11VertexShader*& vShader,
+	ID3D11PixelShader*& pShader, ID3D11InputLayout*& inputLayout, ID3D11Texture2D*& texture, ID3D11ShaderResourceView*& srv);
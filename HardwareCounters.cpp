@@ -0,0 +1,76 @@
+#include "HardwareCounters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+HardwareCounters::~HardwareCounters() {
+	Close();
+}
+
+#ifdef __linux__
+// Function to open one counter of the calling thread, inherited by the threads it starts
+static int OpenCounter(uint32_t type, uint64_t config) {
+	perf_event_attr attributes;
+	std::memset(&attributes, 0, sizeof(attributes));
+	attributes.size = sizeof(attributes);
+	attributes.type = type;
+	attributes.config = config;
+	attributes.exclude_kernel = 1;
+	attributes.exclude_hv = 1;
+	attributes.inherit = 1;
+	return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+#endif
+
+// Function to start the counters
+bool HardwareCounters::Open() {
+	Close();
+#ifdef __linux__
+	const uint64_t READ_MISS = PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+	descriptors[0] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES);
+	descriptors[1] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	descriptors[2] = OpenCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | READ_MISS);
+	descriptors[3] = OpenCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | READ_MISS);
+	open = true;
+	for (int descriptor : descriptors) {
+		open = open && descriptor >= 0;
+	}
+	if (!open) {
+		Close();
+	}
+#endif
+	return open;
+}
+
+// Function to stop the counters
+void HardwareCounters::Close() {
+#ifdef __linux__
+	for (int& descriptor : descriptors) {
+		if (descriptor >= 0) {
+			close(descriptor);
+		}
+		descriptor = -1;
+	}
+#endif
+	open = false;
+}
+
+// Function to read the counters
+HardwareCounterValues HardwareCounters::Read() const {
+	HardwareCounterValues values;
+#ifdef __linux__
+	if (open) {
+		uint64_t* counts[COUNTER_COUNT] = { &values.cacheReferences, &values.cacheMisses, &values.l1dReadMisses, &values.dtlbReadMisses };
+		for (int i = 0; i < COUNTER_COUNT; ++i) {
+			if (read(descriptors[i], counts[i], sizeof(uint64_t)) != sizeof(uint64_t)) {
+				*counts[i] = 0;
+			}
+		}
+	}
+#endif
+	return values;
+}
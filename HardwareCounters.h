@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+// Cache events counted by HardwareCounters
+struct HardwareCounterValues {
+	uint64_t cacheReferences = 0;  // last level cache accesses
+	uint64_t cacheMisses = 0;      // last level cache misses
+	uint64_t l1dReadMisses = 0;    // level 1 data cache read misses
+	uint64_t dtlbReadMisses = 0;   // data TLB read misses
+};
+
+// Counts cache events in user mode for the calling thread and every thread it starts afterwards, through perf_event_open() on Linux.
+// The counts of a started thread are added once it exits, so read them after joining the threads, for example after a ThreadPool was destroyed.
+// Unavailable on other platforms and where the kernel or a virtual machine does not expose the hardware counters.
+class HardwareCounters {
+public:
+	HardwareCounters() = default;
+	~HardwareCounters();
+
+	HardwareCounters(const HardwareCounters&) = delete;
+	HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+	/// <summary>
+	/// Starts counting from zero, closing any counters already open.
+	/// </summary>
+	/// <returns>True if every counter was opened, otherwise false and nothing is counted.</returns>
+	bool Open();
+
+	/// <summary>
+	/// Stops counting.
+	/// </summary>
+	void Close();
+
+	/// <summary>
+	/// Reads the counts so far.
+	/// </summary>
+	HardwareCounterValues Read() const;
+
+	bool IsOpen() const { return open; }
+
+private:
+	static const int COUNTER_COUNT = 4;
+
+	int descriptors[COUNTER_COUNT] = { -1, -1, -1, -1 };
+	bool open = false;
+};
@@ -0,0 +1,345 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AssetArchive.h"
+#include "BlockCompression.h"
+#include "Geometry.h"
+#include "MeshFile.h"
+#include "MipChain.h"
+#include "ShaderCache.h"
+#include "ShaderConstants.h"
+#include "SoftwareRenderer.h"
+#include "SoftwareShader.h"
+#include "TexelCache.h"
+#include "TextureLayout.h"
+#include "TextureLoader.h"
+#include "TextureSampler.h"
+
+// Function to write the resolved B8G8R8A8 image as a binary PPM
+static bool WritePPM(const std::string& filePath, uint32_t width, uint32_t height, const std::vector<uint32_t>& pixels) {
+	FILE* file = std::fopen(filePath.c_str(), "wb");
+	if (file == nullptr) {
+		std::cerr << "Could not open file: " << filePath << std::endl;
+		return false;
+	}
+
+	std::fprintf(file, "P6\n%u %u\n255\n", width, height);
+	std::vector<unsigned char> row(width * 3);
+	for (uint32_t y = 0; y < height; ++y) {
+		for (uint32_t x = 0; x < width; ++x) {
+			uint32_t pixel = pixels[static_cast<size_t>(y) * width + x];
+			row[x * 3 + 0] = static_cast<unsigned char>(pixel >> 16);
+			row[x * 3 + 1] = static_cast<unsigned char>(pixel >> 8);
+			row[x * 3 + 2] = static_cast<unsigned char>(pixel);
+		}
+		std::fwrite(row.data(), 1, row.size(), file);
+	}
+
+	std::fclose(file);
+	return true;
+}
+
+// Function to print frame timings averaged over the rendered frames, the draws of the last frame and a per-tile heat map
+static void PrintStats(const SoftwareFramebuffer& framebuffer, const SoftwareFrameStats& total, const SoftwareFrameStats& last, uint32_t frameCount) {
+	double scale = 1e6 / std::max(frameCount, 1u);
+	std::printf("Average per frame: vertex %.1f us, binning %.1f us, raster %.1f us\n",
+		total.vertexTime * scale, total.binningTime * scale, total.rasterTime * scale);
+	std::printf("Hierarchical depth per frame: %.1f blocks tested, %.1f rejected, %.1f accepted\n",
+		static_cast<double>(total.depthBlocks) / std::max(frameCount, 1u), static_cast<double>(total.depthBlocksRejected) / std::max(frameCount, 1u),
+		static_cast<double>(total.depthBlocksAccepted) / std::max(frameCount, 1u));
+	if (total.texelCacheHits + total.texelCacheMisses > 0) {
+		std::printf("Texel caches per frame: %.1f fetches, %.2f%% hits, %.1f blocks read\n",
+			static_cast<double>(total.texelCacheHits + total.texelCacheMisses) / std::max(frameCount, 1u),
+			100.0 * total.texelCacheHits / (total.texelCacheHits + total.texelCacheMisses), static_cast<double>(total.texelCacheMisses) / std::max(frameCount, 1u));
+	}
+
+	// Post-transform vertex cache of the last frame
+	for (size_t draw = 0; draw < last.draws.size(); ++draw) {
+		const SoftwareDrawStats& stats = last.draws[draw];
+		double hitRate = stats.vertexReferences > 0 ? 1.0 - static_cast<double>(stats.shadedVertices) / stats.vertexReferences : 0.0;
+		std::printf("Draw %zu: %u vertex references, %u shaded, vertex cache hit rate %.1f%%\n",
+			draw, stats.vertexReferences, stats.shadedVertices, hitRate * 100.0);
+	}
+
+	if (total.tileTime.empty()) {
+		return;
+	}
+
+	auto slowest = std::max_element(total.tileTime.begin(), total.tileTime.end());
+	double sum = 0.0;
+	for (double time : total.tileTime) {
+		sum += time;
+	}
+	std::printf("Tiles %ux%u of %u px: mean %.1f us, max %.1f us (tile %u, %u triangles)\n",
+		framebuffer.tilesX, framebuffer.tilesY, framebuffer.tileSize, sum / total.tileTime.size() * scale, *slowest * scale,
+		static_cast<uint32_t>(slowest - total.tileTime.begin()), total.tileTriangles[slowest - total.tileTime.begin()] / std::max(frameCount, 1u));
+
+	// Microseconds per tile, laid out like the screen
+	for (uint32_t tileY = 0; tileY < framebuffer.tilesY; ++tileY) {
+		for (uint32_t tileX = 0; tileX < framebuffer.tilesX; ++tileX) {
+			std::printf("%7.1f", total.tileTime[tileY * framebuffer.tilesX + tileX] * scale);
+		}
+		std::printf("\n");
+	}
+}
+
+// Headless entry point rendering the scene with the software renderer, no window or GPU required
+int main(int argc, char** argv) {
+	const uint32_t WIDTH = 1024;
+	const uint32_t HEIGHT = 576;
+	uint32_t frameCount = 100;
+	uint32_t tileSize = 64;
+	uint32_t threadCount = 0;
+	uint32_t gridSize = 0;
+	std::string archivePath;
+	ShaderBackend shaderBackend = ShaderBackend::Native;
+	std::string shaderCachePath = "ShaderCache";
+	uint64_t shaderCacheLimit = SHADER_CACHE_DEFAULT_LIMIT;
+	bool samplerFiltered = false;
+	SamplerFilter samplerFilter = SamplerFilter::Bilinear;
+	TexelCacheMode texelCacheMode = TexelCacheMode::Compressed;
+	TexelFormat textureFormat = TexelFormat::RGBA8;
+	TexelLayout textureLayout = TexelLayout::Linear;
+	bool printStats = false;
+	SimdLevel simdLevel = DetectSimdLevel();
+	float rotation = 300.0f;
+	float rotationStep = 1.0f / 60.0f;
+	std::string outputPath;
+	std::string meshPath;
+
+	// Parse command line options
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frameCount = static_cast<uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--tile-size") == 0 && i + 1 < argc) {
+			tileSize = static_cast<uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threadCount = static_cast<uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--simd") == 0 && i + 1 < argc) {
+			if (!ParseSimdLevel(argv[++i], simdLevel)) {
+				std::cerr << "Unknown SIMD level: " << argv[i] << std::endl;
+				return -1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--texture-format") == 0 && i + 1 < argc) {
+			if (!ParseTexelFormat(argv[++i], textureFormat)) {
+				std::cerr << "Unknown texture format: " << argv[i] << std::endl;
+				return -1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--shader-cache") == 0 && i + 1 < argc) {
+			shaderCachePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--shader-cache-limit") == 0 && i + 1 < argc) {
+			shaderCacheLimit = static_cast<uint64_t>(std::atoll(argv[++i])) * 1024;
+		}
+		else if (std::strcmp(argv[i], "--shaders") == 0 && i + 1 < argc) {
+			if (!ParseShaderBackend(argv[++i], shaderBackend)) {
+				std::cerr << "Unknown shader backend: " << argv[i] << std::endl;
+				return -1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--sampler-filter") == 0 && i + 1 < argc) {
+			if (!ParseSamplerFilter(argv[++i], samplerFilter)) {
+				std::cerr << "Unknown sampler filter: " << argv[i] << std::endl;
+				return -1;
+			}
+			samplerFiltered = true;
+		}
+		else if (std::strcmp(argv[i], "--texel-cache") == 0 && i + 1 < argc) {
+			if (!ParseTexelCacheMode(argv[++i], texelCacheMode)) {
+				std::cerr << "Unknown texel cache mode: " << argv[i] << std::endl;
+				return -1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--texture-layout") == 0 && i + 1 < argc) {
+			if (!ParseTexelLayout(argv[++i], textureLayout)) {
+				std::cerr << "Unknown texture layout: " << argv[i] << std::endl;
+				return -1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--archive") == 0 && i + 1 < argc) {
+			archivePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+			gridSize = static_cast<uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--mesh") == 0 && i + 1 < argc) {
+			meshPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--stats") == 0) {
+			printStats = true;
+		}
+		else if (std::strcmp(argv[i], "--rotation") == 0 && i + 1 < argc) {
+			rotation = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			outputPath = argv[++i];
+		}
+		else {
+			std::cerr << "Usage: " << argv[0] << " [--frames N] [--tile-size N] [--threads N] [--simd scalar|avx2|avx512] [--texture-format rgba8|bc1|bc3|bc7] [--texture-layout linear|tiled] [--texel-cache off|compressed|all] [--shaders native|jit|interpreter] [--shader-cache dir|off] [--shader-cache-limit KB] [--sampler-filter point|bilinear|trilinear|anisotropic] [--archive file.pack] [--grid N] [--mesh file.mesh|file.obj] [--stats] [--rotation R] [--output frame.ppm]" << std::endl;
+			return -1;
+		}
+	}
+
+	SoftwareContext context;
+	if (!CreateSoftwareContext(threadCount, context)) {
+		std::cerr << "Failed to setup software context!" << std::endl;
+		return -1;
+	}
+	context.simdLevel = std::min(simdLevel, context.simdLevel);
+	context.texelCacheMode = texelCacheMode;
+
+	// Pipeline Setup
+	// The quad of Render(), an N x N grid over the same area to exercise the vertex cache, or a mesh file
+	Mesh mesh;
+	if (!meshPath.empty()) {
+		if (!LoadMesh(meshPath, mesh)) {
+			std::cerr << "Failed to load mesh!" << std::endl;
+			return -1;
+		}
+	}
+	else if (gridSize > 0) {
+		CreateGridMesh(gridSize, gridSize, mesh);
+	}
+	else {
+		CreateQuadMesh(mesh);
+	}
+
+	// The texture comes from the archive when one is given and holds it
+	AssetArchive archive;
+	if (!archivePath.empty() && !archive.Open(archivePath)) {
+		std::cerr << "Failed to open asset archive!" << std::endl;
+		return -1;
+	}
+	AssetData textureFile;
+	TextureData texture;
+	if (!LoadAsset(archive, "image.jpg", textureFile) || !LoadTextureData(*context.pool, textureFile.data, textureFile.size, "image.jpg", texture)) {
+		std::cerr << "Failed to load texture!" << std::endl;
+		return -1;
+	}
+
+	VertexShaderConstants vsConstants;
+	PixelShaderConstants psConstants;
+	CreateSoftwareMatrices(WIDTH, HEIGHT, rotation, vsConstants);
+
+	SoftwareViewport viewport;
+	SetSoftwareViewport(viewport, WIDTH, HEIGHT);
+
+	// A sampler filter samples the mips like the Direct3D sampler, otherwise the base level is sampled bilinearly
+	if (samplerFiltered) {
+		BuildMipChain(*context.pool, MipChainOptions(), texture);
+		context.sampler = SamplerDesc();
+		context.sampler.filter = samplerFilter;
+	}
+
+	// The software path samples block compressed textures straight from their blocks
+	if (textureFormat != TexelFormat::RGBA8) {
+		BlockCompressionOptions compressionOptions;
+		compressionOptions.format = textureFormat;
+		compressionOptions.simdLevel = context.simdLevel;
+		TextureData compressed;
+		if (!CompressTexture(*context.pool, compressionOptions, texture, compressed)) {
+			std::cerr << "Failed to compress texture!" << std::endl;
+			return -1;
+		}
+		texture = std::move(compressed);
+	}
+
+	// Tiling only reorders texels, the rendered frames are identical
+	if (textureLayout != TexelLayout::Linear) {
+		TextureData tiled;
+		if (!ConvertTextureLayout(*context.pool, textureLayout, texture, tiled)) {
+			std::cerr << "Failed to tile texture!" << std::endl;
+			return -1;
+		}
+		texture = std::move(tiled);
+	}
+
+	SoftwareFramebuffer framebuffer;
+	if (!CreateSoftwareFramebuffer(WIDTH, HEIGHT, tileSize, framebuffer)) {
+		std::cerr << "Failed to setup software framebuffer!" << std::endl;
+		return -1;
+	}
+
+	// Shaders loaded from HLSL replace the built-in kernels, compiled ones come from the shader cache
+	if (shaderBackend != ShaderBackend::Native) {
+		std::unique_ptr<ShaderCache> shaderCache;
+		if (shaderCachePath != "off") {
+			shaderCache = std::make_unique<ShaderCache>(shaderCachePath, shaderCacheLimit);
+		}
+		auto shaderStart = std::chrono::high_resolution_clock::now();
+		if (!LoadSoftwareShaders(context, shaderBackend, shaderCache.get())) {
+			std::cerr << "Failed to load shaders!" << std::endl;
+			return -1;
+		}
+		std::chrono::duration<double, std::milli> shaderTime = std::chrono::high_resolution_clock::now() - shaderStart;
+		std::cout << "Shaders loaded in " << shaderTime.count() << " ms";
+		if (shaderCache) {
+			ShaderCacheStats cacheStats = shaderCache->GetStats();
+			std::cout << ", shader cache " << cacheStats.hits << " hits " << cacheStats.misses << " misses " << cacheStats.evictions << " evictions";
+		}
+		std::cout << std::endl;
+	}
+
+	// Render loop, rotation advances by a fixed step so runs are reproducible
+	SoftwareFrameStats total;
+	total.tileTime.assign(framebuffer.tilesX * framebuffer.tilesY, 0.0);
+	total.tileTriangles.assign(framebuffer.tilesX * framebuffer.tilesY, 0);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t frame = 0; frame < frameCount; ++frame) {
+		CreateSoftwareWorldMatrix(rotation, vsConstants.worldMatrix);
+		SoftwareRender(context, framebuffer, viewport, mesh, vsConstants, psConstants, texture);
+
+		// Accumulate the frame timings
+		const SoftwareFrameStats& stats = context.stats;
+		total.vertexTime += stats.vertexTime;
+		total.binningTime += stats.binningTime;
+		total.rasterTime += stats.rasterTime;
+		total.depthBlocks += stats.depthBlocks;
+		total.depthBlocksRejected += stats.depthBlocksRejected;
+		total.depthBlocksAccepted += stats.depthBlocksAccepted;
+		total.texelCacheHits += stats.texelCacheHits;
+		total.texelCacheMisses += stats.texelCacheMisses;
+		for (size_t tile = 0; tile < stats.tileTime.size(); ++tile) {
+			total.tileTime[tile] += stats.tileTime[tile];
+			total.tileTriangles[tile] += stats.tileTriangles[tile];
+		}
+
+		rotation += rotationStep;
+		if (rotation > 360) rotation = 0;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	double seconds = elapsed.count();
+	double fps = seconds > 0.0 ? frameCount / seconds : 0.0;
+	std::cout << "Rendered " << frameCount << " frames in " << seconds * 1000.0 << " ms (" << fps << " fps, "
+		<< fps / context.pool->WorkerCount() << " fps per thread on " << context.pool->WorkerCount() << " threads, "
+		<< SimdLevelName(context.simdLevel) << ")" << std::endl;
+
+	if (printStats) {
+		PrintStats(framebuffer, total, context.stats, frameCount);
+	}
+
+	// Write the last frame
+	if (!outputPath.empty()) {
+		std::vector<uint32_t> pixels;
+		ResolveSoftwareFramebuffer(framebuffer, pixels);
+		if (!WritePPM(outputPath, WIDTH, HEIGHT, pixels)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,171 @@
+#include "LZCompression.h"
+
+#include <cstdint>
+#include <cstring>
+
+static const size_t MIN_MATCH = 4;
+static const size_t MAX_OFFSET = 65535;
+static const int HASH_BITS = 14;
+
+// Function to read 4 unaligned bytes
+static uint32_t Read32(const unsigned char* pointer) {
+	uint32_t value;
+	std::memcpy(&value, pointer, sizeof(value));
+	return value;
+}
+
+// Function to hash the 4 bytes at a position into the match table
+static uint32_t HashSequence(const unsigned char* pointer) {
+	return (Read32(pointer) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Function to append a length that did not fit in its nibble, 255 per byte until the remainder
+static void WriteLengthBytes(size_t length, std::vector<unsigned char>& output) {
+	for (; length >= 255; length -= 255) {
+		output.push_back(255);
+	}
+	output.push_back(static_cast<unsigned char>(length));
+}
+
+// Function to append one sequence, matchLength 0 ends the block with literals only
+static void WriteSequence(const unsigned char* literals, size_t literalCount, size_t offset, size_t matchLength, std::vector<unsigned char>& output) {
+	size_t matchCode = matchLength > 0 ? matchLength - MIN_MATCH : 0;
+	output.push_back(static_cast<unsigned char>((literalCount < 15 ? literalCount : 15) << 4 | (matchCode < 15 ? matchCode : 15)));
+	if (literalCount >= 15) {
+		WriteLengthBytes(literalCount - 15, output);
+	}
+	output.insert(output.end(), literals, literals + literalCount);
+	if (matchLength == 0) {
+		return;
+	}
+	output.push_back(static_cast<unsigned char>(offset));
+	output.push_back(static_cast<unsigned char>(offset >> 8));
+	if (matchCode >= 15) {
+		WriteLengthBytes(matchCode - 15, output);
+	}
+}
+
+// Function to compress a block
+void CompressLZ(const unsigned char* input, size_t size, std::vector<unsigned char>& output) {
+	output.clear();
+	output.reserve(GetCompressBound(size));
+
+	// Positions are stored plus one so zero means empty
+	std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+	size_t literalStart = 0;
+	size_t position = 0;
+	size_t misses = 0;
+	while (size >= MIN_MATCH && position <= size - MIN_MATCH) {
+		uint32_t hash = HashSequence(input + position);
+		size_t candidate = table[hash];
+		table[hash] = static_cast<uint32_t>(position + 1);
+
+		if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || Read32(input + candidate - 1) != Read32(input + position)) {
+			// Skip ahead faster the longer nothing matches, incompressible data like JPEG passes through quickly
+			position += 1 + (misses++ >> 6);
+			continue;
+		}
+		misses = 0;
+
+		size_t matchStart = candidate - 1;
+		size_t length = MIN_MATCH;
+		while (position + length < size && input[matchStart + length] == input[position + length]) {
+			++length;
+		}
+
+		WriteSequence(input + literalStart, position - literalStart, position - matchStart, length, output);
+		position += length;
+		literalStart = position;
+	}
+
+	WriteSequence(input + literalStart, size - literalStart, 0, 0, output);
+}
+
+// Function to read a length continued past its nibble
+static bool ReadLengthBytes(const unsigned char*& input, const unsigned char* inputEnd, size_t& length) {
+	unsigned char byte;
+	do {
+		if (input == inputEnd) {
+			return false;
+		}
+		byte = *input++;
+		length += byte;
+	} while (byte == 255);
+	return true;
+}
+
+// Function to copy in 16-byte chunks, writing up to 15 bytes past the end that later sequences overwrite.
+// The source must not be within 16 bytes before the destination.
+static void CopyChunks(unsigned char* destination, const unsigned char* source, size_t length) {
+	unsigned char* end = destination + length;
+	do {
+		std::memcpy(destination, source, 16);
+		destination += 16;
+		source += 16;
+	} while (destination < end);
+}
+
+// Function to decompress a block
+bool DecompressLZ(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize) {
+	const unsigned char* inputEnd = input + inputSize;
+	unsigned char* outputStart = output;
+	unsigned char* outputEnd = output + outputSize;
+
+	while (input < inputEnd) {
+		unsigned char token = *input++;
+
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !ReadLengthBytes(input, inputEnd, literalCount)) {
+			return false;
+		}
+		if (literalCount > static_cast<size_t>(inputEnd - input) || literalCount > static_cast<size_t>(outputEnd - output)) {
+			return false;
+		}
+		// Away from the ends of both buffers the copies run in whole chunks
+		if (static_cast<size_t>(inputEnd - input) >= literalCount + 16 && static_cast<size_t>(outputEnd - output) >= literalCount + 16) {
+			CopyChunks(output, input, literalCount);
+		}
+		else {
+			std::memcpy(output, input, literalCount);
+		}
+		input += literalCount;
+		output += literalCount;
+
+		// The last sequence has no match
+		if (input == inputEnd) {
+			break;
+		}
+
+		if (inputEnd - input < 2) {
+			return false;
+		}
+		size_t offset = input[0] | static_cast<size_t>(input[1]) << 8;
+		input += 2;
+		size_t length = token & 15;
+		if (length == 15 && !ReadLengthBytes(input, inputEnd, length)) {
+			return false;
+		}
+		length += MIN_MATCH;
+		if (offset == 0 || offset > static_cast<size_t>(output - outputStart) || length > static_cast<size_t>(outputEnd - output)) {
+			return false;
+		}
+
+		// Matches closer than their length repeat the bytes they are writing, those copy forward one byte at a time
+		const unsigned char* match = output - offset;
+		if (offset >= 16 && static_cast<size_t>(outputEnd - output) >= length + 16) {
+			CopyChunks(output, match, length);
+			output += length;
+		}
+		else if (offset >= length) {
+			std::memcpy(output, match, length);
+			output += length;
+		}
+		else {
+			for (size_t i = 0; i < length; ++i) {
+				*output++ = match[i];
+			}
+		}
+	}
+
+	return output == outputEnd;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Byte-oriented LZ77 in the style of an LZ4 block: a sequence is a token byte holding the literal count in the high
+// nibble and the match length minus 4 in the low nibble, 15 continues in extra bytes of up to 255 each, then the
+// literals, a 16-bit little-endian match offset and the extra match length bytes. The last sequence is literals only.
+// Decompression is a loop of copies with no tables, so it runs at memory speed.
+
+/// <summary>
+/// Compresses a block with greedy matching against a hash of the last position of each 4-byte sequence.
+/// Incompressible data grows by at most GetCompressBound(size) - size bytes.
+/// </summary>
+/// <param name="input">- The bytes to compress.</param>
+/// <param name="size">- Number of bytes to compress.</param>
+/// <param name="output">- Receives the compressed block, replacing its contents.</param>
+void CompressLZ(const unsigned char* input, size_t size, std::vector<unsigned char>& output);
+
+/// <summary>
+/// Decompresses a block written by CompressLZ(). Every read and copy is bounds checked, so corrupt input fails instead of overrunning.
+/// </summary>
+/// <param name="input">- The compressed block.</param>
+/// <param name="inputSize">- Size of the compressed block.</param>
+/// <param name="output">- Receives the decompressed bytes.</param>
+/// <param name="outputSize">- Exact decompressed size, stored by the caller.</param>
+/// <returns>True if the block decompressed to exactly outputSize bytes, otherwise false.</returns>
+bool DecompressLZ(const unsigned char* input, size_t inputSize, unsigned char* output, size_t outputSize);
+
+/// <summary>
+/// Returns the largest size CompressLZ() can produce for size bytes.
+/// </summary>
+inline size_t GetCompressBound(size_t size) {
+	return size + size / 255 + 16;
+}
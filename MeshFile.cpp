@@ -0,0 +1,260 @@
+#include "MeshFile.h"
+
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+static const char MESH_MAGIC[4] = { 'M', 'E', 'S', 'H' };
+static const uint32_t MESH_VERSION = 1;
+
+// Layout of the .mesh header, followed by vertexCount SimpleVertex and the raw index data
+struct MeshFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexFormat; // IndexFormat
+	uint32_t topology;    // PrimitiveTopology
+};
+
+// Function to check whether a path ends with an extension, ignoring case
+static bool HasExtension(const std::string& filePath, const char* extension) {
+	size_t length = std::strlen(extension);
+	if (filePath.size() < length) {
+		return false;
+	}
+	for (size_t i = 0; i < length; ++i) {
+		char c = filePath[filePath.size() - length + i];
+		if (c >= 'A' && c <= 'Z') {
+			c = static_cast<char>(c - 'A' + 'a');
+		}
+		if (c != extension[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Function to resolve a 1-based or negative (relative) OBJ index, returns -1 when missing or out of range
+static int ResolveObjIndex(const char* text, size_t count) {
+	if (*text == '\0') {
+		return -1;
+	}
+	long index = std::strtol(text, nullptr, 10);
+	long resolved = index < 0 ? static_cast<long>(count) + index : index - 1;
+	return resolved >= 0 && resolved < static_cast<long>(count) ? static_cast<int>(resolved) : -1;
+}
+
+// Function to load a Wavefront OBJ file as an indexed triangle list
+static bool LoadObj(const std::string& filePath, Mesh& mesh) {
+	std::ifstream reader(filePath);
+	if (!reader.is_open()) {
+		std::cerr << "Could not open file: " << filePath << std::endl;
+		return false;
+	}
+
+	std::vector<std::array<float, 3>> positions;
+	std::vector<std::array<float, 3>> normals;
+	std::vector<std::array<float, 2>> uvs;
+	std::map<std::tuple<int, int, int>, uint32_t> vertexIds;
+	std::vector<uint32_t> indices;
+	bool missingNormals = false;
+
+	mesh.vertices.clear();
+	std::string line;
+	while (std::getline(reader, line)) {
+		std::istringstream stream(line);
+		std::string keyword;
+		stream >> keyword;
+
+		if (keyword == "v") {
+			std::array<float, 3> p = { 0, 0, 0 };
+			stream >> p[0] >> p[1] >> p[2];
+			positions.push_back({ p[0], p[1], -p[2] });
+		}
+		else if (keyword == "vn") {
+			std::array<float, 3> n = { 0, 0, 0 };
+			stream >> n[0] >> n[1] >> n[2];
+			normals.push_back({ n[0], n[1], -n[2] });
+		}
+		else if (keyword == "vt") {
+			std::array<float, 2> uv = { 0, 0 };
+			stream >> uv[0] >> uv[1];
+			uvs.push_back({ uv[0], 1.0f - uv[1] });
+		}
+		else if (keyword == "f") {
+			// Polygons are triangulated as fans
+			std::vector<uint32_t> polygon;
+			std::string corner;
+			while (stream >> corner) {
+				std::string parts[3];
+				size_t part = 0;
+				for (char c : corner) {
+					if (c == '/') {
+						if (++part == 3) {
+							break;
+						}
+					}
+					else {
+						parts[part] += c;
+					}
+				}
+
+				int p = ResolveObjIndex(parts[0].c_str(), positions.size());
+				int t = ResolveObjIndex(parts[1].c_str(), uvs.size());
+				int n = ResolveObjIndex(parts[2].c_str(), normals.size());
+				if (p < 0) {
+					std::cerr << "Invalid face in file: " << filePath << std::endl;
+					return false;
+				}
+
+				auto inserted = vertexIds.emplace(std::make_tuple(p, t, n), static_cast<uint32_t>(mesh.vertices.size()));
+				if (inserted.second) {
+					std::array<float, 3> normal = n >= 0 ? normals[n] : std::array<float, 3>{ 0, 0, 0 };
+					std::array<float, 2> uv = t >= 0 ? uvs[t] : std::array<float, 2>{ 0, 0 };
+					mesh.vertices.emplace_back(positions[p], normal, uv);
+					missingNormals |= n < 0;
+				}
+				polygon.push_back(inserted.first->second);
+			}
+
+			for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+				indices.insert(indices.end(), { polygon[0], polygon[i], polygon[i + 1] });
+			}
+		}
+	}
+
+	// Smooth normals for vertices the file has none for, accumulated from the area-weighted face normals
+	if (missingNormals) {
+		std::vector<std::array<float, 3>> accumulated(mesh.vertices.size(), { 0, 0, 0 });
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			const float* a = mesh.vertices[indices[i]].pos;
+			const float* b = mesh.vertices[indices[i + 1]].pos;
+			const float* c = mesh.vertices[indices[i + 2]].pos;
+			float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			for (int corner = 0; corner < 3; ++corner) {
+				for (int axis = 0; axis < 3; ++axis) {
+					accumulated[indices[i + corner]][axis] += normal[axis];
+				}
+			}
+		}
+
+		for (size_t v = 0; v < mesh.vertices.size(); ++v) {
+			float* normal = mesh.vertices[v].rgb;
+			if (normal[0] != 0.0f || normal[1] != 0.0f || normal[2] != 0.0f) {
+				continue;
+			}
+			const std::array<float, 3>& sum = accumulated[v];
+			float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+			for (int axis = 0; axis < 3; ++axis) {
+				normal[axis] = length > 0.0f ? sum[axis] / length : 0.0f;
+			}
+		}
+	}
+
+	SetMeshIndices(mesh, indices);
+	mesh.topology = PrimitiveTopology::TriangleList;
+	return true;
+}
+
+// Function to load a binary mesh file
+static bool LoadMeshFile(const std::string& filePath, Mesh& mesh) {
+	std::ifstream reader(filePath, std::ios::binary);
+	if (!reader.is_open()) {
+		std::cerr << "Could not open file: " << filePath << std::endl;
+		return false;
+	}
+
+	MeshFileHeader header;
+	if (!reader.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, MESH_MAGIC, sizeof(MESH_MAGIC)) != 0 ||
+		header.version != MESH_VERSION || header.indexFormat > static_cast<uint32_t>(IndexFormat::UInt32) ||
+		header.topology > static_cast<uint32_t>(PrimitiveTopology::TriangleStrip)) {
+		std::cerr << "Invalid mesh file: " << filePath << std::endl;
+		return false;
+	}
+
+	mesh.indexFormat = static_cast<IndexFormat>(header.indexFormat);
+	mesh.topology = static_cast<PrimitiveTopology>(header.topology);
+	mesh.indexCount = header.indexCount;
+	size_t indexSize = mesh.indexFormat == IndexFormat::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	// The counts must fit the file before they size any allocation
+	uint64_t dataSize = static_cast<uint64_t>(header.vertexCount) * sizeof(SimpleVertex) + static_cast<uint64_t>(header.indexCount) * indexSize;
+	reader.seekg(0, std::ios::end);
+	uint64_t fileSize = static_cast<uint64_t>(reader.tellg());
+	reader.seekg(sizeof(header), std::ios::beg);
+	if (!reader || fileSize - sizeof(header) < dataSize) {
+		std::cerr << "Invalid mesh file: " << filePath << std::endl;
+		return false;
+	}
+
+	mesh.vertices.assign(header.vertexCount, SimpleVertex({ 0, 0, 0 }, { 0, 0, 0 }, { 0, 0 }));
+	mesh.indexData.resize(static_cast<size_t>(header.indexCount) * indexSize);
+	if (!reader.read(reinterpret_cast<char*>(mesh.vertices.data()), sizeof(SimpleVertex) * mesh.vertices.size()) ||
+		!reader.read(reinterpret_cast<char*>(mesh.indexData.data()), mesh.indexData.size())) {
+		std::cerr << "Failed to read file: " << filePath << std::endl;
+		return false;
+	}
+
+	// Every index must name a vertex, the renderer and the optimizer index arrays with them unchecked
+	for (uint32_t i = 0; i < mesh.indexCount; ++i) {
+		uint32_t index = 0;
+		if (mesh.indexFormat == IndexFormat::UInt16) {
+			uint16_t shortIndex;
+			std::memcpy(&shortIndex, mesh.indexData.data() + i * sizeof(uint16_t), sizeof(shortIndex));
+			index = shortIndex;
+		}
+		else {
+			std::memcpy(&index, mesh.indexData.data() + i * sizeof(uint32_t), sizeof(index));
+		}
+		if (index >= header.vertexCount) {
+			std::cerr << "Invalid mesh file: " << filePath << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Function to load a mesh, picking the format from the extension
+bool LoadMesh(const std::string& filePath, Mesh& mesh) {
+	if (HasExtension(filePath, ".obj")) {
+		return LoadObj(filePath, mesh);
+	}
+	return LoadMeshFile(filePath, mesh);
+}
+
+// Function to write a binary mesh file
+bool SaveMesh(const std::string& filePath, const Mesh& mesh) {
+	std::ofstream writer(filePath, std::ios::binary);
+	if (!writer.is_open()) {
+		std::cerr << "Could not open file: " << filePath << std::endl;
+		return false;
+	}
+
+	MeshFileHeader header;
+	std::memcpy(header.magic, MESH_MAGIC, sizeof(MESH_MAGIC));
+	header.version = MESH_VERSION;
+	header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	header.indexCount = mesh.indexCount;
+	header.indexFormat = static_cast<uint32_t>(mesh.indexFormat);
+	header.topology = static_cast<uint32_t>(mesh.topology);
+
+	writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	writer.write(reinterpret_cast<const char*>(mesh.vertices.data()), sizeof(SimpleVertex) * mesh.vertices.size());
+	writer.write(reinterpret_cast<const char*>(mesh.indexData.data()), mesh.indexData.size());
+	if (!writer) {
+		std::cerr << "Failed to write file: " << filePath << std::endl;
+		return false;
+	}
+
+	return true;
+}
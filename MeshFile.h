@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include "Geometry.h"
+
+/// <summary>
+/// Loads a mesh from a binary .mesh file written by SaveMesh(), or from a Wavefront .obj file.
+/// OBJ positions and normals are mirrored along z into the left-handed space of the renderer, which also turns
+/// the counter-clockwise OBJ front faces clockwise. Texture coordinates are flipped to a top-left origin.
+/// </summary>
+/// <param name="filePath">- Path of the .mesh or .obj file.</param>
+/// <param name="mesh">- Receives the mesh, OBJ files become an indexed triangle list.</param>
+/// <returns>True if the mesh was loaded, otherwise false.</returns>
+bool LoadMesh(const std::string& filePath, Mesh& mesh);
+
+/// <summary>
+/// Writes a mesh as a binary .mesh file: a header followed by the vertex buffer and the index buffer,
+/// exactly as they are uploaded to the GPU.
+/// </summary>
+/// <param name="filePath">- Path of the file to write.</param>
+/// <param name="mesh">- The mesh to write.</param>
+/// <returns>True if the file was written, otherwise false.</returns>
+bool SaveMesh(const std::string& filePath, const Mesh& mesh);
@@ -0,0 +1,445 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// Tuning of the Forsyth vertex scores, values from the original article
+static const uint32_t FORSYTH_CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+// Resolution of the views rasterized by AnalyzeOverdraw()
+static const int OVERDRAW_RESOLUTION = 256;
+
+// Function to read one index of a mesh, non-indexed meshes use the vertex order
+static uint32_t MeshIndex(const Mesh& mesh, uint32_t i) {
+	if (mesh.indexCount == 0) {
+		return i;
+	}
+	if (mesh.indexFormat == IndexFormat::UInt16) {
+		uint16_t index;
+		std::memcpy(&index, &mesh.indexData[i * sizeof(uint16_t)], sizeof(index));
+		return index;
+	}
+	uint32_t index;
+	std::memcpy(&index, &mesh.indexData[i * sizeof(uint32_t)], sizeof(index));
+	return index;
+}
+
+// Function to expand a mesh into a triangle list
+void GetTriangleList(const Mesh& mesh, std::vector<uint32_t>& indices) {
+	uint32_t count = mesh.indexCount != 0 ? mesh.indexCount : static_cast<uint32_t>(mesh.vertices.size());
+	indices.clear();
+
+	if (mesh.topology == PrimitiveTopology::TriangleList) {
+		indices.reserve(count / 3 * 3);
+		for (uint32_t i = 0; i < count / 3 * 3; ++i) {
+			indices.push_back(MeshIndex(mesh, i));
+		}
+		return;
+	}
+
+	for (uint32_t i = 0; i + 2 < count; ++i) {
+		uint32_t a = MeshIndex(mesh, i);
+		uint32_t b = MeshIndex(mesh, i + 1);
+		uint32_t c = MeshIndex(mesh, i + 2);
+
+		// Odd triangles of a strip swap their first two vertices to keep the winding
+		if (i % 2 == 1) {
+			std::swap(a, b);
+		}
+
+		// Degenerate triangles only join strips, a list does not need them
+		if (a != b && b != c && a != c) {
+			indices.insert(indices.end(), { a, b, c });
+		}
+	}
+}
+
+// Function to score a vertex by its LRU cache position and the number of triangles still using it
+static float VertexScore(int cachePosition, uint32_t remaining) {
+	if (remaining == 0) {
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		// The last triangle's vertices get a fixed score so the next triangle does not simply reuse the same edge
+		if (cachePosition < 3) {
+			score = LAST_TRIANGLE_SCORE;
+		}
+		else {
+			float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+			score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+		}
+	}
+
+	// Boost vertices with few triangles left so they are finished and leave the working set
+	score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+	return score;
+}
+
+// Function to reorder triangles for the vertex cache
+void OptimizeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, std::vector<uint32_t>& result) {
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	result.clear();
+	result.reserve(triangleCount * 3);
+
+	// Triangles using each vertex, the first remaining[v] entries of a vertex are the ones not emitted yet
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t i = 0; i < triangleCount * 3; ++i) {
+		++remaining[indices[i]];
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (uint32_t v = 0; v < vertexCount; ++v) {
+		offsets[v + 1] = offsets[v] + remaining[v];
+	}
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+	for (uint32_t i = 0; i < triangleCount * 3; ++i) {
+		adjacency[cursor[indices[i]]++] = i / 3;
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v) {
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+	}
+
+	std::vector<uint8_t> emitted(triangleCount, 0);
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	int64_t best = -1;
+	uint32_t nextUnemitted = 0;
+	for (uint32_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+		// Dead end, no cached vertex has triangles left: continue with the next triangle in input order
+		if (best < 0) {
+			while (emitted[nextUnemitted] != 0) {
+				++nextUnemitted;
+			}
+			best = nextUnemitted;
+		}
+
+		uint32_t triangle = static_cast<uint32_t>(best);
+		const uint32_t* vertex = &indices[triangle * 3];
+		result.insert(result.end(), vertex, vertex + 3);
+		emitted[triangle] = 1;
+
+		// Remove the triangle from the adjacency of its vertices
+		for (int i = 0; i < 3; ++i) {
+			uint32_t* begin = &adjacency[offsets[vertex[i]]];
+			uint32_t* end = begin + remaining[vertex[i]];
+			uint32_t* found = std::find(begin, end, triangle);
+			std::swap(*found, *(end - 1));
+			--remaining[vertex[i]];
+		}
+
+		// The triangle's vertices move to the front of the LRU cache
+		newCache.assign(vertex, vertex + 3);
+		for (uint32_t cached : cache) {
+			if (cached != vertex[0] && cached != vertex[1] && cached != vertex[2]) {
+				newCache.push_back(cached);
+			}
+		}
+
+		// Rescore the vertices that moved or were evicted
+		for (size_t i = 0; i < newCache.size(); ++i) {
+			uint32_t v = newCache[i];
+			cachePosition[v] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+			vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+		}
+
+		// Score their triangles, the next triangle is the best one touching the cache
+		best = -1;
+		float bestScore = -std::numeric_limits<float>::max();
+		for (size_t i = 0; i < newCache.size(); ++i) {
+			uint32_t v = newCache[i];
+			for (uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; ++a) {
+				uint32_t t = adjacency[a];
+				float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				if (i < FORSYTH_CACHE_SIZE && score > bestScore) {
+					bestScore = score;
+					best = t;
+				}
+			}
+		}
+
+		newCache.resize(std::min<size_t>(newCache.size(), FORSYTH_CACHE_SIZE));
+		std::swap(cache, newCache);
+	}
+}
+
+// Function to run a triangle through a FIFO cache, returns the number of misses.
+// A vertex is cached while fewer than cacheSize vertices were inserted after it.
+static uint32_t UpdateCache(const uint32_t* triangle, uint32_t cacheSize, std::vector<uint32_t>& timestamps, uint32_t& timestamp) {
+	uint32_t misses = 0;
+	for (int i = 0; i < 3; ++i) {
+		uint32_t v = triangle[i];
+		if (timestamp - timestamps[v] > cacheSize) {
+			timestamps[v] = timestamp++;
+			++misses;
+		}
+	}
+	return misses;
+}
+
+// Function to compute the area-weighted normal of a triangle, pointing to the front side
+static void TriangleNormal(const SimpleVertex& a, const SimpleVertex& b, const SimpleVertex& c, float normal[3]) {
+	float e1[3], e2[3];
+	for (int i = 0; i < 3; ++i) {
+		e1[i] = b.pos[i] - a.pos[i];
+		e2[i] = c.pos[i] - a.pos[i];
+	}
+
+	// Clockwise triangles are front facing in the left-handed space of the renderer
+	normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// Function to reorder triangle clusters to reduce overdraw
+void OptimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<SimpleVertex>& vertices, float threshold, std::vector<uint32_t>& result) {
+	const uint32_t cacheSize = DEFAULT_VERTEX_CACHE_SIZE;
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	result.clear();
+	if (triangleCount == 0) {
+		return;
+	}
+
+	std::vector<uint32_t> timestamps(vertices.size(), 0);
+	uint32_t timestamp = cacheSize + 1;
+
+	// Hard boundaries: triangles missing the cache on all vertices start over anyway
+	std::vector<uint32_t> hardBoundaries;
+	for (uint32_t t = 0; t < triangleCount; ++t) {
+		if (UpdateCache(&indices[t * 3], cacheSize, timestamps, timestamp) == 3) {
+			hardBoundaries.push_back(t);
+		}
+	}
+	if (hardBoundaries.empty() || hardBoundaries[0] != 0) {
+		hardBoundaries.insert(hardBoundaries.begin(), 0);
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	// Soft boundaries: split a hard cluster once its running ACMR, starting from an empty cache,
+	// drops to the cluster's own ACMR times the threshold
+	std::vector<uint32_t> clusters;
+	for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h) {
+		uint32_t start = hardBoundaries[h];
+		uint32_t end = hardBoundaries[h + 1];
+
+		timestamp += cacheSize + 1;
+		uint32_t clusterMisses = 0;
+		for (uint32_t t = start; t < end; ++t) {
+			clusterMisses += UpdateCache(&indices[t * 3], cacheSize, timestamps, timestamp);
+		}
+		float clusterThreshold = threshold * clusterMisses / (end - start);
+
+		clusters.push_back(start);
+		timestamp += cacheSize + 1;
+		uint32_t runningMisses = 0;
+		uint32_t runningTriangles = 0;
+		for (uint32_t t = start; t < end; ++t) {
+			runningMisses += UpdateCache(&indices[t * 3], cacheSize, timestamps, timestamp);
+			++runningTriangles;
+
+			if (t + 1 < end && static_cast<float>(runningMisses) / runningTriangles <= clusterThreshold) {
+				clusters.push_back(t + 1);
+				timestamp += cacheSize + 1;
+				runningMisses = 0;
+				runningTriangles = 0;
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	// Area-weighted centroid of the whole mesh
+	double meshCentroid[3] = { 0.0, 0.0, 0.0 };
+	double meshArea = 0.0;
+	std::vector<float> clusterKey(clusters.size() - 1);
+	std::vector<double> clusterCentroid((clusters.size() - 1) * 3, 0.0);
+	std::vector<double> clusterNormal((clusters.size() - 1) * 3, 0.0);
+	for (size_t c = 0; c + 1 < clusters.size(); ++c) {
+		double clusterArea = 0.0;
+		for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+			const SimpleVertex& a = vertices[indices[t * 3]];
+			const SimpleVertex& b = vertices[indices[t * 3 + 1]];
+			const SimpleVertex& d = vertices[indices[t * 3 + 2]];
+			float normal[3];
+			TriangleNormal(a, b, d, normal);
+			double area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			for (int i = 0; i < 3; ++i) {
+				double center = (a.pos[i] + b.pos[i] + d.pos[i]) / 3.0;
+				clusterCentroid[c * 3 + i] += center * area;
+				clusterNormal[c * 3 + i] += normal[i];
+				meshCentroid[i] += center * area;
+			}
+			clusterArea += area;
+		}
+		for (int i = 0; i < 3; ++i) {
+			clusterCentroid[c * 3 + i] /= std::max(clusterArea, 1e-30);
+		}
+		meshArea += clusterArea;
+	}
+	for (int i = 0; i < 3; ++i) {
+		meshCentroid[i] /= std::max(meshArea, 1e-30);
+	}
+
+	// Clusters facing away from the center are likely to occlude the others, draw them first
+	std::vector<uint32_t> order(clusters.size() - 1);
+	for (size_t c = 0; c < order.size(); ++c) {
+		const double* n = &clusterNormal[c * 3];
+		double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		double dot = 0.0;
+		for (int i = 0; i < 3; ++i) {
+			dot += (clusterCentroid[c * 3 + i] - meshCentroid[i]) * n[i];
+		}
+		clusterKey[c] = length > 0.0 ? static_cast<float>(dot / length) : 0.0f;
+		order[c] = static_cast<uint32_t>(c);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return clusterKey[a] > clusterKey[b]; });
+
+	result.reserve(triangleCount * 3);
+	for (uint32_t c : order) {
+		result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+}
+
+// Function to reorder vertices in first-use order
+void OptimizeVertexFetch(std::vector<SimpleVertex>& vertices, std::vector<uint32_t>& indices) {
+	const uint32_t UNUSED = ~uint32_t(0);
+	std::vector<uint32_t> remap(vertices.size(), UNUSED);
+	std::vector<SimpleVertex> reordered;
+	reordered.reserve(vertices.size());
+
+	for (uint32_t& index : indices) {
+		if (remap[index] == UNUSED) {
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(reordered);
+}
+
+// Function to measure the vertex cache efficiency
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize) {
+	VertexCacheStats stats;
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	if (triangleCount == 0) {
+		return stats;
+	}
+
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	std::vector<uint8_t> referenced(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+	uint32_t uniqueVertices = 0;
+	for (uint32_t t = 0; t < triangleCount; ++t) {
+		stats.vertexTransforms += UpdateCache(&indices[t * 3], cacheSize, timestamps, timestamp);
+		for (int i = 0; i < 3; ++i) {
+			if (referenced[indices[t * 3 + i]] == 0) {
+				referenced[indices[t * 3 + i]] = 1;
+				++uniqueVertices;
+			}
+		}
+	}
+
+	stats.acmr = static_cast<float>(stats.vertexTransforms) / triangleCount;
+	stats.atvr = static_cast<float>(stats.vertexTransforms) / uniqueVertices;
+	return stats;
+}
+
+// Function to measure the overdraw from the six axis directions
+OverdrawStats AnalyzeOverdraw(const std::vector<uint32_t>& indices, const std::vector<SimpleVertex>& vertices) {
+	OverdrawStats stats;
+	if (indices.size() < 3 || vertices.empty()) {
+		return stats;
+	}
+
+	// Scale the mesh bounds to the view resolution, the same for every axis so pixels stay square
+	float minimum[3], maximum[3];
+	for (int i = 0; i < 3; ++i) {
+		minimum[i] = std::numeric_limits<float>::max();
+		maximum[i] = -std::numeric_limits<float>::max();
+	}
+	for (const SimpleVertex& vertex : vertices) {
+		for (int i = 0; i < 3; ++i) {
+			minimum[i] = std::min(minimum[i], vertex.pos[i]);
+			maximum[i] = std::max(maximum[i], vertex.pos[i]);
+		}
+	}
+	float extent = std::max({ maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2], 1e-20f });
+	float scale = (OVERDRAW_RESOLUTION - 1) / extent;
+
+	std::vector<float> depth(OVERDRAW_RESOLUTION * OVERDRAW_RESOLUTION);
+	for (int view = 0; view < 6; ++view) {
+		int axis = view / 2;
+		float direction = view % 2 == 0 ? 1.0f : -1.0f;
+		int axisU = (axis + 1) % 3;
+		int axisV = (axis + 2) % 3;
+		std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+
+		for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+			const SimpleVertex* v[3] = { &vertices[indices[t]], &vertices[indices[t + 1]], &vertices[indices[t + 2]] };
+
+			// Back-face culling, the camera looks along the view direction
+			float normal[3];
+			TriangleNormal(*v[0], *v[1], *v[2], normal);
+			if (normal[axis] * direction >= 0.0f) {
+				continue;
+			}
+
+			float x[3], y[3], z[3];
+			for (int i = 0; i < 3; ++i) {
+				x[i] = (v[i]->pos[axisU] - minimum[axisU]) * scale;
+				y[i] = (v[i]->pos[axisV] - minimum[axisV]) * scale;
+				z[i] = v[i]->pos[axis] * direction;
+			}
+			float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+			if (area == 0.0f) {
+				continue;
+			}
+
+			int minX = std::max(0, static_cast<int>(std::floor(std::min({ x[0], x[1], x[2] }))));
+			int maxX = std::min(OVERDRAW_RESOLUTION - 1, static_cast<int>(std::ceil(std::max({ x[0], x[1], x[2] }))));
+			int minY = std::max(0, static_cast<int>(std::floor(std::min({ y[0], y[1], y[2] }))));
+			int maxY = std::min(OVERDRAW_RESOLUTION - 1, static_cast<int>(std::ceil(std::max({ y[0], y[1], y[2] }))));
+			float invArea = 1.0f / area;
+
+			for (int py = minY; py <= maxY; ++py) {
+				for (int px = minX; px <= maxX; ++px) {
+					float cx = px + 0.5f;
+					float cy = py + 0.5f;
+					float w0 = ((x[1] - cx) * (y[2] - cy) - (x[2] - cx) * (y[1] - cy)) * invArea;
+					float w1 = ((x[2] - cx) * (y[0] - cy) - (x[0] - cx) * (y[2] - cy)) * invArea;
+					float w2 = 1.0f - w0 - w1;
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+						continue;
+					}
+
+					float pixelDepth = w0 * z[0] + w1 * z[1] + w2 * z[2];
+					float& stored = depth[py * OVERDRAW_RESOLUTION + px];
+					if (pixelDepth < stored) {
+						if (stored == std::numeric_limits<float>::max()) {
+							++stats.pixelsCovered;
+						}
+						stored = pixelDepth;
+						++stats.pixelsShaded;
+					}
+				}
+			}
+		}
+	}
+
+	stats.overdraw = stats.pixelsCovered > 0 ? static_cast<float>(stats.pixelsShaded) / stats.pixelsCovered : 0.0f;
+	return stats;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Geometry.h"
+
+// Entries of the FIFO post-transform cache simulated by AnalyzeVertexCache(), a common size on current GPUs
+static const uint32_t DEFAULT_VERTEX_CACHE_SIZE = 16;
+
+// Overdraw optimization may raise the ACMR of a cluster by at most this factor
+static const float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+// Vertex cache efficiency of an index buffer
+struct VertexCacheStats {
+	uint32_t vertexTransforms = 0; // cache misses, vertices the vertex shader runs for
+	float acmr = 0.0f;             // average cache miss ratio, transforms per triangle (0.5 is ideal for large grids, 3 is worst)
+	float atvr = 0.0f;             // average transform to vertex ratio, transforms per referenced vertex (1 is ideal)
+};
+
+// Overdraw of a mesh, measured from the six axis-aligned view directions
+struct OverdrawStats {
+	uint64_t pixelsCovered = 0; // pixels covered by at least one front-facing triangle
+	uint64_t pixelsShaded = 0;  // pixels passing the depth test, including those overwritten later
+	float overdraw = 0.0f;      // shaded / covered, 1 means every pixel is shaded once
+};
+
+/// <summary>
+/// Expands any mesh (indexed or not, list or strip) into a 32-bit triangle list. Strip triangles keep their winding.
+/// </summary>
+/// <param name="mesh">- The mesh to expand.</param>
+/// <param name="indices">- Receives three indices per triangle.</param>
+void GetTriangleList(const Mesh& mesh, std::vector<uint32_t>& indices);
+
+/// <summary>
+/// Reorders triangles for the post-transform vertex cache with Tom Forsyth's linear-speed algorithm,
+/// scoring vertices by their position in a simulated 32-entry LRU cache and their remaining triangle count.
+/// </summary>
+/// <param name="indices">- Triangle list to reorder.</param>
+/// <param name="vertexCount">- Number of vertices referenced by the indices.</param>
+/// <param name="result">- Receives the reordered triangle list.</param>
+void OptimizeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, std::vector<uint32_t>& result);
+
+/// <summary>
+/// Reorders clusters of a cache-optimized triangle list to reduce overdraw (Sander et al., "Fast triangle reordering
+/// for vertex locality and reduced overdraw"). The list is split where the cache restarts or where a prefix reaches
+/// the cluster ACMR times the threshold, then clusters facing away from the mesh center are drawn first.
+/// </summary>
+/// <param name="indices">- Triangle list, ideally the output of OptimizeVertexCache().</param>
+/// <param name="vertices">- The vertices referenced by the indices.</param>
+/// <param name="threshold">- Allowed ACMR increase, 1.05 keeps the cache efficiency within 5%.</param>
+/// <param name="result">- Receives the reordered triangle list.</param>
+void OptimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<SimpleVertex>& vertices, float threshold, std::vector<uint32_t>& result);
+
+/// <summary>
+/// Reorders vertices in the order the indices first reference them and drops unreferenced vertices,
+/// so vertex fetches walk the vertex buffer linearly. The indices are remapped in place.
+/// </summary>
+/// <param name="vertices">- The vertices to reorder.</param>
+/// <param name="indices">- Triangle list, remapped to the new vertex order.</param>
+void OptimizeVertexFetch(std::vector<SimpleVertex>& vertices, std::vector<uint32_t>& indices);
+
+/// <summary>
+/// Simulates a FIFO post-transform vertex cache over a triangle list.
+/// </summary>
+/// <param name="indices">- Triangle list to analyze.</param>
+/// <param name="vertexCount">- Number of vertices referenced by the indices.</param>
+/// <param name="cacheSize">- Number of cache entries.</param>
+/// <returns>The cache statistics.</returns>
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize);
+
+/// <summary>
+/// Rasterizes the mesh orthographically along the six axis directions with back-face culling and a LESS depth test,
+/// counting how often covered pixels are shaded.
+/// </summary>
+/// <param name="indices">- Triangle list to analyze.</param>
+/// <param name="vertices">- The vertices referenced by the indices.</param>
+/// <returns>The overdraw statistics.</returns>
+OverdrawStats AnalyzeOverdraw(const std::vector<uint32_t>& indices, const std::vector<SimpleVertex>& vertices);
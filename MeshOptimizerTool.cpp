@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Geometry.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+
+// Function to print the vertex cache and overdraw statistics of a triangle list
+static void PrintReport(const char* label, const std::vector<uint32_t>& indices, const std::vector<SimpleVertex>& vertices, uint32_t cacheSize) {
+	VertexCacheStats cache = AnalyzeVertexCache(indices, static_cast<uint32_t>(vertices.size()), cacheSize);
+	OverdrawStats overdraw = AnalyzeOverdraw(indices, vertices);
+	std::printf("%-7s %8zu vertices %8zu triangles  ACMR %.3f  ATVR %.3f  overdraw %.3f\n", label, vertices.size(), indices.size() / 3,
+		cache.acmr, cache.atvr, overdraw.overdraw);
+}
+
+// Offline tool reordering a mesh for the post-transform cache, overdraw and vertex fetch, then writing it as a .mesh file
+int main(int argc, char** argv) {
+	uint32_t cacheSize = DEFAULT_VERTEX_CACHE_SIZE;
+	float threshold = DEFAULT_OVERDRAW_THRESHOLD;
+	std::string inputPath;
+	std::string outputPath;
+
+	// Parse command line options
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+			cacheSize = static_cast<uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--overdraw-threshold") == 0 && i + 1 < argc) {
+			threshold = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (argv[i][0] != '-' && inputPath.empty()) {
+			inputPath = argv[i];
+		}
+		else if (argv[i][0] != '-' && outputPath.empty()) {
+			outputPath = argv[i];
+		}
+		else {
+			inputPath.clear();
+			break;
+		}
+	}
+
+	if (inputPath.empty() || outputPath.empty() || cacheSize == 0) {
+		std::cerr << "Usage: " << argv[0] << " input.obj|input.mesh output.mesh [--cache-size N] [--overdraw-threshold T]" << std::endl;
+		return -1;
+	}
+
+	Mesh mesh;
+	if (!LoadMesh(inputPath, mesh)) {
+		std::cerr << "Failed to load mesh!" << std::endl;
+		return -1;
+	}
+
+	std::vector<uint32_t> indices;
+	GetTriangleList(mesh, indices);
+	PrintReport("Before", indices, mesh.vertices, cacheSize);
+
+	// Triangle order first, the vertex order follows from the final triangle order
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<uint32_t> cacheOptimized;
+	OptimizeVertexCache(indices, static_cast<uint32_t>(mesh.vertices.size()), cacheOptimized);
+	auto cacheDone = std::chrono::high_resolution_clock::now();
+
+	OptimizeOverdraw(cacheOptimized, mesh.vertices, threshold, indices);
+	auto overdrawDone = std::chrono::high_resolution_clock::now();
+
+	OptimizeVertexFetch(mesh.vertices, indices);
+	auto fetchDone = std::chrono::high_resolution_clock::now();
+
+	PrintReport("After", indices, mesh.vertices, cacheSize);
+	std::printf("Vertex cache %.1f ms, overdraw %.1f ms, vertex fetch %.1f ms\n",
+		std::chrono::duration<double, std::milli>(cacheDone - start).count(),
+		std::chrono::duration<double, std::milli>(overdrawDone - cacheDone).count(),
+		std::chrono::duration<double, std::milli>(fetchDone - overdrawDone).count());
+
+	SetMeshIndices(mesh, indices);
+	mesh.topology = PrimitiveTopology::TriangleList;
+	if (!SaveMesh(outputPath, mesh)) {
+		std::cerr << "Failed to save mesh!" << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
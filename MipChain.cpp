@@ -0,0 +1,320 @@
+#include "MipChain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Multiplies and adds must not be fused into FMA, the kernels round exactly like the scalar ones
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+// Half width of the Kaiser filter in destination texels and the shape of its window
+static const double KAISER_RADIUS = 1.5;
+static const double KAISER_ALPHA = 4.0;
+
+// Destination rows filtered per thread pool task
+static const uint32_t MIP_ROWS_PER_TASK = 4;
+
+// Separable filter along one axis, destination texel d reads taps source texels at indices[d * taps + k]
+struct FilterWeights {
+	uint32_t taps = 0;
+	std::vector<int> indices;
+	std::vector<float> weights;
+};
+
+// Filters rows[k] weighted by weights[k] into output, count floats wide
+typedef void (*FilterRowsFunction)(const float* const* rows, const float* weights, uint32_t taps, uint32_t count, float* output);
+
+// Filters an RGBA row horizontally into width destination texels
+typedef void (*FilterColumnsFunction)(const float* row, const FilterWeights& filter, uint32_t width, float* output);
+
+// Function to evaluate the zeroth order modified Bessel function of the first kind
+static double BesselI0(double x) {
+	double sum = 1.0;
+	double term = 1.0;
+	for (int k = 1; k < 32; ++k) {
+		term *= (x * 0.5) / k;
+		sum += term * term;
+	}
+	return sum;
+}
+
+// Function to evaluate the Kaiser-windowed sinc at t destination texels from the center
+static double KaiserWeight(double t) {
+	if (std::fabs(t) >= KAISER_RADIUS) {
+		return 0.0;
+	}
+	const double PI = 3.14159265358979323846;
+	double sinc = std::fabs(t) < 1e-9 ? 1.0 : std::sin(PI * t) / (PI * t);
+	double r = t / KAISER_RADIUS;
+	return sinc * BesselI0(KAISER_ALPHA * std::sqrt(1.0 - r * r)) / BesselI0(KAISER_ALPHA);
+}
+
+// Function to compute the weights for downsampling one axis, source indices wrap around
+static void ComputeWeights(MipFilter filter, int sourceSize, int destinationSize, FilterWeights& result) {
+	double scale = static_cast<double>(sourceSize) / destinationSize;
+	double support = filter == MipFilter::Box ? scale * 0.5 : KAISER_RADIUS * scale;
+
+	// Weights of every destination texel, with their first source texel
+	std::vector<std::vector<double>> taps(destinationSize);
+	std::vector<int> first(destinationSize);
+	result.taps = 0;
+	for (int d = 0; d < destinationSize; ++d) {
+		double center = (d + 0.5) * scale;
+		int lowest = static_cast<int>(std::floor(center - support));
+		int highest = static_cast<int>(std::ceil(center + support)) - 1;
+		for (int i = lowest; i <= highest; ++i) {
+			double weight;
+			if (filter == MipFilter::Box) {
+				weight = std::max(0.0, std::min(i + 1.0, center + support) - std::max(static_cast<double>(i), center - support));
+			}
+			else {
+				weight = KaiserWeight((i + 0.5 - center) / scale);
+			}
+
+			// Drop leading zeros, trailing ones are trimmed below
+			if (taps[d].empty() && weight == 0.0) {
+				continue;
+			}
+			if (taps[d].empty()) {
+				first[d] = i;
+			}
+			taps[d].push_back(weight);
+		}
+		while (!taps[d].empty() && taps[d].back() == 0.0) {
+			taps[d].pop_back();
+		}
+		result.taps = std::max(result.taps, static_cast<uint32_t>(taps[d].size()));
+	}
+
+	// Normalize and pad to the same number of taps
+	result.indices.assign(static_cast<size_t>(destinationSize) * result.taps, 0);
+	result.weights.assign(static_cast<size_t>(destinationSize) * result.taps, 0.0f);
+	for (int d = 0; d < destinationSize; ++d) {
+		double sum = 0.0;
+		for (double weight : taps[d]) {
+			sum += weight;
+		}
+		for (uint32_t k = 0; k < result.taps; ++k) {
+			int index = first[d] + static_cast<int>(std::min<size_t>(k, taps[d].size() - 1));
+			result.indices[d * result.taps + k] = ((index % sourceSize) + sourceSize) % sourceSize;
+			result.weights[d * result.taps + k] = k < taps[d].size() ? static_cast<float>(taps[d][k] / sum) : 0.0f;
+		}
+	}
+}
+
+// Function to filter rows one float at a time
+static void FilterRowsScalar(const float* const* rows, const float* weights, uint32_t taps, uint32_t count, float* output) {
+	for (uint32_t i = 0; i < count; ++i) {
+		float sum = 0.0f;
+		for (uint32_t k = 0; k < taps; ++k) {
+			sum += rows[k][i] * weights[k];
+		}
+		output[i] = sum;
+	}
+}
+
+// Function to filter destination texels [first, end) of a row horizontally one texel at a time
+static void FilterColumnRange(const float* row, const FilterWeights& filter, uint32_t first, uint32_t end, float* output) {
+	for (uint32_t d = first; d < end; ++d) {
+		const int* indices = &filter.indices[d * filter.taps];
+		const float* weights = &filter.weights[d * filter.taps];
+		for (int c = 0; c < 4; ++c) {
+			float sum = 0.0f;
+			for (uint32_t k = 0; k < filter.taps; ++k) {
+				sum += row[indices[k] * 4 + c] * weights[k];
+			}
+			output[d * 4 + c] = sum;
+		}
+	}
+}
+
+// Function to filter a row horizontally one texel at a time
+static void FilterColumnsScalar(const float* row, const FilterWeights& filter, uint32_t width, float* output) {
+	FilterColumnRange(row, filter, 0, width, output);
+}
+
+#ifdef SIMD_X86
+// Function to filter rows 8 floats at a time
+SIMD_TARGET_AVX2 static void FilterRowsAVX2(const float* const* rows, const float* weights, uint32_t taps, uint32_t count, float* output) {
+	uint32_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 sum = _mm256_setzero_ps();
+		for (uint32_t k = 0; k < taps; ++k) {
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(rows[k] + i), _mm256_set1_ps(weights[k])));
+		}
+		_mm256_storeu_ps(output + i, sum);
+	}
+
+	// Remaining floats
+	for (; i < count; ++i) {
+		float sum = 0.0f;
+		for (uint32_t k = 0; k < taps; ++k) {
+			sum += rows[k][i] * weights[k];
+		}
+		output[i] = sum;
+	}
+}
+
+// Function to filter a row horizontally two RGBA texels at a time
+SIMD_TARGET_AVX2 static void FilterColumnsAVX2(const float* row, const FilterWeights& filter, uint32_t width, float* output) {
+	uint32_t d = 0;
+	for (; d + 2 <= width; d += 2) {
+		const int* indices = &filter.indices[d * filter.taps];
+		const float* weights = &filter.weights[d * filter.taps];
+		__m256 sum = _mm256_setzero_ps();
+		for (uint32_t k = 0; k < filter.taps; ++k) {
+			__m256 texels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(row + indices[k] * 4)),
+				_mm_loadu_ps(row + indices[filter.taps + k] * 4), 1);
+			__m256 weight = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(weights[k])), _mm_set1_ps(weights[filter.taps + k]), 1);
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(texels, weight));
+		}
+		_mm256_storeu_ps(output + d * 4, sum);
+	}
+
+	// Last texel of odd widths
+	FilterColumnRange(row, filter, d, width, output);
+}
+#endif
+
+// Function to decode an sRGB value to linear
+static float SrgbToLinear(float value) {
+	return value <= 0.04045f ? value / 12.92f : static_cast<float>(std::pow((value + 0.055) / 1.055, 2.4));
+}
+
+// Conversions between 8-bit texels and linear floats, built once
+struct ColorTables {
+	float toLinear[256];        // sRGB byte to linear
+	float thresholds[256];      // linear value where rounding switches to the next sRGB byte
+	unsigned char guess[4096];  // sRGB byte at the start of each linear bucket, at most a step or two low
+
+	ColorTables() {
+		for (int i = 0; i < 256; ++i) {
+			toLinear[i] = SrgbToLinear(i / 255.0f);
+			thresholds[i] = i < 255 ? SrgbToLinear((i + 0.5f) / 255.0f) : 2.0f;
+		}
+		int byte = 0;
+		for (int i = 0; i < 4096; ++i) {
+			while (byte < 255 && i / 4095.0f >= thresholds[byte]) {
+				++byte;
+			}
+			guess[i] = static_cast<unsigned char>(byte);
+		}
+	}
+
+	// Function to encode linear to the nearest sRGB byte, exact
+	unsigned char ToSrgb(float value) const {
+		value = std::min(std::max(value, 0.0f), 1.0f);
+		int byte = guess[static_cast<int>(value * 4095.0f)];
+		while (value >= thresholds[byte]) {
+			++byte;
+		}
+		return static_cast<unsigned char>(byte);
+	}
+};
+
+// Function to quantize a linear [0, 1] value to a byte
+static unsigned char ToUnorm8(float value) {
+	return static_cast<unsigned char>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// Function to build the mip chain
+void BuildMipChain(ThreadPool& pool, const MipChainOptions& options, TextureData& texture) {
+	static const ColorTables tables;
+	texture.mips.clear();
+	if (texture.width <= 0 || texture.height <= 0) {
+		return;
+	}
+
+	FilterRowsFunction filterRows = FilterRowsScalar;
+	FilterColumnsFunction filterColumns = FilterColumnsScalar;
+#ifdef SIMD_X86
+	if (std::min(options.simdLevel, DetectSimdLevel()) >= SimdLevel::AVX2) {
+		filterRows = FilterRowsAVX2;
+		filterColumns = FilterColumnsAVX2;
+	}
+#endif
+
+	// Every level is filtered from the float copy of the previous one, so quantization does not accumulate
+	int width = texture.width;
+	int height = texture.height;
+	std::vector<float> source(static_cast<size_t>(width) * height * 4);
+	for (size_t i = 0; i < source.size(); i += 4) {
+		for (int c = 0; c < 3; ++c) {
+			unsigned char value = texture.pixels[i + c];
+			source[i + c] = options.gammaCorrect ? tables.toLinear[value] : value * (1.0f / 255.0f);
+		}
+		source[i + 3] = texture.pixels[i + 3] * (1.0f / 255.0f);
+	}
+
+	std::vector<float> destination;
+	FilterWeights horizontal, vertical;
+	while (width > 1 || height > 1) {
+		int levelWidth = std::max(width >> 1, 1);
+		int levelHeight = std::max(height >> 1, 1);
+		ComputeWeights(options.filter, width, levelWidth, horizontal);
+		ComputeWeights(options.filter, height, levelHeight, vertical);
+
+		texture.mips.emplace_back();
+		TextureMipLevel& level = texture.mips.back();
+		level.width = levelWidth;
+		level.height = levelHeight;
+		level.pixels.resize(static_cast<size_t>(levelWidth) * levelHeight * 4);
+		destination.resize(level.pixels.size());
+
+		// Vertical pass over full source rows, then horizontal pass, then encode
+		uint32_t taskCount = (levelHeight + MIP_ROWS_PER_TASK - 1) / MIP_ROWS_PER_TASK;
+		pool.ParallelFor(taskCount, [&](uint32_t task, uint32_t) {
+			thread_local std::vector<float> filtered;
+			thread_local std::vector<const float*> rows;
+			filtered.resize(static_cast<size_t>(width) * 4);
+			rows.resize(vertical.taps);
+
+			uint32_t end = std::min<uint32_t>(levelHeight, (task + 1) * MIP_ROWS_PER_TASK);
+			for (uint32_t y = task * MIP_ROWS_PER_TASK; y < end; ++y) {
+				for (uint32_t k = 0; k < vertical.taps; ++k) {
+					rows[k] = &source[static_cast<size_t>(vertical.indices[y * vertical.taps + k]) * width * 4];
+				}
+				filterRows(rows.data(), &vertical.weights[y * vertical.taps], vertical.taps, width * 4, filtered.data());
+
+				float* output = &destination[static_cast<size_t>(y) * levelWidth * 4];
+				filterColumns(filtered.data(), horizontal, levelWidth, output);
+
+				unsigned char* texels = &level.pixels[static_cast<size_t>(y) * levelWidth * 4];
+				for (int i = 0; i < levelWidth * 4; i += 4) {
+					for (int c = 0; c < 3; ++c) {
+						texels[i + c] = options.gammaCorrect ? tables.ToSrgb(output[i + c]) : ToUnorm8(output[i + c]);
+					}
+					texels[i + 3] = ToUnorm8(output[i + 3]);
+				}
+			}
+		});
+
+		source.swap(destination);
+		width = levelWidth;
+		height = levelHeight;
+	}
+}
+
+// Function to parse a mip filter name
+bool ParseMipFilter(const char* name, MipFilter& filter) {
+	if (std::strcmp(name, "box") == 0) {
+		filter = MipFilter::Box;
+		return true;
+	}
+	if (std::strcmp(name, "kaiser") == 0) {
+		filter = MipFilter::Kaiser;
+		return true;
+	}
+	return false;
+}
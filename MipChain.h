@@ -0,0 +1,36 @@
+#pragma once
+
+#include "CpuFeatures.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+// Downsampling filters for the mip chain
+enum class MipFilter {
+	Box,    // area average, what GenerateMips() does
+	Kaiser  // Kaiser-windowed sinc over 3 destination texels, sharper with less aliasing
+};
+
+// How BuildMipChain() filters the levels
+struct MipChainOptions {
+	MipFilter filter = MipFilter::Kaiser;
+	bool gammaCorrect = true;                 // filter color in linear light, the texels are sRGB encoded
+	SimdLevel simdLevel = SimdLevel::AVX512;  // lowered to what the CPU supports
+};
+
+/// <summary>
+/// Builds the full mip chain of a texture down to 1x1 and stores it in texture.mips, replacing any previous chain.
+/// Every level is filtered from the full precision previous level with wrap addressing, rows are spread across the pool.
+/// Non power of two sizes round down per level like Direct3D and are resampled with a fractional footprint.
+/// </summary>
+/// <param name="pool">- The threads filtering the rows of each level.</param>
+/// <param name="options">- Filter, color space and SIMD level.</param>
+/// <param name="texture">- The texture, its base level is read and its mips are written.</param>
+void BuildMipChain(ThreadPool& pool, const MipChainOptions& options, TextureData& texture);
+
+/// <summary>
+/// Parses a mip filter name, "box" or "kaiser".
+/// </summary>
+/// <param name="name">- The name to parse.</param>
+/// <param name="filter">- Receives the parsed filter.</param>
+/// <returns>True if the name is known, otherwise false.</returns>
+bool ParseMipFilter(const char* name, MipFilter& filter);
@@ -0,0 +1,299 @@
+#include "PackedVertex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Multiplies and adds must not be fused into FMA, the kernels round exactly like UnpackVertex()
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+// Reciprocals of the largest 16-bit normalized values, decoding multiplies instead of dividing
+static const float UNORM16_SCALE = 1.0f / 65535.0f;
+static const float SNORM16_SCALE = 1.0f / 32767.0f;
+
+// Function to convert a float to a half float with round to nearest even
+uint16_t FloatToHalf(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+	uint32_t magnitude = bits & 0x7FFFFFFF;
+
+	// NaN stays NaN, infinity and values rounding to 65520 or more become infinity
+	if (magnitude > 0x7F800000) {
+		return sign | 0x7E00;
+	}
+	if (magnitude >= 0x477FF000) {
+		return sign | 0x7C00;
+	}
+
+	// Below 2^-14 the half is subnormal, counting units of 2^-24
+	if (magnitude < 0x38800000) {
+		if (magnitude < 0x33000000) {
+			return sign;
+		}
+		uint32_t shift = 126 - (magnitude >> 23);
+		uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1))) {
+			++half;
+		}
+		return sign | static_cast<uint16_t>(half);
+	}
+
+	// Rebias the exponent from 127 to 15, a carry out of the mantissa correctly bumps the exponent
+	uint32_t rebased = magnitude - 0x38000000;
+	uint32_t half = rebased >> 13;
+	uint32_t remainder = rebased & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+		++half;
+	}
+	return sign | static_cast<uint16_t>(half);
+}
+
+// Function to convert a half float to a float
+float HalfToFloat(uint16_t value) {
+	uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+
+	if (exponent == 0) {
+		float subnormal = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+		return sign != 0 ? -subnormal : subnormal;
+	}
+
+	uint32_t bits = exponent == 31 ? sign | 0x7F800000 | (mantissa << 13) : sign | ((exponent + 112) << 23) | (mantissa << 13);
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+// Function to quantize [0, 1] to a 16-bit unsigned normalized value
+static uint16_t QuantizeUnorm(float value) {
+	return static_cast<uint16_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f));
+}
+
+// Function to quantize [-1, 1] to a 16-bit signed normalized value
+static int16_t QuantizeSnorm(float value) {
+	return static_cast<int16_t>(std::lround(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f));
+}
+
+// Function to encode a normal on the octahedron, the lower hemisphere is folded over the diagonals
+static void EncodeOctahedral(const float normal[3], int16_t encoded[2]) {
+	float sum = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+	if (sum == 0.0f) {
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	float x = normal[0] / sum;
+	float y = normal[1] / sum;
+	if (normal[2] < 0.0f) {
+		float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = QuantizeSnorm(x);
+	encoded[1] = QuantizeSnorm(y);
+}
+
+// Function to pack vertices and compute their bounds
+void PackVertices(const std::vector<SimpleVertex>& vertices, std::vector<PackedVertex>& packed, PackedVertexBounds& bounds) {
+	bounds = PackedVertexBounds();
+	packed.resize(vertices.size());
+	if (vertices.empty()) {
+		return;
+	}
+
+	float maximum[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		bounds.minimum[axis] = vertices[0].pos[axis];
+		maximum[axis] = vertices[0].pos[axis];
+	}
+	for (const SimpleVertex& vertex : vertices) {
+		for (int axis = 0; axis < 3; ++axis) {
+			bounds.minimum[axis] = std::min(bounds.minimum[axis], vertex.pos[axis]);
+			maximum[axis] = std::max(maximum[axis], vertex.pos[axis]);
+		}
+	}
+	for (int axis = 0; axis < 3; ++axis) {
+		bounds.extent[axis] = maximum[axis] - bounds.minimum[axis];
+	}
+
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		const SimpleVertex& vertex = vertices[i];
+		PackedVertex& result = packed[i];
+		for (int axis = 0; axis < 3; ++axis) {
+			float extent = bounds.extent[axis];
+			result.position[axis] = extent > 0.0f ? QuantizeUnorm((vertex.pos[axis] - bounds.minimum[axis]) / extent) : 0;
+		}
+		result.position[3] = 0;
+		EncodeOctahedral(vertex.rgb, result.normal);
+		result.uv[0] = FloatToHalf(vertex.uv[0]);
+		result.uv[1] = FloatToHalf(vertex.uv[1]);
+	}
+}
+
+// Function to decode a single packed vertex
+static void UnpackVertex(const PackedVertex& input, const PackedVertexBounds& bounds, SimpleVertex& output) {
+	for (int axis = 0; axis < 3; ++axis) {
+		output.pos[axis] = bounds.minimum[axis] + static_cast<float>(input.position[axis]) * (bounds.extent[axis] * UNORM16_SCALE);
+	}
+
+	// Unfold the octahedron, then normalize
+	float x = std::max(static_cast<float>(input.normal[0]) * SNORM16_SCALE, -1.0f);
+	float y = std::max(static_cast<float>(input.normal[1]) * SNORM16_SCALE, -1.0f);
+	float z = 1.0f - std::fabs(x) - std::fabs(y);
+	float fold = std::max(-z, 0.0f);
+	x += x >= 0.0f ? -fold : fold;
+	y += y >= 0.0f ? -fold : fold;
+	float invLength = 1.0f / std::sqrt(x * x + y * y + z * z);
+	output.rgb[0] = x * invLength;
+	output.rgb[1] = y * invLength;
+	output.rgb[2] = z * invLength;
+
+	output.uv[0] = HalfToFloat(input.uv[0]);
+	output.uv[1] = HalfToFloat(input.uv[1]);
+}
+
+// Function to decode vertices one at a time
+void UnpackVerticesScalar(const PackedVertex* input, uint32_t count, const PackedVertexBounds& bounds, SimpleVertex* output) {
+	for (uint32_t i = 0; i < count; ++i) {
+		UnpackVertex(input[i], bounds, output[i]);
+	}
+}
+
+#ifdef SIMD_X86
+static_assert(sizeof(SimpleVertex) == 8 * sizeof(float), "SimpleVertex must hold 8 floats");
+
+// Function to transpose eight rows of eight floats in place
+SIMD_TARGET_AVX2 static inline void Transpose8x8(__m256 rows[8]) {
+	__m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+	__m256 t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+	__m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]);
+	__m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+	__m256 t4 = _mm256_unpacklo_ps(rows[4], rows[5]);
+	__m256 t5 = _mm256_unpackhi_ps(rows[4], rows[5]);
+	__m256 t6 = _mm256_unpacklo_ps(rows[6], rows[7]);
+	__m256 t7 = _mm256_unpackhi_ps(rows[6], rows[7]);
+
+	__m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+	rows[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+	rows[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+	rows[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+	rows[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+	rows[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+	rows[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+	rows[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+	rows[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+// Function to load the four 32-bit words of vertices i and i + 4 into the low and high lane
+SIMD_TARGET_AVX2 static inline __m256 LoadVertexPair(const PackedVertex* input, int i) {
+	__m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+	__m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 4));
+	return _mm256_castsi256_ps(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1));
+}
+
+// Function to decode vertices in blocks of 8
+SIMD_TARGET_AVX2 void UnpackVerticesAVX2(const PackedVertex* input, uint32_t count, const PackedVertexBounds& bounds, SimpleVertex* output) {
+	const __m256i low16 = _mm256_set1_epi32(0xFFFF);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 signBit = _mm256_set1_ps(-0.0f);
+	const __m256 snormScale = _mm256_set1_ps(SNORM16_SCALE);
+	const __m256 minusOne = _mm256_set1_ps(-1.0f);
+	__m256 minimum[3], scale[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		minimum[axis] = _mm256_set1_ps(bounds.minimum[axis]);
+		scale[axis] = _mm256_set1_ps(bounds.extent[axis] * UNORM16_SCALE);
+	}
+
+	uint32_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		// Transpose the 4x4 words within each lane, word w of vertices 0-3 in the low and 4-7 in the high lane
+		__m256 r0 = LoadVertexPair(input + i, 0);
+		__m256 r1 = LoadVertexPair(input + i, 1);
+		__m256 r2 = LoadVertexPair(input + i, 2);
+		__m256 r3 = LoadVertexPair(input + i, 3);
+		__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+		__m256 t1 = _mm256_unpackhi_ps(r0, r1);
+		__m256 t2 = _mm256_unpacklo_ps(r2, r3);
+		__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+		__m256i positionXY = _mm256_castps_si256(_mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)));
+		__m256i positionZW = _mm256_castps_si256(_mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)));
+		__m256i normal = _mm256_castps_si256(_mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)));
+		__m256i uv = _mm256_castps_si256(_mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)));
+
+		__m256 attributes[8];
+		__m256i quantized[3] = { _mm256_and_si256(positionXY, low16), _mm256_srli_epi32(positionXY, 16), _mm256_and_si256(positionZW, low16) };
+		for (int axis = 0; axis < 3; ++axis) {
+			attributes[axis] = _mm256_add_ps(minimum[axis], _mm256_mul_ps(_mm256_cvtepi32_ps(quantized[axis]), scale[axis]));
+		}
+
+		// Unfold the octahedron, then normalize
+		__m256 x = _mm256_max_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(normal, 16), 16)), snormScale), minusOne);
+		__m256 y = _mm256_max_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(normal, 16)), snormScale), minusOne);
+		__m256 z = _mm256_sub_ps(_mm256_sub_ps(one, _mm256_andnot_ps(signBit, x)), _mm256_andnot_ps(signBit, y));
+		__m256 fold = _mm256_max_ps(_mm256_xor_ps(z, signBit), zero);
+		__m256 negativeFold = _mm256_xor_ps(fold, signBit);
+		x = _mm256_add_ps(x, _mm256_blendv_ps(fold, negativeFold, _mm256_cmp_ps(x, zero, _CMP_GE_OQ)));
+		y = _mm256_add_ps(y, _mm256_blendv_ps(fold, negativeFold, _mm256_cmp_ps(y, zero, _CMP_GE_OQ)));
+		__m256 invLength = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z))));
+		attributes[3] = _mm256_mul_ps(x, invLength);
+		attributes[4] = _mm256_mul_ps(y, invLength);
+		attributes[5] = _mm256_mul_ps(z, invLength);
+
+		// Gather the 16-bit u and v halves into one register each, then convert with F16C
+		__m256i halves = _mm256_packus_epi32(_mm256_and_si256(uv, low16), _mm256_srli_epi32(uv, 16));
+		halves = _mm256_permute4x64_epi64(halves, _MM_SHUFFLE(3, 1, 2, 0));
+		attributes[6] = _mm256_cvtph_ps(_mm256_castsi256_si128(halves));
+		attributes[7] = _mm256_cvtph_ps(_mm256_extracti128_si256(halves, 1));
+
+		Transpose8x8(attributes);
+		float* destination = reinterpret_cast<float*>(output + i);
+		for (int row = 0; row < 8; ++row) {
+			_mm256_storeu_ps(destination + row * 8, attributes[row]);
+		}
+	}
+
+	// Remaining vertices
+	UnpackVerticesScalar(input + i, count - i, bounds, output + i);
+}
+#endif
+
+// Function to pick the decode kernel
+UnpackVerticesFunction SelectUnpackVertices(SimdLevel level) {
+#ifdef SIMD_X86
+	SimdLevel available = DetectSimdLevel();
+	if (level > available) {
+		level = available;
+	}
+	return level >= SimdLevel::AVX2 ? UnpackVerticesAVX2 : UnpackVerticesScalar;
+#else
+	(void)level;
+	return UnpackVerticesScalar;
+#endif
+}
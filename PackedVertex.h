@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "Geometry.h"
+
+// Vertex buffer layouts a mesh can be uploaded with
+enum class VertexFormat {
+	Float,  // SimpleVertex, 32 bytes
+	Packed  // PackedVertex, 16 bytes
+};
+
+// Quantized vertex, half the size of SimpleVertex.
+// Positions are 16-bit unsigned normalized within the mesh bounds (R16G16B16A16_UNORM, w unused),
+// normals are octahedral encoded as two 16-bit signed normalized values (R16G16_SNORM),
+// texture coordinates are half floats (R16G16_FLOAT).
+struct PackedVertex {
+	uint16_t position[4];
+	int16_t normal[2];
+	uint16_t uv[2];
+};
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must be 16 bytes");
+
+// Dequantization of packed positions, position = minimum + unorm * extent.
+// Laid out as two float4 so it can be uploaded as the packed vertex shader's constant buffer.
+struct PackedVertexBounds {
+	float minimum[4] = { 0, 0, 0, 0 };
+	float extent[4] = { 0, 0, 0, 0 };
+};
+
+/// <summary>
+/// Returns the vertex buffer stride of a vertex format.
+/// </summary>
+/// <param name="format">- The vertex format.</param>
+/// <returns>The size of one vertex in bytes.</returns>
+inline uint32_t GetVertexStride(VertexFormat format) {
+	return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(SimpleVertex);
+}
+
+/// <summary>
+/// Converts a float to a half float, rounding to nearest even. Out of range values become infinity.
+/// </summary>
+uint16_t FloatToHalf(float value);
+
+/// <summary>
+/// Converts a half float to a float exactly.
+/// </summary>
+float HalfToFloat(uint16_t value);
+
+/// <summary>
+/// Quantizes vertices to the packed format. The bounds are the axis-aligned box of the positions.
+/// </summary>
+/// <param name="vertices">- The vertices to pack, normals do not need to be normalized.</param>
+/// <param name="packed">- Receives one packed vertex per vertex.</param>
+/// <param name="bounds">- Receives the bounds needed to decode the positions.</param>
+void PackVertices(const std::vector<SimpleVertex>& vertices, std::vector<PackedVertex>& packed, PackedVertexBounds& bounds);
+
+// Decodes count packed vertices into SimpleVertex, exactly as the input assembler and VertexShaderPacked.hlsl do.
+// Normals are decoded to unit length. Every kernel rounds identically, so their outputs are bit-identical.
+typedef void (*UnpackVerticesFunction)(const PackedVertex* input, uint32_t count, const PackedVertexBounds& bounds, SimpleVertex* output);
+
+/// <summary>
+/// Portable decode kernel, one vertex at a time.
+/// </summary>
+void UnpackVerticesScalar(const PackedVertex* input, uint32_t count, const PackedVertexBounds& bounds, SimpleVertex* output);
+
+#ifdef SIMD_X86
+/// <summary>
+/// AVX2 decode kernel, blocks of 8 vertices with F16C half conversion.
+/// </summary>
+void UnpackVerticesAVX2(const PackedVertex* input, uint32_t count, const PackedVertexBounds& bounds, SimpleVertex* output);
+#endif
+
+/// <summary>
+/// Picks the decode kernel for a SIMD level, lowered to what the CPU supports. AVX-512 uses the AVX2 kernel.
+/// </summary>
+/// <param name="level">- The requested SIMD level.</param>
+/// <returns>The decode kernel.</returns>
+UnpackVerticesFunction SelectUnpackVertices(SimdLevel level);
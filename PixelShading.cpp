@@ -0,0 +1,737 @@
+#include "PixelShading.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "BlockCompression.h"
+#include "TextureLayout.h"
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Coefficients of log2(m) = t * (c1 + c3 t^2 + c5 t^4 + c7 t^6 + c9 t^8), t = (m - 1) / (m + 1), m in [sqrt(1/2), sqrt(2)]
+static const float LOG2_C1 = 2.8853900817779268f;
+static const float LOG2_C3 = 0.9617966939259756f;
+static const float LOG2_C5 = 0.5770780163555854f;
+static const float LOG2_C7 = 0.4121985831111324f;
+static const float LOG2_C9 = 0.3205988979753252f;
+
+// Taylor coefficients of 2^f = sum (ln 2)^k / k! f^k, f in [-0.5, 0.5]
+static const float EXP2_C1 = 0.6931471805599453f;
+static const float EXP2_C2 = 0.2402265069591007f;
+static const float EXP2_C3 = 0.05550410866482158f;
+static const float EXP2_C4 = 0.009618129107628477f;
+static const float EXP2_C5 = 0.0013333558146428443f;
+static const float EXP2_C6 = 0.00015403530393381606f;
+static const float EXP2_C7 = 1.525273380405984e-05f;
+
+static const float SQRT2 = 1.41421356f;
+static const float SMALLEST_NORMAL = 1.17549435e-38f;
+
+// Lights dimmer than half an 8-bit step cannot change the output through the specular term, which is at most the light color
+static const float SPECULAR_CUTOFF = 0.5f / 255.0f;
+
+// Function to fill the interpolation data of a triangle
+void SetupShadingTriangle(const ShadedVertex* vertex[3], const float invW[3], const float b1OverW[3], const float b2OverW[3], ShadingTriangle& triangle) {
+	for (int i = 0; i < 3; ++i) {
+		triangle.invW[i] = invW[i];
+		triangle.b1OverW[i] = b1OverW[i];
+		triangle.b2OverW[i] = b2OverW[i];
+	}
+
+	float attributes[3][SHADING_ATTRIBUTES];
+	for (int v = 0; v < 3; ++v) {
+		std::memcpy(&attributes[v][0], vertex[v]->worldPosition, sizeof(float) * 4);
+		std::memcpy(&attributes[v][4], vertex[v]->normal, sizeof(float) * 4);
+		std::memcpy(&attributes[v][8], vertex[v]->uv, sizeof(float) * 2);
+	}
+
+	for (int i = 0; i < SHADING_ATTRIBUTES; ++i) {
+		triangle.base[i] = attributes[0][i];
+		triangle.edge1[i] = attributes[1][i] - attributes[0][i];
+		triangle.edge2[i] = attributes[2][i] - attributes[0][i];
+	}
+}
+
+// Function to approximate pow for bases in [0, 1], fused in the order of PowAVX2() so every backend rounds alike
+float FastPow(float x, float y) {
+	if (!(x >= SMALLEST_NORMAL)) {
+		return 0.0f;
+	}
+
+	// log2(x) = exponent + log2(mantissa)
+	uint32_t bits;
+	std::memcpy(&bits, &x, sizeof(bits));
+	float exponent = static_cast<float>(static_cast<int32_t>(bits >> 23) - 127);
+	bits = (bits & 0x7FFFFF) | 0x3F800000;
+	float mantissa;
+	std::memcpy(&mantissa, &bits, sizeof(mantissa));
+	if (mantissa > SQRT2) {
+		mantissa *= 0.5f;
+		exponent += 1.0f;
+	}
+	float t = (mantissa - 1.0f) / (mantissa + 1.0f);
+	float t2 = t * t;
+	float p = std::fma(t2, LOG2_C9, LOG2_C7);
+	p = std::fma(t2, p, LOG2_C5);
+	p = std::fma(t2, p, LOG2_C3);
+	p = std::fma(t2, p, LOG2_C1);
+	float log2 = std::fma(t, p, exponent);
+
+	// 2^(y * log2(x)) = 2^n * 2^f, clamped like maxps and minps so a NaN exponent clamps too
+	float power = y * log2;
+	power = power > -126.0f ? power : -126.0f;
+	power = power < 127.0f ? power : 127.0f;
+	float n = std::nearbyint(power);
+	float f = power - n;
+	p = std::fma(f, EXP2_C7, EXP2_C6);
+	p = std::fma(f, p, EXP2_C5);
+	p = std::fma(f, p, EXP2_C4);
+	p = std::fma(f, p, EXP2_C3);
+	p = std::fma(f, p, EXP2_C2);
+	p = std::fma(f, p, EXP2_C1);
+	p = std::fma(f, p, 1.0f);
+	uint32_t scaleBits = static_cast<uint32_t>(static_cast<int32_t>(n) + 127) << 23;
+	float scale;
+	std::memcpy(&scale, &scaleBits, sizeof(scale));
+	return p * scale;
+}
+
+// Function to convert a float in [0, 1] to an 8-bit UNORM value
+static uint32_t ToUnorm8(float value) {
+	value = std::min(std::max(value, 0.0f), 1.0f);
+	return static_cast<uint32_t>(value * 255.0f + 0.5f);
+}
+
+// Function to compute the level of detail of every quad from its texel-space uv derivatives
+static void QuadLod(const float u[SHADING_BATCH], const float v[SHADING_BATCH], const TextureData& texture, float lod[SHADING_BATCH]) {
+	for (uint32_t quad = 0; quad < SHADING_BATCH; quad += 4) {
+		// Coarse derivatives, shared by the four pixels of the quad
+		float dudx = (u[quad + 1] - u[quad]) * texture.width;
+		float dvdx = (v[quad + 1] - v[quad]) * texture.height;
+		float dudy = (u[quad + 2] - u[quad]) * texture.width;
+		float dvdy = (v[quad + 2] - v[quad]) * texture.height;
+		float lengthSquared = std::max(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+		float quadLod = 0.5f * std::log2(std::max(lengthSquared, SMALLEST_NORMAL));
+		std::fill_n(lod + quad, 4, quadLod);
+	}
+}
+
+// Function to fetch a texel as normalized floats, through the texel cache or with block compressed textures decoded straight from their blocks
+static void FetchTexel(const TextureData& texture, TexelCache* texelCache, int x, int y, float out[4]) {
+	uint32_t texel;
+	if (texelCache != nullptr) {
+		texel = texelCache->Fetch(x, y);
+	}
+	else if (texture.format == TexelFormat::RGBA8) {
+		std::memcpy(&texel, &texture.pixels[GetTexelIndex(texture.layout, texture.width, x, y) * 4], sizeof(texel));
+	}
+	else {
+		texel = FetchBlockTexel(texture, x, y);
+	}
+	for (int i = 0; i < 4; ++i) {
+		out[i] = ((texel >> (8 * i)) & 0xFF) * (1.0f / 255.0f);
+	}
+}
+
+// Function to sample the texture with bilinear filtering and wrap addressing
+static void SampleTexture(const TextureData& texture, TexelCache* texelCache, float u, float v, float lod, float out[4]) {
+	// Only the base level is sampled, so the level of detail does not change the footprint yet
+	(void)lod;
+
+	u -= std::floor(u);
+	v -= std::floor(v);
+
+	float x = u * texture.width - 0.5f;
+	float y = v * texture.height - 0.5f;
+	float floorX = std::floor(x);
+	float floorY = std::floor(y);
+	float tx = x - floorX;
+	float ty = y - floorY;
+
+	int x0 = static_cast<int>(floorX);
+	int y0 = static_cast<int>(floorY);
+	if (x0 < 0) x0 += texture.width;
+	if (y0 < 0) y0 += texture.height;
+	int x1 = x0 + 1 == texture.width ? 0 : x0 + 1;
+	int y1 = y0 + 1 == texture.height ? 0 : y0 + 1;
+
+	float t00[4], t10[4], t01[4], t11[4];
+	FetchTexel(texture, texelCache, x0, y0, t00);
+	FetchTexel(texture, texelCache, x1, y0, t10);
+	FetchTexel(texture, texelCache, x0, y1, t01);
+	FetchTexel(texture, texelCache, x1, y1, t11);
+
+	for (int i = 0; i < 4; ++i) {
+		float top = t00[i] + (t10[i] - t00[i]) * tx;
+		float bottom = t01[i] + (t11[i] - t01[i]) * tx;
+		out[i] = top + (bottom - top) * ty;
+	}
+}
+
+// Function to check if a sampler reads the base level bilinearly with wrap addressing, the fixed path of the pixel shader
+static bool IsBaseLevelBilinear(const SamplerDesc& sampler) {
+	return sampler.filter == SamplerFilter::Bilinear && sampler.maxLod <= 0.0f &&
+		sampler.addressU == TextureAddressMode::Wrap && sampler.addressV == TextureAddressMode::Wrap;
+}
+
+// Function to filter both quads of a batch through the texture sampler
+static void SampleFiltered(SampleBatchFunction sample, const TextureData& texture, const SamplerDesc& sampler,
+	const float u[SHADING_BATCH], const float v[SHADING_BATCH], float rgba[4][SAMPLE_BATCH]) {
+	SampleBatch batch;
+	std::copy(u, u + SHADING_BATCH, batch.u);
+	std::copy(v, v + SHADING_BATCH, batch.v);
+	SetQuadDerivatives(batch);
+	sample(texture, sampler, batch, rgba);
+}
+
+// Function to normalize a four component vector
+static void Normalize4(float v[4]) {
+	float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3]);
+	float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+	for (int i = 0; i < 4; ++i) {
+		v[i] *= invLength;
+	}
+}
+
+static float Dot4(const float a[4], const float b[4]) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+}
+
+// Function to shade a batch one lane at a time
+void ShadeQuadsScalar(const ShadingTriangle& triangle, const float x[SHADING_BATCH], const float y[SHADING_BATCH],
+	const PixelShaderConstants& constants, const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache, uint32_t color[SHADING_BATCH]) {
+	float attributes[SHADING_BATCH][SHADING_ATTRIBUTES];
+	float u[SHADING_BATCH], v[SHADING_BATCH], lod[SHADING_BATCH];
+
+	// Perspective-correct barycentrics and attributes of every lane
+	for (uint32_t lane = 0; lane < SHADING_BATCH; ++lane) {
+		float invW = triangle.invW[0] + triangle.invW[1] * x[lane] + triangle.invW[2] * y[lane];
+		float w = 1.0f / invW;
+		float b1 = (triangle.b1OverW[0] + triangle.b1OverW[1] * x[lane] + triangle.b1OverW[2] * y[lane]) * w;
+		float b2 = (triangle.b2OverW[0] + triangle.b2OverW[1] * x[lane] + triangle.b2OverW[2] * y[lane]) * w;
+		for (int i = 0; i < SHADING_ATTRIBUTES; ++i) {
+			attributes[lane][i] = triangle.base[i] + triangle.edge1[i] * b1 + triangle.edge2[i] * b2;
+		}
+		u[lane] = attributes[lane][8];
+		v[lane] = attributes[lane][9];
+	}
+	QuadLod(u, v, texture, lod);
+
+	bool textured = !texture.pixels.empty();
+	bool filtered = textured && !IsBaseLevelBilinear(sampler);
+	float filteredColor[4][SAMPLE_BATCH];
+	if (filtered) {
+		SampleFiltered(SampleBatchScalar, texture, sampler, u, v, filteredColor);
+	}
+
+	// Equivalent of PixelShader.hlsl
+	for (uint32_t lane = 0; lane < SHADING_BATCH; ++lane) {
+		const float* worldPosition = &attributes[lane][0];
+		float normal[4] = { attributes[lane][4], attributes[lane][5], attributes[lane][6], attributes[lane][7] };
+		Normalize4(normal);
+
+		float lightDirection[4], vectorToCamera[4];
+		for (int i = 0; i < 4; ++i) {
+			lightDirection[i] = constants.lightPosition[i] - worldPosition[i];
+			vectorToCamera[i] = constants.cameraPosition[i] - worldPosition[i];
+		}
+		Normalize4(lightDirection);
+		Normalize4(vectorToCamera);
+
+		float normalDotLight = Dot4(normal, lightDirection);
+		float diffuseIntensity = std::max(normalDotLight, 0.0f);
+
+		// reflect(-L, N) = -L + 2 * dot(N, L) * N
+		float reflection[4];
+		for (int i = 0; i < 4; ++i) {
+			reflection[i] = 2.0f * normalDotLight * normal[i] - lightDirection[i];
+		}
+		float specularIntensity = std::pow(std::max(Dot4(reflection, vectorToCamera), 0.0f), constants.shininess);
+
+		float textureColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		if (filtered) {
+			for (int i = 0; i < 4; ++i) {
+				textureColor[i] = filteredColor[i][lane];
+			}
+		}
+		else if (textured) {
+			SampleTexture(texture, texelCache, u[lane], v[lane], lod[lane], textureColor);
+		}
+
+		float result[4];
+		for (int i = 0; i < 4; ++i) {
+			float light = constants.lightColor[i];
+			result[i] = (light * constants.ambientLightIntensity + light * diffuseIntensity) * textureColor[i] + light * specularIntensity;
+		}
+
+		color[lane] = (ToUnorm8(result[3]) << 24) | (ToUnorm8(result[0]) << 16) | (ToUnorm8(result[1]) << 8) | ToUnorm8(result[2]);
+	}
+}
+
+#ifdef SIMD_X86
+// Four component vector in structure-of-arrays form, one pixel per lane
+struct Vector4AVX2 {
+	__m256 x, y, z, w;
+};
+
+SIMD_TARGET_AVX2 static inline __m256 Dot4AVX2(const Vector4AVX2& a, const Vector4AVX2& b) {
+	return _mm256_fmadd_ps(a.x, b.x, _mm256_fmadd_ps(a.y, b.y, _mm256_fmadd_ps(a.z, b.z, _mm256_mul_ps(a.w, b.w))));
+}
+
+// Function to normalize with rsqrt refined by one Newton-Raphson step, about 23 bits of precision
+SIMD_TARGET_AVX2 static inline void Normalize4AVX2(Vector4AVX2& v) {
+	__m256 lengthSquared = Dot4AVX2(v, v);
+	__m256 r = _mm256_rsqrt_ps(lengthSquared);
+	__m256 halfLength = _mm256_mul_ps(_mm256_set1_ps(0.5f), lengthSquared);
+	r = _mm256_mul_ps(r, _mm256_fnmadd_ps(halfLength, _mm256_mul_ps(r, r), _mm256_set1_ps(1.5f)));
+	v.x = _mm256_mul_ps(v.x, r);
+	v.y = _mm256_mul_ps(v.y, r);
+	v.z = _mm256_mul_ps(v.z, r);
+	v.w = _mm256_mul_ps(v.w, r);
+}
+
+// Function to compute log2 of positive normal floats, see FastPow()
+SIMD_TARGET_AVX2 static inline __m256 Log2AVX2(__m256 x) {
+	__m256i bits = _mm256_castps_si256(x);
+	__m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+	__m256 mantissa = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x7FFFFF)), _mm256_set1_epi32(0x3F800000)));
+
+	__m256 large = _mm256_cmp_ps(mantissa, _mm256_set1_ps(SQRT2), _CMP_GT_OQ);
+	mantissa = _mm256_blendv_ps(mantissa, _mm256_mul_ps(mantissa, _mm256_set1_ps(0.5f)), large);
+	exponent = _mm256_add_ps(exponent, _mm256_and_ps(large, _mm256_set1_ps(1.0f)));
+
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 t = _mm256_div_ps(_mm256_sub_ps(mantissa, one), _mm256_add_ps(mantissa, one));
+	__m256 t2 = _mm256_mul_ps(t, t);
+	__m256 p = _mm256_fmadd_ps(t2, _mm256_set1_ps(LOG2_C9), _mm256_set1_ps(LOG2_C7));
+	p = _mm256_fmadd_ps(t2, p, _mm256_set1_ps(LOG2_C5));
+	p = _mm256_fmadd_ps(t2, p, _mm256_set1_ps(LOG2_C3));
+	p = _mm256_fmadd_ps(t2, p, _mm256_set1_ps(LOG2_C1));
+	return _mm256_fmadd_ps(t, p, exponent);
+}
+
+// Function to compute 2^x, see FastPow()
+SIMD_TARGET_AVX2 static inline __m256 Exp2AVX2(__m256 x) {
+	x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-126.0f)), _mm256_set1_ps(127.0f));
+	__m256 n = _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m256 f = _mm256_sub_ps(x, n);
+
+	__m256 p = _mm256_fmadd_ps(f, _mm256_set1_ps(EXP2_C7), _mm256_set1_ps(EXP2_C6));
+	p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(EXP2_C5));
+	p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(EXP2_C4));
+	p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(EXP2_C3));
+	p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(EXP2_C2));
+	p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(EXP2_C1));
+	p = _mm256_fmadd_ps(f, p, _mm256_set1_ps(1.0f));
+
+	__m256i scale = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+	return _mm256_mul_ps(p, _mm256_castsi256_ps(scale));
+}
+
+// Function to compute pow(x, y) for x in [0, 1], lanes with denormal or zero bases return 0
+SIMD_TARGET_AVX2 static inline __m256 PowAVX2(__m256 x, __m256 y) {
+	__m256 valid = _mm256_cmp_ps(x, _mm256_set1_ps(SMALLEST_NORMAL), _CMP_GE_OQ);
+	__m256 safe = _mm256_blendv_ps(_mm256_set1_ps(1.0f), x, valid);
+	return _mm256_and_ps(Exp2AVX2(_mm256_mul_ps(y, Log2AVX2(safe))), valid);
+}
+
+// Function to evaluate a plane at the lane positions
+SIMD_TARGET_AVX2 static inline __m256 PlaneAVX2(const float plane[3], __m256 x, __m256 y) {
+	return _mm256_fmadd_ps(_mm256_set1_ps(plane[2]), y, _mm256_fmadd_ps(_mm256_set1_ps(plane[1]), x, _mm256_set1_ps(plane[0])));
+}
+
+// Function to interpolate one attribute from the barycentrics
+SIMD_TARGET_AVX2 static inline __m256 AttributeAVX2(const ShadingTriangle& triangle, int index, __m256 b1, __m256 b2) {
+	return _mm256_fmadd_ps(_mm256_set1_ps(triangle.edge2[index]), b2, _mm256_fmadd_ps(_mm256_set1_ps(triangle.edge1[index]), b1, _mm256_set1_ps(triangle.base[index])));
+}
+
+// Function to compute the level of detail of both quads, every quad occupies one 128-bit half
+SIMD_TARGET_AVX2 static inline __m256 QuadLodAVX2(__m256 u, __m256 v, const TextureData& texture) {
+	__m256 width = _mm256_set1_ps(static_cast<float>(texture.width));
+	__m256 height = _mm256_set1_ps(static_cast<float>(texture.height));
+	__m256 topLeftU = _mm256_permute_ps(u, 0x00);
+	__m256 topLeftV = _mm256_permute_ps(v, 0x00);
+	__m256 dudx = _mm256_mul_ps(_mm256_sub_ps(_mm256_permute_ps(u, 0x55), topLeftU), width);
+	__m256 dvdx = _mm256_mul_ps(_mm256_sub_ps(_mm256_permute_ps(v, 0x55), topLeftV), height);
+	__m256 dudy = _mm256_mul_ps(_mm256_sub_ps(_mm256_permute_ps(u, 0xAA), topLeftU), width);
+	__m256 dvdy = _mm256_mul_ps(_mm256_sub_ps(_mm256_permute_ps(v, 0xAA), topLeftV), height);
+	__m256 lengthSquared = _mm256_max_ps(_mm256_fmadd_ps(dudx, dudx, _mm256_mul_ps(dvdx, dvdx)), _mm256_fmadd_ps(dudy, dudy, _mm256_mul_ps(dvdy, dvdy)));
+	lengthSquared = _mm256_max_ps(lengthSquared, _mm256_set1_ps(SMALLEST_NORMAL));
+	return _mm256_mul_ps(_mm256_set1_ps(0.5f), Log2AVX2(lengthSquared));
+}
+
+// Function to spread the low 5 bits of every lane to the even bits
+SIMD_TARGET_AVX2 static inline __m256i SpreadMortonBitsAVX2(__m256i value) {
+	value = _mm256_and_si256(_mm256_or_si256(value, _mm256_slli_epi32(value, 4)), _mm256_set1_epi32(0x0F0F));
+	value = _mm256_and_si256(_mm256_or_si256(value, _mm256_slli_epi32(value, 2)), _mm256_set1_epi32(0x3333));
+	return _mm256_and_si256(_mm256_or_si256(value, _mm256_slli_epi32(value, 1)), _mm256_set1_epi32(0x5555));
+}
+
+// Function to compute the texel indices of a tiled texture, see GetTiledTexelIndex()
+SIMD_TARGET_AVX2 static inline __m256i TiledTexelIndexAVX2(__m256i x, __m256i y, __m256i tilesWide) {
+	const __m256i tileMask = _mm256_set1_epi32(TEXEL_TILE_DIMENSION - 1);
+	__m256i tile = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(y, TEXEL_TILE_SHIFT), tilesWide), _mm256_srli_epi32(x, TEXEL_TILE_SHIFT));
+	__m256i morton = _mm256_or_si256(SpreadMortonBitsAVX2(_mm256_and_si256(x, tileMask)), _mm256_slli_epi32(SpreadMortonBitsAVX2(_mm256_and_si256(y, tileMask)), 1));
+	return _mm256_add_epi32(_mm256_slli_epi32(tile, 2 * TEXEL_TILE_SHIFT), morton);
+}
+
+// Function to decode the texels of a block compressed texture one lane at a time, there is nothing to gather from
+SIMD_TARGET_AVX2 static inline __m256i FetchBlockTexelsAVX2(const TextureData& texture, __m256i x, __m256i y) {
+	alignas(32) int32_t laneX[8], laneY[8];
+	alignas(32) uint32_t texels[8];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(laneX), x);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(laneY), y);
+	for (int lane = 0; lane < 8; ++lane) {
+		texels[lane] = FetchBlockTexel(texture, laneX[lane], laneY[lane]);
+	}
+	return _mm256_load_si256(reinterpret_cast<const __m256i*>(texels));
+}
+
+// Function to fetch the texels of every lane through the texel cache
+SIMD_TARGET_AVX2 static inline __m256i FetchCachedTexelsAVX2(TexelCache& texelCache, __m256i x, __m256i y) {
+	alignas(32) int32_t laneX[8], laneY[8];
+	alignas(32) uint32_t texels[8];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(laneX), x);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(laneY), y);
+	texelCache.FetchAVX2(laneX, laneY, texels);
+	return _mm256_load_si256(reinterpret_cast<const __m256i*>(texels));
+}
+
+// Function to sample the texture bilinearly with wrap addressing, returns the four channels
+SIMD_TARGET_AVX2 static inline Vector4AVX2 SampleTextureAVX2(const TextureData& texture, TexelCache* texelCache, __m256 u, __m256 v, __m256 lod) {
+	// Only the base level is sampled, so the level of detail does not change the footprint yet
+	(void)lod;
+
+	__m256i width = _mm256_set1_epi32(texture.width);
+	__m256i height = _mm256_set1_epi32(texture.height);
+	u = _mm256_sub_ps(u, _mm256_floor_ps(u));
+	v = _mm256_sub_ps(v, _mm256_floor_ps(v));
+
+	__m256 x = _mm256_fmsub_ps(u, _mm256_cvtepi32_ps(width), _mm256_set1_ps(0.5f));
+	__m256 y = _mm256_fmsub_ps(v, _mm256_cvtepi32_ps(height), _mm256_set1_ps(0.5f));
+	__m256 floorX = _mm256_floor_ps(x);
+	__m256 floorY = _mm256_floor_ps(y);
+	__m256 tx = _mm256_sub_ps(x, floorX);
+	__m256 ty = _mm256_sub_ps(y, floorY);
+
+	// Wrap the footprint, coordinates are at most one texel outside the texture
+	__m256i x0 = _mm256_cvttps_epi32(floorX);
+	__m256i y0 = _mm256_cvttps_epi32(floorY);
+	x0 = _mm256_add_epi32(x0, _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), x0), width));
+	y0 = _mm256_add_epi32(y0, _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), y0), height));
+	__m256i x1 = _mm256_add_epi32(x0, _mm256_set1_epi32(1));
+	__m256i y1 = _mm256_add_epi32(y0, _mm256_set1_epi32(1));
+	x1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(x1, width), x1);
+	y1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(y1, height), y1);
+
+	__m256i t00, t10, t01, t11;
+	if (texelCache != nullptr) {
+		t00 = FetchCachedTexelsAVX2(*texelCache, x0, y0);
+		t10 = FetchCachedTexelsAVX2(*texelCache, x1, y0);
+		t01 = FetchCachedTexelsAVX2(*texelCache, x0, y1);
+		t11 = FetchCachedTexelsAVX2(*texelCache, x1, y1);
+	}
+	else if (texture.format == TexelFormat::RGBA8 && texture.layout == TexelLayout::Tiled) {
+		const int* texels = reinterpret_cast<const int*>(texture.pixels.data());
+		__m256i tilesWide = _mm256_set1_epi32((texture.width + TEXEL_TILE_DIMENSION - 1) >> TEXEL_TILE_SHIFT);
+		t00 = _mm256_i32gather_epi32(texels, TiledTexelIndexAVX2(x0, y0, tilesWide), 4);
+		t10 = _mm256_i32gather_epi32(texels, TiledTexelIndexAVX2(x1, y0, tilesWide), 4);
+		t01 = _mm256_i32gather_epi32(texels, TiledTexelIndexAVX2(x0, y1, tilesWide), 4);
+		t11 = _mm256_i32gather_epi32(texels, TiledTexelIndexAVX2(x1, y1, tilesWide), 4);
+	}
+	else if (texture.format == TexelFormat::RGBA8) {
+		const int* texels = reinterpret_cast<const int*>(texture.pixels.data());
+		__m256i row0 = _mm256_mullo_epi32(y0, width);
+		__m256i row1 = _mm256_mullo_epi32(y1, width);
+		t00 = _mm256_i32gather_epi32(texels, _mm256_add_epi32(row0, x0), 4);
+		t10 = _mm256_i32gather_epi32(texels, _mm256_add_epi32(row0, x1), 4);
+		t01 = _mm256_i32gather_epi32(texels, _mm256_add_epi32(row1, x0), 4);
+		t11 = _mm256_i32gather_epi32(texels, _mm256_add_epi32(row1, x1), 4);
+	}
+	else {
+		t00 = FetchBlockTexelsAVX2(texture, x0, y0);
+		t10 = FetchBlockTexelsAVX2(texture, x1, y0);
+		t01 = FetchBlockTexelsAVX2(texture, x0, y1);
+		t11 = FetchBlockTexelsAVX2(texture, x1, y1);
+	}
+
+	// Filter each channel of the RGBA8 texels
+	__m256 channels[4];
+	const __m256i byteMask = _mm256_set1_epi32(0xFF);
+	const __m256 toFloat = _mm256_set1_ps(1.0f / 255.0f);
+	for (int i = 0; i < 4; ++i) {
+		__m256i shift = _mm256_set1_epi32(i * 8);
+		__m256 c00 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srlv_epi32(t00, shift), byteMask));
+		__m256 c10 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srlv_epi32(t10, shift), byteMask));
+		__m256 c01 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srlv_epi32(t01, shift), byteMask));
+		__m256 c11 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srlv_epi32(t11, shift), byteMask));
+		__m256 top = _mm256_fmadd_ps(_mm256_sub_ps(c10, c00), tx, c00);
+		__m256 bottom = _mm256_fmadd_ps(_mm256_sub_ps(c11, c01), tx, c01);
+		channels[i] = _mm256_mul_ps(_mm256_fmadd_ps(_mm256_sub_ps(bottom, top), ty, top), toFloat);
+	}
+	return { channels[0], channels[1], channels[2], channels[3] };
+}
+
+// Function to convert floats in [0, 1] to 8-bit UNORM values
+SIMD_TARGET_AVX2 static inline __m256i ToUnorm8AVX2(__m256 value) {
+	value = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+	return _mm256_cvttps_epi32(_mm256_fmadd_ps(value, _mm256_set1_ps(255.0f), _mm256_set1_ps(0.5f)));
+}
+
+// Function to shade a batch with all lanes at once, specialized for a set of pipeline features
+template <bool Textured, bool Specular, bool Filtered>
+SIMD_TARGET_AVX2 static void ShadePipelineAVX2(const ShadingTriangle& triangle, const float x[SHADING_BATCH], const float y[SHADING_BATCH],
+	const PixelShaderConstants& constants, const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache, uint32_t color[SHADING_BATCH]) {
+	// Without texture and specular term nothing is left but black
+	if (!Textured && !Specular) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(color), _mm256_setzero_si256());
+		return;
+	}
+
+	__m256 px = _mm256_loadu_ps(x);
+	__m256 py = _mm256_loadu_ps(y);
+
+	// Perspective-correct barycentrics
+	__m256 w = _mm256_div_ps(_mm256_set1_ps(1.0f), PlaneAVX2(triangle.invW, px, py));
+	__m256 b1 = _mm256_mul_ps(PlaneAVX2(triangle.b1OverW, px, py), w);
+	__m256 b2 = _mm256_mul_ps(PlaneAVX2(triangle.b2OverW, px, py), w);
+
+	Vector4AVX2 worldPosition = { AttributeAVX2(triangle, 0, b1, b2), AttributeAVX2(triangle, 1, b1, b2), AttributeAVX2(triangle, 2, b1, b2), AttributeAVX2(triangle, 3, b1, b2) };
+	Vector4AVX2 normal = { AttributeAVX2(triangle, 4, b1, b2), AttributeAVX2(triangle, 5, b1, b2), AttributeAVX2(triangle, 6, b1, b2), AttributeAVX2(triangle, 7, b1, b2) };
+
+	// Equivalent of PixelShader.hlsl
+	Normalize4AVX2(normal);
+
+	Vector4AVX2 lightDirection = {
+		_mm256_sub_ps(_mm256_set1_ps(constants.lightPosition[0]), worldPosition.x),
+		_mm256_sub_ps(_mm256_set1_ps(constants.lightPosition[1]), worldPosition.y),
+		_mm256_sub_ps(_mm256_set1_ps(constants.lightPosition[2]), worldPosition.z),
+		_mm256_sub_ps(_mm256_set1_ps(constants.lightPosition[3]), worldPosition.w)
+	};
+	Normalize4AVX2(lightDirection);
+
+	__m256 normalDotLight = Dot4AVX2(normal, lightDirection);
+	__m256 specularIntensity = _mm256_setzero_ps();
+	if (Specular) {
+		Vector4AVX2 vectorToCamera = {
+			_mm256_sub_ps(_mm256_set1_ps(constants.cameraPosition[0]), worldPosition.x),
+			_mm256_sub_ps(_mm256_set1_ps(constants.cameraPosition[1]), worldPosition.y),
+			_mm256_sub_ps(_mm256_set1_ps(constants.cameraPosition[2]), worldPosition.z),
+			_mm256_sub_ps(_mm256_set1_ps(constants.cameraPosition[3]), worldPosition.w)
+		};
+		Normalize4AVX2(vectorToCamera);
+
+		// reflect(-L, N) = 2 * dot(N, L) * N - L
+		__m256 twiceDot = _mm256_add_ps(normalDotLight, normalDotLight);
+		Vector4AVX2 reflection = {
+			_mm256_fmsub_ps(twiceDot, normal.x, lightDirection.x),
+			_mm256_fmsub_ps(twiceDot, normal.y, lightDirection.y),
+			_mm256_fmsub_ps(twiceDot, normal.z, lightDirection.z),
+			_mm256_fmsub_ps(twiceDot, normal.w, lightDirection.w)
+		};
+		__m256 specularBase = _mm256_max_ps(Dot4AVX2(reflection, vectorToCamera), _mm256_setzero_ps());
+		specularIntensity = PowAVX2(specularBase, _mm256_set1_ps(constants.shininess));
+	}
+
+	Vector4AVX2 textureColor = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+	if (Textured) {
+		__m256 u = AttributeAVX2(triangle, 8, b1, b2);
+		__m256 v = AttributeAVX2(triangle, 9, b1, b2);
+		if (Filtered) {
+			alignas(32) float laneU[SHADING_BATCH], laneV[SHADING_BATCH];
+			alignas(32) float rgba[4][SAMPLE_BATCH];
+			_mm256_store_ps(laneU, u);
+			_mm256_store_ps(laneV, v);
+			SampleFiltered(SampleBatchAVX2, texture, sampler, laneU, laneV, rgba);
+			textureColor = { _mm256_load_ps(rgba[0]), _mm256_load_ps(rgba[1]), _mm256_load_ps(rgba[2]), _mm256_load_ps(rgba[3]) };
+		}
+		else {
+			textureColor = SampleTextureAVX2(texture, texelCache, u, v, QuadLodAVX2(u, v, texture));
+		}
+	}
+
+	// (ambient + diffuse) * texture + specular, per channel
+	__m256 lightScale = _mm256_add_ps(_mm256_set1_ps(constants.ambientLightIntensity), _mm256_max_ps(normalDotLight, _mm256_setzero_ps()));
+	const __m256* channels = &textureColor.x;
+	__m256i packed[4];
+	for (int i = 0; i < 4; ++i) {
+		__m256 light = _mm256_set1_ps(constants.lightColor[i]);
+		__m256 result;
+		if (Textured && Specular) {
+			result = _mm256_fmadd_ps(_mm256_mul_ps(light, lightScale), channels[i], _mm256_mul_ps(light, specularIntensity));
+		}
+		else if (Textured) {
+			result = _mm256_mul_ps(_mm256_mul_ps(light, lightScale), channels[i]);
+		}
+		else {
+			result = _mm256_mul_ps(light, specularIntensity);
+		}
+		packed[i] = ToUnorm8AVX2(result);
+	}
+
+	// Pack as B8G8R8A8
+	__m256i bgra = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(packed[3], 24), _mm256_slli_epi32(packed[0], 16)),
+		_mm256_or_si256(_mm256_slli_epi32(packed[1], 8), packed[2]));
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(color), bgra);
+}
+
+// Specialized pipelines indexed by GetPipelineIndex()
+static const ShadeQuadsFunction PIPELINES_AVX2[PIXEL_PIPELINE_VARIANTS] = {
+	ShadePipelineAVX2<false, false, false>,
+	ShadePipelineAVX2<true, false, false>,
+	ShadePipelineAVX2<false, true, false>,
+	ShadePipelineAVX2<true, true, false>,
+	ShadePipelineAVX2<false, false, true>,
+	ShadePipelineAVX2<true, false, true>,
+	ShadePipelineAVX2<false, true, true>,
+	ShadePipelineAVX2<true, true, true>
+};
+#endif
+
+// Function to index the specialized pipelines by their features
+static uint32_t GetPipelineIndex(const PixelPipelineKey& key) {
+	return (key.textured ? 1 : 0) | (key.specular ? 2 : 0) | (key.filtered ? 4 : 0);
+}
+
+// Function to derive the pipeline features of a draw
+PixelPipelineKey GetPixelPipelineKey(const PixelShaderConstants& constants, const TextureData& texture, const SamplerDesc& sampler) {
+	float brightest = 0.0f;
+	for (int i = 0; i < 4; ++i) {
+		brightest = std::max(brightest, std::fabs(constants.lightColor[i]));
+	}
+
+	PixelPipelineKey key;
+	key.textured = !texture.pixels.empty();
+	key.specular = brightest >= SPECULAR_CUTOFF;
+	key.filtered = key.textured && !IsBaseLevelBilinear(sampler);
+	return key;
+}
+
+// Function to sample a batch one lane at a time like the scalar kernel
+void SampleQuadsScalar(const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache,
+	const float u[SHADING_BATCH], const float v[SHADING_BATCH], float rgba[4][SHADING_BATCH]) {
+	if (texture.pixels.empty()) {
+		for (int i = 0; i < 4; ++i) {
+			std::fill_n(rgba[i], SHADING_BATCH, 0.0f);
+		}
+		return;
+	}
+	if (!IsBaseLevelBilinear(sampler)) {
+		SampleFiltered(SampleBatchScalar, texture, sampler, u, v, rgba);
+		return;
+	}
+
+	float lod[SHADING_BATCH];
+	QuadLod(u, v, texture, lod);
+	for (uint32_t lane = 0; lane < SHADING_BATCH; ++lane) {
+		float color[4];
+		SampleTexture(texture, texelCache, u[lane], v[lane], lod[lane], color);
+		for (int i = 0; i < 4; ++i) {
+			rgba[i][lane] = color[i];
+		}
+	}
+}
+
+// Function to convert shaded colors to B8G8R8A8 one lane at a time
+void PackColorsScalar(const float rgba[4][SHADING_BATCH], uint32_t color[SHADING_BATCH]) {
+	for (uint32_t lane = 0; lane < SHADING_BATCH; ++lane) {
+		color[lane] = (ToUnorm8(rgba[3][lane]) << 24) | (ToUnorm8(rgba[0][lane]) << 16) | (ToUnorm8(rgba[1][lane]) << 8) | ToUnorm8(rgba[2][lane]);
+	}
+}
+
+#ifdef SIMD_X86
+// Function to sample a batch with the coordinates in vector registers like the AVX2 kernel
+SIMD_TARGET_AVX2 void SampleLanesAVX2(const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache,
+	__m256 u, __m256 v, float rgba[4][SHADING_BATCH]) {
+	if (texture.pixels.empty()) {
+		for (int i = 0; i < 4; ++i) {
+			_mm256_storeu_ps(rgba[i], _mm256_setzero_ps());
+		}
+		return;
+	}
+	if (!IsBaseLevelBilinear(sampler)) {
+		alignas(32) float laneU[SHADING_BATCH], laneV[SHADING_BATCH];
+		_mm256_store_ps(laneU, u);
+		_mm256_store_ps(laneV, v);
+		SampleFiltered(SampleBatchAVX2, texture, sampler, laneU, laneV, rgba);
+		return;
+	}
+
+	Vector4AVX2 color = SampleTextureAVX2(texture, texelCache, u, v, QuadLodAVX2(u, v, texture));
+	_mm256_storeu_ps(rgba[0], color.x);
+	_mm256_storeu_ps(rgba[1], color.y);
+	_mm256_storeu_ps(rgba[2], color.z);
+	_mm256_storeu_ps(rgba[3], color.w);
+}
+
+// Function to sample a batch with all lanes at once like the AVX2 kernel
+SIMD_TARGET_AVX2 void SampleQuadsAVX2(const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache,
+	const float u[SHADING_BATCH], const float v[SHADING_BATCH], float rgba[4][SHADING_BATCH]) {
+	SampleLanesAVX2(texture, sampler, texelCache, _mm256_loadu_ps(u), _mm256_loadu_ps(v), rgba);
+}
+
+// Function to convert shaded colors to B8G8R8A8 with all lanes at once
+SIMD_TARGET_AVX2 void PackColorsAVX2(const float rgba[4][SHADING_BATCH], uint32_t color[SHADING_BATCH]) {
+	__m256i packed[4];
+	for (int i = 0; i < 4; ++i) {
+		packed[i] = ToUnorm8AVX2(_mm256_loadu_ps(rgba[i]));
+	}
+	__m256i bgra = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(packed[3], 24), _mm256_slli_epi32(packed[0], 16)),
+		_mm256_or_si256(_mm256_slli_epi32(packed[1], 8), packed[2]));
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(color), bgra);
+}
+#endif
+
+#ifdef SIMD_X86
+// Function to shade a batch with the pipeline its features need, picked on every call
+SIMD_TARGET_AVX2 void ShadeQuadsAVX2(const ShadingTriangle& triangle, const float x[SHADING_BATCH], const float y[SHADING_BATCH],
+	const PixelShaderConstants& constants, const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache, uint32_t color[SHADING_BATCH]) {
+	PIPELINES_AVX2[GetPipelineIndex(GetPixelPipelineKey(constants, texture, sampler))](triangle, x, y, constants, texture, sampler, texelCache, color);
+}
+#endif
+
+// Function to pick the shading kernel
+ShadeQuadsFunction SelectShadeQuads(SimdLevel level) {
+#ifdef SIMD_X86
+	SimdLevel available = DetectSimdLevel();
+	if (level > available) {
+		level = available;
+	}
+
+	if (level >= SimdLevel::AVX2) {
+		return ShadeQuadsAVX2;
+	}
+#else
+	(void)level;
+#endif
+	return ShadeQuadsScalar;
+}
+
+// Function to pick the specialized pipeline of a set of features
+ShadeQuadsFunction SelectPixelPipeline(SimdLevel level, const PixelPipelineKey& key) {
+#ifdef SIMD_X86
+	SimdLevel available = DetectSimdLevel();
+	if (level > available) {
+		level = available;
+	}
+
+	if (level >= SimdLevel::AVX2) {
+		return PIPELINES_AVX2[GetPipelineIndex(key)];
+	}
+#else
+	(void)level;
+	(void)key;
+#endif
+	return ShadeQuadsScalar;
+}
+
+// Function to name a set of pipeline features
+std::string PixelPipelineName(const PixelPipelineKey& key) {
+	std::string name = key.textured ? "textured" : "untextured";
+	name += key.specular ? " specular" : " diffuse";
+	name += key.filtered ? " filtered" : " base";
+	return name;
+}
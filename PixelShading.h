@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "CpuFeatures.h"
+#include "ShaderConstants.h"
+#include "TexelCache.h"
+#include "TextureSampler.h"
+#include "TextureLoader.h"
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Output of the vertex stage, same layout as VertexShaderOutput padded to one cache line per vertex
+struct alignas(64) ShadedVertex {
+	float position[4];
+	float worldPosition[4];
+	float normal[4];
+	float uv[2];
+	float padding[2];
+};
+
+// Interpolated attributes: world position (0-3), normal (4-7) and uv (8-9)
+static const int SHADING_ATTRIBUTES = 10;
+
+// Pixels shaded per kernel call, two 2x2 quads with lanes in top-left, top-right, bottom-left, bottom-right order
+static const uint32_t SHADING_BATCH = 8;
+
+// Per-triangle interpolation data. Planes are evaluated at pixel centers relative to the triangle origin,
+// attributes are reconstructed as base + b1 * edge1 + b2 * edge2 from perspective-correct barycentrics.
+struct ShadingTriangle {
+	float invW[3];
+	float b1OverW[3];
+	float b2OverW[3];
+	float base[SHADING_ATTRIBUTES];
+	float edge1[SHADING_ATTRIBUTES];
+	float edge2[SHADING_ATTRIBUTES];
+};
+
+// Runs PixelShader.hlsl for a batch of two quads, x and y are pixel centers relative to the triangle origin.
+// Helper lanes (uncovered pixels of a quad) are shaded too so derivatives stay valid, the caller masks the writes.
+// The texture is sampled at its base level with bilinear filtering and wrap addressing when the sampler asks for that, which is
+// also what the software renderer sets by default, otherwise through TextureSampler. An empty texture samples zero like an
+// unbound shader resource view. Base level texels are fetched through texelCache when it is not null, it must be reset to the texture.
+typedef void (*ShadeQuadsFunction)(const ShadingTriangle& triangle, const float x[SHADING_BATCH], const float y[SHADING_BATCH],
+	const PixelShaderConstants& constants, const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache, uint32_t color[SHADING_BATCH]);
+
+// Features a pixel pipeline is specialized for, every combination is its own instantiation of the AVX2 kernel without the branches
+// and math of the features it lacks
+struct PixelPipelineKey {
+	bool textured = true;   // false when no texture is bound, only the specular term is left
+	bool specular = true;   // false when the light is too dim for the specular term to ever reach half an 8-bit step
+	bool filtered = false;  // sampled through TextureSampler instead of the base level bilinear path
+};
+
+// Number of specialized pixel pipelines, one per combination of PixelPipelineKey features
+const uint32_t PIXEL_PIPELINE_VARIANTS = 8;
+
+/// <summary>
+/// Fills the interpolation data of a triangle from its vertices.
+/// </summary>
+/// <param name="vertex">- The three vertices of the triangle.</param>
+/// <param name="invW">- Plane of 1 / w.</param>
+/// <param name="b1OverW">- Plane of the second barycentric divided by w.</param>
+/// <param name="b2OverW">- Plane of the third barycentric divided by w.</param>
+/// <param name="triangle">- Receives the interpolation data.</param>
+void SetupShadingTriangle(const ShadedVertex* vertex[3], const float invW[3], const float b1OverW[3], const float b2OverW[3], ShadingTriangle& triangle);
+
+/// <summary>
+/// Reference kernel, one lane at a time with exact normalize and pow like the HLSL intrinsics. Handles every feature with runtime branches.
+/// </summary>
+void ShadeQuadsScalar(const ShadingTriangle& triangle, const float x[SHADING_BATCH], const float y[SHADING_BATCH],
+	const PixelShaderConstants& constants, const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache, uint32_t color[SHADING_BATCH]);
+
+#ifdef SIMD_X86
+/// <summary>
+/// AVX2 kernel shading all eight lanes at once in structure-of-arrays form. Normalize uses rsqrt with one
+/// Newton-Raphson step and pow uses FastPow(), the output stays within 1 LSB of the reference kernel.
+/// Picks the specialized pipeline on every call, draws pick theirs once with SelectPixelPipeline().
+/// </summary>
+void ShadeQuadsAVX2(const ShadingTriangle& triangle, const float x[SHADING_BATCH], const float y[SHADING_BATCH],
+	const PixelShaderConstants& constants, const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache, uint32_t color[SHADING_BATCH]);
+#endif
+
+/// <summary>
+/// Samples the texture for a batch exactly as ShadeQuadsScalar() does, for shaders run outside the built-in kernels.
+/// </summary>
+/// <param name="texture">- The bound texture, empty when none is bound.</param>
+/// <param name="sampler">- The sampler of the draw.</param>
+/// <param name="texelCache">- Cache reset to the texture, or null.</param>
+/// <param name="u">- Texture coordinates of the lanes.</param>
+/// <param name="v">- Texture coordinates of the lanes.</param>
+/// <param name="rgba">- Receives the filtered colors, one row per channel.</param>
+void SampleQuadsScalar(const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache,
+	const float u[SHADING_BATCH], const float v[SHADING_BATCH], float rgba[4][SHADING_BATCH]);
+
+/// <summary>
+/// Converts shaded colors to B8G8R8A8 as ShadeQuadsScalar() does, clamping every channel to [0, 1].
+/// </summary>
+/// <param name="rgba">- The colors of the lanes, one row per channel.</param>
+/// <param name="color">- Receives the packed colors.</param>
+void PackColorsScalar(const float rgba[4][SHADING_BATCH], uint32_t color[SHADING_BATCH]);
+
+#ifdef SIMD_X86
+/// <summary>
+/// Samples the texture for a batch exactly as the AVX2 kernels do, see SampleQuadsScalar().
+/// </summary>
+void SampleQuadsAVX2(const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache,
+	const float u[SHADING_BATCH], const float v[SHADING_BATCH], float rgba[4][SHADING_BATCH]);
+
+/// <summary>
+/// Samples like SampleQuadsAVX2() with the coordinates in vector registers, for native shader code.
+/// </summary>
+SIMD_TARGET_AVX2 void SampleLanesAVX2(const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache,
+	__m256 u, __m256 v, float rgba[4][SHADING_BATCH]);
+
+/// <summary>
+/// Converts shaded colors to B8G8R8A8 as the AVX2 kernels do, see PackColorsScalar().
+/// </summary>
+void PackColorsAVX2(const float rgba[4][SHADING_BATCH], uint32_t color[SHADING_BATCH]);
+#endif
+
+/// <summary>
+/// Picks the shading kernel for a SIMD level. AVX-512 machines use the AVX2 kernel.
+/// </summary>
+/// <param name="level">- The requested SIMD level.</param>
+/// <returns>The shading kernel.</returns>
+ShadeQuadsFunction SelectShadeQuads(SimdLevel level);
+
+/// <summary>
+/// Derives the features a draw needs from its constants, texture and sampler.
+/// Leaving out the specular term changes the output by at most 1 LSB, every other feature is exact.
+/// </summary>
+/// <param name="constants">- The pixel shader constants of the draw.</param>
+/// <param name="texture">- The bound texture, empty when none is bound.</param>
+/// <param name="sampler">- The sampler of the draw.</param>
+/// <returns>The features of the pipeline to run.</returns>
+PixelPipelineKey GetPixelPipelineKey(const PixelShaderConstants& constants, const TextureData& texture, const SamplerDesc& sampler);
+
+/// <summary>
+/// Picks the pipeline specialized for a set of features. The scalar reference kernel serves every set of features.
+/// </summary>
+/// <param name="level">- The requested SIMD level, lowered to what the CPU supports.</param>
+/// <param name="key">- The features of the pipeline.</param>
+/// <returns>The shading kernel.</returns>
+ShadeQuadsFunction SelectPixelPipeline(SimdLevel level, const PixelPipelineKey& key);
+
+/// <summary>
+/// Returns a printable name for a set of pipeline features.
+/// </summary>
+/// <param name="key">- The features of the pipeline.</param>
+/// <returns>Texturing, specular and sampling, such as "textured specular base".</returns>
+std::string PixelPipelineName(const PixelPipelineKey& key);
+
+/// <summary>
+/// Approximates pow(x, y) for x in [0, 1] as exp2(y * log2(x)) with polynomials, the same formula and fused multiply-adds
+/// the SIMD kernels and the shader JIT use, so all of them return the same bits.
+/// log2 has an absolute error below 2e-7 and exp2 a relative error below 2e-7, so for y up to 256 the result has
+/// a relative error below 6e-5 and an absolute error below 3e-6, well under half an 8-bit step.
+/// </summary>
+/// <param name="x">- Base in the range [0, 1], 0 returns 0.</param>
+/// <param name="y">- Positive exponent.</param>
+/// <returns>The approximated power.</returns>
+float FastPow(float x, float y);
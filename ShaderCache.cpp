@@ -0,0 +1,291 @@
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "AssetArchive.h"
+#include "FileView.h"
+
+static const char SHADER_CACHE_MAGIC[4] = { 'S', 'H', 'D', 'C' };
+static const uint32_t SHADER_CACHE_VERSION = 2; // bump whenever the compiler or the code generator changes their output
+static const char SHADER_CACHE_EXTENSION[] = ".shc";
+static const uint64_t CODE_ALIGNMENT = 64;
+
+// Targets of the cached artifacts
+static const uint32_t SHADER_TARGET_INTERPRETER = 0;   // IR only
+static const uint32_t SHADER_TARGET_AVX2_SYSTEMV = 1;  // IR and AVX2 code for the System V convention
+static const uint32_t SHADER_TARGET_AVX2_WINDOWS = 2;  // IR and AVX2 code for the Windows convention
+
+// Layout of a cache file header, followed by instructionCount ShaderCacheInstruction and the 64-byte aligned native code
+struct ShaderCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t target;            // SHADER_TARGET_*
+	uint32_t instructionCount;
+	uint64_t optionsKey;        // HashShaderOptions() of the stage, options and target
+	uint64_t sourceSize;
+	uint64_t sourceHash;        // HashAssetData() of the source
+	uint32_t laneSlots;
+	uint32_t codeOffset;        // from the start of the file
+	uint32_t codeSize;
+	uint32_t reserved[3];
+};
+
+// One IR instruction of a cache file
+struct ShaderCacheInstruction {
+	uint32_t op;
+	uint32_t block;
+	uint32_t index;
+	uint32_t operands[3];
+	float value;
+};
+
+static_assert(sizeof(ShaderCacheHeader) == 64, "ShaderCacheHeader must be 64 bytes");
+static_assert(sizeof(ShaderCacheInstruction) == 28, "ShaderCacheInstruction must be 28 bytes");
+
+// Function to get the target of a load
+static uint32_t GetShaderTarget(bool native) {
+	if (!native) {
+		return SHADER_TARGET_INTERPRETER;
+	}
+	return NATIVE_CALLING_CONVENTION == JitCallingConvention::Windows ? SHADER_TARGET_AVX2_WINDOWS : SHADER_TARGET_AVX2_SYSTEMV;
+}
+
+// Function to hash what besides the source changes a compiled shader
+static uint64_t HashShaderOptions(ShaderStage stage, const ShaderCompileOptions& options, uint32_t target) {
+	unsigned char key[5] = { static_cast<unsigned char>(stage), static_cast<unsigned char>(options.fuseMultiplyAdd),
+		static_cast<unsigned char>(options.approximateRsqrt), static_cast<unsigned char>(target), static_cast<unsigned char>(SHADER_CACHE_VERSION) };
+	return HashAssetData(key, sizeof(key));
+}
+
+// Function to hash a shader source
+static uint64_t HashShaderSource(const std::string& source) {
+	return HashAssetData(reinterpret_cast<const unsigned char*>(source.data()), source.size());
+}
+
+// Function to check a mapped cache file, returns its header or nullptr when it is not a usable entry
+static const ShaderCacheHeader* ValidateEntry(const FileView& entry, ShaderStage stage, uint64_t optionsKey, uint32_t target,
+	uint64_t sourceHash, uint64_t sourceSize) {
+	uint64_t fileSize = entry.Size();
+	if (fileSize < sizeof(ShaderCacheHeader)) {
+		return nullptr;
+	}
+	const ShaderCacheHeader* header = reinterpret_cast<const ShaderCacheHeader*>(entry.Data());
+	uint64_t tablesSize = static_cast<uint64_t>(header->instructionCount) * sizeof(ShaderCacheInstruction);
+	if (std::memcmp(header->magic, SHADER_CACHE_MAGIC, sizeof(SHADER_CACHE_MAGIC)) != 0 || header->version != SHADER_CACHE_VERSION ||
+		header->target != target || header->optionsKey != optionsKey || header->sourceHash != sourceHash || header->sourceSize != sourceSize ||
+		fileSize < sizeof(ShaderCacheHeader) + tablesSize || header->codeOffset < sizeof(ShaderCacheHeader) + tablesSize ||
+		header->codeOffset > fileSize || header->codeSize > fileSize - header->codeOffset) {
+		return nullptr;
+	}
+
+	// Operands must precede their users and registers stay inside the stage, like the compiler leaves them
+	uint32_t stageSlots = stage == ShaderStage::Vertex ? VERTEX_STAGE_SLOTS : PIXEL_STAGE_SLOTS;
+	const ShaderCacheInstruction* instructions = reinterpret_cast<const ShaderCacheInstruction*>(header + 1);
+	for (uint32_t id = 0; id < header->instructionCount; ++id) {
+		const ShaderCacheInstruction& instruction = instructions[id];
+		if (instruction.op > static_cast<uint32_t>(ShaderOp::Store) || instruction.block >= SHADER_BLOCKS) {
+			return nullptr;
+		}
+		ShaderOp op = static_cast<ShaderOp>(instruction.op);
+		if ((op == ShaderOp::Load || op == ShaderOp::Store) && instruction.index >= stageSlots) {
+			return nullptr;
+		}
+		for (int i = 0; i < ShaderOperandCount(op); ++i) {
+			if (instruction.operands[i] >= id) {
+				return nullptr;
+			}
+		}
+	}
+	return header;
+}
+
+// Function to copy the IR and native code of a mapped entry
+static void ReadEntry(const FileView& entry, ShaderStage stage, const ShaderCompileOptions& options, ShaderProgram& program, JitShaderCode& shaderCode) {
+	const ShaderCacheHeader* header = reinterpret_cast<const ShaderCacheHeader*>(entry.Data());
+	const ShaderCacheInstruction* instructions = reinterpret_cast<const ShaderCacheInstruction*>(header + 1);
+
+	program.stage = stage;
+	program.options = options;
+	program.code.resize(header->instructionCount);
+	for (uint32_t id = 0; id < header->instructionCount; ++id) {
+		ShaderInstruction& instruction = program.code[id];
+		instruction.op = static_cast<ShaderOp>(instructions[id].op);
+		instruction.block = instructions[id].block;
+		instruction.index = instructions[id].index;
+		std::memcpy(instruction.operands, instructions[id].operands, sizeof(instruction.operands));
+		instruction.value = instructions[id].value;
+	}
+
+	shaderCode = JitShaderCode();
+	shaderCode.convention = header->target == SHADER_TARGET_AVX2_WINDOWS ? JitCallingConvention::Windows : JitCallingConvention::SystemV;
+	shaderCode.laneSlots = header->laneSlots;
+	shaderCode.code.assign(entry.Data() + header->codeOffset, entry.Data() + header->codeOffset + header->codeSize);
+}
+
+// Function to write an entry next to its final path, then move it in place so readers never see a partial file
+static uint64_t WriteEntry(const std::string& entryPath, ShaderCacheHeader& header, const ShaderProgram& program, const JitShaderCode& shaderCode) {
+	std::vector<ShaderCacheInstruction> instructions(program.code.size());
+	for (size_t id = 0; id < program.code.size(); ++id) {
+		const ShaderInstruction& instruction = program.code[id];
+		instructions[id] = { static_cast<uint32_t>(instruction.op), instruction.block, instruction.index,
+			{ instruction.operands[0], instruction.operands[1], instruction.operands[2] }, instruction.value };
+	}
+
+	uint64_t tablesEnd = sizeof(ShaderCacheHeader) + instructions.size() * sizeof(ShaderCacheInstruction);
+	header.instructionCount = static_cast<uint32_t>(instructions.size());
+	header.laneSlots = shaderCode.laneSlots;
+	header.codeOffset = static_cast<uint32_t>((tablesEnd + CODE_ALIGNMENT - 1) & ~(CODE_ALIGNMENT - 1));
+	header.codeSize = static_cast<uint32_t>(shaderCode.code.size());
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(entryPath).parent_path(), error);
+	std::string temporaryPath = entryPath + ".tmp";
+	{
+		std::ofstream writer(temporaryPath, std::ios::binary);
+		if (!writer.is_open()) {
+			return 0;
+		}
+		static const char PADDING[CODE_ALIGNMENT] = {};
+		writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		writer.write(reinterpret_cast<const char*>(instructions.data()), instructions.size() * sizeof(ShaderCacheInstruction));
+		writer.write(PADDING, static_cast<std::streamsize>(header.codeOffset - tablesEnd));
+		writer.write(reinterpret_cast<const char*>(shaderCode.code.data()), static_cast<std::streamsize>(shaderCode.code.size()));
+		if (!writer) {
+			writer.close();
+			std::filesystem::remove(temporaryPath, error);
+			return 0;
+		}
+	}
+
+	std::filesystem::rename(temporaryPath, entryPath, error);
+	if (error) {
+		std::filesystem::remove(temporaryPath, error);
+		return 0;
+	}
+	return header.codeOffset + header.codeSize;
+}
+
+ShaderCache::ShaderCache(const std::string& directory, uint64_t sizeLimit)
+	: directory(directory), sizeLimit(sizeLimit) {
+}
+
+// Function to name the cache file of a shader
+std::string ShaderCache::GetEntryPath(const std::string& source, ShaderStage stage, const ShaderCompileOptions& options, bool native) const {
+	char fileName[32];
+	uint64_t key = HashShaderSource(source) ^ HashShaderOptions(stage, options, GetShaderTarget(native));
+	std::snprintf(fileName, sizeof(fileName), "%016llx%s", static_cast<unsigned long long>(key), SHADER_CACHE_EXTENSION);
+	return (std::filesystem::path(directory) / fileName).string();
+}
+
+// Function to remove the least recently used entries until the directory fits the size limit, keeping one entry
+uint64_t ShaderCache::Evict(const std::string& keepPath, uint64_t& evictedBytes) {
+	struct CacheFile {
+		std::filesystem::path path;
+		uint64_t size;
+		std::filesystem::file_time_type lastUse;
+	};
+	std::vector<CacheFile> files;
+	uint64_t totalSize = 0;
+	std::error_code error;
+	for (std::filesystem::directory_iterator file(directory, error), end; !error && file != end; file.increment(error)) {
+		if (file->path().extension() != SHADER_CACHE_EXTENSION) {
+			continue;
+		}
+		std::error_code statError;
+		CacheFile cacheFile = { file->path(), file->file_size(statError), file->last_write_time(statError) };
+		if (!statError) {
+			files.push_back(cacheFile);
+			totalSize += cacheFile.size;
+		}
+	}
+
+	std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.lastUse < b.lastUse; });
+	uint64_t evicted = 0;
+	evictedBytes = 0;
+	for (const CacheFile& file : files) {
+		if (totalSize <= sizeLimit) {
+			break;
+		}
+		if (file.path == std::filesystem::path(keepPath) || !std::filesystem::remove(file.path, error)) {
+			continue;
+		}
+		totalSize -= file.size;
+		evictedBytes += file.size;
+		++evicted;
+	}
+	return evicted;
+}
+
+// Function to load a shader from the cache, or compile it and fill the cache
+bool ShaderCache::Load(const std::string& source, ShaderStage stage, const ShaderCompileOptions& options, bool native, ShaderProgram& program, JitShaderCode& shaderCode) {
+	auto start = std::chrono::high_resolution_clock::now();
+	uint32_t target = GetShaderTarget(native);
+	uint64_t optionsKey = HashShaderOptions(stage, options, target);
+	uint64_t sourceHash = HashShaderSource(source);
+	std::string entryPath = GetEntryPath(source, stage, options, native);
+
+	FileView entry;
+	const ShaderCacheHeader* header = nullptr;
+	std::error_code error;
+	if (std::filesystem::exists(entryPath, error) && entry.Open(entryPath, FileAccess::Normal)) {
+		header = ValidateEntry(entry, stage, optionsKey, target, sourceHash, source.size());
+	}
+
+	if (header != nullptr) {
+		ReadEntry(entry, stage, options, program, shaderCode);
+		uint64_t mapped = entry.Size();
+
+		// The write time orders the entries for eviction, a hit makes the entry the most recently used one
+		entry.Close();
+		std::filesystem::last_write_time(entryPath, std::filesystem::file_time_type::clock::now(), error);
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		std::lock_guard<std::mutex> lock(statsMutex);
+		++stats.hits;
+		stats.bytesMapped += mapped;
+		stats.hitMilliseconds += elapsed.count();
+		return true;
+	}
+
+	// Compile and translate, then keep the result for next time
+	if (!CompileShader(source, stage, options, program)) {
+		return false;
+	}
+	shaderCode = JitShaderCode();
+	if (native) {
+		JitCompileShader(program, NATIVE_CALLING_CONVENTION, shaderCode);
+	}
+
+	ShaderCacheHeader newHeader = {};
+	std::memcpy(newHeader.magic, SHADER_CACHE_MAGIC, sizeof(SHADER_CACHE_MAGIC));
+	newHeader.version = SHADER_CACHE_VERSION;
+	newHeader.target = target;
+	newHeader.optionsKey = optionsKey;
+	newHeader.sourceSize = source.size();
+	newHeader.sourceHash = sourceHash;
+	entry.Close();
+	uint64_t written = WriteEntry(entryPath, newHeader, program, shaderCode);
+	uint64_t evictedBytes = 0;
+	uint64_t evicted = written > 0 ? Evict(entryPath, evictedBytes) : 0;
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	std::lock_guard<std::mutex> lock(statsMutex);
+	++stats.misses;
+	stats.evictions += evicted;
+	stats.bytesWritten += written;
+	stats.bytesEvicted += evictedBytes;
+	stats.missMilliseconds += elapsed.count();
+	return true;
+}
+
+// Function to read the cache counters
+ShaderCacheStats ShaderCache::GetStats() const {
+	std::lock_guard<std::mutex> lock(statsMutex);
+	return stats;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "ShaderCompiler.h"
+#include "ShaderJit.h"
+
+// Size a shader cache directory is kept under when no limit is given
+const uint64_t SHADER_CACHE_DEFAULT_LIMIT = 16ull * 1024 * 1024;
+
+// Counters of a ShaderCache, times are the whole Load() call
+struct ShaderCacheStats {
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;     // entries removed to keep the directory under the size limit
+	uint64_t bytesMapped = 0;
+	uint64_t bytesWritten = 0;
+	uint64_t bytesEvicted = 0;
+	double hitMilliseconds = 0.0;
+	double missMilliseconds = 0.0;
+};
+
+// On-disk cache of compiled shaders, so an unchanged shader is never parsed, optimized or translated twice.
+// Entries are keyed by the hash of the source, the compile options and the target: native code for a calling
+// convention, or IR only for the interpreter. They hold the IR and the native code, and hits map the entry.
+// Every write evicts the least recently used entries until the directory fits the size limit again.
+class ShaderCache {
+public:
+	/// <summary>
+	/// Uses a directory for the entries, it is created with the first entry.
+	/// </summary>
+	/// <param name="directory">- Directory of the cache files.</param>
+	/// <param name="sizeLimit">- Bytes the entries may take together.</param>
+	ShaderCache(const std::string& directory, uint64_t sizeLimit);
+
+	ShaderCache(const ShaderCache&) = delete;
+	ShaderCache& operator=(const ShaderCache&) = delete;
+
+	/// <summary>
+	/// Loads a compiled shader from the cache, or compiles and, for native code, translates it and stores the result in the cache.
+	/// Entries that cannot be written only cost the cache, the shader still compiles.
+	/// </summary>
+	/// <param name="source">- The HLSL source.</param>
+	/// <param name="stage">- The stage the shader runs in.</param>
+	/// <param name="options">- Code generation choices, part of the key.</param>
+	/// <param name="native">- True to get native code for the running platform, false for the interpreter only.</param>
+	/// <param name="program">- Receives the IR.</param>
+	/// <param name="shaderCode">- Receives the native code, left empty when native is false.</param>
+	/// <returns>True if the shader was loaded, otherwise false.</returns>
+	bool Load(const std::string& source, ShaderStage stage, const ShaderCompileOptions& options, bool native, ShaderProgram& program, JitShaderCode& shaderCode);
+
+	/// <summary>
+	/// Returns the counters since the cache was created.
+	/// </summary>
+	ShaderCacheStats GetStats() const;
+
+	/// <summary>
+	/// Returns the path of the cache file of a shader.
+	/// </summary>
+	std::string GetEntryPath(const std::string& source, ShaderStage stage, const ShaderCompileOptions& options, bool native) const;
+
+private:
+	uint64_t Evict(const std::string& keepPath, uint64_t& evictedBytes);
+
+	std::string directory;
+	uint64_t sizeLimit;
+	mutable std::mutex statsMutex;
+	ShaderCacheStats stats;
+};
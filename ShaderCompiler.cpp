@@ -0,0 +1,1491 @@
+#include "ShaderCompiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+
+#include "PixelShading.h"
+
+// Constant folding must round like the backends, which only fuse what the IR says
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+// Component id of inputs the software renderer cannot provide, such as SV_POSITION in a pixel shader
+static const uint32_t UNAVAILABLE = ~uint32_t(0);
+
+// Floats per ShadingTriangle member, the pixel stage reads the planes and attributes as constant block 1
+static const uint32_t TRIANGLE_INV_W = offsetof(ShadingTriangle, invW) / sizeof(float);
+static const uint32_t TRIANGLE_B1_OVER_W = offsetof(ShadingTriangle, b1OverW) / sizeof(float);
+static const uint32_t TRIANGLE_B2_OVER_W = offsetof(ShadingTriangle, b2OverW) / sizeof(float);
+static const uint32_t TRIANGLE_BASE = offsetof(ShadingTriangle, base) / sizeof(float);
+static const uint32_t TRIANGLE_EDGE1 = offsetof(ShadingTriangle, edge1) / sizeof(float);
+static const uint32_t TRIANGLE_EDGE2 = offsetof(ShadingTriangle, edge2) / sizeof(float);
+
+// Where a semantic lives in the software pipeline: first float and number of floats provided
+struct SemanticBinding {
+	const char* semantic;
+	uint32_t first;
+	uint32_t count;
+};
+
+// SimpleVertex floats read by vertex shader inputs
+static const SemanticBinding VERTEX_INPUTS[] = { { "POSITION", 0, 3 }, { "NORMAL", 3, 3 }, { "UV", 6, 2 } };
+
+// ShadedVertex floats written by vertex shader outputs
+static const SemanticBinding VERTEX_OUTPUTS[] = { { "SV_POSITION", 0, 4 }, { "WORLD_POSITION", 4, 4 }, { "NORMAL", 8, 4 }, { "UV", 12, 2 } };
+
+// ShadingTriangle attributes read by pixel shader inputs, SV_POSITION is declared by the shaders but never interpolated
+static const SemanticBinding PIXEL_INPUTS[] = { { "WORLD_POSITION", 0, 4 }, { "NORMAL", 4, 4 }, { "UV", 8, 2 }, { "SV_POSITION", 0, 0 } };
+
+// Color target written by pixel shader outputs
+static const SemanticBinding PIXEL_OUTPUTS[] = { { "SV_TARGET", 0, 4 }, { "SV_TARGET0", 0, 4 } };
+
+// Function to evaluate an arithmetic operation on single floats
+float EvaluateShaderOp(ShaderOp op, float a, float b, float c) {
+	switch (op) {
+	case ShaderOp::Add: return a + b;
+	case ShaderOp::Sub: return a - b;
+	case ShaderOp::Mul: return a * b;
+	case ShaderOp::Div: return a / b;
+	case ShaderOp::Min: return a < b ? a : b;
+	case ShaderOp::Max: return a > b ? a : b;
+	case ShaderOp::Neg: return -a;
+	case ShaderOp::MulAdd: return std::fma(a, b, c);
+	case ShaderOp::MulSub: return std::fma(a, b, -c);
+	case ShaderOp::NegMulAdd: return std::fma(-a, b, c);
+	case ShaderOp::Sqrt: return std::sqrt(a);
+	case ShaderOp::Rsqrt: return 1.0f / std::sqrt(a);
+	case ShaderOp::Pow: return FastPow(a, b);
+	default: return 0.0f;
+	}
+}
+
+// Function to count the operands of an operation
+int ShaderOperandCount(ShaderOp op) {
+	switch (op) {
+	case ShaderOp::Load:
+	case ShaderOp::Uniform:
+	case ShaderOp::Literal:
+		return 0;
+	case ShaderOp::Neg:
+	case ShaderOp::Sqrt:
+	case ShaderOp::Rsqrt:
+	case ShaderOp::Store:
+		return 1;
+	case ShaderOp::MulAdd:
+	case ShaderOp::MulSub:
+	case ShaderOp::NegMulAdd:
+		return 3;
+	default:
+		return 2;
+	}
+}
+
+// Function to check whether an operation computes a value from its operands alone
+static bool IsArithmetic(ShaderOp op) {
+	return op >= ShaderOp::Add && op <= ShaderOp::Pow;
+}
+
+// Function to check whether the first two operands of an operation may be swapped
+static bool IsCommutative(ShaderOp op) {
+	return op == ShaderOp::Add || op == ShaderOp::Mul || op == ShaderOp::MulAdd || op == ShaderOp::MulSub || op == ShaderOp::NegMulAdd;
+}
+
+// Key of an instruction for common subexpression elimination
+struct InstructionKey {
+	ShaderOp op;
+	uint32_t block, index, a, b, c, valueBits;
+
+	bool operator==(const InstructionKey& other) const {
+		return op == other.op && block == other.block && index == other.index && a == other.a && b == other.b && c == other.c && valueBits == other.valueBits;
+	}
+};
+
+struct InstructionKeyHash {
+	size_t operator()(const InstructionKey& key) const {
+		uint64_t hash = static_cast<uint64_t>(key.op);
+		const uint32_t fields[] = { key.block, key.index, key.a, key.b, key.c, key.valueBits };
+		for (uint32_t field : fields) {
+			hash = (hash ^ field) * 0x100000001B3ull;
+		}
+		return static_cast<size_t>(hash ^ (hash >> 29));
+	}
+};
+
+// Appends instructions in dependency order, folding constants, moving negations outwards and merging identical instructions
+class ProgramBuilder {
+public:
+	std::vector<ShaderInstruction> code;
+
+	uint32_t Literal(float value) {
+		return Emit(ShaderOp::Literal, 0, 0, 0, 0, 0, value);
+	}
+
+	uint32_t Load(uint32_t slot) {
+		return Emit(ShaderOp::Load, 0, 0, 0, slot);
+	}
+
+	uint32_t Uniform(uint32_t block, uint32_t index) {
+		return Emit(ShaderOp::Uniform, 0, 0, 0, index, block);
+	}
+
+	uint32_t Emit(ShaderOp op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0, uint32_t index = 0, uint32_t block = 0, float value = 0.0f) {
+		if (IsArithmetic(op)) {
+			uint32_t simplified;
+			if (Simplify(op, a, b, c, simplified)) {
+				return simplified;
+			}
+			if (IsCommutative(op) && a > b) {
+				std::swap(a, b);
+			}
+		}
+
+		uint32_t valueBits;
+		std::memcpy(&valueBits, &value, sizeof(valueBits));
+		InstructionKey key = { op, block, index, a, b, c, valueBits };
+		auto found = table.find(key);
+		if (found != table.end()) {
+			return found->second;
+		}
+
+		ShaderInstruction instruction;
+		instruction.op = op;
+		instruction.block = block;
+		instruction.index = index;
+		instruction.operands[0] = a;
+		instruction.operands[1] = b;
+		instruction.operands[2] = c;
+		instruction.value = value;
+		uint32_t id = static_cast<uint32_t>(code.size());
+		code.push_back(instruction);
+		table.emplace(key, id);
+		return id;
+	}
+
+private:
+	bool IsLiteral(uint32_t id, float value) const {
+		return code[id].op == ShaderOp::Literal && code[id].value == value && std::signbit(code[id].value) == std::signbit(value);
+	}
+
+	bool IsNeg(uint32_t id) const {
+		return code[id].op == ShaderOp::Neg;
+	}
+
+	uint32_t Negated(uint32_t id) const {
+		return code[id].operands[0];
+	}
+
+	// Rewrites that keep the result bit for bit, negation and scaling by two are exact
+	bool Simplify(ShaderOp op, uint32_t a, uint32_t b, uint32_t c, uint32_t& result) {
+		int operandCount = ShaderOperandCount(op);
+		const uint32_t operands[3] = { a, b, c };
+		bool constant = true;
+		for (int i = 0; i < operandCount; ++i) {
+			constant = constant && code[operands[i]].op == ShaderOp::Literal;
+		}
+		if (constant) {
+			result = Literal(EvaluateShaderOp(op, code[a].value, operandCount > 1 ? code[b].value : 0.0f, operandCount > 2 ? code[c].value : 0.0f));
+			return true;
+		}
+
+		switch (op) {
+		case ShaderOp::Neg:
+			if (IsNeg(a)) {
+				result = Negated(a);
+				return true;
+			}
+			return false;
+		case ShaderOp::Add:
+			if (IsLiteral(a, 0.0f) || IsLiteral(b, 0.0f)) {
+				result = IsLiteral(a, 0.0f) ? b : a;
+			}
+			else if (IsNeg(a) && IsNeg(b)) {
+				result = Emit(ShaderOp::Neg, Emit(ShaderOp::Add, Negated(a), Negated(b)));
+			}
+			else if (IsNeg(b)) {
+				result = Emit(ShaderOp::Sub, a, Negated(b));
+			}
+			else if (IsNeg(a)) {
+				result = Emit(ShaderOp::Sub, b, Negated(a));
+			}
+			else {
+				return false;
+			}
+			return true;
+		case ShaderOp::Sub:
+			if (IsLiteral(b, 0.0f)) {
+				result = a;
+			}
+			else if (IsNeg(a) && IsNeg(b)) {
+				result = Emit(ShaderOp::Sub, Negated(b), Negated(a));
+			}
+			else if (IsNeg(b)) {
+				result = Emit(ShaderOp::Add, a, Negated(b));
+			}
+			else if (IsNeg(a)) {
+				result = Emit(ShaderOp::Neg, Emit(ShaderOp::Add, Negated(a), b));
+			}
+			else {
+				return false;
+			}
+			return true;
+		case ShaderOp::Mul:
+		case ShaderOp::Div:
+			if (IsLiteral(b, 1.0f) || (op == ShaderOp::Mul && IsLiteral(a, 1.0f))) {
+				result = IsLiteral(b, 1.0f) ? a : b;
+			}
+			else if (op == ShaderOp::Mul && (IsLiteral(a, 0.0f) || IsLiteral(b, 0.0f))) {
+				result = Literal(0.0f);
+			}
+			else if (op == ShaderOp::Mul && (IsLiteral(a, 2.0f) || IsLiteral(b, 2.0f))) {
+				uint32_t other = IsLiteral(a, 2.0f) ? b : a;
+				result = Emit(ShaderOp::Add, other, other);
+			}
+			else if (IsNeg(a) && IsNeg(b)) {
+				result = Emit(op, Negated(a), Negated(b));
+			}
+			else if (IsNeg(a) || IsNeg(b)) {
+				result = Emit(ShaderOp::Neg, Emit(op, IsNeg(a) ? Negated(a) : a, IsNeg(b) ? Negated(b) : b));
+			}
+			else {
+				return false;
+			}
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	std::unordered_map<InstructionKey, uint32_t, InstructionKeyHash> table;
+};
+
+enum class TokenType {
+	Identifier,
+	Number,
+	Symbol,
+	End
+};
+
+struct Token {
+	TokenType type = TokenType::End;
+	std::string text;
+	float number = 0.0f;
+	int line = 0;
+};
+
+// Function to split a shader into tokens, comments and whitespace are dropped
+static bool Tokenize(const std::string& source, std::vector<Token>& tokens, std::string& error, int& errorLine) {
+	static const char* SYMBOLS[] = { "+=", "-=", "*=", "/=", "{", "}", "(", ")", ";", ",", ".", ":", "=", "+", "-", "*", "/" };
+	int line = 1;
+	size_t i = 0;
+	while (i < source.size()) {
+		char c = source[i];
+		if (c == '\n') {
+			++line;
+			++i;
+		}
+		else if (std::isspace(static_cast<unsigned char>(c))) {
+			++i;
+		}
+		else if (source.compare(i, 2, "//") == 0) {
+			while (i < source.size() && source[i] != '\n') {
+				++i;
+			}
+		}
+		else if (source.compare(i, 2, "/*") == 0) {
+			size_t end = source.find("*/", i + 2);
+			if (end == std::string::npos) {
+				error = "Unterminated comment";
+				errorLine = line;
+				return false;
+			}
+			line += static_cast<int>(std::count(source.begin() + i, source.begin() + end, '\n'));
+			i = end + 2;
+		}
+		else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+			Token token;
+			token.type = TokenType::Identifier;
+			token.line = line;
+			while (i < source.size() && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_')) {
+				token.text += source[i++];
+			}
+			tokens.push_back(token);
+		}
+		else if (std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && i + 1 < source.size() && std::isdigit(static_cast<unsigned char>(source[i + 1])))) {
+			char* end = nullptr;
+			Token token;
+			token.type = TokenType::Number;
+			token.line = line;
+			token.number = std::strtof(source.c_str() + i, &end);
+			size_t length = static_cast<size_t>(end - (source.c_str() + i));
+			token.text = source.substr(i, length);
+			i += length;
+			if (i < source.size() && (source[i] == 'f' || source[i] == 'F' || source[i] == 'h' || source[i] == 'H')) {
+				++i;
+			}
+			tokens.push_back(token);
+		}
+		else {
+			bool matched = false;
+			for (const char* symbol : SYMBOLS) {
+				size_t length = std::strlen(symbol);
+				if (source.compare(i, length, symbol) == 0) {
+					Token token;
+					token.type = TokenType::Symbol;
+					token.text = symbol;
+					token.line = line;
+					tokens.push_back(token);
+					i += length;
+					matched = true;
+					break;
+				}
+			}
+			if (!matched) {
+				error = std::string("Unexpected character '") + c + "'";
+				errorLine = line;
+				return false;
+			}
+		}
+	}
+
+	Token end;
+	end.line = line;
+	tokens.push_back(end);
+	return true;
+}
+
+enum class TypeKind {
+	Void,
+	Float,    // float to float4, components 1 to 4
+	Matrix,   // float4x4
+	Struct,
+	Texture,  // Texture2D
+	Sampler   // SamplerState
+};
+
+struct StructType;
+
+struct ShaderType {
+	TypeKind kind = TypeKind::Void;
+	uint32_t components = 0;
+	const StructType* structType = nullptr;
+};
+
+struct StructMember {
+	std::string name;
+	ShaderType type;
+	std::string semantic;
+	uint32_t offset = 0;  // first component in the struct
+};
+
+struct StructType {
+	std::string name;
+	std::vector<StructMember> members;
+	uint32_t components = 0;
+};
+
+// A value during compilation: the IR ids of its components, row-major for matrices and member after member for structs
+struct ShaderValue {
+	ShaderType type;
+	std::vector<uint32_t> ids;
+	uint32_t slot = 0;  // register of textures and samplers
+};
+
+// Recursive descent parser that emits IR while it reads the shader
+class ShaderParser {
+public:
+	ShaderParser(const std::vector<Token>& tokens, ShaderStage stage, ProgramBuilder& builder)
+		: tokens(tokens), stage(stage), builder(builder) {}
+
+	bool ParseProgram() {
+		bool parsedMain = false;
+		while (Peek().type != TokenType::End) {
+			if (Accept("cbuffer")) {
+				if (!ParseConstantBuffer()) return false;
+			}
+			else if (Accept("struct")) {
+				if (!ParseStruct()) return false;
+			}
+			else if (Peek().text == "Texture2D" || Peek().text == "SamplerState") {
+				if (!ParseResource()) return false;
+			}
+			else {
+				if (parsedMain) {
+					return Fail("Only a single main function is supported");
+				}
+				if (!ParseFunction()) return false;
+				parsedMain = true;
+			}
+		}
+		if (!parsedMain) {
+			return Fail("Missing main function");
+		}
+		return true;
+	}
+
+	std::string error;
+	int errorLine = 0;
+
+private:
+	const Token& Peek(size_t ahead = 0) const {
+		return tokens[std::min(position + ahead, tokens.size() - 1)];
+	}
+
+	bool Accept(const char* text) {
+		if (Peek().type != TokenType::End && Peek().type != TokenType::Number && Peek().text == text) {
+			++position;
+			return true;
+		}
+		return false;
+	}
+
+	bool Expect(const char* text) {
+		if (!Accept(text)) {
+			return Fail(std::string("Expected '") + text + "'");
+		}
+		return true;
+	}
+
+	bool ExpectIdentifier(std::string& name) {
+		if (Peek().type != TokenType::Identifier) {
+			return Fail("Expected an identifier");
+		}
+		name = tokens[position++].text;
+		return true;
+	}
+
+	bool Fail(const std::string& message) {
+		if (error.empty()) {
+			error = message;
+			errorLine = Peek().line;
+		}
+		return false;
+	}
+
+	// Function to parse a type name, false without consuming anything if the next token is not one
+	bool ParseType(ShaderType& type) {
+		const std::string& name = Peek().text;
+		if (Peek().type != TokenType::Identifier) {
+			return false;
+		}
+		if (name == "float" || name == "float1") {
+			type = { TypeKind::Float, 1, nullptr };
+		}
+		else if (name.size() == 6 && name.compare(0, 5, "float") == 0 && name[5] >= '2' && name[5] <= '4') {
+			type = { TypeKind::Float, static_cast<uint32_t>(name[5] - '0'), nullptr };
+		}
+		else if (name == "float4x4" || name == "matrix") {
+			type = { TypeKind::Matrix, 16, nullptr };
+		}
+		else if (name == "void") {
+			type = { TypeKind::Void, 0, nullptr };
+		}
+		else {
+			auto found = structs.find(name);
+			if (found == structs.end()) {
+				return false;
+			}
+			type = { TypeKind::Struct, found->second->components, found->second.get() };
+		}
+		++position;
+		return true;
+	}
+
+	// Function to parse an optional ": register(x0)" clause
+	bool ParseRegister(char kind, uint32_t& slot) {
+		slot = 0;
+		if (!(Peek().text == ":" && Peek(1).text == "register")) {
+			return true;
+		}
+		position += 2;
+		std::string name;
+		if (!Expect("(") || !ExpectIdentifier(name)) return false;
+		if (name.size() < 2 || std::tolower(static_cast<unsigned char>(name[0])) != kind || !std::isdigit(static_cast<unsigned char>(name[1]))) {
+			return Fail("Invalid register " + name);
+		}
+		slot = static_cast<uint32_t>(std::atoi(name.c_str() + 1));
+		return Expect(")");
+	}
+
+	bool ParseConstantBuffer() {
+		std::string name;
+		uint32_t slot;
+		if (!ExpectIdentifier(name) || !ParseRegister('b', slot)) return false;
+		if (slot != 0 || constantBufferDeclared) {
+			return Fail("Only one constant buffer in register b0 is supported");
+		}
+		constantBufferDeclared = true;
+		if (!Expect("{")) return false;
+
+		// Packing rules of constant buffers: nothing straddles a 16-byte register, matrices start a new one
+		uint32_t offset = 0;
+		while (!Accept("}")) {
+			bool rowMajor = Accept("row_major");
+			if (!rowMajor) {
+				Accept("column_major");
+			}
+			ShaderType type;
+			std::string member;
+			if (!ParseType(type) || (type.kind != TypeKind::Float && type.kind != TypeKind::Matrix)) {
+				return Fail("Expected a float or float4x4 constant");
+			}
+			if (!ExpectIdentifier(member) || !Expect(";")) return false;
+			if (type.kind == TypeKind::Matrix || offset % 4 + type.components > 4) {
+				offset = (offset + 3) / 4 * 4;
+			}
+
+			ShaderValue value;
+			value.type = type;
+			if (type.kind == TypeKind::Matrix) {
+				// Column-major storage by default, every register holds a column
+				for (uint32_t row = 0; row < 4; ++row) {
+					for (uint32_t column = 0; column < 4; ++column) {
+						value.ids.push_back(builder.Uniform(SHADER_CONSTANT_BUFFER, offset + (rowMajor ? row * 4 + column : column * 4 + row)));
+					}
+				}
+			}
+			else {
+				for (uint32_t i = 0; i < type.components; ++i) {
+					value.ids.push_back(builder.Uniform(SHADER_CONSTANT_BUFFER, offset + i));
+				}
+			}
+			offset += type.components;
+			globals[member] = value;
+		}
+		Accept(";");
+		return true;
+	}
+
+	bool ParseStruct() {
+		std::unique_ptr<StructType> structType(new StructType());
+		if (!ExpectIdentifier(structType->name) || !Expect("{")) return false;
+		while (!Accept("}")) {
+			StructMember member;
+			if (!ParseType(member.type) || member.type.kind != TypeKind::Float) {
+				return Fail("Expected a float member");
+			}
+			if (!ExpectIdentifier(member.name)) return false;
+			if (Accept(":") && !ExpectIdentifier(member.semantic)) return false;
+			if (!Expect(";")) return false;
+			member.offset = structType->components;
+			structType->components += member.type.components;
+			structType->members.push_back(member);
+		}
+		if (!Expect(";")) return false;
+		std::string name = structType->name;
+		structs[name] = std::move(structType);
+		return true;
+	}
+
+	bool ParseResource() {
+		bool texture = Accept("Texture2D");
+		if (!texture) {
+			Accept("SamplerState");
+		}
+		std::string name;
+		ShaderValue value;
+		value.type.kind = texture ? TypeKind::Texture : TypeKind::Sampler;
+		if (!ExpectIdentifier(name) || !ParseRegister(texture ? 't' : 's', value.slot) || !Expect(";")) return false;
+		if (texture && value.slot != 0) {
+			return Fail("Only a texture in register t0 is supported");
+		}
+		globals[name] = value;
+		return true;
+	}
+
+	// Function to find the binding of a semantic, case-insensitive like HLSL
+	static const SemanticBinding* FindBinding(const SemanticBinding* bindings, size_t count, const std::string& semantic) {
+		std::string upper = semantic;
+		for (char& c : upper) {
+			c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+		}
+		for (size_t i = 0; i < count; ++i) {
+			if (upper == bindings[i].semantic) {
+				return &bindings[i];
+			}
+		}
+		return nullptr;
+	}
+
+	// Function to compute the perspective-correct barycentrics of the pixel stage once
+	void SetupBarycentrics() {
+		if (barycentricsReady) {
+			return;
+		}
+		uint32_t x = builder.Load(PIXEL_X_SLOT);
+		uint32_t y = builder.Load(PIXEL_Y_SLOT);
+		auto plane = [&](uint32_t first) {
+			uint32_t value = builder.Emit(ShaderOp::Add, builder.Uniform(SHADER_PRIMITIVE_DATA, first),
+				builder.Emit(ShaderOp::Mul, builder.Uniform(SHADER_PRIMITIVE_DATA, first + 1), x));
+			return builder.Emit(ShaderOp::Add, value, builder.Emit(ShaderOp::Mul, builder.Uniform(SHADER_PRIMITIVE_DATA, first + 2), y));
+		};
+		uint32_t w = builder.Emit(ShaderOp::Div, builder.Literal(1.0f), plane(TRIANGLE_INV_W));
+		b1 = builder.Emit(ShaderOp::Mul, plane(TRIANGLE_B1_OVER_W), w);
+		b2 = builder.Emit(ShaderOp::Mul, plane(TRIANGLE_B2_OVER_W), w);
+		barycentricsReady = true;
+	}
+
+	// Function to read the components of an input semantic, missing ones default to 0 and w to 1 like the input assembler
+	bool BindInput(const std::string& semantic, uint32_t components, std::vector<uint32_t>& ids) {
+		const SemanticBinding* binding = stage == ShaderStage::Vertex ?
+			FindBinding(VERTEX_INPUTS, sizeof(VERTEX_INPUTS) / sizeof(VERTEX_INPUTS[0]), semantic) :
+			FindBinding(PIXEL_INPUTS, sizeof(PIXEL_INPUTS) / sizeof(PIXEL_INPUTS[0]), semantic);
+		if (binding == nullptr) {
+			return Fail("Unknown " + std::string(ShaderStageName(stage)) + " shader input semantic " + semantic);
+		}
+
+		for (uint32_t i = 0; i < components; ++i) {
+			if (stage == ShaderStage::Pixel && binding->count == 0) {
+				ids.push_back(UNAVAILABLE);
+			}
+			else if (i >= binding->count) {
+				ids.push_back(builder.Literal(i == 3 ? 1.0f : 0.0f));
+			}
+			else if (stage == ShaderStage::Vertex) {
+				ids.push_back(builder.Load(VERTEX_INPUT_SLOT + binding->first + i));
+			}
+			else {
+				// base + edge1 * b1 + edge2 * b2
+				SetupBarycentrics();
+				uint32_t attribute = binding->first + i;
+				uint32_t value = builder.Emit(ShaderOp::Add, builder.Uniform(SHADER_PRIMITIVE_DATA, TRIANGLE_BASE + attribute),
+					builder.Emit(ShaderOp::Mul, builder.Uniform(SHADER_PRIMITIVE_DATA, TRIANGLE_EDGE1 + attribute), b1));
+				ids.push_back(builder.Emit(ShaderOp::Add, value, builder.Emit(ShaderOp::Mul, builder.Uniform(SHADER_PRIMITIVE_DATA, TRIANGLE_EDGE2 + attribute), b2)));
+			}
+		}
+		return true;
+	}
+
+	// Function to write the components of an output semantic to their lane registers
+	bool BindOutput(const std::string& semantic, const uint32_t* ids, uint32_t components) {
+		const SemanticBinding* binding = stage == ShaderStage::Vertex ?
+			FindBinding(VERTEX_OUTPUTS, sizeof(VERTEX_OUTPUTS) / sizeof(VERTEX_OUTPUTS[0]), semantic) :
+			FindBinding(PIXEL_OUTPUTS, sizeof(PIXEL_OUTPUTS) / sizeof(PIXEL_OUTPUTS[0]), semantic);
+		if (binding == nullptr) {
+			return Fail("Unknown " + std::string(ShaderStageName(stage)) + " shader output semantic " + semantic);
+		}
+		if (components > binding->count) {
+			return Fail("Too many components for output semantic " + semantic);
+		}
+
+		uint32_t firstSlot = stage == ShaderStage::Vertex ? VERTEX_OUTPUT_SLOT + binding->first : PIXEL_OUTPUT_SLOT + binding->first;
+		for (uint32_t i = 0; i < binding->count; ++i) {
+			uint32_t id = i < components ? ids[i] : builder.Literal(0.0f);
+			if (id == UNAVAILABLE) {
+				return Fail("SV_POSITION is not available to software pixel shaders");
+			}
+			builder.Emit(ShaderOp::Store, id, 0, 0, firstSlot + i);
+		}
+		return true;
+	}
+
+	bool ParseFunction() {
+		ShaderType returnType;
+		std::string name;
+		if (!ParseType(returnType)) {
+			return Fail("Expected a declaration");
+		}
+		if (!ExpectIdentifier(name)) return false;
+		if (name != "main") {
+			return Fail("Only the main function is supported, " + name + " would need to be inlined");
+		}
+		if (!Expect("(")) return false;
+
+		// Parameters are inputs, either structs whose members carry semantics or single values with one
+		while (!Accept(")")) {
+			if (!locals.empty() && !Expect(",")) return false;
+			Accept("in");
+			ShaderValue parameter;
+			std::string parameterName;
+			if (!ParseType(parameter.type) || (parameter.type.kind != TypeKind::Float && parameter.type.kind != TypeKind::Struct)) {
+				return Fail("Expected an input parameter");
+			}
+			if (!ExpectIdentifier(parameterName)) return false;
+			if (parameter.type.kind == TypeKind::Struct) {
+				for (const StructMember& member : parameter.type.structType->members) {
+					if (!BindInput(member.semantic, member.type.components, parameter.ids)) return false;
+				}
+			}
+			else {
+				std::string semantic;
+				if (!Expect(":") || !ExpectIdentifier(semantic) || !BindInput(semantic, parameter.type.components, parameter.ids)) return false;
+			}
+			locals[parameterName] = parameter;
+		}
+
+		std::string returnSemantic;
+		if (Accept(":") && !ExpectIdentifier(returnSemantic)) return false;
+		if (returnType.kind != TypeKind::Struct && returnType.kind != TypeKind::Float) {
+			return Fail("main must return a float vector or a struct");
+		}
+		if (returnType.kind == TypeKind::Float && returnSemantic.empty()) {
+			return Fail("The return value of main needs a semantic");
+		}
+
+		if (!Expect("{")) return false;
+		while (!Accept("}")) {
+			if (returned) {
+				return Fail("Statements after return are not supported");
+			}
+			if (!ParseStatement(returnType, returnSemantic)) return false;
+		}
+		if (!returned) {
+			return Fail("main does not return a value");
+		}
+		return true;
+	}
+
+	bool ParseStatement(const ShaderType& returnType, const std::string& returnSemantic) {
+		if (Accept("return")) {
+			ShaderValue value;
+			if (!ParseExpression(value) || !Convert(value, returnType) || !Expect(";")) return false;
+			returned = true;
+			if (returnType.kind == TypeKind::Float) {
+				return BindOutput(returnSemantic, value.ids.data(), returnType.components);
+			}
+			for (const StructMember& member : returnType.structType->members) {
+				if (!BindOutput(member.semantic, &value.ids[member.offset], member.type.components)) return false;
+			}
+			return true;
+		}
+
+		// Declaration with an optional initializer, uninitialized locals start at zero
+		ShaderType type;
+		if (ParseType(type)) {
+			std::string name;
+			if (!ExpectIdentifier(name)) return false;
+			if (type.kind != TypeKind::Float && type.kind != TypeKind::Struct) {
+				return Fail("Locals must be float vectors or structs");
+			}
+			ShaderValue value;
+			value.type = type;
+			if (Accept("=")) {
+				if (!ParseExpression(value) || !Convert(value, type)) return false;
+			}
+			else {
+				value.ids.assign(type.components, builder.Literal(0.0f));
+			}
+			locals[name] = value;
+			return Expect(";");
+		}
+
+		// Assignment to a variable, a struct member or a swizzle
+		std::string name;
+		if (!ExpectIdentifier(name)) return false;
+		auto found = locals.find(name);
+		if (found == locals.end()) {
+			return Fail(globals.count(name) != 0 ? "Cannot assign to " + name : "Unknown identifier " + name);
+		}
+		ShaderValue& variable = found->second;
+		ShaderType targetType = variable.type;
+		std::vector<uint32_t> targets(variable.ids.size());
+		for (uint32_t i = 0; i < targets.size(); ++i) {
+			targets[i] = i;
+		}
+		while (Accept(".")) {
+			std::string field;
+			if (!ExpectIdentifier(field)) return false;
+			if (targetType.kind == TypeKind::Struct) {
+				const StructMember* member = FindMember(*targetType.structType, field);
+				if (member == nullptr) {
+					return Fail("Unknown member " + field);
+				}
+				targets = std::vector<uint32_t>(targets.begin() + member->offset, targets.begin() + member->offset + member->type.components);
+				targetType = member->type;
+			}
+			else {
+				std::vector<uint32_t> swizzle;
+				if (!ParseSwizzle(field, targetType.components, swizzle)) return false;
+				std::vector<uint32_t> selected;
+				for (uint32_t component : swizzle) {
+					if (std::find(selected.begin(), selected.end(), targets[component]) != selected.end()) {
+						return Fail("Swizzle " + field + " writes a component twice");
+					}
+					selected.push_back(targets[component]);
+				}
+				targets = selected;
+				targetType = { TypeKind::Float, static_cast<uint32_t>(targets.size()), nullptr };
+			}
+		}
+
+		ShaderOp compound = ShaderOp::Store;
+		if (Accept("+=")) compound = ShaderOp::Add;
+		else if (Accept("-=")) compound = ShaderOp::Sub;
+		else if (Accept("*=")) compound = ShaderOp::Mul;
+		else if (Accept("/=")) compound = ShaderOp::Div;
+		else if (!Expect("=")) return false;
+
+		ShaderValue value;
+		if (!ParseExpression(value)) return false;
+		if (compound != ShaderOp::Store) {
+			ShaderValue current;
+			current.type = targetType;
+			for (uint32_t target : targets) {
+				current.ids.push_back(variable.ids[target]);
+			}
+			if (!Binary(compound, current, value, value)) return false;
+		}
+		if (!Convert(value, targetType)) return false;
+		for (size_t i = 0; i < targets.size(); ++i) {
+			variable.ids[targets[i]] = value.ids[i];
+		}
+		return Expect(";");
+	}
+
+	static const StructMember* FindMember(const StructType& structType, const std::string& name) {
+		for (const StructMember& member : structType.members) {
+			if (member.name == name) {
+				return &member;
+			}
+		}
+		return nullptr;
+	}
+
+	bool ParseSwizzle(const std::string& field, uint32_t components, std::vector<uint32_t>& swizzle) {
+		if (field.size() > 4) {
+			return Fail("Invalid swizzle " + field);
+		}
+		for (char c : field) {
+			const char* xyzw = std::strchr("xyzw", c);
+			const char* rgba = std::strchr("rgba", c);
+			uint32_t component = xyzw != nullptr ? static_cast<uint32_t>(xyzw - "xyzw") : rgba != nullptr ? static_cast<uint32_t>(rgba - "rgba") : 4;
+			if (c == '\0' || component >= components) {
+				return Fail("Invalid swizzle " + field);
+			}
+			swizzle.push_back(component);
+		}
+		return true;
+	}
+
+	// Function to convert a value to a type, scalars are replicated to every component
+	bool Convert(ShaderValue& value, const ShaderType& type) {
+		if (type.kind == TypeKind::Struct) {
+			if (value.type.kind != TypeKind::Struct || value.type.structType != type.structType) {
+				return Fail("Expected a value of type " + type.structType->name);
+			}
+			return true;
+		}
+		if (value.type.kind != TypeKind::Float) {
+			return Fail("Expected a float value");
+		}
+		if (value.type.components == 1 && type.components > 1) {
+			value.ids.assign(type.components, value.ids[0]);
+		}
+		else if (value.type.components != type.components) {
+			return Fail("Cannot convert float" + std::to_string(value.type.components) + " to float" + std::to_string(type.components));
+		}
+		value.type = type;
+		return true;
+	}
+
+	// Function to check that every component of a value is something the shader may read
+	bool CheckAvailable(const ShaderValue& value) {
+		for (uint32_t id : value.ids) {
+			if (id == UNAVAILABLE) {
+				return Fail("SV_POSITION is not available to software pixel shaders");
+			}
+		}
+		return true;
+	}
+
+	// Function to apply a component-wise operation, scalars are promoted to the size of the other operand
+	bool Binary(ShaderOp op, const ShaderValue& a, const ShaderValue& b, ShaderValue& result) {
+		if (a.type.kind != TypeKind::Float || b.type.kind != TypeKind::Float) {
+			return Fail("Arithmetic needs float values");
+		}
+		uint32_t components = std::max(a.type.components, b.type.components);
+		if (a.type.components != b.type.components && a.type.components != 1 && b.type.components != 1) {
+			return Fail("Mismatched vector sizes float" + std::to_string(a.type.components) + " and float" + std::to_string(b.type.components));
+		}
+		ShaderValue output;
+		output.type = { TypeKind::Float, components, nullptr };
+		for (uint32_t i = 0; i < components; ++i) {
+			uint32_t left = a.ids[a.type.components == 1 ? 0 : i];
+			uint32_t right = b.ids[b.type.components == 1 ? 0 : i];
+			output.ids.push_back(builder.Emit(op, left, right));
+		}
+		result = output;
+		return true;
+	}
+
+	ShaderValue Unary(ShaderOp op, const ShaderValue& a) {
+		ShaderValue output;
+		output.type = a.type;
+		for (uint32_t id : a.ids) {
+			output.ids.push_back(builder.Emit(op, id));
+		}
+		return output;
+	}
+
+	ShaderValue Scalar(uint32_t id) {
+		ShaderValue value;
+		value.type = { TypeKind::Float, 1, nullptr };
+		value.ids.push_back(id);
+		return value;
+	}
+
+	// Function to sum the products of the components in order, x * x + y * y + ...
+	uint32_t Dot(const ShaderValue& a, const ShaderValue& b) {
+		uint32_t sum = builder.Emit(ShaderOp::Mul, a.ids[0], b.ids[0]);
+		for (uint32_t i = 1; i < a.type.components; ++i) {
+			sum = builder.Emit(ShaderOp::Add, sum, builder.Emit(ShaderOp::Mul, a.ids[i], b.ids[i]));
+		}
+		return sum;
+	}
+
+	bool ParseExpression(ShaderValue& value) {
+		if (!ParseMultiplicative(value)) return false;
+		while (Peek().text == "+" || Peek().text == "-") {
+			ShaderOp op = tokens[position++].text == "+" ? ShaderOp::Add : ShaderOp::Sub;
+			ShaderValue right;
+			if (!ParseMultiplicative(right) || !Binary(op, value, right, value)) return false;
+		}
+		return true;
+	}
+
+	bool ParseMultiplicative(ShaderValue& value) {
+		if (!ParseUnary(value)) return false;
+		while (Peek().text == "*" || Peek().text == "/") {
+			ShaderOp op = tokens[position++].text == "*" ? ShaderOp::Mul : ShaderOp::Div;
+			ShaderValue right;
+			if (!ParseUnary(right) || !Binary(op, value, right, value)) return false;
+		}
+		return true;
+	}
+
+	bool ParseUnary(ShaderValue& value) {
+		if (Accept("-")) {
+			if (!ParseUnary(value)) return false;
+			if (value.type.kind != TypeKind::Float) {
+				return Fail("Arithmetic needs float values");
+			}
+			value = Unary(ShaderOp::Neg, value);
+			return true;
+		}
+		Accept("+");
+		return ParsePostfix(value);
+	}
+
+	bool ParsePostfix(ShaderValue& value) {
+		if (!ParsePrimary(value)) return false;
+		while (Accept(".")) {
+			std::string field;
+			if (!ExpectIdentifier(field)) return false;
+			if (value.type.kind == TypeKind::Struct) {
+				const StructMember* member = FindMember(*value.type.structType, field);
+				if (member == nullptr) {
+					return Fail("Unknown member " + field);
+				}
+				value.ids = std::vector<uint32_t>(value.ids.begin() + member->offset, value.ids.begin() + member->offset + member->type.components);
+				value.type = member->type;
+				if (!CheckAvailable(value)) return false;
+			}
+			else if (value.type.kind == TypeKind::Texture && field == "Sample") {
+				if (!ParseSample(value)) return false;
+			}
+			else if (value.type.kind == TypeKind::Float) {
+				std::vector<uint32_t> swizzle;
+				if (!ParseSwizzle(field, value.type.components, swizzle)) return false;
+				std::vector<uint32_t> ids;
+				for (uint32_t component : swizzle) {
+					ids.push_back(value.ids[component]);
+				}
+				value.ids = ids;
+				value.type.components = static_cast<uint32_t>(ids.size());
+			}
+			else {
+				return Fail("Invalid member access ." + field);
+			}
+		}
+		return true;
+	}
+
+	bool ParseSample(ShaderValue& value) {
+		if (stage != ShaderStage::Pixel) {
+			return Fail("Sample is only available to pixel shaders");
+		}
+		std::vector<ShaderValue> arguments;
+		if (!ParseArguments(arguments)) return false;
+		if (arguments.size() != 2 || arguments[0].type.kind != TypeKind::Sampler || arguments[1].type.kind != TypeKind::Float || arguments[1].type.components != 2) {
+			return Fail("Sample takes a sampler and float2 coordinates");
+		}
+		ShaderValue result;
+		result.type = { TypeKind::Float, 4, nullptr };
+		for (uint32_t channel = 0; channel < 4; ++channel) {
+			result.ids.push_back(builder.Emit(ShaderOp::Sample, arguments[1].ids[0], arguments[1].ids[1], 0, channel));
+		}
+		value = result;
+		return true;
+	}
+
+	bool ParseArguments(std::vector<ShaderValue>& arguments) {
+		if (!Expect("(")) return false;
+		while (!Accept(")")) {
+			if (!arguments.empty() && !Expect(",")) return false;
+			ShaderValue argument;
+			if (!ParseExpression(argument)) return false;
+			arguments.push_back(argument);
+		}
+		return true;
+	}
+
+	bool ParsePrimary(ShaderValue& value) {
+		if (Peek().type == TokenType::Number) {
+			value = Scalar(builder.Literal(tokens[position++].number));
+			return true;
+		}
+		if (Accept("(")) {
+			return ParseExpression(value) && Expect(")");
+		}
+
+		// Constructors such as float4(position, 1.0f)
+		ShaderType type;
+		size_t start = position;
+		if (ParseType(type)) {
+			if (type.kind != TypeKind::Float) {
+				position = start;
+				return Fail("Only float vectors can be constructed");
+			}
+			std::vector<ShaderValue> arguments;
+			if (!ParseArguments(arguments)) return false;
+			ShaderValue result;
+			result.type = type;
+			for (const ShaderValue& argument : arguments) {
+				if (argument.type.kind != TypeKind::Float) {
+					return Fail("Constructors take float values");
+				}
+				result.ids.insert(result.ids.end(), argument.ids.begin(), argument.ids.end());
+			}
+			if (result.ids.size() == 1) {
+				result.ids.assign(type.components, result.ids[0]);
+			}
+			if (result.ids.size() != type.components) {
+				return Fail("Wrong number of components for float" + std::to_string(type.components));
+			}
+			value = result;
+			return true;
+		}
+
+		std::string name;
+		if (!ExpectIdentifier(name)) return false;
+		if (Peek().text == "(") {
+			return ParseIntrinsic(name, value);
+		}
+		auto local = locals.find(name);
+		if (local != locals.end()) {
+			value = local->second;
+			return true;
+		}
+		auto global = globals.find(name);
+		if (global != globals.end()) {
+			value = global->second;
+			return true;
+		}
+		return Fail("Unknown identifier " + name);
+	}
+
+	bool ParseIntrinsic(const std::string& name, ShaderValue& value) {
+		std::vector<ShaderValue> arguments;
+		if (!ParseArguments(arguments)) return false;
+		auto expect = [&](size_t count) {
+			if (arguments.size() != count) {
+				return Fail(name + " takes " + std::to_string(count) + " arguments");
+			}
+			for (const ShaderValue& argument : arguments) {
+				if (argument.type.kind != TypeKind::Float && !(name == "mul" && argument.type.kind == TypeKind::Matrix)) {
+					return Fail(name + " takes float arguments");
+				}
+			}
+			return true;
+		};
+
+		if (name == "mul") {
+			if (!expect(2)) return false;
+			const ShaderValue& a = arguments[0];
+			const ShaderValue& b = arguments[1];
+			if (a.type.kind == TypeKind::Float && b.type.kind == TypeKind::Float && (a.type.components == 1 || b.type.components == 1)) {
+				return Binary(ShaderOp::Mul, a, b, value);
+			}
+			if ((a.type.kind == TypeKind::Matrix) == (b.type.kind == TypeKind::Matrix) || (a.type.kind == TypeKind::Float ? a : b).type.components != 4) {
+				return Fail("mul takes a float4 and a float4x4, or a scalar");
+			}
+			// Row vector times matrix sums down the columns, matrix times column vector along the rows
+			bool vectorFirst = a.type.kind == TypeKind::Float;
+			const ShaderValue& vector = vectorFirst ? a : b;
+			const ShaderValue& matrix = vectorFirst ? b : a;
+			value.type = { TypeKind::Float, 4, nullptr };
+			value.ids.clear();
+			for (uint32_t i = 0; i < 4; ++i) {
+				ShaderValue line;
+				line.type = { TypeKind::Float, 4, nullptr };
+				for (uint32_t k = 0; k < 4; ++k) {
+					line.ids.push_back(vectorFirst ? matrix.ids[k * 4 + i] : matrix.ids[i * 4 + k]);
+				}
+				value.ids.push_back(Dot(vector, line));
+			}
+			return true;
+		}
+		if (name == "dot") {
+			if (!expect(2)) return false;
+			if (arguments[0].type.components != arguments[1].type.components) {
+				return Fail("dot takes vectors of the same size");
+			}
+			value = Scalar(Dot(arguments[0], arguments[1]));
+			return true;
+		}
+		if (name == "normalize") {
+			if (!expect(1)) return false;
+			ShaderValue inverseLength = Scalar(builder.Emit(ShaderOp::Rsqrt, Dot(arguments[0], arguments[0])));
+			return Binary(ShaderOp::Mul, arguments[0], inverseLength, value);
+		}
+		if (name == "length") {
+			if (!expect(1)) return false;
+			value = Scalar(builder.Emit(ShaderOp::Sqrt, Dot(arguments[0], arguments[0])));
+			return true;
+		}
+		if (name == "reflect") {
+			// i - 2 * dot(i, n) * n
+			if (!expect(2)) return false;
+			if (arguments[0].type.components != arguments[1].type.components) {
+				return Fail("reflect takes vectors of the same size");
+			}
+			ShaderValue twiceDot = Scalar(builder.Emit(ShaderOp::Mul, builder.Literal(2.0f), Dot(arguments[0], arguments[1])));
+			ShaderValue scaled;
+			return Binary(ShaderOp::Mul, twiceDot, arguments[1], scaled) && Binary(ShaderOp::Sub, arguments[0], scaled, value);
+		}
+		if (name == "pow" || name == "min" || name == "max") {
+			if (!expect(2)) return false;
+			ShaderOp op = name == "pow" ? ShaderOp::Pow : name == "min" ? ShaderOp::Min : ShaderOp::Max;
+			return Binary(op, arguments[0], arguments[1], value);
+		}
+		if (name == "saturate") {
+			if (!expect(1)) return false;
+			ShaderValue clamped;
+			return Binary(ShaderOp::Max, arguments[0], Scalar(builder.Literal(0.0f)), clamped) &&
+				Binary(ShaderOp::Min, clamped, Scalar(builder.Literal(1.0f)), value);
+		}
+		if (name == "sqrt" || name == "rsqrt") {
+			if (!expect(1)) return false;
+			value = Unary(name == "sqrt" ? ShaderOp::Sqrt : ShaderOp::Rsqrt, arguments[0]);
+			return true;
+		}
+		return Fail("Unsupported function " + name);
+	}
+
+	const std::vector<Token>& tokens;
+	size_t position = 0;
+	ShaderStage stage;
+	ProgramBuilder& builder;
+	std::map<std::string, std::unique_ptr<StructType>> structs;
+	std::map<std::string, ShaderValue> globals;
+	std::map<std::string, ShaderValue> locals;
+	bool constantBufferDeclared = false;
+	bool returned = false;
+	bool barycentricsReady = false;
+	uint32_t b1 = 0;
+	uint32_t b2 = 0;
+};
+
+// Function to keep the instructions in the given order whose flag is set, renumbering the operands
+static void Compact(std::vector<ShaderInstruction>& code, const std::vector<uint32_t>& order) {
+	std::vector<uint32_t> remap(code.size(), 0);
+	std::vector<ShaderInstruction> compacted;
+	compacted.reserve(order.size());
+	for (uint32_t id : order) {
+		ShaderInstruction instruction = code[id];
+		for (int i = 0; i < ShaderOperandCount(instruction.op); ++i) {
+			instruction.operands[i] = remap[instruction.operands[i]];
+		}
+		remap[id] = static_cast<uint32_t>(compacted.size());
+		compacted.push_back(instruction);
+	}
+	code = compacted;
+}
+
+// Function to drop instructions no store depends on
+static void RemoveDeadCode(std::vector<ShaderInstruction>& code) {
+	std::vector<uint8_t> live(code.size(), 0);
+	for (size_t id = code.size(); id-- > 0;) {
+		if (code[id].op == ShaderOp::Store) {
+			live[id] = 1;
+		}
+		if (live[id] != 0) {
+			for (int i = 0; i < ShaderOperandCount(code[id].op); ++i) {
+				live[code[id].operands[i]] = 1;
+			}
+		}
+	}
+
+	std::vector<uint32_t> order;
+	for (uint32_t id = 0; id < code.size(); ++id) {
+		if (live[id] != 0) {
+			order.push_back(id);
+		}
+	}
+	Compact(code, order);
+}
+
+// Function to count the readers of every instruction
+static std::vector<uint32_t> CountUses(const std::vector<ShaderInstruction>& code) {
+	std::vector<uint32_t> uses(code.size(), 0);
+	for (const ShaderInstruction& instruction : code) {
+		for (int i = 0; i < ShaderOperandCount(instruction.op); ++i) {
+			++uses[instruction.operands[i]];
+		}
+	}
+	return uses;
+}
+
+// Function to contract additions and subtractions of products nobody else reads into fused multiply-adds
+static void FuseMultiplyAdd(std::vector<ShaderInstruction>& code) {
+	std::vector<uint32_t> uses = CountUses(code);
+	auto fusable = [&](uint32_t id) {
+		return code[id].op == ShaderOp::Mul && uses[id] == 1;
+	};
+
+	for (ShaderInstruction& instruction : code) {
+		uint32_t a = instruction.operands[0];
+		uint32_t b = instruction.operands[1];
+		if (instruction.op == ShaderOp::Add && (fusable(b) || fusable(a))) {
+			uint32_t product = fusable(b) ? b : a;
+			instruction.op = ShaderOp::MulAdd;
+			instruction.operands[2] = product == b ? a : b;
+			instruction.operands[0] = code[product].operands[0];
+			instruction.operands[1] = code[product].operands[1];
+		}
+		else if (instruction.op == ShaderOp::Sub && fusable(a)) {
+			instruction.op = ShaderOp::MulSub;
+			instruction.operands[2] = b;
+			instruction.operands[0] = code[a].operands[0];
+			instruction.operands[1] = code[a].operands[1];
+		}
+		else if (instruction.op == ShaderOp::Sub && fusable(b)) {
+			instruction.op = ShaderOp::NegMulAdd;
+			instruction.operands[2] = a;
+			instruction.operands[0] = code[b].operands[0];
+			instruction.operands[1] = code[b].operands[1];
+		}
+	}
+	RemoveDeadCode(code);
+}
+
+// Instruction id standing for none
+static const uint32_t NO_VALUE = ~uint32_t(0);
+
+// Function to list the readers of every instruction, each once
+static std::vector<std::vector<uint32_t>> ListUsers(const std::vector<ShaderInstruction>& code) {
+	std::vector<std::vector<uint32_t>> users(code.size());
+	for (uint32_t id = 0; id < code.size(); ++id) {
+		for (int i = 0; i < ShaderOperandCount(code[id].op); ++i) {
+			std::vector<uint32_t>& readers = users[code[id].operands[i]];
+			if (readers.empty() || readers.back() != id) {
+				readers.push_back(id);
+			}
+		}
+	}
+	return users;
+}
+
+// Function to get the phase math can move to: the earliest phase of its readers, unless one of them samples with it
+static uint32_t GetLatestPhase(const std::vector<ShaderInstruction>& code, const std::vector<std::vector<uint32_t>>& users,
+	const std::vector<uint32_t>& phase, uint32_t id) {
+	if (!IsArithmetic(code[id].op) || users[id].empty()) {
+		return phase[id];
+	}
+	uint32_t latest = ~uint32_t(0);
+	for (uint32_t user : users[id]) {
+		if (code[user].op == ShaderOp::Sample) {
+			return phase[id];
+		}
+		latest = std::min(latest, phase[user]);
+	}
+	return latest;
+}
+
+// Function to check whether math can move to a later phase without another value having to be kept across the sampler
+// calls starting it. Inputs, uniforms, literals and samples are read from memory again, they cost nothing to keep, and
+// math of uniforms and literals follows its readers. The kept value, unless NO_VALUE, is kept for other reasons.
+static bool CanSink(const std::vector<ShaderInstruction>& code, const std::vector<std::vector<uint32_t>>& users,
+	const std::vector<uint32_t>& phase, const std::vector<uint8_t>& reloadable, uint32_t id, uint32_t target, uint32_t kept) {
+	for (int i = 0; i < ShaderOperandCount(code[id].op); ++i) {
+		uint32_t operand = code[id].operands[i];
+		if (operand == kept || reloadable[operand] != 0 || phase[operand] >= target) {
+			continue;
+		}
+		bool readLater = false;
+		for (uint32_t user : users[operand]) {
+			readLater = readLater || (user != id && code[user].op != ShaderOp::Sample && phase[user] >= target);
+		}
+		if (!readLater) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Function to order the code so every instruction runs in the earliest phase its operands allow, a sample starting the phase
+// after its coordinates. The math that does not need a sample is then issued before the sampler is called and its latency
+// overlaps with the texture fetches, like in the AVX2 pixel kernel. Math only later phases read moves behind the samples
+// when fewer values have to be kept across the sampler calls that way.
+static void ScheduleSamples(std::vector<ShaderInstruction>& code) {
+	std::vector<uint32_t> phase(code.size(), 0);
+	std::vector<uint32_t> key(code.size());
+	for (uint32_t id = 0; id < code.size(); ++id) {
+		for (int i = 0; i < ShaderOperandCount(code[id].op); ++i) {
+			phase[id] = std::max(phase[id], phase[code[id].operands[i]]);
+		}
+		if (code[id].op == ShaderOp::Sample) {
+			++phase[id];
+		}
+
+		// Stores follow their value, so it does not have to be kept until the end
+		key[id] = id * 2;
+		if (code[id].op == ShaderOp::Store) {
+			key[id] = code[id].operands[0] * 2 + 1;
+		}
+	}
+
+	// Math moves when its operands are kept anyway, or when it is one of several readers of a value that is kept instead of them
+	std::vector<std::vector<uint32_t>> users = ListUsers(code);
+	std::vector<uint8_t> reloadable(code.size(), 0);
+	std::vector<uint8_t> uniform(code.size(), 0);
+	for (uint32_t id = 0; id < code.size(); ++id) {
+		bool operandsUniform = IsArithmetic(code[id].op);
+		for (int i = 0; i < ShaderOperandCount(code[id].op); ++i) {
+			operandsUniform = operandsUniform && uniform[code[id].operands[i]] != 0;
+		}
+		uniform[id] = code[id].op == ShaderOp::Uniform || code[id].op == ShaderOp::Literal || operandsUniform ? 1 : 0;
+		reloadable[id] = !IsArithmetic(code[id].op) || operandsUniform ? 1 : 0;
+	}
+	bool moved = true;
+	while (moved) {
+		moved = false;
+		for (uint32_t id = static_cast<uint32_t>(code.size()); id-- > 0;) {
+			uint32_t target = GetLatestPhase(code, users, phase, id);
+			if (target > phase[id] && CanSink(code, users, phase, reloadable, id, target, NO_VALUE)) {
+				phase[id] = target;
+				moved = true;
+			}
+		}
+		for (uint32_t id = static_cast<uint32_t>(code.size()); id-- > 0;) {
+			if (!IsArithmetic(code[id].op) || users[id].size() < 2) {
+				continue;
+			}
+			bool sinkUsers = true;
+			for (uint32_t user : users[id]) {
+				uint32_t target = GetLatestPhase(code, users, phase, user);
+				sinkUsers = sinkUsers && target > phase[user] && CanSink(code, users, phase, reloadable, user, target, id);
+			}
+			if (sinkUsers) {
+				for (uint32_t user : users[id]) {
+					phase[user] = GetLatestPhase(code, users, phase, user);
+				}
+				moved = true;
+			}
+		}
+	}
+
+	std::vector<uint32_t> order(code.size());
+	for (uint32_t id = 0; id < code.size(); ++id) {
+		order[id] = id;
+	}
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		bool sampleA = code[a].op == ShaderOp::Sample;
+		bool sampleB = code[b].op == ShaderOp::Sample;
+		if (phase[a] != phase[b]) {
+			return phase[a] < phase[b];
+		}
+		return sampleA != sampleB ? sampleA : key[a] < key[b];
+	});
+	Compact(code, order);
+}
+
+// Function to compile a shader to IR
+bool CompileShader(const std::string& source, ShaderStage stage, const ShaderCompileOptions& options, ShaderProgram& program) {
+	std::vector<Token> tokens;
+	std::string error;
+	int errorLine = 0;
+	if (!Tokenize(source, tokens, error, errorLine)) {
+		std::cerr << "Shader error on line " << errorLine << ": " << error << std::endl;
+		return false;
+	}
+
+	ProgramBuilder builder;
+	ShaderParser parser(tokens, stage, builder);
+	if (!parser.ParseProgram()) {
+		std::cerr << "Shader error on line " << parser.errorLine << ": " << parser.error << std::endl;
+		return false;
+	}
+
+	program.stage = stage;
+	program.options = options;
+	program.code = builder.code;
+	RemoveDeadCode(program.code);
+	if (options.fuseMultiplyAdd) {
+		FuseMultiplyAdd(program.code);
+	}
+	ScheduleSamples(program.code);
+	return true;
+}
+
+// Function to get the mnemonic of an operation
+static const char* ShaderOpName(ShaderOp op) {
+	static const char* NAMES[] = { "load", "uniform", "literal", "add", "sub", "mul", "div", "min", "max", "neg",
+		"muladd", "mulsub", "negmuladd", "sqrt", "rsqrt", "pow", "sample", "store" };
+	return NAMES[static_cast<int>(op)];
+}
+
+// Function to list a program
+std::string DisassembleShader(const ShaderProgram& program) {
+	std::ostringstream listing;
+	for (size_t id = 0; id < program.code.size(); ++id) {
+		const ShaderInstruction& instruction = program.code[id];
+		if (instruction.op != ShaderOp::Store) {
+			listing << "%" << id << " = ";
+		}
+		listing << ShaderOpName(instruction.op);
+		switch (instruction.op) {
+		case ShaderOp::Load:
+		case ShaderOp::Store:
+			if (instruction.op == ShaderOp::Store) {
+				listing << " %" << instruction.operands[0] << ",";
+			}
+			listing << " lane" << instruction.index;
+			break;
+		case ShaderOp::Uniform:
+			listing << " c" << instruction.block << "[" << instruction.index << "]";
+			break;
+		case ShaderOp::Literal:
+			listing << " " << instruction.value;
+			break;
+		case ShaderOp::Sample:
+			listing << "." << "rgba"[instruction.index] << " %" << instruction.operands[0] << ", %" << instruction.operands[1];
+			break;
+		default:
+			for (int i = 0; i < ShaderOperandCount(instruction.op); ++i) {
+				listing << (i == 0 ? " %" : ", %") << instruction.operands[i];
+			}
+			break;
+		}
+		listing << "\n";
+	}
+	return listing.str();
+}
+
+// Function to get the name of a shader stage
+const char* ShaderStageName(ShaderStage stage) {
+	return stage == ShaderStage::Vertex ? "vertex" : "pixel";
+}
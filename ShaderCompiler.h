@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Pixels or vertices a shader invocation runs on at once, the pixel shading batch and the AVX2 width
+const uint32_t SHADER_LANES = 8;
+
+// Constant blocks a shader reads: the constant buffer in register b0 and, for pixel shaders, the ShadingTriangle being shaded
+const uint32_t SHADER_CONSTANT_BUFFER = 0;
+const uint32_t SHADER_PRIMITIVE_DATA = 1;
+const uint32_t SHADER_BLOCKS = 2;
+
+// Lane registers the vertex stage exchanges with the shader, one SimpleVertex in and one ShadedVertex out per lane, float by float
+const uint32_t VERTEX_INPUT_SLOT = 0;
+const uint32_t VERTEX_OUTPUT_SLOT = 8;
+const uint32_t VERTEX_STAGE_SLOTS = 24;
+
+// Lane registers the pixel stage exchanges with the shader: pixel centers relative to the triangle origin in, RGBA out
+const uint32_t PIXEL_X_SLOT = 0;
+const uint32_t PIXEL_Y_SLOT = 1;
+const uint32_t PIXEL_OUTPUT_SLOT = 2;
+const uint32_t PIXEL_STAGE_SLOTS = 6;
+
+// Pipeline stage a shader is compiled for, it decides how inputs and outputs bind to the software renderer
+enum class ShaderStage {
+	Vertex,  // VertexShaderInput from SimpleVertex, VertexShaderOutput to ShadedVertex
+	Pixel    // PixelShaderInput interpolated from ShadingTriangle, SV_TARGET to the color target
+};
+
+// Operations of the shader IR. Every instruction yields one float per lane and refers to earlier instructions by index.
+enum class ShaderOp : uint8_t {
+	Load,       // lane register index
+	Uniform,    // float index of constant block, the same for every lane
+	Literal,    // value
+	Add,
+	Sub,
+	Mul,
+	Div,
+	Min,        // a < b ? a : b
+	Max,        // a > b ? a : b
+	Neg,
+	MulAdd,     // a * b + c with a single rounding
+	MulSub,     // a * b - c with a single rounding
+	NegMulAdd,  // -(a * b) + c with a single rounding
+	Sqrt,
+	Rsqrt,      // 1 / sqrt(a)
+	Pow,        // FastPow(a, b)
+	Sample,     // channel index of texture t0 sampled at (a, b), samples sharing coordinates are taken together
+	Store       // writes a to lane register index, yields nothing
+};
+
+// One IR instruction, unused operands are 0
+struct ShaderInstruction {
+	ShaderOp op = ShaderOp::Literal;
+	uint32_t block = 0;
+	uint32_t index = 0;
+	uint32_t operands[3] = { 0, 0, 0 };
+	float value = 0.0f;
+};
+
+// Code generation choices, part of what identifies a compiled shader
+struct ShaderCompileOptions {
+	bool fuseMultiplyAdd = true;   // contract a * b + c into one rounding like the AVX2 pixel kernel, off rounds like the vertex kernels
+	bool approximateRsqrt = true;  // native code normalizes with rsqrt and one Newton-Raphson step, otherwise with sqrt and a division
+};
+
+// A shader lowered to straight-line IR. Operands always precede their users and samples come as early as their
+// coordinates allow, so backends can split the code at the samples without moving anything.
+struct ShaderProgram {
+	ShaderStage stage = ShaderStage::Pixel;
+	ShaderCompileOptions options;
+	std::vector<ShaderInstruction> code;
+};
+
+/// <summary>
+/// Compiles the subset of HLSL the sample shaders use: one cbuffer in register b0, structs with semantics, Texture2D and
+/// SamplerState declarations and a single main function. Statements are declarations, assignments and return, expressions use
+/// + - * /, swizzles, float to float4 constructors, float4x4 constant buffer matrices and the intrinsics mul, dot, normalize,
+/// reflect, pow, min, max, saturate, sqrt, rsqrt, length and Texture2D.Sample. Inputs and outputs bind by semantic to the
+/// software renderer. Errors are printed with their line.
+/// </summary>
+/// <param name="source">- The HLSL source.</param>
+/// <param name="stage">- The stage the shader runs in.</param>
+/// <param name="options">- Code generation options.</param>
+/// <param name="program">- Receives the optimized IR.</param>
+/// <returns>True if the shader was compiled, otherwise false.</returns>
+bool CompileShader(const std::string& source, ShaderStage stage, const ShaderCompileOptions& options, ShaderProgram& program);
+
+/// <summary>
+/// Evaluates one arithmetic IR operation on single floats, the semantics every backend follows.
+/// </summary>
+/// <param name="op">- An operation from Add to Pow.</param>
+/// <param name="a">- First operand.</param>
+/// <param name="b">- Second operand.</param>
+/// <param name="c">- Third operand.</param>
+/// <returns>The result.</returns>
+float EvaluateShaderOp(ShaderOp op, float a, float b, float c);
+
+/// <summary>
+/// Returns the number of operands an IR operation reads.
+/// </summary>
+/// <param name="op">- The operation.</param>
+/// <returns>0 to 3.</returns>
+int ShaderOperandCount(ShaderOp op);
+
+/// <summary>
+/// Writes a readable listing of a program, one instruction per line.
+/// </summary>
+/// <param name="program">- The program to list.</param>
+/// <returns>The listing.</returns>
+std::string DisassembleShader(const ShaderProgram& program);
+
+/// <summary>
+/// Returns a printable name for a shader stage.
+/// </summary>
+/// <param name="stage">- The stage.</param>
+/// <returns>"vertex" or "pixel".</returns>
+const char* ShaderStageName(ShaderStage stage);
@@ -0,0 +1,117 @@
+#include "ShaderConstants.h"
+
+#include <cmath>
+
+// Row-major 4x4 matrix used while building the constants, same convention as DirectX::XMMATRIX
+struct Matrix4 {
+	float m[4][4];
+};
+
+// Function to multiply two matrices
+static Matrix4 Multiply(const Matrix4& a, const Matrix4& b) {
+	Matrix4 result{};
+	for (int r = 0; r < 4; ++r) {
+		for (int c = 0; c < 4; ++c) {
+			result.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c] + a.m[r][3] * b.m[3][c];
+		}
+	}
+	return result;
+}
+
+// Function to store the transpose of a matrix
+static void StoreTransposed(const Matrix4& matrix, float out[4][4]) {
+	for (int r = 0; r < 4; ++r) {
+		for (int c = 0; c < 4; ++c) {
+			out[r][c] = matrix.m[c][r];
+		}
+	}
+}
+
+// Function to create a translation matrix, equivalent to XMMatrixTranslation
+static Matrix4 Translation(float x, float y, float z) {
+	return { {
+		{ 1, 0, 0, 0 },
+		{ 0, 1, 0, 0 },
+		{ 0, 0, 1, 0 },
+		{ x, y, z, 1 }
+	} };
+}
+
+// Function to create a rotation around the Y axis, equivalent to XMMatrixRotationY
+static Matrix4 RotationY(float angle) {
+	float s = std::sin(angle);
+	float c = std::cos(angle);
+	return { {
+		{ c, 0, -s, 0 },
+		{ 0, 1, 0, 0 },
+		{ s, 0, c, 0 },
+		{ 0, 0, 0, 1 }
+	} };
+}
+
+// Function to normalize a three component vector
+static void Normalize3(float v[3]) {
+	float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	if (length > 0.0f) {
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+}
+
+// Function to create a left-handed view matrix, equivalent to XMMatrixLookAtLH
+static Matrix4 LookAtLH(const float eye[3], const float focus[3], const float up[3]) {
+	float r2[3] = { focus[0] - eye[0], focus[1] - eye[1], focus[2] - eye[2] };
+	Normalize3(r2);
+
+	float r0[3] = { up[1] * r2[2] - up[2] * r2[1], up[2] * r2[0] - up[0] * r2[2], up[0] * r2[1] - up[1] * r2[0] };
+	Normalize3(r0);
+
+	float r1[3] = { r2[1] * r0[2] - r2[2] * r0[1], r2[2] * r0[0] - r2[0] * r0[2], r2[0] * r0[1] - r2[1] * r0[0] };
+
+	float d0 = -(r0[0] * eye[0] + r0[1] * eye[1] + r0[2] * eye[2]);
+	float d1 = -(r1[0] * eye[0] + r1[1] * eye[1] + r1[2] * eye[2]);
+	float d2 = -(r2[0] * eye[0] + r2[1] * eye[1] + r2[2] * eye[2]);
+
+	return { {
+		{ r0[0], r1[0], r2[0], 0 },
+		{ r0[1], r1[1], r2[1], 0 },
+		{ r0[2], r1[2], r2[2], 0 },
+		{ d0, d1, d2, 1 }
+	} };
+}
+
+// Function to create a left-handed perspective projection, equivalent to XMMatrixPerspectiveFovLH
+static Matrix4 PerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ) {
+	float height = std::cos(0.5f * fovAngleY) / std::sin(0.5f * fovAngleY);
+	float width = height / aspectRatio;
+	float range = farZ / (farZ - nearZ);
+	return { {
+		{ width, 0, 0, 0 },
+		{ 0, height, 0, 0 },
+		{ 0, 0, range, 1 },
+		{ 0, 0, -range * nearZ, 0 }
+	} };
+}
+
+// Function to create the world matrix
+void CreateSoftwareWorldMatrix(float angle, float worldMatrix[4][4]) {
+	StoreTransposed(Multiply(Translation(0, 0, -1), RotationY(angle)), worldMatrix);
+}
+
+// Function to create world, view, and projection matrices
+void CreateSoftwareMatrices(uint32_t width, uint32_t height, float rotation, VertexShaderConstants& constants) {
+	const float eyePosition[3] = { 0.0f, 0.0f, -3.0f };
+	const float focusPosition[3] = { 0.0f, 0.0f, 0.0f };
+	const float upPosition[3] = { 0.0f, 1.0f, 0.0f };
+	Matrix4 viewMatrix = LookAtLH(eyePosition, focusPosition, upPosition);
+
+	float fovAngle = 59.0f * (3.141592654f / 180.0f);
+	float aspectRatio = static_cast<float>(width) / static_cast<float>(height);
+	float nearZ = 0.1f;
+	float farZ = 100.0f;
+	Matrix4 projectionMatrix = PerspectiveFovLH(fovAngle, aspectRatio, nearZ, farZ);
+
+	CreateSoftwareWorldMatrix(rotation, constants.worldMatrix);
+	StoreTransposed(Multiply(viewMatrix, projectionMatrix), constants.viewProjectionMatrix);
+}
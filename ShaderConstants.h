@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+// Mirrors the vertex shader cbuffer; layout compatible with the DirectX::XMFLOAT4X4[2] matrix array
+struct VertexShaderConstants {
+	float worldMatrix[4][4];
+	float viewProjectionMatrix[4][4];
+};
+
+// Mirrors the pixel shader cbuffer written by CreatePSConstBuffer()
+struct PixelShaderConstants {
+	float lightPosition[4] = { 0.0f, 0.5f, -5.0f, 1.0f };
+	float lightColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	float cameraPosition[4] = { 0.0f, 0.0f, -3.0f, 1.0f };
+	float ambientLightIntensity = 0.01f;
+	float shininess = 200.0f;
+	char padding[8];
+};
+
+/// <summary>
+/// Creates the transposed world matrix for a given rotation angle without DirectXMath.
+/// Produces the same values as CreateWorldMatrix().
+/// </summary>
+/// <param name="angle">- The rotation angle in radians.</param>
+/// <param name="worldMatrix">- Receives the world matrix as stored in the constant buffer.</param>
+void CreateSoftwareWorldMatrix(float angle, float worldMatrix[4][4]);
+
+/// <summary>
+/// Creates the world and view-projection matrices without DirectXMath.
+/// Produces the same values as the matrix array filled by SetupConstantBuffers().
+/// </summary>
+/// <param name="width">- The width of the viewport.</param>
+/// <param name="height">- The height of the viewport.</param>
+/// <param name="rotation">- The rotation angle in radians.</param>
+/// <param name="constants">- Receives the vertex shader constants.</param>
+void CreateSoftwareMatrices(uint32_t width, uint32_t height, float rotation, VertexShaderConstants& constants);
@@ -0,0 +1,96 @@
+#include "ShaderInterpreter.h"
+
+// Every operation must round on its own, as the IR says
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+// Function to get the stage registers of a program
+static uint32_t GetStageSlots(const ShaderProgram& program) {
+	return program.stage == ShaderStage::Vertex ? VERTEX_STAGE_SLOTS : PIXEL_STAGE_SLOTS;
+}
+
+// Function to count the lane registers the interpreter needs
+uint32_t GetInterpreterLaneSlots(const ShaderProgram& program) {
+	return GetStageSlots(program) + static_cast<uint32_t>(program.code.size());
+}
+
+// Function to interpret a program
+void InterpretShader(const ShaderProgram& program, const ShaderInvocation& invocation) {
+	// Instruction results live behind the stage registers
+	float* values = invocation.lanes + GetStageSlots(program) * SHADER_LANES;
+	float rgba[4][SHADER_LANES];
+	uint32_t sampledU = ~uint32_t(0);
+	uint32_t sampledV = ~uint32_t(0);
+
+	for (size_t id = 0; id < program.code.size(); ++id) {
+		const ShaderInstruction& instruction = program.code[id];
+		float* result = values + id * SHADER_LANES;
+		const float* a = values + instruction.operands[0] * SHADER_LANES;
+		const float* b = values + instruction.operands[1] * SHADER_LANES;
+		const float* c = values + instruction.operands[2] * SHADER_LANES;
+
+		switch (instruction.op) {
+		case ShaderOp::Load:
+			for (uint32_t lane = 0; lane < SHADER_LANES; ++lane) {
+				result[lane] = invocation.lanes[instruction.index * SHADER_LANES + lane];
+			}
+			break;
+		case ShaderOp::Uniform:
+			for (uint32_t lane = 0; lane < SHADER_LANES; ++lane) {
+				result[lane] = invocation.blocks[instruction.block][instruction.index];
+			}
+			break;
+		case ShaderOp::Literal:
+			for (uint32_t lane = 0; lane < SHADER_LANES; ++lane) {
+				result[lane] = instruction.value;
+			}
+			break;
+		case ShaderOp::Add:
+			for (uint32_t lane = 0; lane < SHADER_LANES; ++lane) {
+				result[lane] = a[lane] + b[lane];
+			}
+			break;
+		case ShaderOp::Sub:
+			for (uint32_t lane = 0; lane < SHADER_LANES; ++lane) {
+				result[lane] = a[lane] - b[lane];
+			}
+			break;
+		case ShaderOp::Mul:
+			for (uint32_t lane = 0; lane < SHADER_LANES; ++lane) {
+				result[lane] = a[lane] * b[lane];
+			}
+			break;
+		case ShaderOp::Div:
+			for (uint32_t lane = 0; lane < SHADER_LANES; ++lane) {
+				result[lane] = a[lane] / b[lane];
+			}
+			break;
+		case ShaderOp::Sample:
+			// The four channels of a sample follow each other, the first one takes the sample
+			if (instruction.operands[0] != sampledU || instruction.operands[1] != sampledV) {
+				invocation.sample(invocation.sampleContext, a, b, rgba);
+				sampledU = instruction.operands[0];
+				sampledV = instruction.operands[1];
+			}
+			for (uint32_t lane = 0; lane < SHADER_LANES; ++lane) {
+				result[lane] = rgba[instruction.index][lane];
+			}
+			break;
+		case ShaderOp::Store:
+			for (uint32_t lane = 0; lane < SHADER_LANES; ++lane) {
+				invocation.lanes[instruction.index * SHADER_LANES + lane] = a[lane];
+			}
+			break;
+		default:
+			for (uint32_t lane = 0; lane < SHADER_LANES; ++lane) {
+				result[lane] = EvaluateShaderOp(instruction.op, a[lane], b[lane], c[lane]);
+			}
+			break;
+		}
+	}
+}
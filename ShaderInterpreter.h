@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+#include "ShaderCompiler.h"
+
+// Samples texture t0 for every lane, rgba receives one row per channel
+typedef void (*ShaderSampleFunction)(void* context, const float u[SHADER_LANES], const float v[SHADER_LANES], float rgba[4][SHADER_LANES]);
+
+// Everything a shader invocation reads and writes. Lane registers are SHADER_LANES consecutive floats each, the stage
+// inputs and outputs come first and backends keep their temporaries behind them.
+struct ShaderInvocation {
+	float* lanes = nullptr;
+	const float* blocks[SHADER_BLOCKS] = { nullptr, nullptr };
+	ShaderSampleFunction sample = nullptr;
+	void* sampleContext = nullptr;
+};
+
+/// <summary>
+/// Returns how many lane registers InterpretShader() needs for a program.
+/// </summary>
+/// <param name="program">- The program to run.</param>
+/// <returns>The stage registers plus one register per instruction.</returns>
+uint32_t GetInterpreterLaneSlots(const ShaderProgram& program);
+
+/// <summary>
+/// Runs a program over all lanes one instruction at a time, the fallback where no native code can be generated.
+/// Every operation rounds as EvaluateShaderOp() does, rsqrt is exact whatever the compile options say.
+/// </summary>
+/// <param name="program">- The program to run.</param>
+/// <param name="invocation">- Lane registers with at least GetInterpreterLaneSlots() entries, constants and sampler.</param>
+void InterpretShader(const ShaderProgram& program, const ShaderInvocation& invocation);
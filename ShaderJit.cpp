@@ -0,0 +1,942 @@
+#include "ShaderJit.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Coefficients and limits of FastPow() in PixelShading.cpp, pow is generated like PowAVX2() there
+static const float LOG2_C1 = 2.8853900817779268f;
+static const float LOG2_C3 = 0.9617966939259756f;
+static const float LOG2_C5 = 0.5770780163555854f;
+static const float LOG2_C7 = 0.4121985831111324f;
+static const float LOG2_C9 = 0.3205988979753252f;
+static const float EXP2_C1 = 0.6931471805599453f;
+static const float EXP2_C2 = 0.2402265069591007f;
+static const float EXP2_C3 = 0.05550410866482158f;
+static const float EXP2_C4 = 0.009618129107628477f;
+static const float EXP2_C5 = 0.0013333558146428443f;
+static const float EXP2_C6 = 0.00015403530393381606f;
+static const float EXP2_C7 = 1.525273380405984e-05f;
+static const float SQRT2 = 1.41421356f;
+static const float SMALLEST_NORMAL = 1.17549435e-38f;
+
+static const int VECTOR_REGISTERS = 16;
+static const int32_t SLOT_BYTES = SHADER_LANES * sizeof(float);
+static const uint32_t NO_SLOT = ~uint32_t(0);
+static const uint32_t NO_USE = ~uint32_t(0);
+
+// Lane registers xmm6 to xmm15 are saved to under the Windows convention, 16 bytes each
+static const uint32_t SAVE_SLOTS = 5;
+static const int FIRST_PRESERVED_REGISTER = 6;
+
+// Predicates of vcmpps
+static const uint8_t COMPARE_GE_OQ = 0x1D;
+static const uint8_t COMPARE_GT_OQ = 0x1E;
+
+// Rounding control of vroundps, to nearest without exceptions
+static const uint8_t ROUND_NEAREST = 0x08;
+
+// General purpose registers used as bases and arguments
+static const uint8_t RCX = 1;
+static const uint8_t RDX = 2;
+static const uint8_t RBX = 3;
+static const uint8_t RSP = 4;
+static const uint8_t RSI = 6;
+static const uint8_t RDI = 7;
+static const uint8_t R8 = 8;
+static const uint8_t R9 = 9;
+static const uint8_t R12 = 12;
+static const uint8_t R13 = 13;
+static const uint8_t R14 = 14;
+
+// Opcodes of the general purpose instructions around the sample calls
+static const uint8_t OPCODE_MOV_LOAD = 0x8B;
+static const uint8_t OPCODE_LEA = 0x8D;
+static const uint8_t OPCODE_ADD_SUB_IMMEDIATE = 0x83;  // /0 add, /5 sub
+static const uint8_t OPCODE_CALL_INDIRECT = 0xFF;      // /2
+static const uint8_t OPCODE_PUSH = 0x50;
+static const uint8_t OPCODE_POP = 0x58;
+
+// Registers the sample calls preserve, holding the lane, constant and primitive pointers and the sampler across them
+static const uint8_t CALL_PRESERVED_REGISTERS[] = { RBX, R12, R13, R14 };
+
+// Offsets of the function and context in JitSampler
+static const int32_t SAMPLER_FUNCTION_OFFSET = 0;
+static const int32_t SAMPLER_CONTEXT_OFFSET = 8;
+
+// Stack below the pushed registers during the calls: alignment, and the home space of the arguments under Windows
+static const int SYSTEMV_FRAME_BYTES = 8;
+static const int WINDOWS_FRAME_BYTES = 40;
+
+// VEX encoded instruction: pp selects the implied prefix (0 none, 1 66, 2 F3), map the opcode map (1 0F, 2 0F38, 3 0F3A)
+struct Encoding {
+	uint8_t pp;
+	uint8_t map;
+	uint8_t opcode;
+};
+
+static const Encoding VMOVUPS_LOAD = { 0, 1, 0x10 };
+static const Encoding VMOVUPS_STORE = { 0, 1, 0x11 };
+static const Encoding VMOVAPS = { 0, 1, 0x28 };
+static const Encoding VSQRTPS = { 0, 1, 0x51 };
+static const Encoding VRSQRTPS = { 0, 1, 0x52 };
+static const Encoding VANDPS = { 0, 1, 0x54 };
+static const Encoding VORPS = { 0, 1, 0x56 };
+static const Encoding VXORPS = { 0, 1, 0x57 };
+static const Encoding VADDPS = { 0, 1, 0x58 };
+static const Encoding VMULPS = { 0, 1, 0x59 };
+static const Encoding VCVTDQ2PS = { 0, 1, 0x5B };
+static const Encoding VCVTPS2DQ = { 1, 1, 0x5B };
+static const Encoding VSUBPS = { 0, 1, 0x5C };
+static const Encoding VMINPS = { 0, 1, 0x5D };
+static const Encoding VDIVPS = { 0, 1, 0x5E };
+static const Encoding VMAXPS = { 0, 1, 0x5F };
+static const Encoding VPSHIFTD = { 1, 1, 0x72 };  // /2 vpsrld, /6 vpslld
+static const Encoding VCMPPS = { 0, 1, 0xC2 };
+static const Encoding VPSUBD = { 1, 1, 0xFA };
+static const Encoding VPADDD = { 1, 1, 0xFE };
+static const Encoding VBROADCASTSS = { 1, 2, 0x18 };
+static const Encoding VROUNDPS = { 1, 3, 0x08 };
+static const Encoding VBLENDVPS = { 1, 3, 0x4A };
+
+// Operand forms of FMA instructions, named after the order the operands are multiplied and added in
+enum class FmaForm : uint8_t {
+	Form132 = 0x00,  // dst = dst * rm + vvvv
+	Form213 = 0x10,  // dst = vvvv * dst + rm
+	Form231 = 0x20   // dst = vvvv * rm + dst
+};
+
+// Function to encode an FMA instruction of an IR operation
+static Encoding FmaEncoding(ShaderOp op, FmaForm form) {
+	uint8_t base = op == ShaderOp::MulAdd ? 0x98 : op == ShaderOp::MulSub ? 0x9A : 0x9C;
+	return { 1, 2, static_cast<uint8_t>(base + static_cast<uint8_t>(form)) };
+}
+
+// Register or memory operand of an instruction
+struct MachineOperand {
+	enum Kind : uint8_t {
+		Register,
+		Memory,   // base register plus displacement
+		Constant  // entry of the constant pool behind the code, addressed relative to the instruction pointer
+	};
+	Kind kind = Register;
+	uint8_t reg = 0;
+	int32_t displacement = 0;
+};
+
+static MachineOperand Reg(int reg) {
+	return { MachineOperand::Register, static_cast<uint8_t>(reg), 0 };
+}
+
+static MachineOperand Mem(uint8_t base, int32_t displacement) {
+	return { MachineOperand::Memory, base, displacement };
+}
+
+// Reference from an instruction to a constant pool entry, resolved once the pool is placed
+struct ConstantFixup {
+	size_t position;  // of the 32-bit displacement
+	size_t end;       // of the instruction, displacements count from there
+	uint32_t entry;
+};
+
+// Encodes VEX instructions into a byte buffer
+class Assembler {
+public:
+	std::vector<uint8_t> bytes;
+	std::vector<ConstantFixup> fixups;
+
+	void Emit(const Encoding& encoding, int reg, int vvvv, const MachineOperand& rm, int immediate = -1, bool wide = true) {
+		bool extendReg = (reg & 8) != 0;
+		bool extendBase = rm.kind != MachineOperand::Constant && (rm.reg & 8) != 0;
+		uint8_t tail = static_cast<uint8_t>(((~vvvv & 15) << 3) | (wide ? 4 : 0) | encoding.pp);
+		if (encoding.map == 1 && !extendBase) {
+			bytes.push_back(0xC5);
+			bytes.push_back(static_cast<uint8_t>((extendReg ? 0 : 0x80) | tail));
+		}
+		else {
+			bytes.push_back(0xC4);
+			bytes.push_back(static_cast<uint8_t>((extendReg ? 0 : 0x80) | 0x40 | (extendBase ? 0 : 0x20) | encoding.map));
+			bytes.push_back(tail);
+		}
+		bytes.push_back(encoding.opcode);
+
+		EmitOperand(reg, rm, immediate);
+	}
+
+	// General purpose instruction with an optional REX prefix, wide selects 64-bit operands
+	void EmitInteger(uint8_t opcode, int reg, const MachineOperand& rm, bool wide = true, int immediate = -1) {
+		uint8_t rex = static_cast<uint8_t>(0x40 | (wide ? 8 : 0) | ((reg & 8) != 0 ? 4 : 0) | ((rm.reg & 8) != 0 ? 1 : 0));
+		if (rex != 0x40) {
+			bytes.push_back(rex);
+		}
+		bytes.push_back(opcode);
+		EmitOperand(reg, rm, immediate);
+	}
+
+	// push and pop of a 64-bit register
+	void EmitStack(uint8_t opcode, int reg) {
+		if ((reg & 8) != 0) {
+			bytes.push_back(0x41);
+		}
+		bytes.push_back(static_cast<uint8_t>(opcode + (reg & 7)));
+	}
+
+	void Append32(uint32_t value) {
+		for (int i = 0; i < 4; ++i) {
+			bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+		}
+	}
+
+private:
+	// ModRM byte, displacement and immediate of an instruction
+	void EmitOperand(int reg, const MachineOperand& rm, int immediate) {
+		uint8_t modRmReg = static_cast<uint8_t>((reg & 7) << 3);
+		size_t fixupPosition = 0;
+		if (rm.kind == MachineOperand::Register) {
+			bytes.push_back(static_cast<uint8_t>(0xC0 | modRmReg | (rm.reg & 7)));
+		}
+		else if (rm.kind == MachineOperand::Memory) {
+			bool shortDisplacement = rm.displacement >= -128 && rm.displacement <= 127;
+			bytes.push_back(static_cast<uint8_t>((shortDisplacement ? 0x40 : 0x80) | modRmReg | (rm.reg & 7)));
+			if ((rm.reg & 7) == 4) {
+				bytes.push_back(0x24);
+			}
+			if (shortDisplacement) {
+				bytes.push_back(static_cast<uint8_t>(rm.displacement));
+			}
+			else {
+				Append32(static_cast<uint32_t>(rm.displacement));
+			}
+		}
+		else {
+			bytes.push_back(static_cast<uint8_t>(0x05 | modRmReg));
+			fixupPosition = bytes.size();
+			Append32(0);
+		}
+
+		if (immediate >= 0) {
+			bytes.push_back(static_cast<uint8_t>(immediate));
+		}
+		if (rm.kind == MachineOperand::Constant) {
+			fixups.push_back({ fixupPosition, bytes.size(), static_cast<uint32_t>(rm.displacement) });
+		}
+	}
+};
+
+// Translates a program into one function, keeping values in registers until the next sample call
+class JitCompiler {
+public:
+	JitCompiler(const ShaderProgram& program, JitCallingConvention convention, JitShaderCode& shaderCode)
+		: code(program.code), options(program.options), windows(convention == JitCallingConvention::Windows), shaderCode(shaderCode) {
+		// Shaders that sample keep their arguments in registers the sampler preserves
+		sampling = std::any_of(code.begin(), code.end(), [](const ShaderInstruction& instruction) { return instruction.op == ShaderOp::Sample; });
+		if (sampling) {
+			lanes = CALL_PRESERVED_REGISTERS[0];
+			blockBases[SHADER_CONSTANT_BUFFER] = CALL_PRESERVED_REGISTERS[1];
+			blockBases[SHADER_PRIMITIVE_DATA] = CALL_PRESERVED_REGISTERS[2];
+			sampler = CALL_PRESERVED_REGISTERS[3];
+		}
+		else {
+			lanes = windows ? RCX : RDI;
+			blockBases[SHADER_CONSTANT_BUFFER] = windows ? RDX : RSI;
+			blockBases[SHADER_PRIMITIVE_DATA] = windows ? R8 : RDX;
+			sampler = windows ? R9 : RCX;
+		}
+
+		uint32_t stageSlots = program.stage == ShaderStage::Vertex ? VERTEX_STAGE_SLOTS : PIXEL_STAGE_SLOTS;
+		saveSlot = stageSlots;
+		nextSlot = stageSlots + (windows ? SAVE_SLOTS : 0);
+
+		// Positions every value is read at, stores and samples included
+		uses.resize(code.size());
+		laneSlot.assign(code.size(), NO_SLOT);
+		valueRegister.assign(code.size(), -1);
+		for (uint32_t id = 0; id < code.size(); ++id) {
+			for (int i = 0; i < ShaderOperandCount(code[id].op); ++i) {
+				std::vector<uint32_t>& valueUses = uses[code[id].operands[i]];
+				if (valueUses.empty() || valueUses.back() != id) {
+					valueUses.push_back(id);
+				}
+			}
+			if (code[id].op == ShaderOp::Load) {
+				laneSlot[id] = code[id].index;
+			}
+		}
+		std::fill_n(registerValue, VECTOR_REGISTERS, -1);
+	}
+
+	void Compile() {
+		shaderCode.convention = windows ? JitCallingConvention::Windows : JitCallingConvention::SystemV;
+		shaderCode.code.clear();
+
+		uint32_t position = 0;
+		while (position < code.size()) {
+			if (code[position].op != ShaderOp::Sample) {
+				CompileInstruction(position);
+				Release(position);
+				++position;
+				continue;
+			}
+			uint32_t end = position;
+			while (end < code.size() && code[end].op == ShaderOp::Sample) {
+				++end;
+			}
+			CompileSamples(position, end);
+			position = end;
+		}
+		FinishFunction();
+
+		// Constants follow the code, aligned so no load splits a cache line
+		while (shaderCode.code.size() % SLOT_BYTES != 0) {
+			shaderCode.code.push_back(0xCC);
+		}
+		size_t pool = shaderCode.code.size();
+		for (uint32_t bits : constants) {
+			for (uint32_t lane = 0; lane < SHADER_LANES; ++lane) {
+				for (int i = 0; i < 4; ++i) {
+					shaderCode.code.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+				}
+			}
+		}
+		for (const ConstantFixup& fixup : fixups) {
+			uint32_t displacement = static_cast<uint32_t>(pool + fixup.entry * SLOT_BYTES - fixup.end);
+			for (int i = 0; i < 4; ++i) {
+				shaderCode.code[fixup.position + i] = static_cast<uint8_t>(displacement >> (8 * i));
+			}
+		}
+		shaderCode.laneSlots = nextSlot;
+	}
+
+private:
+	static bool IsComputed(ShaderOp op) {
+		return op != ShaderOp::Load && op != ShaderOp::Uniform && op != ShaderOp::Literal && op != ShaderOp::Sample;
+	}
+
+	uint32_t NextUse(uint32_t id, uint32_t position) const {
+		auto next = std::lower_bound(uses[id].begin(), uses[id].end(), position);
+		return next == uses[id].end() ? NO_USE : *next;
+	}
+
+	bool Dies(uint32_t id, uint32_t position) const {
+		return uses[id].back() == position;
+	}
+
+	bool InRegister(uint32_t id) const {
+		return valueRegister[id] >= 0;
+	}
+
+	// Values computed here exist nowhere else until they are spilled
+	bool NeedsSpill(uint32_t id) const {
+		return IsComputed(code[id].op) && laneSlot[id] == NO_SLOT;
+	}
+
+	MachineOperand Lane(uint32_t slot) const {
+		return Mem(lanes, static_cast<int32_t>(slot) * SLOT_BYTES);
+	}
+
+	MachineOperand Constant(float value) {
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return ConstantBits(bits);
+	}
+
+	MachineOperand ConstantBits(uint32_t bits) {
+		auto found = constantEntries.find(bits);
+		if (found == constantEntries.end()) {
+			found = constantEntries.emplace(bits, static_cast<uint32_t>(constants.size())).first;
+			constants.push_back(bits);
+		}
+		return { MachineOperand::Constant, 0, static_cast<int32_t>(found->second) };
+	}
+
+	// Function to find where a value can be read from memory, uniforms have to be broadcast first
+	bool MemoryOperand(uint32_t id, MachineOperand& operand) {
+		if (laneSlot[id] != NO_SLOT) {
+			operand = Lane(laneSlot[id]);
+			return true;
+		}
+		if (code[id].op == ShaderOp::Literal) {
+			operand = Constant(code[id].value);
+			return true;
+		}
+		return false;
+	}
+
+	uint32_t AllocateSlot() {
+		if (!freeSlots.empty()) {
+			uint32_t slot = freeSlots.back();
+			freeSlots.pop_back();
+			return slot;
+		}
+		return nextSlot++;
+	}
+
+	void Spill(int reg) {
+		uint32_t id = static_cast<uint32_t>(registerValue[reg]);
+		laneSlot[id] = AllocateSlot();
+		body.Emit(VMOVUPS_STORE, reg, 0, Lane(laneSlot[id]));
+	}
+
+	void Unbind(int reg) {
+		if (registerValue[reg] >= 0) {
+			valueRegister[registerValue[reg]] = -1;
+			registerValue[reg] = -1;
+		}
+	}
+
+	void Bind(uint32_t id, int reg) {
+		Unbind(reg);
+		registerValue[reg] = static_cast<int32_t>(id);
+		valueRegister[id] = reg;
+	}
+
+	// Function to get a register for the current instruction: a free one, otherwise the one whose value is needed last
+	int AllocateRegister(uint32_t position) {
+		int best = -1;
+		uint32_t bestUse = 0;
+		bool bestClean = false;
+		for (int reg = 0; reg < VECTOR_REGISTERS; ++reg) {
+			if ((pinned >> reg) & 1) {
+				continue;
+			}
+			if (registerValue[reg] < 0) {
+				best = reg;
+				break;
+			}
+			uint32_t id = static_cast<uint32_t>(registerValue[reg]);
+			uint32_t nextUse = NextUse(id, position);
+			bool clean = !NeedsSpill(id);
+			if (best < 0 || nextUse > bestUse || (nextUse == bestUse && clean && !bestClean)) {
+				best = reg;
+				bestUse = nextUse;
+				bestClean = clean;
+			}
+		}
+
+		if (registerValue[best] >= 0) {
+			uint32_t id = static_cast<uint32_t>(registerValue[best]);
+			if (NeedsSpill(id) && NextUse(id, position) != NO_USE) {
+				Spill(best);
+			}
+			Unbind(best);
+		}
+		pinned |= 1u << best;
+		usedRegisters |= 1u << best;
+		return best;
+	}
+
+	// Function to load a value into a register without binding it there
+	void Materialize(uint32_t id, int reg) {
+		MachineOperand operand;
+		if (MemoryOperand(id, operand)) {
+			body.Emit(VMOVUPS_LOAD, reg, 0, operand);
+		}
+		else {
+			body.Emit(VBROADCASTSS, reg, 0, Mem(blockBases[code[id].block], static_cast<int32_t>(code[id].index * sizeof(float))));
+		}
+	}
+
+	// Function to get a value into a register, which stays pinned until the instruction is done
+	int Register(uint32_t id, uint32_t position) {
+		if (!InRegister(id)) {
+			int reg = AllocateRegister(position);
+			Materialize(id, reg);
+			Bind(id, reg);
+		}
+		pinned |= 1u << valueRegister[id];
+		return valueRegister[id];
+	}
+
+	// Function to get a value as a register or memory operand
+	MachineOperand Any(uint32_t id, uint32_t position) {
+		MachineOperand operand;
+		if (!InRegister(id) && MemoryOperand(id, operand)) {
+			return operand;
+		}
+		return Reg(Register(id, position));
+	}
+
+	// Function to pick the result register, taking over the register of an operand read for the last time when there is one
+	int Destination(const uint32_t* operands, int count, uint32_t position) {
+		for (int i = 0; i < count; ++i) {
+			if (Dies(operands[i], position) && InRegister(operands[i])) {
+				int reg = valueRegister[operands[i]];
+				Unbind(reg);
+				return reg;
+			}
+		}
+		return AllocateRegister(position);
+	}
+
+	void StoreToLane(uint32_t id, uint32_t position) {
+		if (laneSlot[id] != NO_SLOT) {
+			return;
+		}
+		int reg = Register(id, position);
+		laneSlot[id] = AllocateSlot();
+		body.Emit(VMOVUPS_STORE, reg, 0, Lane(laneSlot[id]));
+		pinned = 0;
+	}
+
+	// Function to free the registers and spill slots of values read for the last time
+	void Release(uint32_t position) {
+		const ShaderInstruction& instruction = code[position];
+		for (int i = 0; i < ShaderOperandCount(instruction.op); ++i) {
+			uint32_t id = instruction.operands[i];
+			if (!Dies(id, position)) {
+				continue;
+			}
+			if (InRegister(id)) {
+				Unbind(valueRegister[id]);
+			}
+			if (IsComputed(code[id].op) && laneSlot[id] != NO_SLOT) {
+				freeSlots.push_back(laneSlot[id]);
+				laneSlot[id] = NO_SLOT;
+			}
+		}
+		pinned = 0;
+	}
+
+	// Function to call the sampler once per pair of coordinates of a group of samples. The calls keep no vector register:
+	// coordinates of the later calls and values needed after the group go to lane registers first.
+	void CompileSamples(uint32_t position, uint32_t end) {
+		std::vector<std::pair<uint32_t, uint32_t>> calls;
+		std::vector<uint32_t> resultSlots;
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> groups;
+		for (uint32_t id = position; id < end; ++id) {
+			std::pair<uint32_t, uint32_t> coordinates(code[id].operands[0], code[id].operands[1]);
+			auto group = groups.find(coordinates);
+			if (group == groups.end()) {
+				calls.push_back(coordinates);
+				resultSlots.push_back(nextSlot);
+				group = groups.emplace(coordinates, nextSlot).first;
+				nextSlot += 4;
+			}
+			laneSlot[id] = group->second + code[id].index;
+		}
+
+		for (size_t call = 1; call < calls.size(); ++call) {
+			StoreToLane(calls[call].first, position);
+			StoreToLane(calls[call].second, position);
+		}
+		for (int reg = 0; reg < VECTOR_REGISTERS; ++reg) {
+			if (registerValue[reg] >= 0) {
+				uint32_t id = static_cast<uint32_t>(registerValue[reg]);
+				if (NeedsSpill(id) && NextUse(id, end) != NO_USE) {
+					Spill(reg);
+				}
+			}
+		}
+
+		// sampler->sample(u, v, sampler->context, lanes + resultSlot), u and v in ymm0 and ymm1
+		for (size_t call = 0; call < calls.size(); ++call) {
+			PassCoordinates(calls[call].first, calls[call].second);
+			body.EmitInteger(OPCODE_MOV_LOAD, windows ? R8 : RDI, Mem(sampler, SAMPLER_CONTEXT_OFFSET));
+			body.EmitInteger(OPCODE_LEA, windows ? R9 : RSI, Lane(resultSlots[call]));
+			body.EmitInteger(OPCODE_CALL_INDIRECT, 2, Mem(sampler, SAMPLER_FUNCTION_OFFSET), false);
+			for (int reg = 0; reg < VECTOR_REGISTERS; ++reg) {
+				Unbind(reg);
+			}
+		}
+		for (uint32_t id = position; id < end; ++id) {
+			Release(id);
+		}
+	}
+
+	// Function to put the coordinates of a sample call into ymm0 and ymm1, moving v out of ymm0 first when it is there
+	void PassCoordinates(uint32_t u, uint32_t v) {
+		int uRegister = valueRegister[u];
+		int vRegister = valueRegister[v];
+		if (vRegister == 0) {
+			if (uRegister == 1) {
+				body.Emit(VMOVAPS, 2, 0, Reg(1));
+				uRegister = 2;
+			}
+			body.Emit(VMOVAPS, 1, 0, Reg(0));
+			vRegister = 1;
+		}
+		if (uRegister < 0) {
+			Materialize(u, 0);
+		}
+		else if (uRegister != 0) {
+			body.Emit(VMOVAPS, 0, 0, Reg(uRegister));
+		}
+		if (u == v) {
+			vRegister = vRegister < 0 ? 0 : vRegister;
+		}
+		if (vRegister < 0) {
+			Materialize(v, 1);
+		}
+		else if (vRegister != 1) {
+			body.Emit(VMOVAPS, 1, 0, Reg(vRegister));
+		}
+	}
+
+	// Function to wrap the code into a function, saving the registers the sample calls and the Windows convention need
+	void FinishFunction() {
+		Assembler prologue, epilogue;
+		if (sampling) {
+			const uint8_t SYSTEMV_ARGUMENTS[] = { RDI, RSI, RDX, RCX };
+			const uint8_t WINDOWS_ARGUMENTS[] = { RCX, RDX, R8, R9 };
+			int frameBytes = windows ? WINDOWS_FRAME_BYTES : SYSTEMV_FRAME_BYTES;
+			for (uint8_t reg : CALL_PRESERVED_REGISTERS) {
+				prologue.EmitStack(OPCODE_PUSH, reg);
+			}
+			prologue.EmitInteger(OPCODE_ADD_SUB_IMMEDIATE, 5, Reg(RSP), true, frameBytes);
+			for (int i = 0; i < 4; ++i) {
+				prologue.EmitInteger(OPCODE_MOV_LOAD, CALL_PRESERVED_REGISTERS[i], Reg(windows ? WINDOWS_ARGUMENTS[i] : SYSTEMV_ARGUMENTS[i]));
+			}
+		}
+
+		// Windows preserves the low halves of xmm6 to xmm15
+		if (windows) {
+			for (int reg = FIRST_PRESERVED_REGISTER; reg < VECTOR_REGISTERS; ++reg) {
+				if ((usedRegisters >> reg) & 1) {
+					MachineOperand save = Mem(lanes, static_cast<int32_t>(saveSlot) * SLOT_BYTES + (reg - FIRST_PRESERVED_REGISTER) * 16);
+					prologue.Emit(VMOVUPS_STORE, reg, 0, save, -1, false);
+					epilogue.Emit(VMOVUPS_LOAD, reg, 0, save, -1, false);
+				}
+			}
+		}
+
+		if (sampling) {
+			epilogue.EmitInteger(OPCODE_ADD_SUB_IMMEDIATE, 0, Reg(RSP), true, windows ? WINDOWS_FRAME_BYTES : SYSTEMV_FRAME_BYTES);
+			for (int i = 3; i >= 0; --i) {
+				epilogue.EmitStack(OPCODE_POP, CALL_PRESERVED_REGISTERS[i]);
+			}
+		}
+
+		size_t bodyStart = prologue.bytes.size();
+		shaderCode.code.insert(shaderCode.code.end(), prologue.bytes.begin(), prologue.bytes.end());
+		shaderCode.code.insert(shaderCode.code.end(), body.bytes.begin(), body.bytes.end());
+		shaderCode.code.insert(shaderCode.code.end(), epilogue.bytes.begin(), epilogue.bytes.end());
+		for (const ConstantFixup& fixup : body.fixups) {
+			fixups.push_back({ bodyStart + fixup.position, bodyStart + fixup.end, fixup.entry });
+		}
+
+		// vzeroupper, ret
+		const uint8_t exit[] = { 0xC5, 0xF8, 0x77, 0xC3 };
+		shaderCode.code.insert(shaderCode.code.end(), exit, exit + sizeof(exit));
+	}
+
+	void CompileInstruction(uint32_t position) {
+		const ShaderInstruction& instruction = code[position];
+		uint32_t a = instruction.operands[0];
+		uint32_t b = instruction.operands[1];
+		uint32_t c = instruction.operands[2];
+		int result = -1;
+
+		switch (instruction.op) {
+		case ShaderOp::Load:
+		case ShaderOp::Uniform:
+		case ShaderOp::Literal:
+			// Read where they are used
+			return;
+		case ShaderOp::Store:
+			body.Emit(VMOVUPS_STORE, Register(a, position), 0, Lane(instruction.index));
+			return;
+		case ShaderOp::Add:
+		case ShaderOp::Mul:
+		case ShaderOp::Sub:
+		case ShaderOp::Div:
+		case ShaderOp::Min:
+		case ShaderOp::Max: {
+			// Only the second source can be memory, commutative operations put a register first
+			MachineOperand unused;
+			bool commutative = instruction.op == ShaderOp::Add || instruction.op == ShaderOp::Mul;
+			if (commutative && !InRegister(a) && (InRegister(b) || (MemoryOperand(a, unused) && !MemoryOperand(b, unused)))) {
+				std::swap(a, b);
+			}
+			int first = Register(a, position);
+			MachineOperand second = Any(b, position);
+			const uint32_t operands[2] = { a, b };
+			result = Destination(operands, 2, position);
+			static const Encoding* ENCODINGS[] = { &VADDPS, &VSUBPS, &VMULPS, &VDIVPS, &VMINPS, &VMAXPS };
+			body.Emit(*ENCODINGS[static_cast<int>(instruction.op) - static_cast<int>(ShaderOp::Add)], result, first, second);
+			break;
+		}
+		case ShaderOp::Neg: {
+			int source = Register(a, position);
+			result = Destination(&a, 1, position);
+			body.Emit(VXORPS, result, source, ConstantBits(0x80000000));
+			break;
+		}
+		case ShaderOp::Sqrt: {
+			MachineOperand source = Any(a, position);
+			result = Destination(&a, 1, position);
+			body.Emit(VSQRTPS, result, 0, source);
+			break;
+		}
+		case ShaderOp::Rsqrt:
+			result = CompileRsqrt(a, position);
+			break;
+		case ShaderOp::MulAdd:
+		case ShaderOp::MulSub:
+		case ShaderOp::NegMulAdd:
+			result = CompileFma(instruction.op, a, b, c, position);
+			break;
+		case ShaderOp::Pow:
+			result = CompilePow(a, b, position);
+			break;
+		default:
+			return;
+		}
+		Bind(position, result);
+	}
+
+	int CompileRsqrt(uint32_t a, uint32_t position) {
+		if (!options.approximateRsqrt) {
+			// 1 / sqrt(x)
+			MachineOperand source = Any(a, position);
+			int root = AllocateRegister(position);
+			int one = AllocateRegister(position);
+			body.Emit(VSQRTPS, root, 0, source);
+			body.Emit(VMOVUPS_LOAD, one, 0, Constant(1.0f));
+			body.Emit(VDIVPS, root, one, Reg(root));
+			return root;
+		}
+
+		// r * (1.5 - 0.5 * x * r * r), the Newton-Raphson step of the AVX2 pixel kernel
+		int source = Register(a, position);
+		int estimate = AllocateRegister(position);
+		int half = AllocateRegister(position);
+		int square = AllocateRegister(position);
+		body.Emit(VRSQRTPS, estimate, 0, Reg(source));
+		body.Emit(VMULPS, half, source, Constant(0.5f));
+		body.Emit(VMULPS, square, estimate, Reg(estimate));
+		body.Emit(FmaEncoding(ShaderOp::NegMulAdd, FmaForm::Form213), half, square, Constant(1.5f));
+		body.Emit(VMULPS, half, estimate, Reg(half));
+		return half;
+	}
+
+	int CompileFma(ShaderOp op, uint32_t a, uint32_t b, uint32_t c, uint32_t position) {
+		// The addend is read for the last time: accumulate into its register
+		if (Dies(c, position) && InRegister(c)) {
+			int addend = Register(c, position);
+			if (!InRegister(a) && InRegister(b)) {
+				std::swap(a, b);
+			}
+			int first = Register(a, position);
+			MachineOperand second = Any(b, position);
+			Unbind(addend);
+			body.Emit(FmaEncoding(op, FmaForm::Form231), addend, first, second);
+			return addend;
+		}
+
+		// A factor is read for the last time: multiply into its register
+		if ((Dies(a, position) && InRegister(a)) || (Dies(b, position) && InRegister(b))) {
+			if (!(Dies(a, position) && InRegister(a))) {
+				std::swap(a, b);
+			}
+			int factor = Register(a, position);
+			if (!InRegister(b) && InRegister(c)) {
+				int addend = Register(c, position);
+				MachineOperand second = Any(b, position);
+				Unbind(factor);
+				body.Emit(FmaEncoding(op, FmaForm::Form132), factor, addend, second);
+			}
+			else {
+				int second = Register(b, position);
+				MachineOperand addend = Any(c, position);
+				Unbind(factor);
+				body.Emit(FmaEncoding(op, FmaForm::Form213), factor, second, addend);
+			}
+			return factor;
+		}
+
+		// Every operand lives on: copy the addend
+		if (!InRegister(a) && InRegister(b)) {
+			std::swap(a, b);
+		}
+		int first = Register(a, position);
+		MachineOperand second = Any(b, position);
+		int addend = InRegister(c) ? Register(c, position) : -1;
+		int result = AllocateRegister(position);
+		if (addend >= 0) {
+			body.Emit(VMOVAPS, result, 0, Reg(addend));
+		}
+		else {
+			Materialize(c, result);
+		}
+		body.Emit(FmaEncoding(op, FmaForm::Form231), result, first, second);
+		return result;
+	}
+
+	// Function to generate FastPow(x, y) = 2^(y * log2(x)) like PowAVX2(), bases below the smallest normal give 0
+	int CompilePow(uint32_t a, uint32_t b, uint32_t position) {
+		int x = Register(a, position);
+		MachineOperand y = Any(b, position);
+		int valid = AllocateRegister(position);
+		int mantissa = AllocateRegister(position);
+		int log2 = AllocateRegister(position);
+		int t = AllocateRegister(position);
+		int scratch = AllocateRegister(position);
+		const Encoding FMADD213 = FmaEncoding(ShaderOp::MulAdd, FmaForm::Form213);
+
+		body.Emit(VCMPPS, valid, x, Constant(SMALLEST_NORMAL), COMPARE_GE_OQ);
+		body.Emit(VMOVUPS_LOAD, mantissa, 0, Constant(1.0f));
+		body.Emit(VBLENDVPS, mantissa, mantissa, Reg(x), valid << 4);
+
+		// log2(x) = exponent + log2(mantissa), the mantissa folded into [sqrt(1/2), sqrt(2)]
+		body.Emit(VPSHIFTD, 2, log2, Reg(mantissa), 23);
+		body.Emit(VPSUBD, log2, log2, ConstantBits(127));
+		body.Emit(VCVTDQ2PS, log2, 0, Reg(log2));
+		body.Emit(VANDPS, mantissa, mantissa, ConstantBits(0x7FFFFF));
+		body.Emit(VORPS, mantissa, mantissa, Constant(1.0f));
+		body.Emit(VCMPPS, t, mantissa, Constant(SQRT2), COMPARE_GT_OQ);
+		body.Emit(VMULPS, scratch, mantissa, Constant(0.5f));
+		body.Emit(VBLENDVPS, mantissa, mantissa, Reg(scratch), t << 4);
+		body.Emit(VANDPS, t, t, Constant(1.0f));
+		body.Emit(VADDPS, log2, log2, Reg(t));
+		body.Emit(VSUBPS, t, mantissa, Constant(1.0f));
+		body.Emit(VADDPS, mantissa, mantissa, Constant(1.0f));
+		body.Emit(VDIVPS, t, t, Reg(mantissa));
+		int t2 = mantissa;
+		body.Emit(VMULPS, t2, t, Reg(t));
+		body.Emit(VMOVUPS_LOAD, scratch, 0, Constant(LOG2_C9));
+		const float LOG2_COEFFICIENTS[] = { LOG2_C7, LOG2_C5, LOG2_C3, LOG2_C1 };
+		for (float coefficient : LOG2_COEFFICIENTS) {
+			body.Emit(FMADD213, scratch, t2, Constant(coefficient));
+		}
+		body.Emit(FmaEncoding(ShaderOp::MulAdd, FmaForm::Form231), log2, t, Reg(scratch));
+
+		// 2^(y * log2(x)) = 2^n * 2^f
+		int power = log2;
+		int n = mantissa;
+		body.Emit(VMULPS, power, power, y);
+		body.Emit(VMAXPS, power, power, Constant(-126.0f));
+		body.Emit(VMINPS, power, power, Constant(127.0f));
+		body.Emit(VROUNDPS, n, 0, Reg(power), ROUND_NEAREST);
+		body.Emit(VSUBPS, power, power, Reg(n));
+		int p = t;
+		body.Emit(VMOVUPS_LOAD, p, 0, Constant(EXP2_C7));
+		const float EXP2_COEFFICIENTS[] = { EXP2_C6, EXP2_C5, EXP2_C4, EXP2_C3, EXP2_C2, EXP2_C1, 1.0f };
+		for (float coefficient : EXP2_COEFFICIENTS) {
+			body.Emit(FMADD213, p, power, Constant(coefficient));
+		}
+		body.Emit(VCVTPS2DQ, n, 0, Reg(n));
+		body.Emit(VPADDD, n, n, ConstantBits(127));
+		body.Emit(VPSHIFTD, 6, n, Reg(n), 23);
+		body.Emit(VMULPS, p, p, Reg(n));
+		body.Emit(VANDPS, p, p, Reg(valid));
+		return p;
+	}
+
+	const std::vector<ShaderInstruction>& code;
+	ShaderCompileOptions options;
+	bool windows;
+	JitShaderCode& shaderCode;
+	bool sampling;
+
+	uint8_t lanes;
+	uint8_t blockBases[SHADER_BLOCKS];
+	uint8_t sampler;
+	uint32_t saveSlot;
+	uint32_t nextSlot;
+	std::vector<uint32_t> freeSlots;
+
+	std::vector<std::vector<uint32_t>> uses;
+	std::vector<uint32_t> laneSlot;     // lane register holding a value: inputs, samples and spills
+	std::vector<int> valueRegister;
+	int32_t registerValue[VECTOR_REGISTERS];
+	uint32_t pinned = 0;                // registers the current instruction reads or writes
+	uint32_t usedRegisters = 0;         // registers the function writes
+
+	Assembler body;
+	std::vector<ConstantFixup> fixups;
+	std::vector<uint32_t> constants;
+	std::map<uint32_t, uint32_t> constantEntries;
+};
+
+// Function to translate a program to native code
+void JitCompileShader(const ShaderProgram& program, JitCallingConvention convention, JitShaderCode& shaderCode) {
+	JitCompiler compiler(program, convention, shaderCode);
+	compiler.Compile();
+}
+
+ExecutableMemory::~ExecutableMemory() {
+	Release();
+}
+
+// Function to copy code into executable pages
+bool ExecutableMemory::Load(const uint8_t* code, size_t codeSize) {
+	Release();
+	if (codeSize == 0) {
+		return true;
+	}
+
+#ifdef _WIN32
+	void* pages = VirtualAlloc(nullptr, codeSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (pages == nullptr) {
+		std::cerr << "Failed to allocate executable memory!" << std::endl;
+		return false;
+	}
+	std::memcpy(pages, code, codeSize);
+	DWORD previous;
+	if (!VirtualProtect(pages, codeSize, PAGE_EXECUTE_READ, &previous)) {
+		std::cerr << "Failed to allocate executable memory!" << std::endl;
+		VirtualFree(pages, 0, MEM_RELEASE);
+		return false;
+	}
+	FlushInstructionCache(GetCurrentProcess(), pages, codeSize);
+	mappedSize = codeSize;
+#else
+	size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	size_t pagesSize = (codeSize + pageSize - 1) / pageSize * pageSize;
+	void* pages = mmap(nullptr, pagesSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (pages == MAP_FAILED) {
+		std::cerr << "Failed to allocate executable memory!" << std::endl;
+		return false;
+	}
+	std::memcpy(pages, code, codeSize);
+	if (mprotect(pages, pagesSize, PROT_READ | PROT_EXEC) != 0) {
+		std::cerr << "Failed to allocate executable memory!" << std::endl;
+		munmap(pages, pagesSize);
+		return false;
+	}
+	mappedSize = pagesSize;
+#endif
+
+	data = static_cast<uint8_t*>(pages);
+	size = codeSize;
+	return true;
+}
+
+// Function to release the pages
+void ExecutableMemory::Release() {
+	if (data != nullptr) {
+#ifdef _WIN32
+		VirtualFree(data, 0, MEM_RELEASE);
+#else
+		munmap(data, mappedSize);
+#endif
+	}
+	data = nullptr;
+	size = 0;
+	mappedSize = 0;
+}
+
+#ifdef SHADER_JIT
+static_assert(offsetof(JitSampler, sample) == SAMPLER_FUNCTION_OFFSET && offsetof(JitSampler, context) == SAMPLER_CONTEXT_OFFSET,
+	"JitSampler must match the generated code");
+
+// Entry of native shader code
+typedef void (*JitShaderFunction)(float* lanes, const float* constants, const float* primitive, const JitSampler* sampler);
+
+// Function to run native shader code
+void RunJitShader(const ExecutableMemory& memory, const ShaderInvocation& invocation, const JitSampler* sampler) {
+	JitShaderFunction run = reinterpret_cast<JitShaderFunction>(const_cast<uint8_t*>(memory.Data()));
+	run(invocation.lanes, invocation.blocks[SHADER_CONSTANT_BUFFER], invocation.blocks[SHADER_PRIMITIVE_DATA], sampler);
+}
+#endif
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ShaderInterpreter.h"
+
+// Native shader code is generated for x86-64 with AVX2 and FMA, elsewhere shaders run in the interpreter. On Windows the
+// sampler is called with __vectorcall, which only MSVC compatible compilers have.
+#if defined(_M_X64) || (defined(__x86_64__) && !defined(_WIN32))
+#define SHADER_JIT
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#define JIT_SAMPLE_CALL __vectorcall
+#else
+#define JIT_SAMPLE_CALL
+#endif
+
+// Register conventions native shader code follows. Code is generated for the convention of the running platform,
+// the other one is only there so both can be tested on one machine.
+enum class JitCallingConvention : uint8_t {
+	SystemV,  // arguments in rdi, rsi and rdx, every vector register is scratch
+	Windows   // arguments in rcx, rdx and r8, xmm6 to xmm15 are preserved
+};
+
+#ifdef _WIN32
+const JitCallingConvention NATIVE_CALLING_CONVENTION = JitCallingConvention::Windows;
+#else
+const JitCallingConvention NATIVE_CALLING_CONVENTION = JitCallingConvention::SystemV;
+#endif
+
+// Position-independent native code of a shader, it can be copied or saved and mapped anywhere. The function starts at the
+// first byte: void(float* lanes, const float* constants, const float* primitive, const JitSampler* sampler)
+struct JitShaderCode {
+	JitCallingConvention convention = NATIVE_CALLING_CONVENTION;
+	uint32_t laneSlots = 0;  // lane registers the code needs, stage registers included
+	std::vector<uint8_t> code;
+};
+
+#ifdef SHADER_JIT
+// Samples texture t0 for native shader code: the coordinates arrive in ymm0 and ymm1, the channels go to four lane registers of the shader
+typedef void (JIT_SAMPLE_CALL *JitSampleFunction)(__m256 u, __m256 v, void* context, float rgba[4][SHADER_LANES]);
+
+// Sampler native shader code calls, the layout is part of the generated code
+struct JitSampler {
+	JitSampleFunction sample = nullptr;
+	void* context = nullptr;
+};
+#endif
+
+/// <summary>
+/// Translates a program to one function of AVX2 and FMA machine code working on all eight lanes at once, which calls the sampler itself.
+/// Values live in the 16 vector registers, which are assigned by furthest next use, and spill to lane registers, only values
+/// needed after a sample call are spilled around it.
+/// Rsqrt is refined with one Newton-Raphson step when the options approximate it, everything else, pow included,
+/// returns the same bits as the interpreter.
+/// </summary>
+/// <param name="program">- The program to translate.</param>
+/// <param name="convention">- The calling convention of the generated runs.</param>
+/// <param name="shaderCode">- Receives the code.</param>
+void JitCompileShader(const ShaderProgram& program, JitCallingConvention convention, JitShaderCode& shaderCode);
+
+// Executable copy of native shader code. Pages are mapped writable to copy the code in and then switched to read and execute.
+class ExecutableMemory {
+public:
+	ExecutableMemory() = default;
+	~ExecutableMemory();
+	ExecutableMemory(const ExecutableMemory&) = delete;
+	ExecutableMemory& operator=(const ExecutableMemory&) = delete;
+
+	/// <summary>
+	/// Copies code into fresh executable pages, releasing any code held before.
+	/// </summary>
+	/// <param name="code">- The machine code.</param>
+	/// <param name="size">- Bytes of machine code.</param>
+	/// <returns>True if the code is executable, otherwise false.</returns>
+	bool Load(const uint8_t* code, size_t size);
+
+	/// <summary>
+	/// Releases the pages.
+	/// </summary>
+	void Release();
+
+	const uint8_t* Data() const { return data; }
+	size_t Size() const { return size; }
+
+private:
+	uint8_t* data = nullptr;
+	size_t size = 0;
+	size_t mappedSize = 0;
+};
+
+#ifdef SHADER_JIT
+/// <summary>
+/// Runs native shader code over all lanes. The CPU must support AVX2 and FMA.
+/// </summary>
+/// <param name="memory">- The shader code loaded into executable memory, compiled for the native calling convention.</param>
+/// <param name="invocation">- Lane registers with at least laneSlots entries and constants, the sampler of the invocation is not used.</param>
+/// <param name="sampler">- The sampler the code calls, may be null for shaders that do not sample.</param>
+void RunJitShader(const ExecutableMemory& memory, const ShaderInvocation& invocation, const JitSampler* sampler);
+#endif
@@ -0,0 +1,893 @@
+#include "SoftwareRenderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "EdgeKernels.h"
+#include "PixelShading.h"
+#include "SoftwareShader.h"
+#include "VertexProcessing.h"
+
+// Sub-pixel precision of the rasterizer, same as Direct3D 11 (8 fractional bits)
+static const int SUBPIXEL_BITS = 8;
+static const int SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+
+// Distance in pixels outside the viewport that geometry may reach before it is clipped
+static const float GUARD_BAND = 8192.0f;
+
+// Largest render target edge, keeps guard band coordinates inside the fixed-point range
+static const uint32_t MAX_TARGET_SIZE = 8192;
+
+static const uint32_t BLOCK_SIZE = 8;
+static const uint64_t FULL_BLOCK = ~uint64_t(0);
+static const uint64_t QUAD_MASK = 0x303; // 2x2 pixels at the top-left corner of a block
+static const float DEPTH_SCALE = 16777215.0f;
+static const int64_t DEPTH_MAX = 16777215;
+
+// Slack in 24-bit depth units added to block depth bounds, covers float rounding of the depth plane
+static const int64_t DEPTH_BOUND_MARGIN = 4;
+
+// Work granularity of the parallel binning stage
+static const uint32_t TRIANGLE_CHUNK = 256;
+
+// Index slot of primitives referencing vertices outside the vertex buffer
+static const uint32_t INVALID_SLOT = ~uint32_t(0);
+
+static const int SHADED_VERTEX_FLOATS = sizeof(ShadedVertex) / sizeof(float);
+
+// Per-triangle data needed to rasterize and shade
+struct TriangleSetup {
+	// Edge functions E(px, py) = a * px + b * py + c, evaluated at integer pixel coordinates
+	int32_t a[3];
+	int32_t b[3];
+	int64_t c[3];
+
+	// Inclusive pixel bounds, clamped to the scissor rectangle
+	int minX, minY, maxX, maxY;
+
+	// Planes relative to the first vertex: value = q + dx * (x - originX) + dy * (y - originY)
+	float originX, originY;
+	float depth[3];
+	float minDepth, maxDepth; // depth range of the vertices, clamped to the viewport
+
+	// Interpolation data copied from the (possibly clipped) vertices, the setup outlives the clipper
+	ShadingTriangle shading;
+};
+
+// Pixel rectangle [minX, maxX) x [minY, maxY) that may be written
+struct ScissorRect {
+	int minX, minY, maxX, maxY;
+};
+
+// Hierarchical depth test results, counted per worker and summed into the frame stats
+struct DepthCounters {
+	uint64_t blocks = 0;
+	uint64_t rejected = 0;
+	uint64_t accepted = 0;
+};
+
+// Everything a tile job needs to rasterize and shade
+struct RasterState {
+	SoftwareFramebuffer& framebuffer;
+	const SoftwareViewport& viewport;
+	const PixelShaderConstants& constants;
+	const TextureData& texture;
+	const SamplerDesc& sampler;
+	BlockCoverageFunction blockCoverage;
+	ShadeQuadsFunction shadeQuads;
+	DepthCounters& counters;
+	TexelCache* texelCache;  // null when the draw fetches straight from the texture
+	const SoftwareShader* pixelShader;  // runs instead of shadeQuads when not null
+};
+
+// Scratch memory reused between draws. Binning is done per chunk of triangles so every chunk
+// writes only its own bins, and tiles walk the chunks in order to keep the API draw order.
+struct SoftwareContextData {
+	std::vector<ShadedVertex> shaded;                    // post-transform vertices of the current draw
+
+	// Post-transform vertex cache of indexed draws, entries are valid while their tag equals cacheDraw
+	std::vector<uint32_t> cacheTag;                      // [vertex] -> draw that last shaded the vertex
+	std::vector<uint32_t> cacheSlot;                     // [vertex] -> index into shaded
+	std::vector<SimpleVertex> cachedVertices;            // vertices to shade, in order of first reference
+	std::vector<uint32_t> indexSlots;                    // [index] -> index into shaded, or INVALID_SLOT
+	uint32_t cacheDraw = 0;
+
+	std::vector<std::vector<TriangleSetup>> chunkSetups; // [chunk] -> triangles set up by the chunk
+	std::vector<std::vector<uint32_t>> bins;             // [chunk * tileCount + tile] -> indices into chunkSetups[chunk]
+	std::vector<DepthCounters> depthCounters;            // [worker]
+	std::vector<std::unique_ptr<TexelCache>> texelCaches; // [worker], reset at the start of every tile
+};
+
+SoftwareContext::SoftwareContext() = default;
+SoftwareContext::~SoftwareContext() = default;
+
+// Function to compute the signed distance of a clip-space position to a clip plane (inside when >= 0)
+static float PlaneDistance(const float position[4], int plane, float guardX, float guardY) {
+	switch (plane) {
+	case 0: return position[2];                           // near, z >= 0
+	case 1: return position[3] - position[2];             // far, z <= w
+	case 2: return guardX * position[3] + position[0];    // left guard band
+	case 3: return guardX * position[3] - position[0];    // right guard band
+	case 4: return guardY * position[3] + position[1];    // bottom guard band
+	default: return guardY * position[3] - position[1];   // top guard band
+	}
+}
+
+// Function to clip a triangle against the near, far and guard band planes, returns the polygon vertex count
+static int ClipTriangle(const ShadedVertex* input[3], ShadedVertex* polygon, ShadedVertex* scratch, float guardX, float guardY) {
+	// Clip only against planes that at least one vertex is outside of
+	int clipMask = 0;
+	for (int plane = 0; plane < 6; ++plane) {
+		for (int i = 0; i < 3; ++i) {
+			if (PlaneDistance(input[i]->position, plane, guardX, guardY) < 0.0f) {
+				clipMask |= 1 << plane;
+			}
+		}
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		polygon[i] = *input[i];
+	}
+	int count = 3;
+
+	for (int plane = 0; plane < 6 && count > 0; ++plane) {
+		if ((clipMask & (1 << plane)) == 0) {
+			continue;
+		}
+
+		int outCount = 0;
+		for (int i = 0; i < count; ++i) {
+			const ShadedVertex& current = polygon[i];
+			const ShadedVertex& next = polygon[(i + 1) % count];
+			float dCurrent = PlaneDistance(current.position, plane, guardX, guardY);
+			float dNext = PlaneDistance(next.position, plane, guardX, guardY);
+
+			if (dCurrent >= 0.0f) {
+				scratch[outCount++] = current;
+			}
+
+			// Emit the intersection when the edge crosses the plane
+			if ((dCurrent >= 0.0f) != (dNext >= 0.0f)) {
+				float t = dCurrent / (dCurrent - dNext);
+				const float* a = reinterpret_cast<const float*>(&current);
+				const float* b = reinterpret_cast<const float*>(&next);
+				float* out = reinterpret_cast<float*>(&scratch[outCount++]);
+				for (int f = 0; f < SHADED_VERTEX_FLOATS; ++f) {
+					out[f] = a[f] + (b[f] - a[f]) * t;
+				}
+			}
+		}
+
+		std::copy(scratch, scratch + outCount, polygon);
+		count = outCount;
+	}
+
+	return count;
+}
+
+// Function to round a screen position to the fixed-point sub-pixel grid
+static int32_t ToFixed(float value) {
+	return static_cast<int32_t>(std::lround(value * SUBPIXEL_ONE));
+}
+
+// Function to set up edge functions and interpolation planes, returns false if the triangle is culled or empty
+static bool SetupTriangle(const ShadedVertex* vertex[3], const float screen[3][3], const ScissorRect& scissor, TriangleSetup& setup) {
+	int32_t x[3], y[3];
+	for (int i = 0; i < 3; ++i) {
+		x[i] = ToFixed(screen[i][0]);
+		y[i] = ToFixed(screen[i][1]);
+	}
+
+	// Clockwise triangles in screen space are front facing, cull everything else and degenerate triangles
+	int64_t area = static_cast<int64_t>(x[1] - x[0]) * (y[2] - y[0]) - static_cast<int64_t>(x[2] - x[0]) * (y[1] - y[0]);
+	if (area <= 0) {
+		return false;
+	}
+
+	// Bounding box of the pixel centers covered by the triangle
+	int32_t minFixedX = std::min({ x[0], x[1], x[2] });
+	int32_t maxFixedX = std::max({ x[0], x[1], x[2] });
+	int32_t minFixedY = std::min({ y[0], y[1], y[2] });
+	int32_t maxFixedY = std::max({ y[0], y[1], y[2] });
+	const int32_t half = SUBPIXEL_ONE / 2;
+	setup.minX = std::max(scissor.minX, (minFixedX - half) >> SUBPIXEL_BITS);
+	setup.maxX = std::min(scissor.maxX - 1, (maxFixedX - half) >> SUBPIXEL_BITS);
+	setup.minY = std::max(scissor.minY, (minFixedY - half) >> SUBPIXEL_BITS);
+	setup.maxY = std::min(scissor.maxY - 1, (maxFixedY - half) >> SUBPIXEL_BITS);
+	if (setup.minX > setup.maxX || setup.minY > setup.maxY) {
+		return false;
+	}
+
+	// Edge i is opposite to vertex i, positive inside the triangle
+	for (int i = 0; i < 3; ++i) {
+		int from = (i + 1) % 3;
+		int to = (i + 2) % 3;
+		int32_t a = y[from] - y[to];
+		int32_t b = x[to] - x[from];
+		int64_t c = -(static_cast<int64_t>(a) * x[from] + static_cast<int64_t>(b) * y[from]);
+
+		// Top-left fill rule, samples exactly on other edges are not covered
+		bool topLeft = a > 0 || (a == 0 && b > 0);
+		int64_t bias = topLeft ? 0 : -1;
+
+		// Evaluate at pixel centers and fold the sub-pixel scale into the constant:
+		// a * (px * one + one / 2) + b * (py * one + one / 2) + c >= 0  <=>  a * px + b * py + floor(d / one) >= 0
+		int64_t d = static_cast<int64_t>(a + b) * half + c + bias;
+		setup.a[i] = a;
+		setup.b[i] = b;
+		setup.c[i] = d >> SUBPIXEL_BITS;
+	}
+
+	// Interpolation planes in floating point, derived from the snapped positions
+	double fx[3], fy[3];
+	for (int i = 0; i < 3; ++i) {
+		fx[i] = static_cast<double>(x[i]) / SUBPIXEL_ONE;
+		fy[i] = static_cast<double>(y[i]) / SUBPIXEL_ONE;
+	}
+	double invArea = static_cast<double>(SUBPIXEL_ONE) * SUBPIXEL_ONE / static_cast<double>(area);
+	double dx1 = fx[1] - fx[0], dy1 = fy[1] - fy[0];
+	double dx2 = fx[2] - fx[0], dy2 = fy[2] - fy[0];
+
+	auto makePlane = [&](double q0, double q1, double q2, float plane[3]) {
+		double d1 = q1 - q0;
+		double d2 = q2 - q0;
+		plane[0] = static_cast<float>(q0);
+		plane[1] = static_cast<float>((d1 * dy2 - d2 * dy1) * invArea);
+		plane[2] = static_cast<float>((d2 * dx1 - d1 * dx2) * invArea);
+	};
+
+	double invW[3];
+	for (int i = 0; i < 3; ++i) {
+		invW[i] = 1.0 / vertex[i]->position[3];
+	}
+	float invWPlane[3], b1OverW[3], b2OverW[3];
+
+	setup.originX = static_cast<float>(fx[0]);
+	setup.originY = static_cast<float>(fy[0]);
+	makePlane(screen[0][2], screen[1][2], screen[2][2], setup.depth);
+	setup.minDepth = std::min({ screen[0][2], screen[1][2], screen[2][2] });
+	setup.maxDepth = std::max({ screen[0][2], screen[1][2], screen[2][2] });
+	makePlane(invW[0], invW[1], invW[2], invWPlane);
+	makePlane(0.0, invW[1], 0.0, b1OverW);
+	makePlane(0.0, 0.0, invW[2], b2OverW);
+
+	SetupShadingTriangle(vertex, invWPlane, b1OverW, b2OverW, setup.shading);
+	return true;
+}
+
+// Function to build the mask of block pixels inside [minX, maxX] x [minY, maxY] (block relative, inclusive)
+static uint64_t RectMask(int minX, int minY, int maxX, int maxY) {
+	uint64_t rowMask = ((uint64_t(1) << (maxX - minX + 1)) - 1) << minX;
+	uint64_t mask = 0;
+	for (int row = minY; row <= maxY; ++row) {
+		mask |= rowMask << (row * BLOCK_SIZE);
+	}
+	return mask;
+}
+
+// Function to convert a float in [0, 1] to an 8-bit UNORM value
+static uint32_t ToUnorm8(float value) {
+	value = std::min(std::max(value, 0.0f), 1.0f);
+	return static_cast<uint32_t>(value * 255.0f + 0.5f);
+}
+
+// Function to compute conservative 24-bit depth bounds of a triangle inside an 8x8 block
+static void BlockDepthBounds(const TriangleSetup& setup, int blockX, int blockY, const SoftwareViewport& viewport, int64_t& minimum, int64_t& maximum) {
+	// The depth plane is linear, so its extremes over the block lie on the outer pixel centers
+	float x0 = blockX + 0.5f - setup.originX;
+	float y0 = blockY + 0.5f - setup.originY;
+	float z00 = setup.depth[0] + setup.depth[1] * x0 + setup.depth[2] * y0;
+	float stepX = setup.depth[1] * (BLOCK_SIZE - 1);
+	float stepY = setup.depth[2] * (BLOCK_SIZE - 1);
+	float zMin = z00 + std::min(stepX, 0.0f) + std::min(stepY, 0.0f);
+	float zMax = z00 + std::max(stepX, 0.0f) + std::max(stepY, 0.0f);
+
+	zMin = std::max({ zMin, setup.minDepth, viewport.minDepth });
+	zMax = std::min({ zMax, setup.maxDepth, viewport.maxDepth });
+
+	minimum = std::max<int64_t>(static_cast<int64_t>(std::floor(zMin * DEPTH_SCALE)) - DEPTH_BOUND_MARGIN, 0);
+	maximum = std::min<int64_t>(static_cast<int64_t>(std::ceil(zMax * DEPTH_SCALE)) + DEPTH_BOUND_MARGIN, DEPTH_MAX);
+}
+
+// Function to depth test and shade the covered pixels of an 8x8 block
+static void ShadeBlock(RasterState& state, const TriangleSetup& setup, int blockX, int blockY, uint64_t mask) {
+	SoftwareFramebuffer& framebuffer = state.framebuffer;
+	uint32_t tileSize = framebuffer.tileSize;
+	uint32_t tileIndex = (blockY / tileSize) * framebuffer.tilesX + blockX / tileSize;
+	uint32_t localX = blockX % tileSize;
+	uint32_t localY = blockY % tileSize;
+	size_t base = static_cast<size_t>(tileIndex) * tileSize * tileSize + localY * tileSize + localX;
+	size_t block = static_cast<size_t>(tileIndex) * (tileSize / BLOCK_SIZE) * (tileSize / BLOCK_SIZE) + (localY / BLOCK_SIZE) * (tileSize / BLOCK_SIZE) + localX / BLOCK_SIZE;
+	uint32_t* color = &framebuffer.color[base];
+	uint32_t* depth = &framebuffer.depth[base];
+
+	// Coarse depth test against the block bounds
+	int64_t triangleMin, triangleMax;
+	BlockDepthBounds(setup, blockX, blockY, state.viewport, triangleMin, triangleMax);
+	++state.counters.blocks;
+	if (triangleMin >= framebuffer.blockMaxDepth[block]) {
+		++state.counters.rejected;
+		return;
+	}
+
+	// Every sample is nearer than everything stored, skip the per-pixel depth reads
+	bool accepted = triangleMax < framebuffer.blockMinDepth[block];
+	if (accepted) {
+		++state.counters.accepted;
+	}
+
+	// A fast cleared block only gets its texels when a pixel may survive next to untouched ones
+	if (framebuffer.blockUniform[block] != 0) {
+		if (!(accepted && mask == FULL_BLOCK)) {
+			uint32_t value = framebuffer.blockMaxDepth[block];
+			for (uint32_t row = 0; row < BLOCK_SIZE; ++row) {
+				std::fill_n(depth + row * tileSize, BLOCK_SIZE, value);
+			}
+		}
+		framebuffer.blockUniform[block] = 0;
+	}
+
+	// Depth test LESS against the 24-bit depth buffer, collecting the pixels to shade
+	uint64_t written = 0;
+	while (mask != 0) {
+		int bit = 0;
+		while ((mask & (uint64_t(1) << bit)) == 0) {
+			++bit;
+		}
+		mask &= mask - 1;
+
+		int row = bit / BLOCK_SIZE;
+		int column = bit % BLOCK_SIZE;
+		float x = blockX + column + 0.5f - setup.originX;
+		float y = blockY + row + 0.5f - setup.originY;
+
+		float z = setup.depth[0] + setup.depth[1] * x + setup.depth[2] * y;
+		z = std::min(std::max(z, state.viewport.minDepth), state.viewport.maxDepth);
+		uint32_t quantized = static_cast<uint32_t>(z * DEPTH_SCALE + 0.5f);
+		size_t offset = row * tileSize + column;
+		if (!accepted && quantized >= depth[offset]) {
+			continue;
+		}
+
+		depth[offset] = quantized;
+		written |= uint64_t(1) << bit;
+	}
+
+	// Shade the 2x2 quads holding written pixels two at a time, uncovered pixels run as helper lanes
+	float x[SHADING_BATCH], y[SHADING_BATCH];
+	uint32_t shaded[SHADING_BATCH];
+	uint64_t quadMasks[2];
+	int quadOffsets[2];
+	int batched = 0;
+	for (int quad = 0; quad < 16; ++quad) {
+		int quadX = (quad % 4) * 2;
+		int quadY = (quad / 4) * 2;
+		uint64_t quadMask = written & (QUAD_MASK << (quadY * BLOCK_SIZE + quadX));
+		if (quadMask != 0) {
+			for (int lane = 0; lane < 4; ++lane) {
+				x[batched * 4 + lane] = blockX + quadX + (lane & 1) + 0.5f - setup.originX;
+				y[batched * 4 + lane] = blockY + quadY + (lane >> 1) + 0.5f - setup.originY;
+			}
+			quadMasks[batched] = quadMask;
+			quadOffsets[batched] = quadY * BLOCK_SIZE + quadX;
+			++batched;
+		}
+
+		if (batched == 2 || (quad == 15 && batched != 0)) {
+			// A lone quad is shaded twice rather than with undefined lanes
+			if (batched == 1) {
+				std::copy(x, x + 4, x + 4);
+				std::copy(y, y + 4, y + 4);
+				quadMasks[1] = 0;
+			}
+			if (state.pixelShader != nullptr) {
+				state.pixelShader->ShadeQuads(setup.shading, x, y, state.constants, state.texture, state.sampler, state.texelCache, shaded);
+			}
+			else {
+				state.shadeQuads(setup.shading, x, y, state.constants, state.texture, state.sampler, state.texelCache, shaded);
+			}
+
+			for (int i = 0; i < 2; ++i) {
+				for (int lane = 0; lane < 4; ++lane) {
+					int bit = quadOffsets[i] + (lane >> 1) * BLOCK_SIZE + (lane & 1);
+					if ((quadMasks[i] & (uint64_t(1) << bit)) != 0) {
+						color[(bit / BLOCK_SIZE) * tileSize + bit % BLOCK_SIZE] = shaded[i * 4 + lane];
+					}
+				}
+			}
+			batched = 0;
+		}
+	}
+
+	// Refresh the block bounds from the texels
+	if (written != 0) {
+		uint32_t minimum = depth[0];
+		uint32_t maximum = depth[0];
+		for (uint32_t row = 0; row < BLOCK_SIZE; ++row) {
+			for (uint32_t column = 0; column < BLOCK_SIZE; ++column) {
+				minimum = std::min(minimum, depth[row * tileSize + column]);
+				maximum = std::max(maximum, depth[row * tileSize + column]);
+			}
+		}
+		framebuffer.blockMinDepth[block] = minimum;
+		framebuffer.blockMaxDepth[block] = maximum;
+	}
+}
+
+// Function to materialize a fast cleared tile before it is first drawn to
+static void PrepareTile(SoftwareFramebuffer& framebuffer, uint32_t tile) {
+	if (framebuffer.tileCleared[tile] == 0) {
+		return;
+	}
+
+	size_t tilePixels = static_cast<size_t>(framebuffer.tileSize) * framebuffer.tileSize;
+	size_t tileBlocks = tilePixels / (BLOCK_SIZE * BLOCK_SIZE);
+	std::fill_n(&framebuffer.color[tile * tilePixels], tilePixels, framebuffer.clearColor);
+	std::fill_n(&framebuffer.blockMinDepth[tile * tileBlocks], tileBlocks, framebuffer.clearDepth);
+	std::fill_n(&framebuffer.blockMaxDepth[tile * tileBlocks], tileBlocks, framebuffer.clearDepth);
+	std::fill_n(&framebuffer.blockUniform[tile * tileBlocks], tileBlocks, 1);
+	framebuffer.tileCleared[tile] = 0;
+}
+
+// Function to rasterize the part of a triangle inside one tile in 8x8 blocks
+static void RasterizeTriangle(RasterState& state, const TriangleSetup& setup, int tileX, int tileY) {
+	const int tileSize = static_cast<int>(state.framebuffer.tileSize);
+	const int64_t span = BLOCK_SIZE - 1;
+
+	int startX = std::max(setup.minX, tileX * tileSize) & ~(BLOCK_SIZE - 1);
+	int startY = std::max(setup.minY, tileY * tileSize) & ~(BLOCK_SIZE - 1);
+	int endX = std::min(setup.maxX, tileX * tileSize + tileSize - 1);
+	int endY = std::min(setup.maxY, tileY * tileSize + tileSize - 1);
+
+	for (int blockY = startY; blockY <= endY; blockY += BLOCK_SIZE) {
+		for (int blockX = startX; blockX <= endX; blockX += BLOCK_SIZE) {
+			int32_t e[3], a[3], b[3];
+			bool rejected = false;
+
+			// Classify the block against each edge using the extreme corners
+			for (int i = 0; i < 3 && !rejected; ++i) {
+				int64_t value = static_cast<int64_t>(setup.a[i]) * blockX + static_cast<int64_t>(setup.b[i]) * blockY + setup.c[i];
+				int64_t minimum = value + std::min(setup.a[i], 0) * span + std::min(setup.b[i], 0) * span;
+				int64_t maximum = value + std::max(setup.a[i], 0) * span + std::max(setup.b[i], 0) * span;
+
+				if (maximum < 0) {
+					rejected = true;
+				}
+				else if (minimum >= 0) {
+					// Edge covers the whole block, drop it from the per-pixel test
+					e[i] = 0;
+					a[i] = 0;
+					b[i] = 0;
+				}
+				else {
+					e[i] = static_cast<int32_t>(value);
+					a[i] = setup.a[i];
+					b[i] = setup.b[i];
+				}
+			}
+			if (rejected) {
+				continue;
+			}
+
+			uint64_t mask = state.blockCoverage(e, a, b);
+
+			// Clip blocks that straddle the bounding box or scissor rectangle
+			int localMinX = std::max(setup.minX - blockX, 0);
+			int localMinY = std::max(setup.minY - blockY, 0);
+			int localMaxX = std::min(setup.maxX - blockX, static_cast<int>(BLOCK_SIZE) - 1);
+			int localMaxY = std::min(setup.maxY - blockY, static_cast<int>(BLOCK_SIZE) - 1);
+			if (localMinX != 0 || localMinY != 0 || localMaxX != BLOCK_SIZE - 1 || localMaxY != BLOCK_SIZE - 1) {
+				mask &= RectMask(localMinX, localMinY, localMaxX, localMaxY);
+			}
+
+			if (mask != 0) {
+				ShadeBlock(state, setup, blockX, blockY, mask);
+			}
+		}
+	}
+}
+
+// Function to clip, project and set up a single triangle, appending the resulting triangles to setups
+static void ClipAndSetupTriangle(const SoftwareViewport& viewport, const ScissorRect& scissor, const ShadedVertex* triangle[3], std::vector<TriangleSetup>& setups) {
+	// Trivially reject triangles fully outside one of the frustum planes
+	for (int plane = 0; plane < 6; ++plane) {
+		int outside = 0;
+		for (int i = 0; i < 3; ++i) {
+			if (PlaneDistance(triangle[i]->position, plane, 1.0f, 1.0f) < 0.0f) {
+				++outside;
+			}
+		}
+		if (outside == 3) {
+			return;
+		}
+	}
+
+	float guardX = GUARD_BAND / (0.5f * viewport.width) + 1.0f;
+	float guardY = GUARD_BAND / (0.5f * viewport.height) + 1.0f;
+	ShadedVertex polygon[9], scratch[9];
+	int count = ClipTriangle(triangle, polygon, scratch, guardX, guardY);
+	if (count < 3) {
+		return;
+	}
+
+	// Project to screen space
+	float screen[9][3];
+	for (int i = 0; i < count; ++i) {
+		float invW = 1.0f / polygon[i].position[3];
+		screen[i][0] = (polygon[i].position[0] * invW + 1.0f) * 0.5f * viewport.width + viewport.topLeftX;
+		screen[i][1] = (1.0f - polygon[i].position[1] * invW) * 0.5f * viewport.height + viewport.topLeftY;
+		screen[i][2] = viewport.minDepth + polygon[i].position[2] * invW * (viewport.maxDepth - viewport.minDepth);
+	}
+
+	// Triangulate the clipped polygon as a fan
+	for (int i = 1; i + 1 < count; ++i) {
+		const ShadedVertex* vertex[3] = { &polygon[0], &polygon[i], &polygon[i + 1] };
+		const float fanScreen[3][3] = {
+			{ screen[0][0], screen[0][1], screen[0][2] },
+			{ screen[i][0], screen[i][1], screen[i][2] },
+			{ screen[i + 1][0], screen[i + 1][1], screen[i + 1][2] }
+		};
+
+		setups.emplace_back();
+		if (!SetupTriangle(vertex, fanScreen, scissor, setups.back())) {
+			setups.pop_back();
+		}
+	}
+}
+
+// Function to append a triangle to the bins of every tile it may touch
+static void BinTriangle(const SoftwareFramebuffer& framebuffer, const TriangleSetup& setup, uint32_t setupIndex, std::vector<uint32_t>* bins) {
+	const int tileSize = static_cast<int>(framebuffer.tileSize);
+
+	for (int tileY = setup.minY / tileSize; tileY <= setup.maxY / tileSize; ++tileY) {
+		for (int tileX = setup.minX / tileSize; tileX <= setup.maxX / tileSize; ++tileX) {
+			// Skip tiles of the bounding box that lie completely outside one of the edges
+			int64_t spanX = std::min(setup.maxX, tileX * tileSize + tileSize - 1) - std::max(setup.minX, tileX * tileSize);
+			int64_t spanY = std::min(setup.maxY, tileY * tileSize + tileSize - 1) - std::max(setup.minY, tileY * tileSize);
+			int64_t originX = std::max(setup.minX, tileX * tileSize);
+			int64_t originY = std::max(setup.minY, tileY * tileSize);
+
+			bool outside = false;
+			for (int i = 0; i < 3 && !outside; ++i) {
+				int64_t maximum = setup.a[i] * originX + setup.b[i] * originY + setup.c[i]
+					+ std::max(setup.a[i], 0) * spanX + std::max(setup.b[i], 0) * spanY;
+				outside = maximum < 0;
+			}
+
+			if (!outside) {
+				bins[tileY * framebuffer.tilesX + tileX].push_back(setupIndex);
+			}
+		}
+	}
+}
+
+// Function to set viewport dimensions
+void SetSoftwareViewport(SoftwareViewport& viewport, uint32_t width, uint32_t height) {
+	viewport.topLeftX = 0;
+	viewport.topLeftY = 0;
+	viewport.width = static_cast<float>(width);
+	viewport.height = static_cast<float>(height);
+	viewport.minDepth = 0;
+	viewport.maxDepth = 1;
+}
+
+// Function to create the software renderer context
+bool CreateSoftwareContext(uint32_t threadCount, SoftwareContext& context) {
+	context.pool = std::make_unique<ThreadPool>(threadCount);
+	context.data = std::make_unique<SoftwareContextData>();
+	context.simdLevel = DetectSimdLevel();
+	context.stats = SoftwareFrameStats();
+
+	// The pixel shader has always sampled the base level, keep it unless a draw asks for filtering
+	context.sampler = SamplerDesc();
+	context.sampler.filter = SamplerFilter::Bilinear;
+	context.sampler.maxLod = 0.0f;
+	return true;
+}
+
+// Function to create the tiled render targets
+bool CreateSoftwareFramebuffer(uint32_t width, uint32_t height, uint32_t tileSize, SoftwareFramebuffer& framebuffer) {
+	if (width == 0 || height == 0 || width > MAX_TARGET_SIZE || height > MAX_TARGET_SIZE) {
+		std::cerr << "Unsupported software framebuffer size: " << width << "x" << height << std::endl;
+		return false;
+	}
+
+	if (tileSize == 0 || tileSize % BLOCK_SIZE != 0) {
+		std::cerr << "Tile size must be a non-zero multiple of " << BLOCK_SIZE << "!" << std::endl;
+		return false;
+	}
+
+	framebuffer.width = width;
+	framebuffer.height = height;
+	framebuffer.tileSize = tileSize;
+	framebuffer.tilesX = (width + tileSize - 1) / tileSize;
+	framebuffer.tilesY = (height + tileSize - 1) / tileSize;
+
+	size_t pixelCount = static_cast<size_t>(framebuffer.tilesX) * framebuffer.tilesY * tileSize * tileSize;
+	framebuffer.color.assign(pixelCount, 0);
+	framebuffer.depth.assign(pixelCount, 0);
+
+	size_t blockCount = pixelCount / (BLOCK_SIZE * BLOCK_SIZE);
+	framebuffer.blockMinDepth.assign(blockCount, 0);
+	framebuffer.blockMaxDepth.assign(blockCount, 0);
+	framebuffer.blockUniform.assign(blockCount, 0);
+	framebuffer.tileCleared.assign(static_cast<size_t>(framebuffer.tilesX) * framebuffer.tilesY, 0);
+	return true;
+}
+
+// Function to clear the render targets
+void ClearSoftwareFramebuffer(SoftwareFramebuffer& framebuffer, const float clearColor[4], float clearDepth) {
+	// Fast clear, tiles are filled when a triangle first touches them or when resolving
+	framebuffer.clearColor = (ToUnorm8(clearColor[3]) << 24) | (ToUnorm8(clearColor[0]) << 16) | (ToUnorm8(clearColor[1]) << 8) | ToUnorm8(clearColor[2]);
+	framebuffer.clearDepth = static_cast<uint32_t>(std::min(std::max(clearDepth, 0.0f), 1.0f) * DEPTH_SCALE + 0.5f);
+	std::fill(framebuffer.tileCleared.begin(), framebuffer.tileCleared.end(), 1);
+}
+
+// Function to count the triangles of a primitive list or strip
+static uint32_t TriangleCount(PrimitiveTopology topology, uint32_t count) {
+	if (topology == PrimitiveTopology::TriangleStrip) {
+		return count < 3 ? 0 : count - 2;
+	}
+	return count / 3;
+}
+
+// Function to look up the shaded vertices of a triangle, returns false if it references an invalid index
+static bool AssembleTriangle(PrimitiveTopology topology, const std::vector<ShadedVertex>& shaded, const uint32_t* slots, uint32_t triangle, const ShadedVertex* vertex[3]) {
+	uint32_t first = topology == PrimitiveTopology::TriangleStrip ? triangle : triangle * 3;
+	uint32_t slot[3];
+	for (int i = 0; i < 3; ++i) {
+		slot[i] = slots != nullptr ? slots[first + i] : first + i;
+		if (slot[i] == INVALID_SLOT) {
+			return false;
+		}
+	}
+
+	// Odd triangles of a strip swap their first two vertices to keep the winding
+	if (topology == PrimitiveTopology::TriangleStrip && triangle % 2 == 1) {
+		std::swap(slot[0], slot[1]);
+	}
+
+	for (int i = 0; i < 3; ++i) {
+		vertex[i] = &shaded[slot[i]];
+	}
+	return true;
+}
+
+// Function to read an index from an index buffer
+static uint32_t ReadIndex(const void* indices, IndexFormat format, uint32_t i) {
+	if (format == IndexFormat::UInt16) {
+		return static_cast<const uint16_t*>(indices)[i];
+	}
+	return static_cast<const uint32_t*>(indices)[i];
+}
+
+// Function to bin, rasterize and shade the primitives of a draw whose vertices are already in data.shaded
+static void DrawPrimitives(SoftwareContext& context, SoftwareFramebuffer& framebuffer, const SoftwareViewport& viewport, PrimitiveTopology topology,
+	const uint32_t* slots, uint32_t count, const PixelShaderConstants& psConstants, const TextureData& texture) {
+	using Clock = std::chrono::high_resolution_clock;
+	SoftwareContextData& data = *context.data;
+	SoftwareFrameStats& stats = context.stats;
+	uint32_t tileCount = framebuffer.tilesX * framebuffer.tilesY;
+	stats.tileTime.resize(tileCount, 0.0);
+	stats.tileTriangles.resize(tileCount, 0);
+
+	// Pixels outside the viewport and render target are never written
+	ScissorRect scissor;
+	scissor.minX = std::max(0, static_cast<int>(viewport.topLeftX));
+	scissor.minY = std::max(0, static_cast<int>(viewport.topLeftY));
+	scissor.maxX = std::min(static_cast<int>(framebuffer.width), static_cast<int>(viewport.topLeftX + viewport.width));
+	scissor.maxY = std::min(static_cast<int>(framebuffer.height), static_cast<int>(viewport.topLeftY + viewport.height));
+
+	// Assemble the primitives, set up the triangles and bin them to tiles, one chunk of triangles per task
+	auto binningStart = Clock::now();
+	uint32_t triangleCount = TriangleCount(topology, count);
+	uint32_t chunkCount = (triangleCount + TRIANGLE_CHUNK - 1) / TRIANGLE_CHUNK;
+	data.chunkSetups.resize(chunkCount);
+	data.bins.resize(static_cast<size_t>(chunkCount) * tileCount);
+
+	context.pool->ParallelFor(chunkCount, [&](uint32_t chunk, uint32_t) {
+		std::vector<TriangleSetup>& setups = data.chunkSetups[chunk];
+		std::vector<uint32_t>* bins = &data.bins[static_cast<size_t>(chunk) * tileCount];
+		setups.clear();
+		for (uint32_t tile = 0; tile < tileCount; ++tile) {
+			bins[tile].clear();
+		}
+
+		uint32_t end = std::min(triangleCount, (chunk + 1) * TRIANGLE_CHUNK);
+		for (uint32_t i = chunk * TRIANGLE_CHUNK; i < end; ++i) {
+			const ShadedVertex* triangle[3];
+			if (!AssembleTriangle(topology, data.shaded, slots, i, triangle)) {
+				continue;
+			}
+
+			size_t first = setups.size();
+			ClipAndSetupTriangle(viewport, scissor, triangle, setups);
+			for (size_t setup = first; setup < setups.size(); ++setup) {
+				BinTriangle(framebuffer, setups[setup], static_cast<uint32_t>(setup), bins);
+			}
+		}
+	});
+
+	// Rasterize and shade every tile on a single thread, so the framebuffer needs no locks
+	auto rasterStart = Clock::now();
+	BlockCoverageFunction blockCoverage = SelectBlockCoverage(context.simdLevel);
+	PixelPipelineKey pipeline = GetPixelPipelineKey(psConstants, texture, context.sampler);
+	ShadeQuadsFunction shadeQuads = SelectPixelPipeline(context.simdLevel, pipeline);
+	data.depthCounters.assign(context.pool->WorkerCount(), DepthCounters());
+	bool cacheTexels = pipeline.textured && !pipeline.filtered && (context.texelCacheMode == TexelCacheMode::All ||
+		(context.texelCacheMode == TexelCacheMode::Compressed && texture.format != TexelFormat::RGBA8));
+	while (data.texelCaches.size() < context.pool->WorkerCount()) {
+		data.texelCaches.push_back(std::make_unique<TexelCache>());
+	}
+	for (std::unique_ptr<TexelCache>& texelCache : data.texelCaches) {
+		texelCache->ClearCounters();
+	}
+	context.pool->ParallelFor(tileCount, [&](uint32_t tile, uint32_t worker) {
+		auto tileStart = Clock::now();
+		int tileX = static_cast<int>(tile % framebuffer.tilesX);
+		int tileY = static_cast<int>(tile / framebuffer.tilesX);
+		uint32_t triangles = 0;
+		TexelCache* texelCache = nullptr;
+		if (cacheTexels) {
+			texelCache = data.texelCaches[worker].get();
+			texelCache->Reset(texture);
+		}
+		RasterState state = { framebuffer, viewport, psConstants, texture, context.sampler, blockCoverage, shadeQuads, data.depthCounters[worker], texelCache,
+			context.pixelShader.get() };
+
+		for (uint32_t chunk = 0; chunk < chunkCount; ++chunk) {
+			const std::vector<TriangleSetup>& setups = data.chunkSetups[chunk];
+			for (uint32_t setup : data.bins[static_cast<size_t>(chunk) * tileCount + tile]) {
+				if (triangles++ == 0) {
+					PrepareTile(framebuffer, tile);
+				}
+				RasterizeTriangle(state, setups[setup], tileX, tileY);
+			}
+		}
+
+		std::chrono::duration<double> tileTime = Clock::now() - tileStart;
+		stats.tileTime[tile] += tileTime.count();
+		stats.tileTriangles[tile] += triangles;
+	});
+	auto rasterEnd = Clock::now();
+
+	stats.binningTime += std::chrono::duration<double>(rasterStart - binningStart).count();
+	stats.rasterTime += std::chrono::duration<double>(rasterEnd - rasterStart).count();
+
+	for (const DepthCounters& counters : data.depthCounters) {
+		stats.depthBlocks += counters.blocks;
+		stats.depthBlocksRejected += counters.rejected;
+		stats.depthBlocksAccepted += counters.accepted;
+	}
+	for (const std::unique_ptr<TexelCache>& texelCache : data.texelCaches) {
+		stats.texelCacheHits += texelCache->Counters().hits;
+		stats.texelCacheMisses += texelCache->Counters().misses;
+	}
+}
+
+// Function to run the vertex stage of a draw with the loaded vertex shader, or the vertex kernel when none is loaded
+static void RunVertexStage(SoftwareContext& context, const SimpleVertex* input, uint32_t count, const VertexShaderConstants& constants, ShadedVertex* output) {
+	if (context.vertexShader) {
+		ProcessVertices(*context.pool, *context.vertexShader, input, count, constants, output);
+	}
+	else {
+		ProcessVertices(*context.pool, SelectShadeVertices(context.simdLevel), input, count, constants, output);
+	}
+}
+
+// Function to draw non-indexed primitives
+void SoftwareDraw(SoftwareContext& context, SoftwareFramebuffer& framebuffer, const SoftwareViewport& viewport, const SimpleVertex* vertices, uint32_t vertexCount,
+	PrimitiveTopology topology, const VertexShaderConstants& vsConstants, const PixelShaderConstants& psConstants, const TextureData& texture) {
+	if (TriangleCount(topology, vertexCount) == 0) {
+		return;
+	}
+
+	// Run the vertex shader once per vertex
+	auto vertexStart = std::chrono::high_resolution_clock::now();
+	SoftwareContextData& data = *context.data;
+	data.shaded.resize(vertexCount);
+	RunVertexStage(context, vertices, vertexCount, vsConstants, data.shaded.data());
+	context.stats.vertexTime += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - vertexStart).count();
+	context.stats.draws.push_back({ vertexCount, vertexCount });
+
+	DrawPrimitives(context, framebuffer, viewport, topology, nullptr, vertexCount, psConstants, texture);
+}
+
+// Function to draw indexed primitives
+void SoftwareDrawIndexed(SoftwareContext& context, SoftwareFramebuffer& framebuffer, const SoftwareViewport& viewport, const SimpleVertex* vertices, uint32_t vertexCount,
+	const void* indices, IndexFormat indexFormat, uint32_t indexCount, PrimitiveTopology topology,
+	const VertexShaderConstants& vsConstants, const PixelShaderConstants& psConstants, const TextureData& texture) {
+	if (TriangleCount(topology, indexCount) == 0) {
+		return;
+	}
+
+	auto vertexStart = std::chrono::high_resolution_clock::now();
+	SoftwareContextData& data = *context.data;
+
+	// New tag per draw so the cache never needs clearing
+	if (++data.cacheDraw == 0) {
+		std::fill(data.cacheTag.begin(), data.cacheTag.end(), 0);
+		data.cacheDraw = 1;
+	}
+	if (data.cacheTag.size() < vertexCount) {
+		data.cacheTag.resize(vertexCount, 0);
+		data.cacheSlot.resize(vertexCount);
+	}
+
+	// Post-transform vertex cache: the first reference to a vertex queues it for shading, later ones reuse its slot.
+	// Indices outside the vertex buffer (including strip cut values) drop the triangles using them.
+	data.cachedVertices.clear();
+	data.indexSlots.resize(indexCount);
+	uint32_t references = 0;
+	for (uint32_t i = 0; i < indexCount; ++i) {
+		uint32_t index = ReadIndex(indices, indexFormat, i);
+		if (index >= vertexCount) {
+			data.indexSlots[i] = INVALID_SLOT;
+			continue;
+		}
+
+		if (data.cacheTag[index] != data.cacheDraw) {
+			data.cacheTag[index] = data.cacheDraw;
+			data.cacheSlot[index] = static_cast<uint32_t>(data.cachedVertices.size());
+			data.cachedVertices.push_back(vertices[index]);
+		}
+		data.indexSlots[i] = data.cacheSlot[index];
+		++references;
+	}
+
+	// Run the vertex shader once per referenced vertex
+	uint32_t shadedCount = static_cast<uint32_t>(data.cachedVertices.size());
+	data.shaded.resize(shadedCount);
+	RunVertexStage(context, data.cachedVertices.data(), shadedCount, vsConstants, data.shaded.data());
+	context.stats.vertexTime += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - vertexStart).count();
+	context.stats.draws.push_back({ references, shadedCount });
+
+	DrawPrimitives(context, framebuffer, viewport, topology, data.indexSlots.data(), indexCount, psConstants, texture);
+}
+
+// Function to render the scene
+void SoftwareRender(SoftwareContext& context, SoftwareFramebuffer& framebuffer, const SoftwareViewport& viewport, const Mesh& mesh,
+	const VertexShaderConstants& vsConstants, const PixelShaderConstants& psConstants, const TextureData& texture) {
+	context.stats = SoftwareFrameStats();
+
+	// Clear the render target and depth buffer
+	float clearColor[4] = { 0, 0, 0, 0 };
+	ClearSoftwareFramebuffer(framebuffer, clearColor, 1.0f);
+
+	// Draw the mesh
+	uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	if (mesh.indexCount != 0) {
+		SoftwareDrawIndexed(context, framebuffer, viewport, mesh.vertices.data(), vertexCount, mesh.indexData.data(), mesh.indexFormat, mesh.indexCount,
+			mesh.topology, vsConstants, psConstants, texture);
+	}
+	else {
+		SoftwareDraw(context, framebuffer, viewport, mesh.vertices.data(), vertexCount, mesh.topology, vsConstants, psConstants, texture);
+	}
+}
+
+// Function to copy the tiled color target into a linear image
+void ResolveSoftwareFramebuffer(const SoftwareFramebuffer& framebuffer, std::vector<uint32_t>& pixels) {
+	uint32_t tileSize = framebuffer.tileSize;
+	pixels.resize(static_cast<size_t>(framebuffer.width) * framebuffer.height);
+
+	for (uint32_t tileY = 0; tileY < framebuffer.tilesY; ++tileY) {
+		for (uint32_t tileX = 0; tileX < framebuffer.tilesX; ++tileX) {
+			size_t tileIndex = static_cast<size_t>(tileY) * framebuffer.tilesX + tileX;
+			const uint32_t* tile = &framebuffer.color[tileIndex * tileSize * tileSize];
+			uint32_t rows = std::min(tileSize, framebuffer.height - tileY * tileSize);
+			uint32_t columns = std::min(tileSize, framebuffer.width - tileX * tileSize);
+
+			for (uint32_t row = 0; row < rows; ++row) {
+				uint32_t* destination = &pixels[static_cast<size_t>(tileY * tileSize + row) * framebuffer.width + tileX * tileSize];
+				if (framebuffer.tileCleared[tileIndex] != 0) {
+					std::fill_n(destination, columns, framebuffer.clearColor);
+				}
+				else {
+					std::copy(tile + row * tileSize, tile + row * tileSize + columns, destination);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "Geometry.h"
+#include "ShaderConstants.h"
+#include "TexelCache.h"
+#include "TextureSampler.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+// Mirrors D3D11_VIEWPORT so the viewport produced for the device can be reused as is
+struct SoftwareViewport {
+	float topLeftX;
+	float topLeftY;
+	float width;
+	float height;
+	float minDepth;
+	float maxDepth;
+};
+
+/// <summary>
+/// Converts a D3D11_VIEWPORT, such as the one filled by SetViewport(), to a software viewport.
+/// Works with any type exposing the same members so this header does not depend on d3d11.h.
+/// </summary>
+/// <param name="viewport">- The viewport to convert.</param>
+/// <returns>The equivalent software viewport.</returns>
+template <typename Viewport>
+SoftwareViewport ToSoftwareViewport(const Viewport& viewport) {
+	return { viewport.TopLeftX, viewport.TopLeftY, viewport.Width, viewport.Height, viewport.MinDepth, viewport.MaxDepth };
+}
+
+// Tiled render targets, every tile stores tileSize x tileSize pixels contiguously (row-major inside the tile)
+struct SoftwareFramebuffer {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t tileSize = 0;
+	uint32_t tilesX = 0;
+	uint32_t tilesY = 0;
+	std::vector<uint32_t> color; // B8G8R8A8_UNORM, same format as the swap chain
+	std::vector<uint32_t> depth; // 24-bit UNORM depth, same precision as D24_UNORM_S8_UINT
+
+	// Hierarchical depth, one entry per 8x8 block in the same tile-major order as the pixels
+	std::vector<uint32_t> blockMinDepth;
+	std::vector<uint32_t> blockMaxDepth;
+	std::vector<uint8_t> blockUniform; // set while the block texels are stale and all equal blockMaxDepth
+
+	// Fast clear, flagged tiles hold the clear values and are filled on first use
+	std::vector<uint8_t> tileCleared;
+	uint32_t clearColor = 0;
+	uint32_t clearDepth = 0;
+};
+
+// Vertex reuse of a single draw
+struct SoftwareDrawStats {
+	uint32_t vertexReferences = 0; // vertices referenced by the primitives, indices that hit or miss the vertex cache
+	uint32_t shadedVertices = 0;   // vertices run through the vertex shader, the vertex cache misses
+};
+
+// Timings of the last rendered frame, used to tune the tile size and thread count
+struct SoftwareFrameStats {
+	double vertexTime = 0.0;             // seconds spent running the vertex shader
+	double binningTime = 0.0;            // seconds spent clipping, setting up and binning triangles
+	double rasterTime = 0.0;             // seconds spent rasterizing and shading all tiles
+	std::vector<double> tileTime;        // seconds spent rasterizing and shading each tile
+	std::vector<uint32_t> tileTriangles; // triangles binned to each tile
+
+	uint64_t depthBlocks = 0;            // 8x8 blocks tested against the hierarchical depth
+	uint64_t depthBlocksRejected = 0;    // blocks skipped because every sample is occluded
+	uint64_t depthBlocksAccepted = 0;    // blocks written without per-pixel depth reads
+
+	uint64_t texelCacheHits = 0;         // texel fetches served by the texel caches
+	uint64_t texelCacheMisses = 0;       // 4x4 texel blocks read from textures by the texel caches
+
+	std::vector<SoftwareDrawStats> draws; // one entry per draw, in submission order
+};
+
+struct SoftwareContextData;
+class SoftwareShader;
+
+// Worker threads and per-draw scratch memory of the software renderer, similar to a device context
+struct SoftwareContext {
+	std::unique_ptr<ThreadPool> pool;
+	std::unique_ptr<SoftwareContextData> data;
+	SoftwareFrameStats stats;
+	SimdLevel simdLevel = SimdLevel::Scalar; // kernels used by draws, lowered to what the CPU supports
+	TexelCacheMode texelCacheMode = TexelCacheMode::Compressed; // textures fetched through the per-thread texel caches
+	SamplerDesc sampler;                     // sampler state of draws, base level bilinear with wrap addressing after CreateSoftwareContext()
+	std::unique_ptr<SoftwareShader> vertexShader; // shaders loaded at runtime, null runs the built-in kernels
+	std::unique_ptr<SoftwareShader> pixelShader;
+
+	SoftwareContext();
+	~SoftwareContext();
+};
+
+/// <summary>
+/// Sets the viewport dimensions, equivalent to SetViewport() for the Direct3D path.
+/// </summary>
+/// <param name="viewport">- Reference to the viewport.</param>
+/// <param name="width">- Width of the render target.</param>
+/// <param name="height">- Height of the render target.</param>
+void SetSoftwareViewport(SoftwareViewport& viewport, uint32_t width, uint32_t height);
+
+/// <summary>
+/// Starts the worker threads used by the software renderer and selects the fastest SIMD kernels.
+/// </summary>
+/// <param name="threadCount">- Number of threads rasterizing tiles, 0 uses all hardware threads.</param>
+/// <param name="context">- Reference to the context to be created.</param>
+/// <returns>True if the context was created, otherwise false.</returns>
+bool CreateSoftwareContext(uint32_t threadCount, SoftwareContext& context);
+
+/// <summary>
+/// Creates the tiled color and depth targets for the software renderer.
+/// </summary>
+/// <param name="width">- Width of the render target.</param>
+/// <param name="height">- Height of the render target.</param>
+/// <param name="tileSize">- Edge length of a tile in pixels, must be a non-zero multiple of 8.</param>
+/// <param name="framebuffer">- Reference to the framebuffer to be created.</param>
+/// <returns>True if the framebuffer was created, otherwise false.</returns>
+bool CreateSoftwareFramebuffer(uint32_t width, uint32_t height, uint32_t tileSize, SoftwareFramebuffer& framebuffer);
+
+/// <summary>
+/// Clears the color and depth targets, equivalent to ClearRenderTargetView() and ClearDepthStencilView().
+/// Only marks the tiles as cleared, their memory is written when a triangle first touches them.
+/// </summary>
+/// <param name="framebuffer">- The framebuffer to clear.</param>
+/// <param name="clearColor">- RGBA clear color.</param>
+/// <param name="clearDepth">- Depth clear value in the range [0, 1].</param>
+void ClearSoftwareFramebuffer(SoftwareFramebuffer& framebuffer, const float clearColor[4], float clearDepth);
+
+/// <summary>
+/// Draws non-indexed primitives with the CPU equivalents of VertexShader.hlsl and PixelShader.hlsl, or the shaders loaded
+/// into the context, using the default rasterizer and depth-stencil states (back-face culling, depth test LESS).
+/// Triangles are binned to tiles and the tiles are rasterized in parallel, each by a single thread.
+/// Timings are added to the context stats.
+/// </summary>
+/// <param name="context">- The context running the draw.</param>
+/// <param name="framebuffer">- The render targets to draw into.</param>
+/// <param name="viewport">- The viewport to map clip space onto.</param>
+/// <param name="vertices">- The vertices of the primitives.</param>
+/// <param name="vertexCount">- Number of vertices to draw.</param>
+/// <param name="topology">- Triangle list or strip.</param>
+/// <param name="vsConstants">- Vertex shader constants.</param>
+/// <param name="psConstants">- Pixel shader constants.</param>
+/// <param name="texture">- The texture sampled by the pixel shader.</param>
+void SoftwareDraw(SoftwareContext& context, SoftwareFramebuffer& framebuffer, const SoftwareViewport& viewport, const SimpleVertex* vertices, uint32_t vertexCount,
+	PrimitiveTopology topology, const VertexShaderConstants& vsConstants, const PixelShaderConstants& psConstants, const TextureData& texture);
+
+/// <summary>
+/// Draws indexed primitives like SoftwareDraw(), equivalent to DrawIndexed(). A post-transform vertex cache shades
+/// every referenced vertex once, no matter how many primitives share it. Primitives using an index outside the
+/// vertex buffer are skipped, strip cut values are not supported.
+/// </summary>
+/// <param name="context">- The context running the draw.</param>
+/// <param name="framebuffer">- The render targets to draw into.</param>
+/// <param name="viewport">- The viewport to map clip space onto.</param>
+/// <param name="vertices">- The vertex buffer.</param>
+/// <param name="vertexCount">- Number of vertices in the vertex buffer.</param>
+/// <param name="indices">- The 16- or 32-bit index buffer.</param>
+/// <param name="indexFormat">- Format of the indices.</param>
+/// <param name="indexCount">- Number of indices to draw.</param>
+/// <param name="topology">- Triangle list or strip.</param>
+/// <param name="vsConstants">- Vertex shader constants.</param>
+/// <param name="psConstants">- Pixel shader constants.</param>
+/// <param name="texture">- The texture sampled by the pixel shader.</param>
+void SoftwareDrawIndexed(SoftwareContext& context, SoftwareFramebuffer& framebuffer, const SoftwareViewport& viewport, const SimpleVertex* vertices, uint32_t vertexCount,
+	const void* indices, IndexFormat indexFormat, uint32_t indexCount, PrimitiveTopology topology,
+	const VertexShaderConstants& vsConstants, const PixelShaderConstants& psConstants, const TextureData& texture);
+
+/// <summary>
+/// Renders the scene on the CPU, performing the same pass as Render(). Resets the context stats.
+/// </summary>
+/// <param name="context">- The context running the pass.</param>
+/// <param name="framebuffer">- The render targets to draw into.</param>
+/// <param name="viewport">- The viewport to map clip space onto.</param>
+/// <param name="mesh">- The mesh to draw, indexed or not.</param>
+/// <param name="vsConstants">- Vertex shader constants.</param>
+/// <param name="psConstants">- Pixel shader constants.</param>
+/// <param name="texture">- The texture sampled by the pixel shader.</param>
+void SoftwareRender(SoftwareContext& context, SoftwareFramebuffer& framebuffer, const SoftwareViewport& viewport, const Mesh& mesh,
+	const VertexShaderConstants& vsConstants, const PixelShaderConstants& psConstants, const TextureData& texture);
+
+/// <summary>
+/// Copies the tiled color target into a linear, row-major B8G8R8A8 image.
+/// </summary>
+/// <param name="framebuffer">- The framebuffer to resolve.</param>
+/// <param name="pixels">- Receives width * height pixels.</param>
+void ResolveSoftwareFramebuffer(const SoftwareFramebuffer& framebuffer, std::vector<uint32_t>& pixels);
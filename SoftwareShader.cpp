@@ -0,0 +1,233 @@
+#include "SoftwareShader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "SoftwareRenderer.h"
+
+// Texture state a pixel shader samples through
+struct ShaderSampleContext {
+	const TextureData* texture;
+	const SamplerDesc* sampler;
+	TexelCache* texelCache;
+};
+
+// Function to sample for a shader like the scalar kernel
+static void SampleScalar(void* context, const float u[SHADER_LANES], const float v[SHADER_LANES], float rgba[4][SHADER_LANES]) {
+	const ShaderSampleContext& sampleContext = *static_cast<const ShaderSampleContext*>(context);
+	SampleQuadsScalar(*sampleContext.texture, *sampleContext.sampler, sampleContext.texelCache, u, v, rgba);
+}
+
+#ifdef SIMD_X86
+// Function to sample for a shader like the AVX2 kernels
+static void SampleAVX2(void* context, const float u[SHADER_LANES], const float v[SHADER_LANES], float rgba[4][SHADER_LANES]) {
+	const ShaderSampleContext& sampleContext = *static_cast<const ShaderSampleContext*>(context);
+	SampleQuadsAVX2(*sampleContext.texture, *sampleContext.sampler, sampleContext.texelCache, u, v, rgba);
+}
+#endif
+
+#ifdef SHADER_JIT
+// Function native shader code calls to sample like the AVX2 kernels, the coordinates stay in vector registers
+SIMD_TARGET_AVX2 static void JIT_SAMPLE_CALL SampleJit(__m256 u, __m256 v, void* context, float rgba[4][SHADER_LANES]) {
+	const ShaderSampleContext& sampleContext = *static_cast<const ShaderSampleContext*>(context);
+	SampleLanesAVX2(*sampleContext.texture, *sampleContext.sampler, sampleContext.texelCache, u, v, rgba);
+}
+#endif
+
+// Function to load a shader
+bool SoftwareShader::Load(const std::string& source, ShaderStage stage, ShaderBackend backend, SimdLevel level, ShaderCache* cache) {
+	SimdLevel available = DetectSimdLevel();
+	simdLevel = level > available ? available : level;
+
+	ShaderCompileOptions options;
+	options.fuseMultiplyAdd = stage == ShaderStage::Pixel;
+	options.approximateRsqrt = stage == ShaderStage::Pixel;
+	bool native = false;
+#ifdef SHADER_JIT
+	native = backend == ShaderBackend::Jit && simdLevel >= SimdLevel::AVX2;
+#else
+	(void)backend;
+#endif
+
+	jit = false;
+	memory.Release();
+	if (cache != nullptr) {
+		if (!cache->Load(source, stage, options, native, program, jitCode)) {
+			return false;
+		}
+	}
+	else {
+		if (!CompileShader(source, stage, options, program)) {
+			return false;
+		}
+		jitCode = JitShaderCode();
+		if (native) {
+			JitCompileShader(program, NATIVE_CALLING_CONVENTION, jitCode);
+		}
+	}
+
+	laneSlots = GetInterpreterLaneSlots(program);
+	if (native) {
+		if (!memory.Load(jitCode.code.data(), jitCode.code.size())) {
+			return false;
+		}
+		jit = true;
+		laneSlots = jitCode.laneSlots;
+	}
+	return true;
+}
+
+// Function to read and load a shader file
+bool SoftwareShader::LoadFile(const std::string& filePath, ShaderStage stage, ShaderBackend backend, SimdLevel level, ShaderCache* cache) {
+	std::ifstream reader(filePath, std::ios::binary);
+	if (!reader) {
+		std::cerr << "Could not open file: " << filePath << std::endl;
+		return false;
+	}
+	std::stringstream source;
+	source << reader.rdbuf();
+	return Load(source.str(), stage, backend, level, cache);
+}
+
+// Lane registers of one lane slot, aligned for vector loads and stores
+struct alignas(32) ShaderLaneSlot {
+	float lanes[SHADER_LANES];
+};
+
+// Function to get the lane registers of the calling thread, shared by all shaders it runs
+float* SoftwareShader::GetLanes() const {
+	thread_local std::vector<ShaderLaneSlot> slots;
+	if (slots.size() < laneSlots) {
+		slots.resize(laneSlots);
+	}
+	return slots[0].lanes;
+}
+
+// Function to run a shader that does not sample with its backend
+void SoftwareShader::Run(ShaderInvocation& invocation) const {
+#ifdef SHADER_JIT
+	if (jit) {
+		RunJitShader(memory, invocation, nullptr);
+		return;
+	}
+#endif
+	InterpretShader(program, invocation);
+}
+
+// Function to shade a batch with a pixel shader
+void SoftwareShader::ShadeQuads(const ShadingTriangle& triangle, const float x[SHADING_BATCH], const float y[SHADING_BATCH],
+	const PixelShaderConstants& constants, const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache, uint32_t color[SHADING_BATCH]) const {
+	float* lanes = GetLanes();
+	std::memcpy(lanes + PIXEL_X_SLOT * SHADER_LANES, x, SHADING_BATCH * sizeof(float));
+	std::memcpy(lanes + PIXEL_Y_SLOT * SHADER_LANES, y, SHADING_BATCH * sizeof(float));
+
+	ShaderSampleContext sampleContext = { &texture, &sampler, texelCache };
+	ShaderInvocation invocation;
+	invocation.lanes = lanes;
+	invocation.blocks[SHADER_CONSTANT_BUFFER] = reinterpret_cast<const float*>(&constants);
+	invocation.blocks[SHADER_PRIMITIVE_DATA] = reinterpret_cast<const float*>(&triangle);
+	invocation.sample = SampleScalar;
+	invocation.sampleContext = &sampleContext;
+	const float (*rgba)[SHADER_LANES] = reinterpret_cast<const float(*)[SHADER_LANES]>(lanes + PIXEL_OUTPUT_SLOT * SHADER_LANES);
+
+#ifdef SHADER_JIT
+	if (jit) {
+		// Native code calls the sampler itself
+		JitSampler jitSampler;
+		jitSampler.sample = SampleJit;
+		jitSampler.context = &sampleContext;
+		RunJitShader(memory, invocation, &jitSampler);
+		PackColorsAVX2(rgba, color);
+		return;
+	}
+#endif
+#ifdef SIMD_X86
+	if (simdLevel >= SimdLevel::AVX2) {
+		invocation.sample = SampleAVX2;
+		InterpretShader(program, invocation);
+		PackColorsAVX2(rgba, color);
+		return;
+	}
+#endif
+	InterpretShader(program, invocation);
+	PackColorsScalar(rgba, color);
+}
+
+// Function to shade vertices with a vertex shader, eight at a time in structure-of-arrays form
+void SoftwareShader::ShadeVertices(const SimpleVertex* input, uint32_t count, const VertexShaderConstants& constants, ShadedVertex* output) const {
+	const uint32_t INPUT_FLOATS = sizeof(SimpleVertex) / sizeof(float);
+	const uint32_t OUTPUT_FLOATS = sizeof(ShadedVertex) / sizeof(float);
+	float* lanes = GetLanes();
+	ShaderInvocation invocation;
+	invocation.lanes = lanes;
+	invocation.blocks[SHADER_CONSTANT_BUFFER] = &constants.worldMatrix[0][0];
+	invocation.blocks[SHADER_PRIMITIVE_DATA] = nullptr;
+	invocation.sample = nullptr;
+	invocation.sampleContext = nullptr;
+
+	for (uint32_t first = 0; first < count; first += SHADER_LANES) {
+		// The last block repeats its last vertex in the unused lanes
+		uint32_t batch = std::min(count - first, SHADER_LANES);
+		for (uint32_t lane = 0; lane < SHADER_LANES; ++lane) {
+			const float* vertex = reinterpret_cast<const float*>(&input[first + std::min(lane, batch - 1)]);
+			for (uint32_t i = 0; i < INPUT_FLOATS; ++i) {
+				lanes[(VERTEX_INPUT_SLOT + i) * SHADER_LANES + lane] = vertex[i];
+			}
+		}
+
+		// Outputs the shader leaves alone, the padding included, stay zero
+		std::fill_n(lanes + VERTEX_OUTPUT_SLOT * SHADER_LANES, OUTPUT_FLOATS * SHADER_LANES, 0.0f);
+		Run(invocation);
+
+		for (uint32_t lane = 0; lane < batch; ++lane) {
+			float* vertex = reinterpret_cast<float*>(&output[first + lane]);
+			for (uint32_t i = 0; i < OUTPUT_FLOATS; ++i) {
+				vertex[i] = lanes[(VERTEX_OUTPUT_SLOT + i) * SHADER_LANES + lane];
+			}
+		}
+	}
+}
+
+// Function to get the name of a shader backend
+const char* ShaderBackendName(ShaderBackend backend) {
+	switch (backend) {
+	case ShaderBackend::Jit: return "jit";
+	case ShaderBackend::Interpreter: return "interpreter";
+	default: return "native";
+	}
+}
+
+// Function to parse a shader backend name
+bool ParseShaderBackend(const char* name, ShaderBackend& backend) {
+	const ShaderBackend backends[] = { ShaderBackend::Native, ShaderBackend::Jit, ShaderBackend::Interpreter };
+	for (ShaderBackend candidate : backends) {
+		if (std::strcmp(name, ShaderBackendName(candidate)) == 0) {
+			backend = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Function to load VertexShader.hlsl and PixelShader.hlsl into the context for a shader backend, the native backend unloads them
+bool LoadSoftwareShaders(SoftwareContext& context, ShaderBackend backend, ShaderCache* cache) {
+	context.vertexShader.reset();
+	context.pixelShader.reset();
+	if (backend == ShaderBackend::Native) {
+		return true;
+	}
+	std::unique_ptr<SoftwareShader> vertexShader = std::make_unique<SoftwareShader>();
+	std::unique_ptr<SoftwareShader> pixelShader = std::make_unique<SoftwareShader>();
+	if (!vertexShader->LoadFile("VertexShader.hlsl", ShaderStage::Vertex, backend, context.simdLevel, cache) ||
+		!pixelShader->LoadFile("PixelShader.hlsl", ShaderStage::Pixel, backend, context.simdLevel, cache)) {
+		return false;
+	}
+	context.vertexShader = std::move(vertexShader);
+	context.pixelShader = std::move(pixelShader);
+	return true;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "CpuFeatures.h"
+#include "Geometry.h"
+#include "PixelShading.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderConstants.h"
+#include "ShaderJit.h"
+
+struct SoftwareContext;
+
+// How the software renderer runs shaders
+enum class ShaderBackend {
+	Native,      // the kernels written for VertexShader.hlsl and PixelShader.hlsl, no shader is loaded
+	Jit,         // shaders translated to machine code at load time, interpreted where AVX2 is not available
+	Interpreter  // shaders interpreted one IR instruction at a time
+};
+
+// A vertex or pixel shader loaded from HLSL at runtime, run by the software renderer instead of its built-in kernels.
+// Pixel shaders shade the same batches as ShadeQuadsFunction kernels and sample like them, vertex shaders fill
+// ShadedVertex from SimpleVertex eight vertices at a time. The shader is immutable once loaded and shared by all threads.
+class SoftwareShader {
+public:
+	SoftwareShader() = default;
+	SoftwareShader(const SoftwareShader&) = delete;
+	SoftwareShader& operator=(const SoftwareShader&) = delete;
+
+	/// <summary>
+	/// Compiles a shader and, for the JIT backend on CPUs with AVX2, translates it to machine code.
+	/// Vertex shaders are compiled without contraction and with exact rsqrt so they round like the vertex kernels,
+	/// pixel shaders with fused multiply-add and approximated rsqrt like the AVX2 pixel kernel.
+	/// </summary>
+	/// <param name="source">- The HLSL source.</param>
+	/// <param name="stage">- The stage the shader runs in.</param>
+	/// <param name="backend">- Jit or Interpreter.</param>
+	/// <param name="level">- The SIMD level of the renderer, lowered to what the CPU supports.</param>
+	/// <param name="cache">- Cache of compiled shaders looked up before compiling, or null to always compile.</param>
+	/// <returns>True if the shader was loaded, otherwise false.</returns>
+	bool Load(const std::string& source, ShaderStage stage, ShaderBackend backend, SimdLevel level, ShaderCache* cache);
+
+	/// <summary>
+	/// Reads a shader file and loads it, see Load().
+	/// </summary>
+	/// <param name="filePath">- The HLSL file.</param>
+	/// <param name="stage">- The stage the shader runs in.</param>
+	/// <param name="backend">- Jit or Interpreter.</param>
+	/// <param name="level">- The SIMD level of the renderer.</param>
+	/// <param name="cache">- Cache of compiled shaders, or null.</param>
+	/// <returns>True if the shader was loaded, otherwise false.</returns>
+	bool LoadFile(const std::string& filePath, ShaderStage stage, ShaderBackend backend, SimdLevel level, ShaderCache* cache);
+
+	/// <summary>
+	/// Runs a pixel shader for a batch of two quads, with the arguments and output of a ShadeQuadsFunction kernel.
+	/// </summary>
+	void ShadeQuads(const ShadingTriangle& triangle, const float x[SHADING_BATCH], const float y[SHADING_BATCH],
+		const PixelShaderConstants& constants, const TextureData& texture, const SamplerDesc& sampler, TexelCache* texelCache, uint32_t color[SHADING_BATCH]) const;
+
+	/// <summary>
+	/// Runs a vertex shader on count vertices, with the arguments and output of a ShadeVerticesFunction kernel.
+	/// </summary>
+	void ShadeVertices(const SimpleVertex* input, uint32_t count, const VertexShaderConstants& constants, ShadedVertex* output) const;
+
+	ShaderStage Stage() const { return program.stage; }
+	bool IsJit() const { return jit; }
+	const ShaderProgram& Program() const { return program; }
+	const JitShaderCode& Code() const { return jitCode; }
+
+private:
+	float* GetLanes() const;
+	void Run(ShaderInvocation& invocation) const;
+
+	ShaderProgram program;
+	JitShaderCode jitCode;
+	ExecutableMemory memory;
+	uint32_t laneSlots = 0;
+	bool jit = false;
+	SimdLevel simdLevel = SimdLevel::Scalar;
+};
+
+/// <summary>
+/// Returns a printable name for a shader backend.
+/// </summary>
+/// <param name="backend">- The backend.</param>
+/// <returns>"native", "jit" or "interpreter".</returns>
+const char* ShaderBackendName(ShaderBackend backend);
+
+/// <summary>
+/// Parses a shader backend name as returned by ShaderBackendName().
+/// </summary>
+/// <param name="name">- The name to parse.</param>
+/// <param name="backend">- Receives the parsed backend.</param>
+/// <returns>True if the name is known, otherwise false.</returns>
+bool ParseShaderBackend(const char* name, ShaderBackend& backend);
+
+/// <summary>
+/// Loads VertexShader.hlsl and PixelShader.hlsl into a software context, replacing the built-in kernels of its draws.
+/// </summary>
+/// <param name="context">- The context to load the shaders into, at its SIMD level.</param>
+/// <param name="backend">- How the shaders run, Native unloads them and restores the built-in kernels.</param>
+/// <param name="cache">- Shader cache compiled shaders are loaded from and stored in, may be null.</param>
+/// <returns>True if the shaders were loaded, otherwise false.</returns>
+bool LoadSoftwareShaders(SoftwareContext& context, ShaderBackend backend, ShaderCache* cache);
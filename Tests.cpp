@@ -0,0 +1,819 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "AssetArchive.h"
+#include "BlockCompression.h"
+#include "CpuFeatures.h"
+#include "Geometry.h"
+#include "LZCompression.h"
+#include "MeshFile.h"
+#include "MipChain.h"
+#include "PixelShading.h"
+#include "ShaderCompiler.h"
+#include "ShaderConstants.h"
+#include "ShaderJit.h"
+#include "SoftwareRenderer.h"
+#include "SoftwareShader.h"
+#include "TextureCache.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+#include "VertexProcessing.h"
+
+// Checks run and checks failed, a failure makes the test run exit with an error
+static uint32_t checkCount = 0;
+static uint32_t failureCount = 0;
+
+// Function to record a check, printing it when it fails
+static bool Check(bool passed, const std::string& what) {
+	++checkCount;
+	if (!passed) {
+		++failureCount;
+		std::cerr << "FAILED: " << what << std::endl;
+	}
+	return passed;
+}
+
+// Function to fill a buffer with bytes that do not compress
+static std::vector<unsigned char> RandomBytes(size_t size, uint32_t seed) {
+	std::mt19937 random(seed);
+	std::vector<unsigned char> bytes(size);
+	for (unsigned char& byte : bytes) {
+		byte = static_cast<unsigned char>(random());
+	}
+	return bytes;
+}
+
+// Function to build a texture of smooth gradients with a little noise, close to photographic content
+static TextureData CreateGradientTexture(int width, int height, uint32_t seed) {
+	std::mt19937 random(seed);
+	TextureData texture;
+	texture.width = width;
+	texture.height = height;
+	texture.pixels.resize(static_cast<size_t>(width) * height * 4);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			unsigned char* texel = &texture.pixels[(static_cast<size_t>(y) * width + x) * 4];
+			int noise = static_cast<int>(random() % 9) - 4;
+			texel[0] = static_cast<unsigned char>(std::min(std::max(x * 255 / width + noise, 0), 255));
+			texel[1] = static_cast<unsigned char>(std::min(std::max(y * 255 / height + noise, 0), 255));
+			texel[2] = static_cast<unsigned char>(std::min(std::max((x + y) * 127 / (width + height) + 64 + noise, 0), 255));
+			texel[3] = 255;
+		}
+	}
+	return texture;
+}
+
+// Function to compare the levels of two textures byte for byte
+static bool TexturesEqual(const TextureData& a, const TextureData& b) {
+	if (a.width != b.width || a.height != b.height || a.format != b.format || a.pixels != b.pixels || a.mips.size() != b.mips.size()) {
+		return false;
+	}
+	for (size_t level = 0; level < a.mips.size(); ++level) {
+		if (a.mips[level].width != b.mips[level].width || a.mips[level].height != b.mips[level].height || a.mips[level].pixels != b.mips[level].pixels) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Function to compute the PSNR of the RGB channels of two RGBA8 images of the same size
+static double ComputePSNR(const TexelBuffer& a, const TexelBuffer& b) {
+	double squaredError = 0.0;
+	size_t samples = 0;
+	for (size_t i = 0; i < a.size() && i < b.size(); ++i) {
+		if (i % 4 == 3) {
+			continue;
+		}
+		double difference = static_cast<double>(a[i]) - b[i];
+		squaredError += difference * difference;
+		++samples;
+	}
+	if (squaredError == 0.0) {
+		return 99.0;
+	}
+	return 10.0 * std::log10(255.0 * 255.0 * samples / squaredError);
+}
+
+// Function to write an uncompressed 32-bit TGA, an image format the texture loader decodes without loss
+static bool WriteTGA(const std::string& filePath, const TextureData& texture) {
+	std::ofstream writer(filePath, std::ios::binary | std::ios::trunc);
+	if (!writer.is_open()) {
+		std::cerr << "Could not open file: " << filePath << std::endl;
+		return false;
+	}
+	unsigned char header[18] = {};
+	header[2] = 2;  // uncompressed true color
+	header[12] = static_cast<unsigned char>(texture.width);
+	header[13] = static_cast<unsigned char>(texture.width >> 8);
+	header[14] = static_cast<unsigned char>(texture.height);
+	header[15] = static_cast<unsigned char>(texture.height >> 8);
+	header[16] = 32;
+	header[17] = 0x28; // top-left origin, 8 alpha bits
+	writer.write(reinterpret_cast<const char*>(header), sizeof(header));
+	std::vector<unsigned char> bgra(texture.pixels.begin(), texture.pixels.end());
+	for (size_t i = 0; i < bgra.size(); i += 4) {
+		std::swap(bgra[i], bgra[i + 2]);
+	}
+	writer.write(reinterpret_cast<const char*>(bgra.data()), static_cast<std::streamsize>(bgra.size()));
+	return static_cast<bool>(writer);
+}
+
+// Function to test that LZ blocks decompress to their input and that damaged blocks are rejected
+static void TestLZCompression() {
+	std::vector<std::vector<unsigned char>> inputs;
+	inputs.push_back({});
+	inputs.push_back({ 42 });
+	inputs.push_back(RandomBytes(100000, 1));
+	inputs.push_back(std::vector<unsigned char>(70000, 7));  // one long run, match lengths with many extra bytes
+
+	// Text-like data, short matches at many offsets and literal runs longer than 15 bytes
+	std::string text;
+	std::mt19937 random(2);
+	const char* words[] = { "vertex ", "pixel ", "texture ", "sampler ", "shader ", "mip ", "tile " };
+	while (text.size() < 50000) {
+		text += words[random() % 7];
+		if (random() % 16 == 0) {
+			for (int i = 0; i < 40; ++i) {
+				text += static_cast<char>('a' + random() % 26);
+			}
+		}
+	}
+	inputs.push_back(std::vector<unsigned char>(text.begin(), text.end()));
+
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		const std::vector<unsigned char>& input = inputs[i];
+		std::vector<unsigned char> compressed;
+		CompressLZ(input.data(), input.size(), compressed);
+		Check(compressed.size() <= GetCompressBound(input.size()), "LZ input " + std::to_string(i) + " fits the compress bound");
+
+		std::vector<unsigned char> output(input.size());
+		Check(DecompressLZ(compressed.data(), compressed.size(), output.data(), output.size()) && output == input,
+			"LZ input " + std::to_string(i) + " round trips");
+
+		// A wrong output size or a truncated block must fail instead of writing out of bounds
+		if (!input.empty()) {
+			std::vector<unsigned char> shorter(input.size() - 1);
+			Check(!DecompressLZ(compressed.data(), compressed.size(), shorter.data(), shorter.size()), "LZ input " + std::to_string(i) + " rejects a short output");
+			Check(!DecompressLZ(compressed.data(), compressed.size() / 2, output.data(), output.size()), "LZ input " + std::to_string(i) + " rejects a truncated block");
+		}
+	}
+
+	std::vector<unsigned char> compressed;
+	CompressLZ(inputs[3].data(), inputs[3].size(), compressed);
+	Check(compressed.size() < inputs[3].size() / 100, "LZ compresses a run");
+}
+
+// Function to test packing an archive, finding and fetching its assets in place or decompressed, and rejecting damaged archives
+static void TestAssetArchive(const std::filesystem::path& directory) {
+	std::string text(20000, ' ');
+	for (size_t i = 0; i < text.size(); ++i) {
+		text[i] = "archive "[i % 8];
+	}
+	std::vector<unsigned char> random = RandomBytes(5000, 3);
+	std::vector<unsigned char> small = { 1, 2, 3 };
+
+	std::vector<AssetArchiveInput> inputs(3);
+	inputs[0].name = "text.txt";
+	inputs[0].data = reinterpret_cast<const unsigned char*>(text.data());
+	inputs[0].size = text.size();
+	inputs[0].compress = true;
+	inputs[1].name = "random.bin";
+	inputs[1].data = random.data();
+	inputs[1].size = random.size();
+	inputs[1].compress = true;  // stored anyway, it does not compress
+	inputs[2].name = "small.mesh";
+	inputs[2].data = small.data();
+	inputs[2].size = small.size();
+	inputs[2].format = AssetFormat::Mesh;
+
+	std::string archivePath = (directory / "test.pack").string();
+	if (!Check(WriteAssetArchive(archivePath, inputs), "archive is written")) {
+		return;
+	}
+
+	{
+		AssetArchive archive;
+		if (!Check(archive.Open(archivePath), "archive opens")) {
+			return;
+		}
+		Check(archive.EntryCount() == 3, "archive holds every asset");
+		Check(archive.Find("missing.bin") == nullptr, "archive does not find a missing asset");
+		for (const AssetArchiveInput& input : inputs) {
+			const ArchiveEntry* entry = archive.Find(input.name);
+			if (!Check(entry != nullptr, "archive finds " + input.name)) {
+				continue;
+			}
+			Check(archive.GetName(*entry) == input.name, "archive names " + input.name);
+			Check(entry->offset % ARCHIVE_ALIGNMENT == 0, "archive aligns " + input.name);
+			AssetData asset;
+			Check(archive.Load(input.name, asset) && asset.size == input.size && std::memcmp(asset.data, input.data, input.size) == 0 &&
+				asset.format == input.format, "archive fetches " + input.name);
+		}
+		const ArchiveEntry* text = archive.Find("text.txt");
+		const ArchiveEntry* stored = archive.Find("random.bin");
+		Check(text != nullptr && text->compression == AssetCompression::LZ && text->storedSize < text->size, "archive compresses text");
+		Check(stored != nullptr && stored->compression == AssetCompression::None, "archive stores incompressible data");
+
+		AssetData asset;
+		Check(LoadAsset(archive, "random.bin", asset) && asset.buffer.empty(), "archived stored assets are used in place");
+	}
+
+	// Damaged archives: a wrong magic, a header cut short and payloads cut off
+	std::vector<unsigned char> bytes;
+	{
+		std::ifstream reader(archivePath, std::ios::binary);
+		bytes.assign(std::istreambuf_iterator<char>(reader), std::istreambuf_iterator<char>());
+	}
+	std::string damagedPath = (directory / "damaged.pack").string();
+	auto writeDamaged = [&](const std::vector<unsigned char>& damaged) {
+		std::ofstream writer(damagedPath, std::ios::binary | std::ios::trunc);
+		writer.write(reinterpret_cast<const char*>(damaged.data()), static_cast<std::streamsize>(damaged.size()));
+	};
+
+	std::vector<unsigned char> damaged = bytes;
+	damaged[0] ^= 0xFF;
+	writeDamaged(damaged);
+	AssetArchive archive;
+	Check(!archive.Open(damagedPath), "archive with a wrong magic is rejected");
+
+	writeDamaged(std::vector<unsigned char>(bytes.begin(), bytes.begin() + 16));
+	Check(!archive.Open(damagedPath), "archive with a short header is rejected");
+
+	// The last payload is the small asset, cutting the file drops it
+	const ArchiveEntry* entry = nullptr;
+	uint64_t cut = 0;
+	{
+		AssetArchive intact;
+		intact.Open(archivePath);
+		entry = intact.Find("small.mesh");
+		cut = entry != nullptr ? entry->offset + 1 : bytes.size();
+	}
+	writeDamaged(std::vector<unsigned char>(bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(cut)));
+	AssetData asset;
+	Check(archive.Open(damagedPath) && !archive.Load("small.mesh", asset) && !asset.loaded, "archived asset past the end of the file is rejected");
+	Check(archive.Load("text.txt", asset) && asset.size == text.size(), "archived assets before the cut still load");
+}
+
+// Function to test that saved meshes load back and that mesh files with counts past their end or indices past their vertices are rejected
+static void TestMeshFile(const std::filesystem::path& directory) {
+	const size_t HEADER_SIZE = 24;
+	Mesh grid;
+	CreateGridMesh(2, 2, grid);
+	std::string meshPath = (directory / "grid.mesh").string();
+	if (!Check(SaveMesh(meshPath, grid), "mesh file is written")) {
+		return;
+	}
+	Mesh mesh;
+	Check(LoadMesh(meshPath, mesh) && mesh.vertices.size() == grid.vertices.size() && mesh.indexData == grid.indexData &&
+		mesh.indexCount == grid.indexCount && mesh.indexFormat == grid.indexFormat, "mesh file loads what was saved");
+
+	std::ifstream reader(meshPath, std::ios::binary);
+	std::vector<char> bytes((std::istreambuf_iterator<char>(reader)), std::istreambuf_iterator<char>());
+	reader.close();
+	std::string damagedPath = (directory / "damaged.mesh").string();
+	auto writeDamaged = [&](const std::vector<char>& damaged) {
+		std::ofstream writer(damagedPath, std::ios::binary | std::ios::trunc);
+		writer.write(damaged.data(), static_cast<std::streamsize>(damaged.size()));
+	};
+
+	// The counts sit after the magic and the version
+	std::vector<char> damaged = bytes;
+	uint32_t count = 0x7FFFFFFF;
+	std::memcpy(&damaged[8], &count, sizeof(count));
+	writeDamaged(damaged);
+	Check(!LoadMesh(damagedPath, mesh), "mesh file with more vertices than it holds is rejected");
+
+	damaged = bytes;
+	std::memcpy(&damaged[12], &count, sizeof(count));
+	writeDamaged(damaged);
+	Check(!LoadMesh(damagedPath, mesh), "mesh file with more indices than it holds is rejected");
+
+	damaged = bytes;
+	uint16_t index = static_cast<uint16_t>(grid.vertices.size());
+	std::memcpy(&damaged[HEADER_SIZE + grid.vertices.size() * sizeof(SimpleVertex)], &index, sizeof(index));
+	writeDamaged(damaged);
+	Check(!LoadMesh(damagedPath, mesh), "mesh file with an index past its vertices is rejected");
+}
+
+// Function to test that block compression keeps flat colors, keeps gradients within a PSNR bound and is the same at every SIMD level
+static void TestBlockCompression(ThreadPool& pool) {
+	const TexelFormat FORMATS[] = { TexelFormat::BC1, TexelFormat::BC3, TexelFormat::BC7 };
+	const double MIN_PSNR[] = { 35.0, 35.0, 37.0 };
+
+	// Solid colors whose channels BC1 can represent in 5:6:5. BC7 mode 6 shares a p-bit between the channels of an endpoint,
+	// so colors mixing odd and even channels, like opaque black, come out 1 off
+	const int SOLID_TOLERANCE[] = { 0, 0, 1 };
+	const unsigned char COLORS[][4] = { { 0, 0, 0, 255 }, { 255, 255, 255, 255 }, { 255, 0, 0, 255 }, { 0, 255, 0, 255 }, { 0, 0, 255, 255 }, { 132, 130, 132, 255 } };
+	for (int format = 0; format < 3; ++format) {
+		const char* name = TexelFormatName(FORMATS[format]);
+		for (const unsigned char* color : COLORS) {
+			TextureData solid;
+			solid.width = 8;
+			solid.height = 8;
+			solid.pixels.resize(8 * 8 * 4);
+			for (size_t i = 0; i < solid.pixels.size(); ++i) {
+				solid.pixels[i] = color[i % 4];
+			}
+			BlockCompressionOptions options;
+			options.format = FORMATS[format];
+			TextureData compressed;
+			TextureData decoded;
+			bool decompressed = CompressTexture(pool, options, solid, compressed) && DecompressTexture(pool, compressed, decoded) &&
+				decoded.pixels.size() == solid.pixels.size();
+			int maxError = 0;
+			for (size_t i = 0; decompressed && i < solid.pixels.size(); ++i) {
+				maxError = std::max(maxError, std::abs(static_cast<int>(decoded.pixels[i]) - solid.pixels[i]));
+			}
+			Check(decompressed && maxError <= SOLID_TOLERANCE[format], std::string(name) + " keeps a solid color");
+		}
+
+		// A gradient with noise at every SIMD level the CPU runs, the levels must write the same blocks
+		TextureData source = CreateGradientTexture(64, 48, 4);
+		BlockCompressionOptions options;
+		options.format = FORMATS[format];
+		options.simdLevel = SimdLevel::Scalar;
+		TextureData reference;
+		if (!Check(CompressTexture(pool, options, source, reference), std::string(name) + " compresses a gradient")) {
+			continue;
+		}
+		Check(reference.format == FORMATS[format] && reference.pixels.size() == GetLevelBytes(FORMATS[format], 64, 48), std::string(name) + " writes whole blocks");
+		for (SimdLevel level = SimdLevel::AVX2; level <= DetectSimdLevel(); level = static_cast<SimdLevel>(static_cast<int>(level) + 1)) {
+			options.simdLevel = level;
+			TextureData compressed;
+			Check(CompressTexture(pool, options, source, compressed) && compressed.pixels == reference.pixels,
+				std::string(name) + " " + SimdLevelName(level) + " matches scalar");
+		}
+
+		TextureData decoded;
+		Check(DecompressTexture(pool, reference, decoded), std::string(name) + " decompresses");
+		double psnr = ComputePSNR(source.pixels, decoded.pixels);
+		char text[64];
+		std::snprintf(text, sizeof(text), " gradient PSNR %.1f dB is at least %.0f dB", psnr, MIN_PSNR[format]);
+		Check(psnr >= MIN_PSNR[format], name + std::string(text));
+
+		// Single texel fetches read the same texels as whole block decodes
+		bool fetchesMatch = true;
+		for (int y = 0; y < source.height; y += 3) {
+			for (int x = 0; x < source.width; x += 5) {
+				uint32_t texel;
+				std::memcpy(&texel, &decoded.pixels[(static_cast<size_t>(y) * source.width + x) * 4], sizeof(texel));
+				fetchesMatch &= FetchBlockTexel(reference, x, y) == texel;
+			}
+		}
+		Check(fetchesMatch, std::string(name) + " texel fetches match the decoded blocks");
+	}
+
+	Check(GetLevelBytes(TexelFormat::BC1, 5, 5) == 4 * 8 && GetLevelBytes(TexelFormat::BC7, 1, 1) == 16 && GetLevelBytes(TexelFormat::RGBA8, 5, 3) == 60,
+		"level sizes round up to whole blocks");
+
+	// Padding keeps every texel and repeats the last column and row
+	TextureData padded = CreateGradientTexture(7, 6, 7);
+	TextureData original = padded;
+	bool padKeepsTexels = PadToBlocks(padded) && padded.width == 8 && padded.height == 8;
+	for (int y = 0; padKeepsTexels && y < padded.height; ++y) {
+		for (int x = 0; x < padded.width; ++x) {
+			int sourceX = std::min(x, original.width - 1);
+			int sourceY = std::min(y, original.height - 1);
+			padKeepsTexels &= std::memcmp(&padded.pixels[(static_cast<size_t>(y) * padded.width + x) * 4],
+				&original.pixels[(static_cast<size_t>(sourceY) * original.width + sourceX) * 4], 4) == 0;
+		}
+	}
+	Check(padKeepsTexels, "padding to whole blocks keeps every texel and repeats the edges");
+	Check(!PadToBlocks(padded), "whole blocks are not padded");
+}
+
+// Function to test that the texture cache misses once, then hits with the same texels, and notices edits, option changes and damaged entries,
+// for RGBA8 and block compressed entries
+static void TestTextureCache(ThreadPool& pool, const std::filesystem::path& directory) {
+	std::string imagePath = (directory / "image.tga").string();
+	TextureData image = CreateGradientTexture(40, 24, 5);
+	if (!Check(WriteTGA(imagePath, image), "test image is written")) {
+		return;
+	}
+
+	MipChainOptions options;
+	TextureData expected;
+	if (!Check(LoadTextureData(pool, imagePath, expected) && expected.pixels == image.pixels, "test image decodes losslessly")) {
+		return;
+	}
+	BuildMipChain(pool, options, expected);
+
+	TextureCache cache((directory / "TextureCache").string());
+	AssetArchive archive;
+	TextureData texture;
+	Check(cache.Load(pool, archive, imagePath, options, texture) && TexturesEqual(texture, expected), "texture cache miss loads the texture");
+	Check(cache.GetStats().misses == 1 && cache.GetStats().hits == 0, "texture cache misses the first load");
+	texture = TextureData();
+	Check(cache.Load(pool, archive, imagePath, options, texture) && TexturesEqual(texture, expected), "texture cache hit loads the same texels");
+	Check(cache.GetStats().hits == 1, "texture cache hits the second load");
+
+	// Touching the file without changing it is still a hit, after hashing it
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(imagePath);
+	std::filesystem::last_write_time(imagePath, writeTime + std::chrono::seconds(1));
+	Check(cache.Load(pool, archive, imagePath, options, texture) && TexturesEqual(texture, expected), "texture cache revalidates a touched source");
+	Check(cache.GetStats().revalidated == 1, "texture cache counts the revalidation");
+
+	// A different mip filter is a different entry
+	MipChainOptions boxOptions;
+	boxOptions.filter = MipFilter::Box;
+	boxOptions.gammaCorrect = false;
+	TextureData boxExpected = expected;
+	BuildMipChain(pool, boxOptions, boxExpected);
+	Check(cache.GetEntryPath(imagePath, boxOptions) != cache.GetEntryPath(imagePath, options), "texture cache keys the mip options");
+	Check(cache.Load(pool, archive, imagePath, boxOptions, texture) && TexturesEqual(texture, boxExpected) && cache.GetStats().misses == 2,
+		"texture cache misses new mip options");
+
+	// Editing the source replaces the entry
+	TextureData edited = CreateGradientTexture(40, 24, 6);
+	WriteTGA(imagePath, edited);
+	std::filesystem::last_write_time(imagePath, writeTime + std::chrono::seconds(2));
+	TextureData editedExpected;
+	LoadTextureData(pool, imagePath, editedExpected);
+	BuildMipChain(pool, options, editedExpected);
+	Check(cache.Load(pool, archive, imagePath, options, texture) && TexturesEqual(texture, editedExpected), "texture cache reloads an edited source");
+	Check(cache.GetStats().stale == 1, "texture cache counts the stale entry");
+
+	// A truncated entry is rebuilt instead of read
+	std::string entryPath = cache.GetEntryPath(imagePath, options);
+	std::filesystem::resize_file(entryPath, std::filesystem::file_size(entryPath) - 100);
+	uint64_t misses = cache.GetStats().misses;
+	Check(cache.Load(pool, archive, imagePath, options, texture) && TexturesEqual(texture, editedExpected) && cache.GetStats().misses == misses + 1,
+		"texture cache rebuilds a truncated entry");
+	Check(cache.Load(pool, archive, imagePath, options, texture) && TexturesEqual(texture, editedExpected) && cache.GetStats().misses == misses + 1,
+		"texture cache hits the rebuilt entry");
+
+	// Block compressed entries hold the blocks of the padded image, hits skip decoding, filtering and compressing
+	BlockCompressionOptions compressionOptions;
+	compressionOptions.format = TexelFormat::BC1;
+	TextureData compressedExpected;
+	LoadTextureData(pool, imagePath, compressedExpected);
+	PadToBlocks(compressedExpected);
+	BuildMipChain(pool, options, compressedExpected);
+	TextureData blocks;
+	CompressTexture(pool, compressionOptions, compressedExpected, blocks);
+	Check(cache.GetEntryPath(imagePath, options, compressionOptions) != cache.GetEntryPath(imagePath, options), "texture cache keys the compression options");
+	misses = cache.GetStats().misses;
+	Check(cache.Load(pool, archive, imagePath, options, compressionOptions, texture) && TexturesEqual(texture, blocks) && cache.GetStats().misses == misses + 1,
+		"texture cache misses a new block compressed texture");
+	uint64_t hits = cache.GetStats().hits;
+	texture = TextureData();
+	Check(cache.Load(pool, archive, imagePath, options, compressionOptions, texture) && TexturesEqual(texture, blocks) && cache.GetStats().hits == hits + 1,
+		"texture cache hits the blocks");
+	Check(texture.width % BLOCK_DIMENSION == 0 && texture.height % BLOCK_DIMENSION == 0 && texture.format == TexelFormat::BC1, "cached blocks cover whole blocks");
+
+	compressionOptions.format = TexelFormat::BC7;
+	Check(cache.Load(pool, archive, imagePath, options, compressionOptions, texture) && texture.format == TexelFormat::BC7 && cache.GetStats().misses == misses + 2,
+		"texture cache misses another block format");
+	Check(cache.Load(pool, archive, imagePath, options, texture) && TexturesEqual(texture, editedExpected), "texture cache keeps the RGBA8 entry apart");
+}
+
+// Function to count the pixels of a frame that are not the clear color
+static uint32_t CountCovered(const SoftwareFramebuffer& framebuffer, uint32_t clearColor) {
+	std::vector<uint32_t> pixels;
+	ResolveSoftwareFramebuffer(framebuffer, pixels);
+	uint32_t covered = 0;
+	for (uint32_t pixel : pixels) {
+		covered += pixel != clearColor;
+	}
+	return covered;
+}
+
+// Function to test the fill rule at every SIMD level: two triangles splitting the viewport along its diagonal cover every pixel exactly once
+static void TestRasterizerCoverage() {
+	const uint32_t SIZE = 96;
+	const float CLEAR_COLOR[4] = { 1.0f, 0.0f, 1.0f, 1.0f };
+	const uint32_t CLEAR_PIXEL = 0xFFFF00FF;
+
+	SoftwareContext context;
+	SoftwareFramebuffer framebuffer;
+	if (!Check(CreateSoftwareContext(2, context) && CreateSoftwareFramebuffer(SIZE, SIZE, 32, framebuffer), "software renderer is created")) {
+		return;
+	}
+	SoftwareViewport viewport;
+	SetSoftwareViewport(viewport, SIZE, SIZE);
+
+	// Clip space is screen space with identity matrices
+	VertexShaderConstants vsConstants = {};
+	for (int i = 0; i < 4; ++i) {
+		vsConstants.worldMatrix[i][i] = 1.0f;
+		vsConstants.viewProjectionMatrix[i][i] = 1.0f;
+	}
+	PixelShaderConstants psConstants;
+	TextureData texture;
+	texture.width = 1;
+	texture.height = 1;
+	texture.pixels.assign(4, 255);
+
+	// Clockwise in screen space, the upper left half and the lower right half
+	SimpleVertex upperLeft[3] = {
+		SimpleVertex({ -1.0f, 1.0f, 0.5f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 0.0f }),
+		SimpleVertex({ 1.0f, 1.0f, 0.5f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f }),
+		SimpleVertex({ -1.0f, -1.0f, 0.5f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f })
+	};
+	SimpleVertex lowerRight[3] = {
+		SimpleVertex({ 1.0f, 1.0f, 0.5f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f }),
+		SimpleVertex({ 1.0f, -1.0f, 0.5f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 1.0f }),
+		SimpleVertex({ -1.0f, -1.0f, 0.5f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f })
+	};
+
+	SimdLevel fastest = context.simdLevel;
+	for (int level = 0; level <= static_cast<int>(fastest); ++level) {
+		context.simdLevel = static_cast<SimdLevel>(level);
+		std::string name = SimdLevelName(context.simdLevel);
+
+		// Pixel centers on the shared diagonal belong to the lower right triangle, its diagonal is a left edge
+		ClearSoftwareFramebuffer(framebuffer, CLEAR_COLOR, 1.0f);
+		SoftwareDraw(context, framebuffer, viewport, upperLeft, 3, PrimitiveTopology::TriangleList, vsConstants, psConstants, texture);
+		Check(CountCovered(framebuffer, CLEAR_PIXEL) == SIZE * (SIZE - 1) / 2, name + " upper left triangle covers the pixels above the diagonal");
+
+		ClearSoftwareFramebuffer(framebuffer, CLEAR_COLOR, 1.0f);
+		SoftwareDraw(context, framebuffer, viewport, lowerRight, 3, PrimitiveTopology::TriangleList, vsConstants, psConstants, texture);
+		Check(CountCovered(framebuffer, CLEAR_PIXEL) == SIZE * (SIZE + 1) / 2, name + " lower right triangle covers the diagonal and below");
+
+		ClearSoftwareFramebuffer(framebuffer, CLEAR_COLOR, 1.0f);
+		SoftwareDraw(context, framebuffer, viewport, upperLeft, 3, PrimitiveTopology::TriangleList, vsConstants, psConstants, texture);
+		SoftwareDraw(context, framebuffer, viewport, lowerRight, 3, PrimitiveTopology::TriangleList, vsConstants, psConstants, texture);
+		Check(CountCovered(framebuffer, CLEAR_PIXEL) == SIZE * SIZE, name + " both triangles cover the whole viewport");
+
+		// Counter-clockwise triangles are back faces
+		SimpleVertex backFace[3] = { upperLeft[0], upperLeft[2], upperLeft[1] };
+		ClearSoftwareFramebuffer(framebuffer, CLEAR_COLOR, 1.0f);
+		SoftwareDraw(context, framebuffer, viewport, backFace, 3, PrimitiveTopology::TriangleList, vsConstants, psConstants, texture);
+		Check(CountCovered(framebuffer, CLEAR_PIXEL) == 0, name + " back faces are culled");
+	}
+}
+
+// Function to get the largest channel difference of two runs of packed colors
+static uint32_t MaxChannelDifference(const uint32_t* a, const uint32_t* b, size_t count) {
+	uint32_t difference = 0;
+	for (size_t i = 0; i < count; ++i) {
+		for (uint32_t shift = 0; shift < 32; shift += 8) {
+			int channelA = (a[i] >> shift) & 0xFF;
+			int channelB = (b[i] >> shift) & 0xFF;
+			difference = std::max<uint32_t>(difference, static_cast<uint32_t>(std::abs(channelA - channelB)));
+		}
+	}
+	return difference;
+}
+
+// Function to test that the sample shaders run by the JIT and the interpreter match the built-in kernels on fixed inputs:
+// shaded vertices bit for bit, pixels within one step per channel, and the JIT like the interpreter where it is available
+static void TestShaderBackends() {
+	SimdLevel level = DetectSimdLevel();
+	std::string name = SimdLevelName(level);
+	const ShaderBackend backends[2] = { ShaderBackend::Jit, ShaderBackend::Interpreter };
+	SoftwareShader vertexShaders[2];
+	SoftwareShader pixelShaders[2];
+	for (int backend = 0; backend < 2; ++backend) {
+		std::string backendName = ShaderBackendName(backends[backend]);
+		if (!Check(vertexShaders[backend].LoadFile("VertexShader.hlsl", ShaderStage::Vertex, backends[backend], level, nullptr) &&
+			pixelShaders[backend].LoadFile("PixelShader.hlsl", ShaderStage::Pixel, backends[backend], level, nullptr), backendName + " loads the sample shaders")) {
+			return;
+		}
+	}
+#ifdef SHADER_JIT
+	Check(pixelShaders[0].IsJit() == (level >= SimdLevel::AVX2), name + " runs the JIT where the CPU has AVX2");
+#endif
+
+	// Thirteen vertices leave a partial block of lanes
+	const uint32_t VERTICES = 13;
+	std::vector<SimpleVertex> vertices;
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+	for (uint32_t i = 0; i < VERTICES; ++i) {
+		vertices.push_back(SimpleVertex({ coordinate(random), coordinate(random), coordinate(random) },
+			{ coordinate(random), coordinate(random), coordinate(random) }, { coordinate(random), coordinate(random) }));
+	}
+	VertexShaderConstants vsConstants = {};
+	CreateSoftwareWorldMatrix(0.7f, vsConstants.worldMatrix);
+	for (int i = 0; i < 4; ++i) {
+		vsConstants.viewProjectionMatrix[i][i] = 0.5f + 0.25f * i;
+	}
+	vsConstants.viewProjectionMatrix[3][2] = 0.25f;
+	std::vector<ShadedVertex> expectedVertices(VERTICES);
+	SelectShadeVertices(level)(vertices.data(), VERTICES, vsConstants, expectedVertices.data());
+
+	// A lit, textured triangle at w = 2 with barycentrics growing across the two quads
+	ShadedVertex corners[3] = {};
+	const float WORLD_POSITIONS[3][3] = { { -0.5f, 0.5f, 0.0f }, { 0.5f, 0.5f, 0.25f }, { -0.5f, -0.5f, -0.25f } };
+	const float NORMALS[3][3] = { { 0.0f, 0.0f, -1.0f }, { 0.3f, 0.1f, -0.9f }, { -0.2f, 0.4f, -0.8f } };
+	const float UVS[3][2] = { { 0.1f, 0.2f }, { 0.9f, 0.3f }, { 0.2f, 1.4f } };
+	const ShadedVertex* cornerPointers[3];
+	for (int i = 0; i < 3; ++i) {
+		std::copy(WORLD_POSITIONS[i], WORLD_POSITIONS[i] + 3, corners[i].worldPosition);
+		corners[i].worldPosition[3] = 1.0f;
+		std::copy(NORMALS[i], NORMALS[i] + 3, corners[i].normal);
+		std::copy(UVS[i], UVS[i] + 2, corners[i].uv);
+		cornerPointers[i] = &corners[i];
+	}
+	const float INV_W[3] = { 0.5f, 0.0f, 0.0f };
+	const float B1_OVER_W[3] = { 0.0f, 0.05f, 0.0f };
+	const float B2_OVER_W[3] = { 0.0f, 0.0f, 0.05f };
+	ShadingTriangle triangle;
+	SetupShadingTriangle(cornerPointers, INV_W, B1_OVER_W, B2_OVER_W, triangle);
+	const float X[SHADING_BATCH] = { 0.5f, 1.5f, 0.5f, 1.5f, 2.5f, 3.5f, 2.5f, 3.5f };
+	const float Y[SHADING_BATCH] = { 0.5f, 0.5f, 1.5f, 1.5f, 0.5f, 0.5f, 1.5f, 1.5f };
+	PixelShaderConstants psConstants;
+	psConstants.lightPosition[0] = -1.0f;
+	psConstants.ambientLightIntensity = 0.1f;
+	psConstants.shininess = 8.0f;
+	TextureData texture = CreateGradientTexture(16, 16, 4);
+	SamplerDesc sampler;
+	sampler.filter = SamplerFilter::Bilinear;
+	uint32_t expectedColors[SHADING_BATCH];
+	SelectShadeQuads(level)(triangle, X, Y, psConstants, texture, sampler, nullptr, expectedColors);
+
+	std::vector<ShadedVertex> shadedVertices[2];
+	uint32_t colors[2][SHADING_BATCH];
+	for (int backend = 0; backend < 2; ++backend) {
+		std::string backendName = name + " " + ShaderBackendName(backends[backend]);
+		shadedVertices[backend].resize(VERTICES);
+		vertexShaders[backend].ShadeVertices(vertices.data(), VERTICES, vsConstants, shadedVertices[backend].data());
+		Check(std::memcmp(shadedVertices[backend].data(), expectedVertices.data(), VERTICES * sizeof(ShadedVertex)) == 0,
+			backendName + " vertex shader matches the vertex kernel");
+		pixelShaders[backend].ShadeQuads(triangle, X, Y, psConstants, texture, sampler, nullptr, colors[backend]);
+		Check(MaxChannelDifference(colors[backend], expectedColors, SHADING_BATCH) <= 1, backendName + " pixel shader is within one step of the pixel kernel");
+	}
+	Check(std::memcmp(colors[0], colors[1], sizeof(colors[0])) == 0, name + " JIT shades like the interpreter");
+
+	// Without a bound texture the sample reads zero and only the specular term is left
+	TextureData unbound;
+	SelectShadeQuads(level)(triangle, X, Y, psConstants, unbound, sampler, nullptr, expectedColors);
+	for (int backend = 0; backend < 2; ++backend) {
+		pixelShaders[backend].ShadeQuads(triangle, X, Y, psConstants, unbound, sampler, nullptr, colors[backend]);
+		Check(MaxChannelDifference(colors[backend], expectedColors, SHADING_BATCH) <= 1,
+			name + " " + ShaderBackendName(backends[backend]) + " pixel shader samples zero without a texture");
+	}
+
+	// The light position is a point with any w, the kernels subtract the world position like PixelShader.hlsl
+	const float LIGHT_W[2] = { 0.0f, 2.0f };
+	for (float lightW : LIGHT_W) {
+		psConstants.lightPosition[3] = lightW;
+		std::string lightName = " with light w " + std::to_string(static_cast<int>(lightW));
+		uint32_t scalarColors[SHADING_BATCH];
+		ShadeQuadsScalar(triangle, X, Y, psConstants, texture, sampler, nullptr, scalarColors);
+		SelectShadeQuads(level)(triangle, X, Y, psConstants, texture, sampler, nullptr, expectedColors);
+		Check(MaxChannelDifference(scalarColors, expectedColors, SHADING_BATCH) <= 1, name + " pixel kernel is within one step of the scalar kernel" + lightName);
+		for (int backend = 0; backend < 2; ++backend) {
+			pixelShaders[backend].ShadeQuads(triangle, X, Y, psConstants, texture, sampler, nullptr, colors[backend]);
+			Check(MaxChannelDifference(colors[backend], scalarColors, SHADING_BATCH) <= 1,
+				name + " " + ShaderBackendName(backends[backend]) + " pixel shader is within one step of the scalar kernel" + lightName);
+		}
+	}
+}
+
+// Function to test that JIT compiled code returns the same floats as the interpreter, pow included, over random inputs
+// that reach zero, denormal and saturated bases. Rsqrt is exact here, the approximation of native code is its own rounding.
+static void TestShaderJitFloats() {
+#ifdef SHADER_JIT
+	if (DetectSimdLevel() < SimdLevel::AVX2) {
+		return;
+	}
+	const char* SOURCE =
+		"cbuffer ConstBuffer : register(b0)\n{\n    float4 scale;\n    float exponent;\n    float bias;\n}\n\n"
+		"struct PixelShaderInput\n{\n    float4 position : SV_POSITION;\n    float4 worldPosition : WORLD_POSITION;\n"
+		"    float4 normal : NORMAL;\n    float2 uv : UV;\n};\n\n"
+		"float4 main(PixelShaderInput input) : SV_TARGET\n{\n"
+		"    float4 base = saturate(input.worldPosition * scale);\n"
+		"    float specular = pow(saturate(input.uv.x), input.uv.y * 256.0f);\n"
+		"    float4 lit = float4(pow(base.x, exponent), pow(base.y, exponent), pow(base.z, 1.5f), pow(base.w, bias));\n"
+		"    return lit * rsqrt(dot(input.normal, input.normal) + 1.0f) + specular * bias - normalize(input.normal) * 0.25f;\n}\n";
+	ShaderCompileOptions options;
+	options.approximateRsqrt = false;
+	ShaderProgram program;
+	JitShaderCode code;
+	ExecutableMemory memory;
+	if (!Check(CompileShader(SOURCE, ShaderStage::Pixel, options, program), "pow test shader compiles")) {
+		return;
+	}
+	JitCompileShader(program, NATIVE_CALLING_CONVENTION, code);
+	if (!Check(memory.Load(code.code.data(), code.code.size()), "pow test shader loads as native code")) {
+		return;
+	}
+	bool hasPow = false;
+	for (const ShaderInstruction& instruction : program.code) {
+		hasPow = hasPow || instruction.op == ShaderOp::Pow;
+	}
+	Check(hasPow, "pow test shader keeps its pow");
+
+	struct alignas(32) LaneSlot {
+		float lanes[SHADER_LANES];
+	};
+	uint32_t slots = std::max(GetInterpreterLaneSlots(program), code.laneSlots);
+	std::vector<LaneSlot> interpreted(slots);
+	std::vector<LaneSlot> native(slots);
+	const float CONSTANTS[8] = { 1.5f, 0.75f, 1e-30f, 2.0f, 200.0f, 0.5f, 0.0f, 0.0f };
+	ShadingTriangle triangle = {};
+	triangle.invW[0] = 1.0f;
+	triangle.b1OverW[1] = 0.25f;
+	triangle.b2OverW[2] = 0.25f;
+
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> value(-0.5f, 1.5f);
+	uint32_t mismatches = 0;
+	for (uint32_t batch = 0; batch < 512; ++batch) {
+		for (int i = 0; i < SHADING_ATTRIBUTES; ++i) {
+			triangle.base[i] = value(random);
+			triangle.edge1[i] = value(random) * 0.5f;
+			triangle.edge2[i] = value(random) * 0.5f;
+		}
+		for (uint32_t lane = 0; lane < SHADER_LANES; ++lane) {
+			interpreted[PIXEL_X_SLOT].lanes[lane] = native[PIXEL_X_SLOT].lanes[lane] = static_cast<float>(random() % 4);
+			interpreted[PIXEL_Y_SLOT].lanes[lane] = native[PIXEL_Y_SLOT].lanes[lane] = static_cast<float>(random() % 4);
+		}
+		ShaderInvocation invocation;
+		invocation.blocks[SHADER_CONSTANT_BUFFER] = CONSTANTS;
+		invocation.blocks[SHADER_PRIMITIVE_DATA] = reinterpret_cast<const float*>(&triangle);
+		invocation.lanes = interpreted[0].lanes;
+		InterpretShader(program, invocation);
+		invocation.lanes = native[0].lanes;
+		RunJitShader(memory, invocation, nullptr);
+		mismatches += std::memcmp(interpreted[PIXEL_OUTPUT_SLOT].lanes, native[PIXEL_OUTPUT_SLOT].lanes, 4 * sizeof(LaneSlot)) != 0 ? 1 : 0;
+	}
+	Check(mismatches == 0, "JIT returns the floats of the interpreter, pow included (" + std::to_string(mismatches) + " batches differ)");
+
+	// The scalar pow every interpreter lane runs is the one the JIT generates
+	const float BASES[] = { 0.0f, 1e-39f, 1.17549435e-38f, 1e-20f, 0.001f, 0.3f, 0.70710677f, 0.70710683f, 0.999999f, 1.0f };
+	const float EXPONENTS[] = { 0.5f, 1.0f, 7.3f, 200.0f, 1000.0f };
+	bool powMatches = true;
+	for (float exponent : EXPONENTS) {
+		for (float base : BASES) {
+			float fast = FastPow(base, exponent);
+			float exact = std::pow(base, exponent);
+			powMatches = powMatches && std::fabs(fast - exact) <= std::max(6e-5f * exact, 3e-6f);
+		}
+	}
+	Check(powMatches, "FastPow stays within its error bound");
+#endif
+}
+
+// Function to test that the shader compiler rejects HLSL outside the subset it supports instead of running something else
+static void TestShaderParseErrors() {
+	const char* PREFIX = "cbuffer ConstBuffer : register(b0)\n{\n    float4 color;\n}\n\n";
+	const char* SOURCES[][2] = {
+		{ "float4 main(float4 position : SV_POSITION) : SV_TARGET\n{\n    return sin(color);\n}\n", "unknown intrinsics" },
+		{ "float4 main(float4 position : SV_POSITION) : SV_TARGET\n{\n    for (int i = 0; i < 2; ++i) { }\n    return color;\n}\n", "loops" },
+		{ "float4 main(float4 position : SV_POSITION) : SV_TARGET\n{\n    if (color.x > 0.5f) return color;\n    return color;\n}\n", "branches" },
+		{ "float4 main(float4 position : SV_POSITION) : SV_TARGET\n{\n    return missing;\n}\n", "undeclared names" },
+		{ "float4 main(float4 position : SV_POSITION) : SV_TARGET\n{\n    return color\n}\n", "a missing semicolon" },
+		{ "float4 main(float4 position : SV_POSITION) : SV_TARGET\n{\n    float4 value = color;\n", "an unterminated function" },
+		{ "float4 shade(float4 position : SV_POSITION) : SV_TARGET\n{\n    return color;\n}\n", "a source without main" }
+	};
+
+	// The compiler prints its errors, they are expected here
+	std::ostringstream errors;
+	std::streambuf* previous = std::cerr.rdbuf(errors.rdbuf());
+	ShaderCompileOptions options;
+	ShaderProgram program;
+	std::vector<bool> rejected;
+	for (const auto& source : SOURCES) {
+		rejected.push_back(!CompileShader(std::string(PREFIX) + source[0], ShaderStage::Pixel, options, program));
+	}
+	std::string valid = std::string(PREFIX) + "float4 main(float4 position : SV_POSITION) : SV_TARGET\n{\n    return saturate(color * 2.0f);\n}\n";
+	bool accepted = CompileShader(valid, ShaderStage::Pixel, options, program);
+	std::cerr.rdbuf(previous);
+
+	Check(accepted, "shader compiler accepts the supported subset");
+	for (size_t i = 0; i < rejected.size(); ++i) {
+		Check(rejected[i], std::string("shader compiler rejects ") + SOURCES[i][1]);
+	}
+	Check(errors.str().find("line") != std::string::npos, "shader compiler errors name their line");
+}
+
+// Test entry point, returns an error when any check fails so the build fails with it
+int main() {
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "RasterizerTests";
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+	std::filesystem::create_directories(directory, error);
+	if (error) {
+		std::cerr << "Could not create directory: " << directory.string() << std::endl;
+		return -1;
+	}
+
+	ThreadPool pool;
+	TestLZCompression();
+	TestAssetArchive(directory);
+	TestMeshFile(directory);
+	TestBlockCompression(pool);
+	TestTextureCache(pool, directory);
+	TestRasterizerCoverage();
+	TestShaderBackends();
+	TestShaderJitFloats();
+	TestShaderParseErrors();
+
+	std::filesystem::remove_all(directory, error);
+	std::cout << checkCount << " checks, " << failureCount << " failed" << std::endl;
+	return failureCount == 0 ? 0 : -1;
+}
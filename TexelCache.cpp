@@ -0,0 +1,118 @@
+#include "TexelCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "TextureLayout.h"
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Tag no block can have, block rows stay below 65535 for any texture Direct3D can create
+static const uint32_t INVALID_TAG = 0xFFFFFFFF;
+
+// Function to create an empty cache
+TexelCache::TexelCache() {
+	std::fill_n(tags, TEXEL_CACHE_ENTRIES, INVALID_TAG);
+}
+
+// Function to invalidate the cache and bind a texture
+void TexelCache::Reset(const TextureData& boundTexture) {
+	std::fill_n(tags, TEXEL_CACHE_ENTRIES, INVALID_TAG);
+	texture = &boundTexture;
+}
+
+// Function to clear the counters
+void TexelCache::ClearCounters() {
+	counters = TexelCacheCounters();
+}
+
+// Function to read a block of the bound texture into an entry
+void TexelCache::Fill(uint32_t slot, uint32_t blockX, uint32_t blockY) {
+	const TextureData& source = *texture;
+	uint32_t* entry = texels[slot];
+	if (source.format != TexelFormat::RGBA8) {
+		size_t blocksWide = (source.width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+		const unsigned char* block = source.pixels.data() + (blockY * blocksWide + blockX) * GetBlockBytes(source.format);
+		unsigned char rgba[BLOCK_TEXELS * 4];
+		DecodeBlock(source.format, block, rgba);
+		std::memcpy(entry, rgba, sizeof(rgba));
+		return;
+	}
+
+	// Aligned 4x4 blocks of a tiled texture are 16 consecutive texels in Morton order
+	int firstX = static_cast<int>(blockX) * BLOCK_DIMENSION;
+	int firstY = static_cast<int>(blockY) * BLOCK_DIMENSION;
+	if (source.layout == TexelLayout::Tiled) {
+		static const uint8_t MORTON_OFFSETS[BLOCK_TEXELS] = { 0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 12, 13, 10, 11, 14, 15 };
+		const uint32_t* block = reinterpret_cast<const uint32_t*>(source.pixels.data()) + GetTiledTexelIndex(source.width, firstX, firstY);
+		for (int texel = 0; texel < BLOCK_TEXELS; ++texel) {
+			entry[texel] = block[MORTON_OFFSETS[texel]];
+		}
+		return;
+	}
+
+	// Blocks on the right and bottom edges of linear textures repeat the last texels, those are never fetched
+	for (int y = 0; y < BLOCK_DIMENSION; ++y) {
+		const unsigned char* row = &source.pixels[static_cast<size_t>(std::min(firstY + y, source.height - 1)) * source.width * 4];
+		if (firstX + BLOCK_DIMENSION <= source.width) {
+			std::memcpy(&entry[y * BLOCK_DIMENSION], row + static_cast<size_t>(firstX) * 4, BLOCK_DIMENSION * 4);
+			continue;
+		}
+		for (int x = 0; x < BLOCK_DIMENSION; ++x) {
+			std::memcpy(&entry[y * BLOCK_DIMENSION + x], row + static_cast<size_t>(std::min(firstX + x, source.width - 1)) * 4, sizeof(uint32_t));
+		}
+	}
+}
+
+#ifdef SIMD_X86
+// Function to fetch eight texels with one tag lookup and one gather
+SIMD_TARGET_AVX2 void TexelCache::FetchAVX2(const int32_t x[8], const int32_t y[8], uint32_t result[8]) {
+	__m256i laneX = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x));
+	__m256i laneY = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y));
+	__m256i blockX = _mm256_srli_epi32(laneX, 2);
+	__m256i blockY = _mm256_srli_epi32(laneY, 2);
+	const __m256i windowMask = _mm256_set1_epi32(TEXEL_CACHE_DIMENSION - 1);
+	__m256i slot = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(blockY, windowMask), TEXEL_CACHE_SHIFT), _mm256_and_si256(blockX, windowMask));
+	__m256i tag = _mm256_or_si256(_mm256_slli_epi32(blockY, 16), blockX);
+	__m256i hit = _mm256_cmpeq_epi32(_mm256_i32gather_epi32(reinterpret_cast<const int*>(tags), slot, 4), tag);
+
+	// Hits are gathered before any miss is filled, a fill may evict the block of another lane
+	const __m256i texelMask = _mm256_set1_epi32(BLOCK_DIMENSION - 1);
+	__m256i texel = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(laneY, texelMask), 2), _mm256_and_si256(laneX, texelMask));
+	__m256i index = _mm256_or_si256(_mm256_slli_epi32(slot, 4), texel);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(result), _mm256_i32gather_epi32(reinterpret_cast<const int*>(texels), index, 4));
+
+	int hitMask = _mm256_movemask_ps(_mm256_castsi256_ps(hit));
+	for (int lane = 0; lane < 8; ++lane) {
+		if ((hitMask >> lane) & 1) {
+			++counters.hits;
+		}
+		else {
+			result[lane] = Fetch(x[lane], y[lane]);
+		}
+	}
+}
+#endif
+
+// Function to get the name of a texel cache mode
+const char* TexelCacheModeName(TexelCacheMode mode) {
+	switch (mode) {
+	case TexelCacheMode::Off: return "off";
+	case TexelCacheMode::Compressed: return "compressed";
+	default: return "all";
+	}
+}
+
+// Function to parse a texel cache mode name
+bool ParseTexelCacheMode(const char* name, TexelCacheMode& mode) {
+	const TexelCacheMode modes[] = { TexelCacheMode::Off, TexelCacheMode::Compressed, TexelCacheMode::All };
+	for (TexelCacheMode candidate : modes) {
+		if (std::strcmp(name, TexelCacheModeName(candidate)) == 0) {
+			mode = candidate;
+			return true;
+		}
+	}
+	return false;
+}
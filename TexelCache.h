@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+
+#include "BlockCompression.h"
+#include "TextureLoader.h"
+
+// Blocks per side of the window the cache holds without conflicts, 16x16 blocks of 4x4 texels cover 64x64 texels
+const int TEXEL_CACHE_SHIFT = 4;
+const int TEXEL_CACHE_DIMENSION = 1 << TEXEL_CACHE_SHIFT;
+const uint32_t TEXEL_CACHE_ENTRIES = TEXEL_CACHE_DIMENSION * TEXEL_CACHE_DIMENSION;
+
+// Which textures the software renderer fetches through its texel caches
+enum class TexelCacheMode {
+	Off,         // every fetch reads the texture
+	Compressed,  // block compressed textures only, each block is decoded once instead of once per texel
+	All          // every texture, RGBA8 blocks are copied out of the texture
+};
+
+// Fetches served by a texel cache
+struct TexelCacheCounters {
+	uint64_t hits = 0;
+	uint64_t misses = 0;  // blocks read from the texture, one per miss
+};
+
+// Direct-mapped cache of decoded 4x4 texel blocks of a texture's base level, keyed by block coordinates.
+// Each entry is one 64-byte line of RGBA8 texels in row order. Entries are picked by the low 4 bits of the block
+// column and row, so any 16x16 block window fits without conflicts, which a tile's footprint does at any rotation.
+// Every rasterizer thread owns one and resets it per tile, so it needs no locks.
+class TexelCache {
+public:
+	TexelCache();
+	TexelCache(const TexelCache&) = delete;
+	TexelCache& operator=(const TexelCache&) = delete;
+
+	/// <summary>
+	/// Invalidates every entry and binds the texture the following fetches read. The counters keep running.
+	/// </summary>
+	/// <param name="texture">- The texture to fetch from, RGBA8 in either layout or block compressed.</param>
+	void Reset(const TextureData& texture);
+
+	/// <summary>
+	/// Fetches a texel of the base level, reading its whole block on a miss.
+	/// </summary>
+	/// <param name="x">- Column of the texel.</param>
+	/// <param name="y">- Row of the texel.</param>
+	/// <returns>The texel as RGBA8 in memory order, red in the lowest byte.</returns>
+	uint32_t Fetch(int x, int y) {
+		uint32_t blockX = static_cast<uint32_t>(x) / BLOCK_DIMENSION;
+		uint32_t blockY = static_cast<uint32_t>(y) / BLOCK_DIMENSION;
+		uint32_t slot = (blockY % TEXEL_CACHE_DIMENSION) * TEXEL_CACHE_DIMENSION + blockX % TEXEL_CACHE_DIMENSION;
+		uint32_t tag = (blockY << 16) | blockX;
+		if (tags[slot] != tag) {
+			Fill(slot, blockX, blockY);
+			tags[slot] = tag;
+			++counters.misses;
+		}
+		else {
+			++counters.hits;
+		}
+		return texels[slot][(y % BLOCK_DIMENSION) * BLOCK_DIMENSION + x % BLOCK_DIMENSION];
+	}
+
+#ifdef SIMD_X86
+	/// <summary>
+	/// Fetches eight texels like Fetch(), looking up every tag at once and gathering the hits straight from the entries.
+	/// Misses are filled one lane at a time.
+	/// </summary>
+	/// <param name="x">- Columns of the texels.</param>
+	/// <param name="y">- Rows of the texels.</param>
+	/// <param name="result">- Receives the texels.</param>
+	void FetchAVX2(const int32_t x[8], const int32_t y[8], uint32_t result[8]);
+#endif
+
+	/// <summary>
+	/// Returns the fetches served since the counters were last cleared.
+	/// </summary>
+	const TexelCacheCounters& Counters() const {
+		return counters;
+	}
+
+	/// <summary>
+	/// Clears the hit and miss counters.
+	/// </summary>
+	void ClearCounters();
+
+private:
+	void Fill(uint32_t slot, uint32_t blockX, uint32_t blockY);
+
+	alignas(64) uint32_t texels[TEXEL_CACHE_ENTRIES][BLOCK_TEXELS];
+	uint32_t tags[TEXEL_CACHE_ENTRIES];  // block row in the high 16 bits, block column in the low 16 bits
+	const TextureData* texture = nullptr;
+	TexelCacheCounters counters;
+};
+
+/// <summary>
+/// Returns the texture bytes a fetch reads: a texel of an RGBA8 texture, or the whole block of a block compressed one.
+/// </summary>
+/// <param name="format">- The texel format.</param>
+/// <returns>4 for RGBA8, the block size otherwise.</returns>
+inline uint32_t GetFetchBytes(TexelFormat format) {
+	return format == TexelFormat::RGBA8 ? 4 : GetBlockBytes(format);
+}
+
+/// <summary>
+/// Returns the texture bytes a texel cache miss reads: 16 texels of an RGBA8 texture, or one block of a block compressed one.
+/// </summary>
+/// <param name="format">- The texel format.</param>
+/// <returns>64 for RGBA8, the block size otherwise.</returns>
+inline uint32_t GetCachedBlockBytes(TexelFormat format) {
+	return format == TexelFormat::RGBA8 ? BLOCK_TEXELS * 4 : GetBlockBytes(format);
+}
+
+/// <summary>
+/// Returns a printable name for a texel cache mode.
+/// </summary>
+/// <param name="mode">- The mode.</param>
+/// <returns>"off", "compressed" or "all".</returns>
+const char* TexelCacheModeName(TexelCacheMode mode);
+
+/// <summary>
+/// Parses a texel cache mode name as returned by TexelCacheModeName().
+/// </summary>
+/// <param name="name">- The name to parse.</param>
+/// <param name="mode">- Receives the parsed mode.</param>
+/// <returns>True if the name is known, otherwise false.</returns>
+bool ParseTexelCacheMode(const char* name, TexelCacheMode& mode);
@@ -0,0 +1,296 @@
+#include "TextureCache.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+static const char TEXTURE_CACHE_MAGIC[4] = { 'T', 'E', 'X', 'C' };
+static const uint32_t TEXTURE_CACHE_VERSION = 1; // bump whenever decoding, mip filtering or block compression changes their output
+static const uint32_t MAX_CACHED_LEVELS = 32;
+static const uint64_t LEVEL_ALIGNMENT = 64;
+
+// Layout of a cache file header, followed by levelCount TextureCacheLevel and the 64-byte aligned level payloads
+struct TextureCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t format;       // TexelFormat of every level
+	uint32_t levelCount;   // the base level and every mip
+	uint64_t optionsKey;   // HashTextureOptions() of the options the levels were built with
+	uint64_t sourceSize;
+	int64_t sourceTime;    // last write time of a loose source, 0 for archived sources
+	uint64_t sourceHash;   // HashAssetData() of the source
+	uint64_t reserved[2];
+};
+
+// One level of a cache file
+struct TextureCacheLevel {
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;       // from the start of the file
+	uint64_t size;         // GetLevelBytes() of the format, whole blocks for block compressed formats
+};
+
+static_assert(sizeof(TextureCacheHeader) == 64, "TextureCacheHeader must be 64 bytes");
+static_assert(sizeof(TextureCacheLevel) == 24, "TextureCacheLevel must be 24 bytes");
+
+// Function to hash the mip and compression options that change the cached levels, RGBA8 entries leave the compression out
+static uint64_t HashTextureOptions(const MipChainOptions& mipOptions, const BlockCompressionOptions* compressionOptions) {
+	unsigned char key[5] = { static_cast<unsigned char>(mipOptions.filter), static_cast<unsigned char>(mipOptions.gammaCorrect), static_cast<unsigned char>(TEXTURE_CACHE_VERSION) };
+	if (compressionOptions == nullptr) {
+		return HashAssetData(key, 3);
+	}
+	key[3] = static_cast<unsigned char>(compressionOptions->format);
+	key[4] = static_cast<unsigned char>(compressionOptions->highQuality);
+	return HashAssetData(key, sizeof(key));
+}
+
+// Function to read the size and last write time of a loose file
+static bool ReadSourceStamp(const std::string& filePath, uint64_t& size, int64_t& time) {
+	std::error_code error;
+	size = std::filesystem::file_size(filePath, error);
+	if (error) {
+		return false;
+	}
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(filePath, error);
+	if (error) {
+		return false;
+	}
+	time = static_cast<int64_t>(writeTime.time_since_epoch().count());
+	return true;
+}
+
+// Function to check a mapped cache file, returns its header or nullptr when it is not a usable entry
+static const TextureCacheHeader* ValidateEntry(const FileView& entry, uint64_t optionsKey, TexelFormat format) {
+	uint64_t fileSize = entry.Size();
+	if (fileSize < sizeof(TextureCacheHeader)) {
+		return nullptr;
+	}
+	const TextureCacheHeader* header = reinterpret_cast<const TextureCacheHeader*>(entry.Data());
+	if (std::memcmp(header->magic, TEXTURE_CACHE_MAGIC, sizeof(TEXTURE_CACHE_MAGIC)) != 0 || header->version != TEXTURE_CACHE_VERSION ||
+		header->format != static_cast<uint32_t>(format) || header->optionsKey != optionsKey || header->levelCount == 0 || header->levelCount > MAX_CACHED_LEVELS ||
+		fileSize < sizeof(TextureCacheHeader) + header->levelCount * sizeof(TextureCacheLevel)) {
+		return nullptr;
+	}
+
+	const TextureCacheLevel* levels = reinterpret_cast<const TextureCacheLevel*>(header + 1);
+	for (uint32_t level = 0; level < header->levelCount; ++level) {
+		const TextureCacheLevel& info = levels[level];
+		if (info.width == 0 || info.height == 0 || info.width > INT32_MAX || info.height > INT32_MAX ||
+			info.size != GetLevelBytes(format, static_cast<int>(info.width), static_cast<int>(info.height)) ||
+			info.offset > fileSize || info.size > fileSize - info.offset) {
+			return nullptr;
+		}
+	}
+	return header;
+}
+
+// Function to copy the levels of a mapped entry into a texture
+static void ReadEntry(const FileView& entry, TextureData& texture) {
+	const TextureCacheHeader* header = reinterpret_cast<const TextureCacheHeader*>(entry.Data());
+	const TextureCacheLevel* levels = reinterpret_cast<const TextureCacheLevel*>(header + 1);
+
+	texture.width = static_cast<int>(levels[0].width);
+	texture.height = static_cast<int>(levels[0].height);
+	texture.format = static_cast<TexelFormat>(header->format);
+	texture.layout = TexelLayout::Linear;
+	texture.pixels.resize(static_cast<size_t>(levels[0].size));
+	std::memcpy(texture.pixels.data(), entry.Data() + levels[0].offset, texture.pixels.size());
+
+	texture.mips.resize(header->levelCount - 1);
+	for (uint32_t level = 1; level < header->levelCount; ++level) {
+		TextureMipLevel& mip = texture.mips[level - 1];
+		mip.width = static_cast<int>(levels[level].width);
+		mip.height = static_cast<int>(levels[level].height);
+		mip.pixels.resize(static_cast<size_t>(levels[level].size));
+		std::memcpy(mip.pixels.data(), entry.Data() + levels[level].offset, mip.pixels.size());
+	}
+}
+
+// Function to write an entry next to its final path, then move it in place so readers never see a partial file
+static uint64_t WriteEntry(const std::string& entryPath, const TextureCacheHeader& header, const TextureData& texture) {
+	std::vector<TextureCacheLevel> levels(header.levelCount);
+	std::vector<const unsigned char*> payloads(header.levelCount);
+	uint64_t offset = sizeof(TextureCacheHeader) + levels.size() * sizeof(TextureCacheLevel);
+	for (uint32_t level = 0; level < header.levelCount; ++level) {
+		const TextureMipLevel* mip = level > 0 ? &texture.mips[level - 1] : nullptr;
+		levels[level].width = static_cast<uint32_t>(mip != nullptr ? mip->width : texture.width);
+		levels[level].height = static_cast<uint32_t>(mip != nullptr ? mip->height : texture.height);
+		levels[level].size = GetLevelBytes(texture.format, static_cast<int>(levels[level].width), static_cast<int>(levels[level].height));
+		offset = (offset + LEVEL_ALIGNMENT - 1) & ~(LEVEL_ALIGNMENT - 1);
+		levels[level].offset = offset;
+		offset += levels[level].size;
+		payloads[level] = mip != nullptr ? mip->pixels.data() : texture.pixels.data();
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(entryPath).parent_path(), error);
+	std::string temporaryPath = entryPath + ".tmp";
+	{
+		std::ofstream writer(temporaryPath, std::ios::binary);
+		if (!writer.is_open()) {
+			return 0;
+		}
+		writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		writer.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(TextureCacheLevel));
+
+		static const char PADDING[LEVEL_ALIGNMENT] = {};
+		uint64_t written = sizeof(TextureCacheHeader) + levels.size() * sizeof(TextureCacheLevel);
+		for (uint32_t level = 0; level < header.levelCount; ++level) {
+			writer.write(PADDING, static_cast<std::streamsize>(levels[level].offset - written));
+			writer.write(reinterpret_cast<const char*>(payloads[level]), static_cast<std::streamsize>(levels[level].size));
+			written = levels[level].offset + levels[level].size;
+		}
+		if (!writer) {
+			writer.close();
+			std::filesystem::remove(temporaryPath, error);
+			return 0;
+		}
+	}
+
+	std::filesystem::rename(temporaryPath, entryPath, error);
+	if (error) {
+		std::filesystem::remove(temporaryPath, error);
+		return 0;
+	}
+	return offset;
+}
+
+// Function to record the source stamp in an entry that was revalidated by its hash, so the next load skips the hash
+static void UpdateEntryStamp(const std::string& entryPath, int64_t sourceTime) {
+	std::fstream writer(entryPath, std::ios::binary | std::ios::in | std::ios::out);
+	if (writer.is_open()) {
+		writer.seekp(offsetof(TextureCacheHeader, sourceTime));
+		writer.write(reinterpret_cast<const char*>(&sourceTime), sizeof(sourceTime));
+	}
+}
+
+TextureCache::TextureCache(const std::string& directory)
+	: directory(directory) {
+}
+
+// Function to name the cache file of a source and its options
+std::string TextureCache::GetEntryPath(const std::string& name, const MipChainOptions& mipOptions, const BlockCompressionOptions* compressionOptions) const {
+	char fileName[32];
+	std::snprintf(fileName, sizeof(fileName), "%016llx.tex", static_cast<unsigned long long>(HashAssetName(name) ^ HashTextureOptions(mipOptions, compressionOptions)));
+	return (std::filesystem::path(directory) / fileName).string();
+}
+
+// Function to name the cache file of an RGBA8 texture
+std::string TextureCache::GetEntryPath(const std::string& name, const MipChainOptions& mipOptions) const {
+	return GetEntryPath(name, mipOptions, nullptr);
+}
+
+// Function to name the cache file of a block compressed texture
+std::string TextureCache::GetEntryPath(const std::string& name, const MipChainOptions& mipOptions, const BlockCompressionOptions& compressionOptions) const {
+	return GetEntryPath(name, mipOptions, &compressionOptions);
+}
+
+// Function to load an RGBA8 texture from the cache, or decode it and fill the cache
+bool TextureCache::Load(ThreadPool& pool, const AssetArchive& archive, const std::string& name, const MipChainOptions& mipOptions, TextureData& texture) {
+	return Load(pool, archive, name, mipOptions, nullptr, texture);
+}
+
+// Function to load a block compressed texture from the cache, or decode and compress it and fill the cache
+bool TextureCache::Load(ThreadPool& pool, const AssetArchive& archive, const std::string& name, const MipChainOptions& mipOptions,
+	const BlockCompressionOptions& compressionOptions, TextureData& texture) {
+	return Load(pool, archive, name, mipOptions, &compressionOptions, texture);
+}
+
+// Function to load a texture from the cache, or decode it, build the mips, compress them when asked and fill the cache
+bool TextureCache::Load(ThreadPool& pool, const AssetArchive& archive, const std::string& name, const MipChainOptions& mipOptions,
+	const BlockCompressionOptions* compressionOptions, TextureData& texture) {
+	auto start = std::chrono::high_resolution_clock::now();
+	uint64_t optionsKey = HashTextureOptions(mipOptions, compressionOptions);
+	TexelFormat format = compressionOptions != nullptr ? compressionOptions->format : TexelFormat::RGBA8;
+	std::string entryPath = GetEntryPath(name, mipOptions, compressionOptions);
+
+	// Only loose files have a stamp worth trusting, an archive can hold a different file by the same name
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	bool stamped = archive.Find(name) == nullptr && ReadSourceStamp(name, sourceSize, sourceTime);
+
+	FileView entry;
+	const TextureCacheHeader* header = nullptr;
+	std::error_code error;
+	if (std::filesystem::exists(entryPath, error) && entry.Open(entryPath, FileAccess::Normal)) {
+		header = ValidateEntry(entry, optionsKey, format);
+	}
+	bool hit = header != nullptr && stamped && header->sourceTime == sourceTime && header->sourceSize == sourceSize;
+	bool revalidated = false;
+
+	AssetData source;
+	if (!hit) {
+		if (!LoadAsset(archive, name, source)) {
+			return false;
+		}
+		uint64_t sourceHash = HashAssetData(source.data, source.size);
+		revalidated = header != nullptr && header->sourceHash == sourceHash && header->sourceSize == source.size;
+		hit = revalidated;
+
+		if (!hit) {
+			// Decode, build the mips and compress them, then keep them for next time
+			texture = TextureData();
+			if (!LoadTextureData(pool, source.data, source.size, name, texture)) {
+				return false;
+			}
+			if (compressionOptions != nullptr) {
+				PadToBlocks(texture);
+			}
+			BuildMipChain(pool, mipOptions, texture);
+			if (compressionOptions != nullptr) {
+				TextureData compressed;
+				if (!CompressTexture(pool, *compressionOptions, texture, compressed)) {
+					return false;
+				}
+				texture = std::move(compressed);
+			}
+
+			TextureCacheHeader newHeader = {};
+			std::memcpy(newHeader.magic, TEXTURE_CACHE_MAGIC, sizeof(TEXTURE_CACHE_MAGIC));
+			newHeader.version = TEXTURE_CACHE_VERSION;
+			newHeader.format = static_cast<uint32_t>(texture.format);
+			newHeader.levelCount = static_cast<uint32_t>(texture.mips.size() + 1);
+			newHeader.optionsKey = optionsKey;
+			newHeader.sourceSize = source.size;
+			newHeader.sourceTime = stamped ? sourceTime : 0;
+			newHeader.sourceHash = sourceHash;
+			entry.Close();
+			uint64_t written = WriteEntry(entryPath, newHeader, texture);
+
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+			std::lock_guard<std::mutex> lock(statsMutex);
+			++stats.misses;
+			stats.stale += header != nullptr;
+			stats.bytesWritten += written;
+			stats.missMilliseconds += elapsed.count();
+			return true;
+		}
+	}
+
+	ReadEntry(entry, texture);
+	uint64_t mapped = entry.Size();
+	if (revalidated && stamped) {
+		entry.Close();
+		UpdateEntryStamp(entryPath, sourceTime);
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	std::lock_guard<std::mutex> lock(statsMutex);
+	++stats.hits;
+	stats.revalidated += revalidated;
+	stats.bytesMapped += mapped;
+	stats.hitMilliseconds += elapsed.count();
+	return true;
+}
+
+// Function to read the cache counters
+TextureCacheStats TextureCache::GetStats() const {
+	std::lock_guard<std::mutex> lock(statsMutex);
+	return stats;
+}
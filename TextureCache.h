@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "AssetArchive.h"
+#include "BlockCompression.h"
+#include "MipChain.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+// Counters of a TextureCache, times are the whole Load() call
+struct TextureCacheStats {
+	uint64_t hits = 0;
+	uint64_t revalidated = 0;   // hits whose source stamp changed but whose content hash still matched
+	uint64_t misses = 0;
+	uint64_t stale = 0;         // misses that replaced an entry of an older version of the source
+	uint64_t bytesMapped = 0;
+	uint64_t bytesWritten = 0;
+	double hitMilliseconds = 0.0;
+	double missMilliseconds = 0.0;
+};
+
+// On-disk cache of decoded textures with their full mip chain, RGBA8 or block compressed, so an unchanged image is never
+// decoded, filtered or compressed twice. Entries are named by the source name, the mip options and the compression options,
+// and hold the source's size, last write time and
+// content hash. A loose source whose size and time match is a hit without reading it, otherwise the source is
+// hashed and a matching hash is still a hit. Archived sources are always checked by hash. Hits map the entry.
+class TextureCache {
+public:
+	/// <summary>
+	/// Uses a directory for the entries, it is created with the first entry.
+	/// </summary>
+	/// <param name="directory">- Directory of the cache files.</param>
+	explicit TextureCache(const std::string& directory);
+
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	/// <summary>
+	/// Loads a texture with its mips from the cache, or decodes the image, builds the mips and stores them in the cache.
+	/// Entries that cannot be written only cost the cache, the texture still loads.
+	/// </summary>
+	/// <param name="pool">- The threads decoding and filtering on a miss.</param>
+	/// <param name="archive">- The archive the image is looked up in first, may be closed, see LoadAsset().</param>
+	/// <param name="name">- Asset name of the image.</param>
+	/// <param name="mipOptions">- How the mip levels are filtered, the SIMD level is not part of the key.</param>
+	/// <param name="texture">- Receives the texture and its mips.</param>
+	/// <returns>True if the texture was loaded, otherwise false.</returns>
+	bool Load(ThreadPool& pool, const AssetArchive& archive, const std::string& name, const MipChainOptions& mipOptions, TextureData& texture);
+
+	/// <summary>
+	/// Loads a block compressed texture with its mips from the cache, or decodes the image, pads it to whole blocks with PadToBlocks(),
+	/// builds the mips, compresses every level and stores the blocks in the cache. Hits skip the decode, the mips and the encode.
+	/// </summary>
+	/// <param name="pool">- The threads decoding, filtering and compressing on a miss.</param>
+	/// <param name="archive">- The archive the image is looked up in first, may be closed, see LoadAsset().</param>
+	/// <param name="name">- Asset name of the image.</param>
+	/// <param name="mipOptions">- How the mip levels are filtered, the SIMD level is not part of the key.</param>
+	/// <param name="compressionOptions">- Format and quality of the blocks, the SIMD level is not part of the key.</param>
+	/// <param name="texture">- Receives the compressed texture and its mips.</param>
+	/// <returns>True if the texture was loaded, otherwise false.</returns>
+	bool Load(ThreadPool& pool, const AssetArchive& archive, const std::string& name, const MipChainOptions& mipOptions,
+		const BlockCompressionOptions& compressionOptions, TextureData& texture);
+
+	/// <summary>
+	/// Returns the counters since the cache was created.
+	/// </summary>
+	TextureCacheStats GetStats() const;
+
+	/// <summary>
+	/// Returns the path of the cache file of a source and its options.
+	/// </summary>
+	std::string GetEntryPath(const std::string& name, const MipChainOptions& mipOptions) const;
+	std::string GetEntryPath(const std::string& name, const MipChainOptions& mipOptions, const BlockCompressionOptions& compressionOptions) const;
+
+private:
+	bool Load(ThreadPool& pool, const AssetArchive& archive, const std::string& name, const MipChainOptions& mipOptions,
+		const BlockCompressionOptions* compressionOptions, TextureData& texture);
+	std::string GetEntryPath(const std::string& name, const MipChainOptions& mipOptions, const BlockCompressionOptions* compressionOptions) const;
+
+	std::string directory;
+	mutable std::mutex statsMutex;
+	TextureCacheStats stats;
+};
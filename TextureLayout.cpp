@@ -0,0 +1,70 @@
+#include "TextureLayout.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Function to reorder every level of a texture
+bool ConvertTextureLayout(ThreadPool& pool, TexelLayout layout, const TextureData& source, TextureData& converted) {
+	if (source.format != TexelFormat::RGBA8 || &source == &converted) {
+		std::cerr << "Unsupported texture layout conversion: " << TexelLayoutName(source.layout) << " to " << TexelLayoutName(layout) << std::endl;
+		return false;
+	}
+
+	converted.width = source.width;
+	converted.height = source.height;
+	converted.format = source.format;
+	converted.layout = layout;
+	converted.mips.resize(source.mips.size());
+	for (size_t level = 0; level <= source.mips.size(); ++level) {
+		const TexelBuffer& pixels = level == 0 ? source.pixels : source.mips[level - 1].pixels;
+		int width = level == 0 ? source.width : source.mips[level - 1].width;
+		int height = level == 0 ? source.height : source.mips[level - 1].height;
+		TexelBuffer& reordered = level == 0 ? converted.pixels : converted.mips[level - 1].pixels;
+		if (level > 0) {
+			converted.mips[level - 1].width = width;
+			converted.mips[level - 1].height = height;
+		}
+
+		// Every stored texel is written, the padding of tiled levels repeats the edge texels
+		int storedWidth = width;
+		int storedHeight = height;
+		if (layout == TexelLayout::Tiled) {
+			storedWidth = (width + TEXEL_TILE_DIMENSION - 1) / TEXEL_TILE_DIMENSION * TEXEL_TILE_DIMENSION;
+			storedHeight = (height + TEXEL_TILE_DIMENSION - 1) / TEXEL_TILE_DIMENSION * TEXEL_TILE_DIMENSION;
+		}
+		reordered.resize(GetLayoutTexelCount(layout, width, height) * 4);
+		const uint32_t* input = reinterpret_cast<const uint32_t*>(pixels.data());
+		uint32_t* output = reinterpret_cast<uint32_t*>(reordered.data());
+		uint32_t bands = static_cast<uint32_t>((storedHeight + TEXEL_TILE_DIMENSION - 1) / TEXEL_TILE_DIMENSION);
+		pool.ParallelFor(bands, [&](uint32_t band, uint32_t) {
+			int firstRow = static_cast<int>(band) * TEXEL_TILE_DIMENSION;
+			int lastRow = std::min(firstRow + TEXEL_TILE_DIMENSION, storedHeight);
+			for (int y = firstRow; y < lastRow; ++y) {
+				int sourceY = std::min(y, height - 1);
+				for (int x = 0; x < storedWidth; ++x) {
+					int sourceX = std::min(x, width - 1);
+					output[GetTexelIndex(layout, width, x, y)] = input[GetTexelIndex(source.layout, width, sourceX, sourceY)];
+				}
+			}
+		});
+	}
+	return true;
+}
+
+// Function to get the name of a texel layout
+const char* TexelLayoutName(TexelLayout layout) {
+	return layout == TexelLayout::Tiled ? "tiled" : "linear";
+}
+
+// Function to parse a texel layout name
+bool ParseTexelLayout(const char* name, TexelLayout& layout) {
+	const TexelLayout layouts[] = { TexelLayout::Linear, TexelLayout::Tiled };
+	for (TexelLayout candidate : layouts) {
+		if (std::strcmp(name, TexelLayoutName(candidate)) == 0) {
+			layout = candidate;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+// Tiled levels are stored as 32x32 texel tiles, 4 KB of RGBA8 or one page each, in row-major tile order.
+// Within a tile the texels follow the Morton (Z-order) curve, so every aligned 4x4 texel square is one 64-byte cache line
+// and texels close in both directions are close in memory, whatever direction the sampling footprints move in.
+// The level is padded to whole tiles with its edge texels.
+const int TEXEL_TILE_SHIFT = 5;
+const int TEXEL_TILE_DIMENSION = 1 << TEXEL_TILE_SHIFT;
+const int TEXEL_TILE_TEXELS = TEXEL_TILE_DIMENSION * TEXEL_TILE_DIMENSION;
+
+/// <summary>
+/// Spreads the low 8 bits of a value to the even bits, the Morton code of a coordinate.
+/// </summary>
+inline uint32_t SpreadMortonBits(uint32_t value) {
+	value &= 0xFF;
+	value = (value | (value << 4)) & 0x0F0F;
+	value = (value | (value << 2)) & 0x3333;
+	value = (value | (value << 1)) & 0x5555;
+	return value;
+}
+
+/// <summary>
+/// Returns the position of a texel in a tiled level.
+/// </summary>
+/// <param name="width">- Width of the level in texels.</param>
+/// <param name="x">- Column of the texel.</param>
+/// <param name="y">- Row of the texel.</param>
+/// <returns>The texel index, multiply by 4 for the byte offset.</returns>
+inline size_t GetTiledTexelIndex(int width, int x, int y) {
+	size_t tilesWide = static_cast<size_t>((width + TEXEL_TILE_DIMENSION - 1) >> TEXEL_TILE_SHIFT);
+	size_t tile = (static_cast<size_t>(y) >> TEXEL_TILE_SHIFT) * tilesWide + (static_cast<size_t>(x) >> TEXEL_TILE_SHIFT);
+	uint32_t mask = TEXEL_TILE_DIMENSION - 1;
+	return tile * TEXEL_TILE_TEXELS + (SpreadMortonBits(x & mask) | (SpreadMortonBits(y & mask) << 1));
+}
+
+/// <summary>
+/// Returns the position of a texel in a level of either layout.
+/// </summary>
+/// <param name="layout">- Texel order of the level.</param>
+/// <param name="width">- Width of the level in texels.</param>
+/// <param name="x">- Column of the texel.</param>
+/// <param name="y">- Row of the texel.</param>
+/// <returns>The texel index, multiply by 4 for the byte offset.</returns>
+inline size_t GetTexelIndex(TexelLayout layout, int width, int x, int y) {
+	return layout == TexelLayout::Tiled ? GetTiledTexelIndex(width, x, y) : static_cast<size_t>(y) * width + x;
+}
+
+/// <summary>
+/// Returns the number of texels a level of either layout stores, including the padding of tiled levels.
+/// </summary>
+inline size_t GetLayoutTexelCount(TexelLayout layout, int width, int height) {
+	if (layout == TexelLayout::Linear) {
+		return static_cast<size_t>(width) * height;
+	}
+	size_t tilesWide = static_cast<size_t>((width + TEXEL_TILE_DIMENSION - 1) >> TEXEL_TILE_SHIFT);
+	size_t tilesHigh = static_cast<size_t>((height + TEXEL_TILE_DIMENSION - 1) >> TEXEL_TILE_SHIFT);
+	return tilesWide * tilesHigh * TEXEL_TILE_TEXELS;
+}
+
+/// <summary>
+/// Reorders every level of an RGBA8 texture to another layout, tile rows are spread across the pool.
+/// Tiled textures are for the software sampler only, Direct3D textures are uploaded linear and tiled by the driver.
+/// </summary>
+/// <param name="pool">- The threads reordering the tile rows.</param>
+/// <param name="layout">- The layout to convert to.</param>
+/// <param name="source">- The RGBA8 texture with its mips.</param>
+/// <param name="converted">- Receives the reordered levels, must not be the source.</param>
+/// <returns>True if the texture was converted, otherwise false.</returns>
+bool ConvertTextureLayout(ThreadPool& pool, TexelLayout layout, const TextureData& source, TextureData& converted);
+
+/// <summary>
+/// Returns a printable name for a texel layout.
+/// </summary>
+/// <param name="layout">- The texel layout.</param>
+/// <returns>"linear" or "tiled".</returns>
+const char* TexelLayoutName(TexelLayout layout);
+
+/// <summary>
+/// Parses a texel layout name as returned by TexelLayoutName().
+/// </summary>
+/// <param name="name">- The name to parse.</param>
+/// <param name="layout">- Receives the parsed layout.</param>
+/// <returns>True if the name is known, otherwise false.</returns>
+bool ParseTexelLayout(const char* name, TexelLayout& layout);
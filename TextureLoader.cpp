@@ -0,0 +1,161 @@
+#include "TextureLoader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+
+#include "FileView.h"
+
+// Every decoder allocation carries its size in front so the working memory can be tracked
+static const size_t ALLOCATION_HEADER = 16;
+static std::atomic<size_t> decoderBytes{ 0 };
+static std::atomic<size_t> decoderPeakBytes{ 0 };
+
+// Function to account for a decoder allocation changing size
+static void TrackDecoderBytes(size_t added, size_t removed) {
+	size_t current = decoderBytes.fetch_add(added) + added - removed;
+	decoderBytes.fetch_sub(removed);
+	size_t peak = decoderPeakBytes.load();
+	while (current > peak && !decoderPeakBytes.compare_exchange_weak(peak, current)) {
+	}
+}
+
+// Function to allocate decoder memory
+static void* DecoderMalloc(size_t size) {
+	unsigned char* block = static_cast<unsigned char*>(std::malloc(size + ALLOCATION_HEADER));
+	if (block == nullptr) {
+		return nullptr;
+	}
+	*reinterpret_cast<size_t*>(block) = size;
+	TrackDecoderBytes(size, 0);
+	return block + ALLOCATION_HEADER;
+}
+
+// Function to free decoder memory
+static void DecoderFree(void* pointer) {
+	if (pointer == nullptr) {
+		return;
+	}
+	unsigned char* block = static_cast<unsigned char*>(pointer) - ALLOCATION_HEADER;
+	TrackDecoderBytes(0, *reinterpret_cast<size_t*>(block));
+	std::free(block);
+}
+
+// Function to resize decoder memory
+static void* DecoderRealloc(void* pointer, size_t size) {
+	if (pointer == nullptr) {
+		return DecoderMalloc(size);
+	}
+	unsigned char* block = static_cast<unsigned char*>(pointer) - ALLOCATION_HEADER;
+	size_t previous = *reinterpret_cast<size_t*>(block);
+	unsigned char* resized = static_cast<unsigned char*>(std::realloc(block, size + ALLOCATION_HEADER));
+	if (resized == nullptr) {
+		return nullptr;
+	}
+	*reinterpret_cast<size_t*>(resized) = size;
+	TrackDecoderBytes(size, previous);
+	return resized + ALLOCATION_HEADER;
+}
+
+#define STBI_MALLOC(size) DecoderMalloc(size)
+#define STBI_REALLOC(pointer, size) DecoderRealloc(pointer, size)
+#define STBI_FREE(pointer) DecoderFree(pointer)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// Function to run the decoder's tasks on a thread pool
+static void DecoderParallelFor(void* pool, int count, stbi_parallel_task task, void* taskContext) {
+	static_cast<ThreadPool*>(pool)->ParallelFor(static_cast<uint32_t>(count), [task, taskContext](uint32_t index, uint32_t) {
+		task(taskContext, static_cast<int>(index));
+	});
+}
+
+// Function to load an image as RGBA, decoded in place straight from the file bytes, serially without a pool
+static bool DecodeTexture(ThreadPool* pool, int scaleShift, const unsigned char* data, size_t size, const std::string& filePath, TextureData& texture) {
+	if (size > static_cast<size_t>(INT_MAX)) {
+		std::cerr << "Image file too large: " << filePath << std::endl;
+		return false;
+	}
+	const stbi_uc* fileData = data;
+	int fileSize = static_cast<int>(size);
+
+	// Read the dimensions first so the decoder can write into the final buffer
+	int width, height, channels;
+	if (!stbi_info_from_memory(fileData, fileSize, &width, &height, &channels)) {
+		std::cerr << "Failed to load image: " << filePath << std::endl;
+		return false;
+	}
+	width = (width + (1 << scaleShift) - 1) >> scaleShift;
+	height = (height + (1 << scaleShift) - 1) >> scaleShift;
+
+	texture.pixels.resize(static_cast<size_t>(width) * height * 4);
+	int loaded = 0;
+	if (scaleShift > 0) {
+		loaded = stbi_load_from_memory_into_scaled(fileData, fileSize, texture.pixels.data(), texture.pixels.size(), &width, &height, &channels, 4, scaleShift);
+	}
+	else if (pool != nullptr) {
+		loaded = stbi_load_from_memory_into_parallel(fileData, fileSize, texture.pixels.data(), texture.pixels.size(), &width, &height, &channels, 4, DecoderParallelFor, pool);
+	}
+	else {
+		loaded = stbi_load_from_memory_into(fileData, fileSize, texture.pixels.data(), texture.pixels.size(), &width, &height, &channels, 4);
+	}
+	if (!loaded) {
+		std::cerr << "Failed to load image: " << filePath << std::endl;
+		return false;
+	}
+
+	texture.width = width;
+	texture.height = height;
+	texture.mips.clear();
+
+	// Images with their own alpha are forced opaque, like the texture always was
+	if (channels == 2 || channels == 4) {
+		for (size_t i = 3; i < texture.pixels.size(); i += 4) {
+			texture.pixels[i] = 255;
+		}
+	}
+
+	return true;
+}
+
+// Function to load an image as RGBA on the calling thread
+bool LoadTextureData(const std::string& filePath, TextureData& texture) {
+	FileView file;
+	return file.Open(filePath, FileAccess::Sequential) && DecodeTexture(nullptr, 0, file.Data(), file.Size(), filePath, texture);
+}
+
+// Function to load an image as RGBA with the decoder spread across a pool
+bool LoadTextureData(ThreadPool& pool, const std::string& filePath, TextureData& texture) {
+	FileView file;
+	return file.Open(filePath, FileAccess::Sequential) && DecodeTexture(&pool, 0, file.Data(), file.Size(), filePath, texture);
+}
+
+// Function to decode an image file that is already in memory, with the decoder spread across a pool
+bool LoadTextureData(ThreadPool& pool, const unsigned char* data, size_t size, const std::string& filePath, TextureData& texture) {
+	return DecodeTexture(&pool, 0, data, size, filePath, texture);
+}
+
+// Function to load a JPEG at a fraction of its size
+bool LoadTextureDataScaled(const std::string& filePath, int scaleShift, TextureData& texture) {
+	if (scaleShift < 0 || scaleShift > 3) {
+		std::cerr << "Unsupported texture scale: 1/" << (1 << std::max(scaleShift, 0)) << std::endl;
+		return false;
+	}
+	FileView file;
+	return file.Open(filePath, FileAccess::Sequential) && DecodeTexture(nullptr, scaleShift, file.Data(), file.Size(), filePath, texture);
+}
+
+// Function to read the decoder memory counters
+DecoderMemoryStats GetDecoderMemory() {
+	DecoderMemoryStats stats;
+	stats.currentBytes = decoderBytes.load();
+	stats.peakBytes = decoderPeakBytes.load();
+	return stats;
+}
+
+// Function to restart peak tracking
+void ResetDecoderPeakMemory() {
+	decoderPeakBytes.store(decoderBytes.load());
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.h"
+
+// Allocator for texel buffers: cache line aligned for SIMD access, and resize() leaves new texels
+// uninitialized because decoders and filters overwrite every byte anyway
+template <typename T>
+struct TexelAllocator {
+	typedef T value_type;
+	static const size_t ALIGNMENT = 64;
+
+	TexelAllocator() = default;
+	template <typename U>
+	TexelAllocator(const TexelAllocator<U>&) {}
+
+	T* allocate(size_t count) {
+		return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(ALIGNMENT)));
+	}
+	void deallocate(T* pointer, size_t) {
+		::operator delete(pointer, std::align_val_t(ALIGNMENT));
+	}
+
+	// Default-initialize instead of value-initialize, no zero fill
+	template <typename U>
+	void construct(U* pointer) {
+		::new (static_cast<void*>(pointer)) U;
+	}
+	template <typename U, typename... Args>
+	void construct(U* pointer, Args&&... args) {
+		::new (static_cast<void*>(pointer)) U(std::forward<Args>(args)...);
+	}
+
+	template <typename U>
+	bool operator==(const TexelAllocator<U>&) const { return true; }
+	template <typename U>
+	bool operator!=(const TexelAllocator<U>&) const { return false; }
+};
+
+typedef std::vector<unsigned char, TexelAllocator<unsigned char>> TexelBuffer;
+
+// Layouts of texel data. Block compressed formats store rows of 4x4 texel blocks, partial blocks at the edges
+// are padded with replicated texels, see BlockCompression.h
+enum class TexelFormat {
+	RGBA8,  // tightly packed RGBA8 rows
+	BC1,    // 8 bytes per block, RGB with two 5:6:5 endpoints and 2-bit indices
+	BC3,    // 16 bytes per block, a BC4 alpha block followed by a BC1 color block
+	BC7     // 16 bytes per block, RGBA with up to 8-bit endpoints and 4-bit indices
+};
+
+// Orders of the texels of RGBA8 levels, see TextureLayout.h
+enum class TexelLayout {
+	Linear,  // row-major
+	Tiled    // 32x32 texel tiles in row-major order, Morton order within a tile
+};
+
+// One level of a mip chain below the base level, laid out like the base level
+struct TextureMipLevel {
+	int width = 0;
+	int height = 0;
+	TexelBuffer pixels;
+};
+
+// CPU-side texture prepared for upload or software sampling, tightly packed RGBA8 rows unless it was compressed
+struct TextureData {
+	int width = 0;
+	int height = 0;
+	TexelFormat format = TexelFormat::RGBA8; // encoding of the pixels of every level
+	TexelLayout layout = TexelLayout::Linear; // texel order of every level, RGBA8 only
+	TexelBuffer pixels;
+	std::vector<TextureMipLevel> mips; // levels 1 and up, empty until BuildMipChain() runs
+};
+
+// Memory allocated by the image decoder, tracked through STBI_MALLOC
+struct DecoderMemoryStats {
+	size_t currentBytes = 0;
+	size_t peakBytes = 0;
+};
+
+/// <summary>
+/// Loads an image file as RGBA8 with alpha set to 255. The decoder reads the memory mapped file and writes straight into texture.pixels,
+/// JPEG color conversion fills in alpha, so there is no second copy of the file or the image.
+/// </summary>
+/// <param name="filePath">- Path to the image file.</param>
+/// <param name="texture">- Receives the texture dimensions and pixels.</param>
+/// <returns>True if the image was loaded, otherwise false.</returns>
+bool LoadTextureData(const std::string& filePath, TextureData& texture);
+
+/// <summary>
+/// Loads an image file like LoadTextureData(filePath, texture) with the decoder spread across a pool.
+/// Baseline JPEGs with restart markers are entropy decoded one restart interval per task, the upsampling and color
+/// conversion of every JPEG runs in bands of rows. Other files decode serially, the pixels are identical either way.
+/// </summary>
+/// <param name="pool">- The threads running the decoder.</param>
+/// <param name="filePath">- Path to the image file.</param>
+/// <param name="texture">- Receives the texture dimensions and pixels.</param>
+/// <returns>True if the image was loaded, otherwise false.</returns>
+bool LoadTextureData(ThreadPool& pool, const std::string& filePath, TextureData& texture);
+
+/// <summary>
+/// Decodes an image file that is already in memory like LoadTextureData(pool, filePath, texture), so the read and the decode
+/// can be scheduled apart and images can come from a mapped file or an archive.
+/// </summary>
+/// <param name="pool">- The threads running the decoder.</param>
+/// <param name="data">- The encoded image file.</param>
+/// <param name="size">- Size of the image file in bytes.</param>
+/// <param name="filePath">- Name of the image, for error messages.</param>
+/// <param name="texture">- Receives the texture dimensions and pixels.</param>
+/// <returns>True if the image was loaded, otherwise false.</returns>
+bool LoadTextureData(ThreadPool& pool, const unsigned char* data, size_t size, const std::string& filePath, TextureData& texture);
+
+/// <summary>
+/// Loads a JPEG at 1/2, 1/4 or 1/8 of its size, for previews, low mips and LOD streaming. Each 8x8 block is transformed
+/// straight to 4x4, 2x2 or 1x1 pixels from its low frequencies, so the full size image is never built.
+/// The result is ceil(width / scale) by ceil(height / scale) and slightly softer than a filtered downsample.
+/// </summary>
+/// <param name="filePath">- Path to the JPEG file.</param>
+/// <param name="scaleShift">- 0 to 3 for 1/1, 1/2, 1/4 and 1/8 of the size, only 0 works for other formats.</param>
+/// <param name="texture">- Receives the texture dimensions and pixels.</param>
+/// <returns>True if the image was loaded, otherwise false.</returns>
+bool LoadTextureDataScaled(const std::string& filePath, int scaleShift, TextureData& texture);
+
+/// <summary>
+/// Returns the current and peak memory held by the image decoder.
+/// </summary>
+DecoderMemoryStats GetDecoderMemory();
+
+/// <summary>
+/// Restarts peak tracking of the image decoder memory at its current allocation.
+/// </summary>
+void ResetDecoderPeakMemory();
@@ -0,0 +1,532 @@
+#include "TextureSampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "BlockCompression.h"
+#include "TextureLayout.h"
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Multiplies and adds must not be fused into FMA, the kernels round exactly like the scalar ones
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+static const float SMALLEST_NORMAL = 1.17549435e-38f;
+
+// Coordinates further out than this, infinities and NaNs sample at 0 instead of overflowing the texel addresses
+static const float MAX_COORDINATE = 1e7f;
+
+// Coefficients of log2(m) = c0 + m (c1 + m (c2 + m (c3 + m c4))), m in [1, 2), exact at 1 and within 2e-4, ample for level selection
+static const float LOG2_C0 = -2.52450051f;
+static const float LOG2_C1 = 4.10261242f;
+static const float LOG2_C2 = -2.15454182f;
+static const float LOG2_C3 = 0.660703065f;
+static const float LOG2_C4 = -0.0842731506f;
+
+// The levels of the sampled texture, in tables the AVX2 kernel gathers from with each sample's level
+struct SamplerLevels {
+	const unsigned char* pixels[MAX_SAMPLER_LEVELS];
+	int64_t offset[MAX_SAMPLER_LEVELS];  // bytes from the base level's pixels
+	int32_t width[MAX_SAMPLER_LEVELS];
+	int32_t height[MAX_SAMPLER_LEVELS];
+	int32_t tilesWide[MAX_SAMPLER_LEVELS];
+	float widthF[MAX_SAMPLER_LEVELS];
+	float heightF[MAX_SAMPLER_LEVELS];
+	int32_t count;
+	TexelFormat format;
+	TexelLayout layout;
+};
+
+// Function to fill the level tables of a texture
+static void SetupLevels(const TextureData& texture, SamplerLevels& levels) {
+	levels.count = static_cast<int32_t>(std::min<size_t>(texture.mips.size() + 1, MAX_SAMPLER_LEVELS));
+	levels.format = texture.format;
+	levels.layout = texture.layout;
+	for (int32_t level = 0; level < levels.count; ++level) {
+		const TexelBuffer& pixels = level == 0 ? texture.pixels : texture.mips[level - 1].pixels;
+		levels.pixels[level] = pixels.data();
+		levels.offset[level] = reinterpret_cast<intptr_t>(pixels.data()) - reinterpret_cast<intptr_t>(texture.pixels.data());
+		levels.width[level] = level == 0 ? texture.width : texture.mips[level - 1].width;
+		levels.height[level] = level == 0 ? texture.height : texture.mips[level - 1].height;
+		levels.tilesWide[level] = (levels.width[level] + TEXEL_TILE_DIMENSION - 1) >> TEXEL_TILE_SHIFT;
+		levels.widthF[level] = static_cast<float>(levels.width[level]);
+		levels.heightF[level] = static_cast<float>(levels.height[level]);
+	}
+}
+
+// Function to clamp the anisotropy to what Direct3D allows
+static float GetMaxAnisotropy(const SamplerDesc& sampler) {
+	return static_cast<float>(std::min(std::max(sampler.maxAnisotropy, 1u), 16u));
+}
+
+// Minimum and maximum with the operand order of minps and maxps, so NaNs resolve the same way in every kernel
+static float MinFloat(float a, float b) {
+	return a < b ? a : b;
+}
+
+static float MaxFloat(float a, float b) {
+	return a > b ? a : b;
+}
+
+// Function to approximate log2 of a positive float
+static float Log2Approximate(float x) {
+	uint32_t bits;
+	std::memcpy(&bits, &x, sizeof(bits));
+	float exponent = static_cast<float>(static_cast<int32_t>(bits >> 23) - 127);
+	bits = (bits & 0x7FFFFF) | 0x3F800000;
+	float mantissa;
+	std::memcpy(&mantissa, &bits, sizeof(mantissa));
+	return exponent + (LOG2_C0 + mantissa * (LOG2_C1 + mantissa * (LOG2_C2 + mantissa * (LOG2_C3 + mantissa * LOG2_C4))));
+}
+
+// Function to move a coordinate into the range its address mode handles with single texel steps
+static float ReduceCoordinate(float u, TextureAddressMode mode) {
+	switch (mode) {
+	case TextureAddressMode::Wrap: return u - std::floor(u);
+	case TextureAddressMode::Mirror: return u - 2.0f * std::floor(u * 0.5f);
+	default: return MinFloat(MaxFloat(u, -1.0f), 2.0f);
+	}
+}
+
+// Function to apply an address mode to a texel coordinate at most one period outside the level, border flags texels outside it
+static int AddressTexel(int x, int size, TextureAddressMode mode, bool& border) {
+	switch (mode) {
+	case TextureAddressMode::Wrap:
+		return x < 0 ? x + size : (x >= size ? x - size : x);
+	case TextureAddressMode::Mirror: {
+		int period = 2 * size;
+		int p = x < 0 ? x + period : (x >= period ? x - period : x);
+		return p >= size ? period - 1 - p : p;
+	}
+	case TextureAddressMode::Border:
+		border = border || x < 0 || x >= size;
+		return std::min(std::max(x, 0), size - 1);
+	default:
+		return std::min(std::max(x, 0), size - 1);
+	}
+}
+
+// Function to fetch a texel of a level as RGBA8
+static uint32_t FetchTexel(const SamplerLevels& levels, int level, int x, int y) {
+	if (levels.format != TexelFormat::RGBA8) {
+		return FetchBlockTexel(levels.format, levels.pixels[level], levels.width[level], x, y);
+	}
+	uint32_t texel;
+	std::memcpy(&texel, levels.pixels[level] + GetTexelIndex(levels.layout, levels.width[level], x, y) * 4, sizeof(texel));
+	return texel;
+}
+
+// Function to convert a texel to normalized floats, or take the border color
+static void TexelToColor(uint32_t texel, bool border, const float borderColor[4], float color[4]) {
+	for (int c = 0; c < 4; ++c) {
+		color[c] = border ? borderColor[c] : static_cast<float>((texel >> (8 * c)) & 0xFF) * (1.0f / 255.0f);
+	}
+}
+
+// Function to sample one level with point or bilinear filtering
+static void SampleLevel(const SamplerLevels& levels, const SamplerDesc& sampler, bool linear, int level, float u, float v, float color[4]) {
+	int width = levels.width[level];
+	int height = levels.height[level];
+	if (!linear) {
+		bool border = false;
+		int x = AddressTexel(static_cast<int>(std::floor(u * levels.widthF[level])), width, sampler.addressU, border);
+		int y = AddressTexel(static_cast<int>(std::floor(v * levels.heightF[level])), height, sampler.addressV, border);
+		TexelToColor(FetchTexel(levels, level, x, y), border, sampler.borderColor, color);
+		return;
+	}
+
+	float tx = u * levels.widthF[level] - 0.5f;
+	float ty = v * levels.heightF[level] - 0.5f;
+	float floorX = std::floor(tx);
+	float floorY = std::floor(ty);
+	float fx = tx - floorX;
+	float fy = ty - floorY;
+	bool borderX0 = false, borderX1 = false, borderY0 = false, borderY1 = false;
+	int x0 = AddressTexel(static_cast<int>(floorX), width, sampler.addressU, borderX0);
+	int x1 = AddressTexel(static_cast<int>(floorX) + 1, width, sampler.addressU, borderX1);
+	int y0 = AddressTexel(static_cast<int>(floorY), height, sampler.addressV, borderY0);
+	int y1 = AddressTexel(static_cast<int>(floorY) + 1, height, sampler.addressV, borderY1);
+
+	float c00[4], c10[4], c01[4], c11[4];
+	TexelToColor(FetchTexel(levels, level, x0, y0), borderX0 || borderY0, sampler.borderColor, c00);
+	TexelToColor(FetchTexel(levels, level, x1, y0), borderX1 || borderY0, sampler.borderColor, c10);
+	TexelToColor(FetchTexel(levels, level, x0, y1), borderX0 || borderY1, sampler.borderColor, c01);
+	TexelToColor(FetchTexel(levels, level, x1, y1), borderX1 || borderY1, sampler.borderColor, c11);
+	for (int c = 0; c < 4; ++c) {
+		float top = c00[c] + (c10[c] - c00[c]) * fx;
+		float bottom = c01[c] + (c11[c] - c01[c]) * fx;
+		color[c] = top + (bottom - top) * fy;
+	}
+}
+
+// Function to filter one sample of a batch
+static void SampleOne(const SamplerLevels& levels, const SamplerDesc& sampler, const SampleBatch& batch, uint32_t lane, float out[4]) {
+	float u = std::fabs(batch.u[lane]) <= MAX_COORDINATE ? batch.u[lane] : 0.0f;
+	float v = std::fabs(batch.v[lane]) <= MAX_COORDINATE ? batch.v[lane] : 0.0f;
+
+	// Squared lengths of the texel-space derivatives
+	float dxu = batch.dudx[lane] * levels.widthF[0];
+	float dxv = batch.dvdx[lane] * levels.heightF[0];
+	float dyu = batch.dudy[lane] * levels.widthF[0];
+	float dyv = batch.dvdy[lane] * levels.heightF[0];
+	float lengthX = dxu * dxu + dxv * dxv;
+	float lengthY = dyu * dyu + dyv * dyv;
+	float major = MaxFloat(lengthX, lengthY);
+
+	// Anisotropic filtering spreads up to maxAnisotropy taps along the major axis, each covering the major length divided by the taps
+	float tapCount = 1.0f;
+	float axisU = 0.0f;
+	float axisV = 0.0f;
+	if (sampler.filter == SamplerFilter::Anisotropic) {
+		float minor = MinFloat(lengthX, lengthY);
+		float ratio = std::sqrt(major / MaxFloat(minor, SMALLEST_NORMAL));
+		tapCount = MaxFloat(MinFloat(std::ceil(ratio), GetMaxAnisotropy(sampler)), 1.0f);
+		major = major / (tapCount * tapCount);
+		bool xMajor = lengthX >= lengthY;
+		axisU = xMajor ? batch.dudx[lane] : batch.dudy[lane];
+		axisV = xMajor ? batch.dvdx[lane] : batch.dvdy[lane];
+	}
+
+	float lod = 0.5f * Log2Approximate(MaxFloat(major, SMALLEST_NORMAL)) + sampler.mipLodBias;
+	lod = MinFloat(MaxFloat(lod, sampler.minLod), sampler.maxLod);
+	lod = MinFloat(MaxFloat(lod, 0.0f), static_cast<float>(levels.count - 1));
+
+	bool linear = sampler.filter != SamplerFilter::Point;
+	bool mipLinear = sampler.filter == SamplerFilter::Trilinear || sampler.filter == SamplerFilter::Anisotropic;
+	int level0, level1;
+	float fraction = 0.0f;
+	if (mipLinear) {
+		float floorLod = std::floor(lod);
+		level0 = static_cast<int>(floorLod);
+		fraction = lod - floorLod;
+		level1 = std::min(level0 + 1, levels.count - 1);
+	}
+	else {
+		level0 = static_cast<int>(std::floor(lod + 0.5f));
+		level1 = level0;
+	}
+
+	float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	int taps = static_cast<int>(tapCount);
+	for (int tap = 0; tap < taps; ++tap) {
+		float offset = (static_cast<float>(tap) + 0.5f) / tapCount - 0.5f;
+		float tu = ReduceCoordinate(u + axisU * offset, sampler.addressU);
+		float tv = ReduceCoordinate(v + axisV * offset, sampler.addressV);
+		float color[4];
+		SampleLevel(levels, sampler, linear, level0, tu, tv, color);
+		if (mipLinear) {
+			float color1[4];
+			SampleLevel(levels, sampler, linear, level1, tu, tv, color1);
+			for (int c = 0; c < 4; ++c) {
+				color[c] = color[c] + (color1[c] - color[c]) * fraction;
+			}
+		}
+		for (int c = 0; c < 4; ++c) {
+			sum[c] += color[c];
+		}
+	}
+	for (int c = 0; c < 4; ++c) {
+		out[c] = sum[c] / tapCount;
+	}
+}
+
+// Function to filter a batch one sample at a time
+void SampleBatchScalar(const TextureData& texture, const SamplerDesc& sampler, const SampleBatch& batch, float rgba[4][SAMPLE_BATCH]) {
+	SamplerLevels levels;
+	SetupLevels(texture, levels);
+	for (uint32_t lane = 0; lane < SAMPLE_BATCH; ++lane) {
+		float color[4];
+		SampleOne(levels, sampler, batch, lane, color);
+		for (int c = 0; c < 4; ++c) {
+			rgba[c][lane] = color[c];
+		}
+	}
+}
+
+#ifdef SIMD_X86
+// Four channels of eight samples
+struct ColorAVX2 {
+	__m256 channel[4];
+};
+
+// Function to zero coordinates that are too large, infinite or NaN
+SIMD_TARGET_AVX2 static inline __m256 SanitizeCoordinateAVX2(__m256 u) {
+	__m256 magnitude = _mm256_and_ps(u, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)));
+	return _mm256_and_ps(u, _mm256_cmp_ps(magnitude, _mm256_set1_ps(MAX_COORDINATE), _CMP_LE_OQ));
+}
+
+// Function to approximate log2 of positive floats
+SIMD_TARGET_AVX2 static inline __m256 Log2ApproximateAVX2(__m256 x) {
+	__m256i bits = _mm256_castps_si256(x);
+	__m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+	__m256 mantissa = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x7FFFFF)), _mm256_set1_epi32(0x3F800000)));
+	__m256 polynomial = _mm256_add_ps(_mm256_set1_ps(LOG2_C3), _mm256_mul_ps(mantissa, _mm256_set1_ps(LOG2_C4)));
+	polynomial = _mm256_add_ps(_mm256_set1_ps(LOG2_C2), _mm256_mul_ps(mantissa, polynomial));
+	polynomial = _mm256_add_ps(_mm256_set1_ps(LOG2_C1), _mm256_mul_ps(mantissa, polynomial));
+	polynomial = _mm256_add_ps(_mm256_set1_ps(LOG2_C0), _mm256_mul_ps(mantissa, polynomial));
+	return _mm256_add_ps(exponent, polynomial);
+}
+
+// Function to move coordinates into the range their address mode handles
+SIMD_TARGET_AVX2 static inline __m256 ReduceCoordinateAVX2(__m256 u, TextureAddressMode mode) {
+	switch (mode) {
+	case TextureAddressMode::Wrap:
+		return _mm256_sub_ps(u, _mm256_floor_ps(u));
+	case TextureAddressMode::Mirror:
+		return _mm256_sub_ps(u, _mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_floor_ps(_mm256_mul_ps(u, _mm256_set1_ps(0.5f)))));
+	default:
+		return _mm256_min_ps(_mm256_max_ps(u, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(2.0f));
+	}
+}
+
+// Function to apply an address mode to texel coordinates, border collects the lanes outside the level
+SIMD_TARGET_AVX2 static inline __m256i AddressTexelAVX2(__m256i x, __m256i size, TextureAddressMode mode, __m256i& border) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi32(1);
+	switch (mode) {
+	case TextureAddressMode::Wrap: {
+		__m256i below = _mm256_cmpgt_epi32(zero, x);
+		__m256i above = _mm256_cmpgt_epi32(x, _mm256_sub_epi32(size, one));
+		return _mm256_sub_epi32(_mm256_add_epi32(x, _mm256_and_si256(below, size)), _mm256_and_si256(above, size));
+	}
+	case TextureAddressMode::Mirror: {
+		__m256i period = _mm256_add_epi32(size, size);
+		__m256i below = _mm256_cmpgt_epi32(zero, x);
+		__m256i above = _mm256_cmpgt_epi32(x, _mm256_sub_epi32(period, one));
+		__m256i p = _mm256_sub_epi32(_mm256_add_epi32(x, _mm256_and_si256(below, period)), _mm256_and_si256(above, period));
+		__m256i mirrored = _mm256_cmpgt_epi32(p, _mm256_sub_epi32(size, one));
+		return _mm256_blendv_epi8(p, _mm256_sub_epi32(_mm256_sub_epi32(period, one), p), mirrored);
+	}
+	case TextureAddressMode::Border:
+		border = _mm256_or_si256(border, _mm256_or_si256(_mm256_cmpgt_epi32(zero, x), _mm256_cmpgt_epi32(x, _mm256_sub_epi32(size, one))));
+		return _mm256_min_epi32(_mm256_max_epi32(x, zero), _mm256_sub_epi32(size, one));
+	default:
+		return _mm256_min_epi32(_mm256_max_epi32(x, zero), _mm256_sub_epi32(size, one));
+	}
+}
+
+// Function to spread the low 5 bits of every lane to the even bits
+SIMD_TARGET_AVX2 static inline __m256i SpreadMortonBitsAVX2(__m256i value) {
+	value = _mm256_and_si256(_mm256_or_si256(value, _mm256_slli_epi32(value, 4)), _mm256_set1_epi32(0x0F0F));
+	value = _mm256_and_si256(_mm256_or_si256(value, _mm256_slli_epi32(value, 2)), _mm256_set1_epi32(0x3333));
+	return _mm256_and_si256(_mm256_or_si256(value, _mm256_slli_epi32(value, 1)), _mm256_set1_epi32(0x5555));
+}
+
+// Function to fetch the texels of every lane from its own level as RGBA8
+SIMD_TARGET_AVX2 static inline __m256i FetchTexelsAVX2(const SamplerLevels& levels, __m256i level, __m256i x, __m256i y) {
+	// Block compressed texels are decoded one lane at a time
+	if (levels.format != TexelFormat::RGBA8) {
+		alignas(32) int32_t laneLevel[8], laneX[8], laneY[8];
+		alignas(32) uint32_t texels[8];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(laneLevel), level);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(laneX), x);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(laneY), y);
+		for (int lane = 0; lane < 8; ++lane) {
+			texels[lane] = FetchTexel(levels, laneLevel[lane], laneX[lane], laneY[lane]);
+		}
+		return _mm256_load_si256(reinterpret_cast<const __m256i*>(texels));
+	}
+
+	__m256i index;
+	if (levels.layout == TexelLayout::Tiled) {
+		const __m256i tileMask = _mm256_set1_epi32(TEXEL_TILE_DIMENSION - 1);
+		__m256i tilesWide = _mm256_i32gather_epi32(levels.tilesWide, level, 4);
+		__m256i tile = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(y, TEXEL_TILE_SHIFT), tilesWide), _mm256_srli_epi32(x, TEXEL_TILE_SHIFT));
+		__m256i morton = _mm256_or_si256(SpreadMortonBitsAVX2(_mm256_and_si256(x, tileMask)), _mm256_slli_epi32(SpreadMortonBitsAVX2(_mm256_and_si256(y, tileMask)), 1));
+		index = _mm256_add_epi32(_mm256_slli_epi32(tile, 2 * TEXEL_TILE_SHIFT), morton);
+	}
+	else {
+		index = _mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_i32gather_epi32(levels.width, level, 4)), x);
+	}
+
+	// Byte offsets from the base level are 64-bit, the levels are separate allocations
+	const long long* offsets = reinterpret_cast<const long long*>(levels.offset);
+	__m256i low = _mm256_i32gather_epi64(offsets, _mm256_castsi256_si128(level), 8);
+	__m256i high = _mm256_i32gather_epi64(offsets, _mm256_extracti128_si256(level, 1), 8);
+	low = _mm256_add_epi64(low, _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(index)), 2));
+	high = _mm256_add_epi64(high, _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm256_extracti128_si256(index, 1)), 2));
+	const int* base = reinterpret_cast<const int*>(levels.pixels[0]);
+	__m128i texelsLow = _mm256_i64gather_epi32(base, low, 1);
+	__m128i texelsHigh = _mm256_i64gather_epi32(base, high, 1);
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(texelsLow), texelsHigh, 1);
+}
+
+// Function to convert texels to normalized floats, lanes in border take the border color
+SIMD_TARGET_AVX2 static inline ColorAVX2 TexelsToColorAVX2(__m256i texels, __m256i border, const float borderColor[4]) {
+	ColorAVX2 color;
+	const __m256 toFloat = _mm256_set1_ps(1.0f / 255.0f);
+	for (int c = 0; c < 4; ++c) {
+		__m256 value = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 8 * c), _mm256_set1_epi32(0xFF))), toFloat);
+		color.channel[c] = _mm256_blendv_ps(value, _mm256_set1_ps(borderColor[c]), _mm256_castsi256_ps(border));
+	}
+	return color;
+}
+
+// Function to sample each lane's level with point or bilinear filtering
+SIMD_TARGET_AVX2 static inline ColorAVX2 SampleLevelAVX2(const SamplerLevels& levels, const SamplerDesc& sampler, bool linear, __m256i level, __m256 u, __m256 v) {
+	__m256i width = _mm256_i32gather_epi32(levels.width, level, 4);
+	__m256i height = _mm256_i32gather_epi32(levels.height, level, 4);
+	__m256 widthF = _mm256_i32gather_ps(levels.widthF, level, 4);
+	__m256 heightF = _mm256_i32gather_ps(levels.heightF, level, 4);
+	if (!linear) {
+		__m256i border = _mm256_setzero_si256();
+		__m256i x = AddressTexelAVX2(_mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(u, widthF))), width, sampler.addressU, border);
+		__m256i y = AddressTexelAVX2(_mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(v, heightF))), height, sampler.addressV, border);
+		return TexelsToColorAVX2(FetchTexelsAVX2(levels, level, x, y), border, sampler.borderColor);
+	}
+
+	__m256 tx = _mm256_sub_ps(_mm256_mul_ps(u, widthF), _mm256_set1_ps(0.5f));
+	__m256 ty = _mm256_sub_ps(_mm256_mul_ps(v, heightF), _mm256_set1_ps(0.5f));
+	__m256 floorX = _mm256_floor_ps(tx);
+	__m256 floorY = _mm256_floor_ps(ty);
+	__m256 fx = _mm256_sub_ps(tx, floorX);
+	__m256 fy = _mm256_sub_ps(ty, floorY);
+	__m256i borderX0 = _mm256_setzero_si256(), borderX1 = _mm256_setzero_si256();
+	__m256i borderY0 = _mm256_setzero_si256(), borderY1 = _mm256_setzero_si256();
+	__m256i integerX = _mm256_cvttps_epi32(floorX);
+	__m256i integerY = _mm256_cvttps_epi32(floorY);
+	const __m256i one = _mm256_set1_epi32(1);
+	__m256i x0 = AddressTexelAVX2(integerX, width, sampler.addressU, borderX0);
+	__m256i x1 = AddressTexelAVX2(_mm256_add_epi32(integerX, one), width, sampler.addressU, borderX1);
+	__m256i y0 = AddressTexelAVX2(integerY, height, sampler.addressV, borderY0);
+	__m256i y1 = AddressTexelAVX2(_mm256_add_epi32(integerY, one), height, sampler.addressV, borderY1);
+
+	ColorAVX2 c00 = TexelsToColorAVX2(FetchTexelsAVX2(levels, level, x0, y0), _mm256_or_si256(borderX0, borderY0), sampler.borderColor);
+	ColorAVX2 c10 = TexelsToColorAVX2(FetchTexelsAVX2(levels, level, x1, y0), _mm256_or_si256(borderX1, borderY0), sampler.borderColor);
+	ColorAVX2 c01 = TexelsToColorAVX2(FetchTexelsAVX2(levels, level, x0, y1), _mm256_or_si256(borderX0, borderY1), sampler.borderColor);
+	ColorAVX2 c11 = TexelsToColorAVX2(FetchTexelsAVX2(levels, level, x1, y1), _mm256_or_si256(borderX1, borderY1), sampler.borderColor);
+	ColorAVX2 color;
+	for (int c = 0; c < 4; ++c) {
+		__m256 top = _mm256_add_ps(c00.channel[c], _mm256_mul_ps(_mm256_sub_ps(c10.channel[c], c00.channel[c]), fx));
+		__m256 bottom = _mm256_add_ps(c01.channel[c], _mm256_mul_ps(_mm256_sub_ps(c11.channel[c], c01.channel[c]), fx));
+		color.channel[c] = _mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), fy));
+	}
+	return color;
+}
+
+// Function to filter a batch with all samples at once
+SIMD_TARGET_AVX2 void SampleBatchAVX2(const TextureData& texture, const SamplerDesc& sampler, const SampleBatch& batch, float rgba[4][SAMPLE_BATCH]) {
+	SamplerLevels levels;
+	SetupLevels(texture, levels);
+	__m256 u = SanitizeCoordinateAVX2(_mm256_loadu_ps(batch.u));
+	__m256 v = SanitizeCoordinateAVX2(_mm256_loadu_ps(batch.v));
+
+	// Squared lengths of the texel-space derivatives
+	__m256 width0 = _mm256_set1_ps(levels.widthF[0]);
+	__m256 height0 = _mm256_set1_ps(levels.heightF[0]);
+	__m256 dudx = _mm256_loadu_ps(batch.dudx);
+	__m256 dvdx = _mm256_loadu_ps(batch.dvdx);
+	__m256 dudy = _mm256_loadu_ps(batch.dudy);
+	__m256 dvdy = _mm256_loadu_ps(batch.dvdy);
+	__m256 dxu = _mm256_mul_ps(dudx, width0);
+	__m256 dxv = _mm256_mul_ps(dvdx, height0);
+	__m256 dyu = _mm256_mul_ps(dudy, width0);
+	__m256 dyv = _mm256_mul_ps(dvdy, height0);
+	__m256 lengthX = _mm256_add_ps(_mm256_mul_ps(dxu, dxu), _mm256_mul_ps(dxv, dxv));
+	__m256 lengthY = _mm256_add_ps(_mm256_mul_ps(dyu, dyu), _mm256_mul_ps(dyv, dyv));
+	__m256 major = _mm256_max_ps(lengthX, lengthY);
+
+	__m256 tapCount = _mm256_set1_ps(1.0f);
+	__m256 axisU = _mm256_setzero_ps();
+	__m256 axisV = _mm256_setzero_ps();
+	if (sampler.filter == SamplerFilter::Anisotropic) {
+		__m256 minor = _mm256_min_ps(lengthX, lengthY);
+		__m256 ratio = _mm256_sqrt_ps(_mm256_div_ps(major, _mm256_max_ps(minor, _mm256_set1_ps(SMALLEST_NORMAL))));
+		tapCount = _mm256_max_ps(_mm256_min_ps(_mm256_ceil_ps(ratio), _mm256_set1_ps(GetMaxAnisotropy(sampler))), _mm256_set1_ps(1.0f));
+		major = _mm256_div_ps(major, _mm256_mul_ps(tapCount, tapCount));
+		__m256 xMajor = _mm256_cmp_ps(lengthX, lengthY, _CMP_GE_OQ);
+		axisU = _mm256_blendv_ps(dudy, dudx, xMajor);
+		axisV = _mm256_blendv_ps(dvdy, dvdx, xMajor);
+	}
+
+	__m256 lod = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), Log2ApproximateAVX2(_mm256_max_ps(major, _mm256_set1_ps(SMALLEST_NORMAL)))), _mm256_set1_ps(sampler.mipLodBias));
+	lod = _mm256_min_ps(_mm256_max_ps(lod, _mm256_set1_ps(sampler.minLod)), _mm256_set1_ps(sampler.maxLod));
+	lod = _mm256_min_ps(_mm256_max_ps(lod, _mm256_setzero_ps()), _mm256_set1_ps(static_cast<float>(levels.count - 1)));
+
+	bool linear = sampler.filter != SamplerFilter::Point;
+	bool mipLinear = sampler.filter == SamplerFilter::Trilinear || sampler.filter == SamplerFilter::Anisotropic;
+	__m256i level0, level1;
+	__m256 fraction = _mm256_setzero_ps();
+	if (mipLinear) {
+		__m256 floorLod = _mm256_floor_ps(lod);
+		level0 = _mm256_cvttps_epi32(floorLod);
+		fraction = _mm256_sub_ps(lod, floorLod);
+		level1 = _mm256_min_epi32(_mm256_add_epi32(level0, _mm256_set1_epi32(1)), _mm256_set1_epi32(levels.count - 1));
+	}
+	else {
+		level0 = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(lod, _mm256_set1_ps(0.5f))));
+		level1 = level0;
+	}
+
+	// Lanes with fewer taps than the batch's most stop accumulating
+	alignas(32) float laneTaps[8];
+	_mm256_store_ps(laneTaps, tapCount);
+	int taps = static_cast<int>(*std::max_element(laneTaps, laneTaps + 8));
+	__m256 sum[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+	for (int tap = 0; tap < taps; ++tap) {
+		__m256 tapIndex = _mm256_set1_ps(static_cast<float>(tap));
+		__m256 offset = _mm256_sub_ps(_mm256_div_ps(_mm256_add_ps(tapIndex, _mm256_set1_ps(0.5f)), tapCount), _mm256_set1_ps(0.5f));
+		__m256 tu = ReduceCoordinateAVX2(_mm256_add_ps(u, _mm256_mul_ps(axisU, offset)), sampler.addressU);
+		__m256 tv = ReduceCoordinateAVX2(_mm256_add_ps(v, _mm256_mul_ps(axisV, offset)), sampler.addressV);
+		ColorAVX2 color = SampleLevelAVX2(levels, sampler, linear, level0, tu, tv);
+		if (mipLinear) {
+			ColorAVX2 color1 = SampleLevelAVX2(levels, sampler, linear, level1, tu, tv);
+			for (int c = 0; c < 4; ++c) {
+				color.channel[c] = _mm256_add_ps(color.channel[c], _mm256_mul_ps(_mm256_sub_ps(color1.channel[c], color.channel[c]), fraction));
+			}
+		}
+		__m256 active = _mm256_cmp_ps(tapIndex, tapCount, _CMP_LT_OQ);
+		for (int c = 0; c < 4; ++c) {
+			sum[c] = _mm256_add_ps(sum[c], _mm256_and_ps(color.channel[c], active));
+		}
+	}
+	for (int c = 0; c < 4; ++c) {
+		_mm256_storeu_ps(rgba[c], _mm256_div_ps(sum[c], tapCount));
+	}
+}
+#endif
+
+// Function to pick the sampling kernel
+SampleBatchFunction SelectSampleBatch(SimdLevel level) {
+#ifdef SIMD_X86
+	SimdLevel available = DetectSimdLevel();
+	if (level > available) {
+		level = available;
+	}
+	return level >= SimdLevel::AVX2 ? SampleBatchAVX2 : SampleBatchScalar;
+#else
+	(void)level;
+	return SampleBatchScalar;
+#endif
+}
+
+// Function to get the name of a sampler filter
+const char* SamplerFilterName(SamplerFilter filter) {
+	switch (filter) {
+	case SamplerFilter::Point: return "point";
+	case SamplerFilter::Bilinear: return "bilinear";
+	case SamplerFilter::Trilinear: return "trilinear";
+	default: return "anisotropic";
+	}
+}
+
+// Function to parse a sampler filter name
+bool ParseSamplerFilter(const char* name, SamplerFilter& filter) {
+	const SamplerFilter filters[] = { SamplerFilter::Point, SamplerFilter::Bilinear, SamplerFilter::Trilinear, SamplerFilter::Anisotropic };
+	for (SamplerFilter candidate : filters) {
+		if (std::strcmp(name, SamplerFilterName(candidate)) == 0) {
+			filter = candidate;
+			return true;
+		}
+	}
+	return false;
+}
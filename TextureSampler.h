@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+
+#include "CpuFeatures.h"
+#include "TextureLoader.h"
+
+// Samples filtered per call, two 2x2 quads like the pixel shading batches
+const uint32_t SAMPLE_BATCH = 8;
+
+// Most levels a sampled texture can have, enough for 32768 texels
+const uint32_t MAX_SAMPLER_LEVELS = 16;
+
+// Texture filtering, the software equivalents of the D3D11_FILTER modes with the same minification and magnification filter
+enum class SamplerFilter {
+	Point,       // MIN_MAG_MIP_POINT
+	Bilinear,    // MIN_MAG_LINEAR_MIP_POINT
+	Trilinear,   // MIN_MAG_MIP_LINEAR
+	Anisotropic  // ANISOTROPIC, trilinear taps spread along the major axis of the footprint
+};
+
+// Addressing of coordinates outside [0, 1], D3D11_TEXTURE_ADDRESS_MODE
+enum class TextureAddressMode {
+	Wrap,
+	Mirror,
+	Clamp,
+	Border
+};
+
+// Software equivalent of D3D11_SAMPLER_DESC, the defaults match CreateSamplerState()
+struct SamplerDesc {
+	SamplerFilter filter = SamplerFilter::Anisotropic;
+	TextureAddressMode addressU = TextureAddressMode::Wrap;
+	TextureAddressMode addressV = TextureAddressMode::Wrap;
+	float mipLodBias = 0.0f;
+	uint32_t maxAnisotropy = 16;  // 1 to 16, only used by the anisotropic filter
+	float borderColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float minLod = 0.0f;
+	float maxLod = FLT_MAX;
+};
+
+// Normalized texture coordinates of a batch of samples with their screen-space derivatives
+struct SampleBatch {
+	float u[SAMPLE_BATCH];
+	float v[SAMPLE_BATCH];
+	float dudx[SAMPLE_BATCH];
+	float dvdx[SAMPLE_BATCH];
+	float dudy[SAMPLE_BATCH];
+	float dvdy[SAMPLE_BATCH];
+};
+
+/// <summary>
+/// Fills in coarse derivatives like ddx() and ddy(), shared by the four samples of a quad.
+/// Samples 0 to 3 and 4 to 7 are quads ordered top left, top right, bottom left, bottom right.
+/// </summary>
+/// <param name="batch">- The batch, its coordinates are read and its derivatives written.</param>
+inline void SetQuadDerivatives(SampleBatch& batch) {
+	for (uint32_t quad = 0; quad < SAMPLE_BATCH; quad += 4) {
+		float dudx = batch.u[quad + 1] - batch.u[quad];
+		float dvdx = batch.v[quad + 1] - batch.v[quad];
+		float dudy = batch.u[quad + 2] - batch.u[quad];
+		float dvdy = batch.v[quad + 2] - batch.v[quad];
+		for (uint32_t lane = quad; lane < quad + 4; ++lane) {
+			batch.dudx[lane] = dudx;
+			batch.dvdx[lane] = dvdx;
+			batch.dudy[lane] = dudy;
+			batch.dvdy[lane] = dvdy;
+		}
+	}
+}
+
+// Filters a batch of samples from a texture with its mips, RGBA8 in either layout or block compressed.
+// The level of detail is log2 of the longest texel-space derivative, or of the major axis divided by the tap count for anisotropic
+// filtering, plus mipLodBias, clamped to [minLod, maxLod] and to the levels the texture has.
+// Every kernel rounds identically, so their outputs are bit-identical.
+typedef void (*SampleBatchFunction)(const TextureData& texture, const SamplerDesc& sampler, const SampleBatch& batch, float rgba[4][SAMPLE_BATCH]);
+
+/// <summary>
+/// Portable sampling kernel, one sample at a time.
+/// </summary>
+void SampleBatchScalar(const TextureData& texture, const SamplerDesc& sampler, const SampleBatch& batch, float rgba[4][SAMPLE_BATCH]);
+
+#ifdef SIMD_X86
+/// <summary>
+/// AVX2 sampling kernel, all samples at once. Every sample may read different levels, texels are gathered with 64-bit addresses.
+/// </summary>
+void SampleBatchAVX2(const TextureData& texture, const SamplerDesc& sampler, const SampleBatch& batch, float rgba[4][SAMPLE_BATCH]);
+#endif
+
+/// <summary>
+/// Picks the sampling kernel for a SIMD level, lowered to what the CPU supports. AVX-512 uses the AVX2 kernel.
+/// </summary>
+/// <param name="level">- The requested SIMD level.</param>
+/// <returns>The sampling kernel.</returns>
+SampleBatchFunction SelectSampleBatch(SimdLevel level);
+
+/// <summary>
+/// Returns a printable name for a sampler filter.
+/// </summary>
+/// <param name="filter">- The filter.</param>
+/// <returns>"point", "bilinear", "trilinear" or "anisotropic".</returns>
+const char* SamplerFilterName(SamplerFilter filter);
+
+/// <summary>
+/// Parses a sampler filter name as returned by SamplerFilterName().
+/// </summary>
+/// <param name="name">- The name to parse.</param>
+/// <param name="filter">- Receives the parsed filter.</param>
+/// <returns>True if the name is known, otherwise false.</returns>
+bool ParseSamplerFilter(const char* name, SamplerFilter& filter);
@@ -0,0 +1,91 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+// Function to start the worker threads
+ThreadPool::ThreadPool(uint32_t threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (uint32_t worker = 1; worker < threadCount; ++worker) {
+		threads.emplace_back(&ThreadPool::WorkerLoop, this, worker);
+	}
+}
+
+// Function to stop and join the worker threads
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeWorkers.notify_all();
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+// Function to run a data-parallel loop on all threads
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t index, uint32_t worker)>& task) {
+	if (count == 0) {
+		return;
+	}
+
+	// Small loops are not worth waking the workers for
+	if (threads.empty() || count == 1) {
+		for (uint32_t index = 0; index < count; ++index) {
+			task(index, 0);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &task;
+		jobCount = count;
+		nextIndex.store(0, std::memory_order_relaxed);
+		activeWorkers = static_cast<uint32_t>(threads.size());
+		++generation;
+	}
+	wakeWorkers.notify_all();
+
+	RunTasks(0);
+
+	// Wait for the workers to finish their last index before the task goes out of scope
+	std::unique_lock<std::mutex> lock(mutex);
+	jobFinished.wait(lock, [this] { return activeWorkers == 0; });
+	job = nullptr;
+}
+
+// Function to pull indices until the current job is exhausted
+void ThreadPool::RunTasks(uint32_t worker) {
+	const std::function<void(uint32_t, uint32_t)>& task = *job;
+	for (uint32_t index = nextIndex.fetch_add(1); index < jobCount; index = nextIndex.fetch_add(1)) {
+		task(index, worker);
+	}
+}
+
+// Function run by every worker thread
+void ThreadPool::WorkerLoop(uint32_t worker) {
+	uint64_t seenGeneration = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeWorkers.wait(lock, [&] { return stopping || generation != seenGeneration; });
+			if (stopping) {
+				return;
+			}
+			seenGeneration = generation;
+		}
+
+		RunTasks(worker);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--activeWorkers == 0) {
+				jobFinished.notify_one();
+			}
+		}
+	}
+}
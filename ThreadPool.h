@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running data-parallel loops, the calling thread takes part as worker 0
+class ThreadPool {
+public:
+	/// <summary>
+	/// Starts the worker threads.
+	/// </summary>
+	/// <param name="threadCount">- Total number of threads including the caller, 0 uses all hardware threads.</param>
+	explicit ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// <summary>
+	/// Number of threads taking part in ParallelFor(), including the caller.
+	/// </summary>
+	uint32_t WorkerCount() const { return static_cast<uint32_t>(threads.size()) + 1; }
+
+	/// <summary>
+	/// Runs task(index, worker) for every index in [0, count) and returns once all of them finished.
+	/// Indices are handed out dynamically, worker is in [0, WorkerCount()).
+	/// </summary>
+	/// <param name="count">- Number of indices to run.</param>
+	/// <param name="task">- The work for a single index.</param>
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t index, uint32_t worker)>& task);
+
+private:
+	void WorkerLoop(uint32_t worker);
+	void RunTasks(uint32_t worker);
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wakeWorkers;
+	std::condition_variable jobFinished;
+
+	const std::function<void(uint32_t, uint32_t)>* job = nullptr;
+	uint32_t jobCount = 0;
+	uint64_t generation = 0;
+	uint32_t activeWorkers = 0;
+	bool stopping = false;
+	std::atomic<uint32_t> nextIndex{ 0 };
+};
@@ -0,0 +1,297 @@
+#include "VertexProcessing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "SoftwareShader.h"
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Multiplies and adds must not be fused into FMA, the kernels round exactly like Transform()
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+// Vertices per thread pool task, a multiple of every kernel's block size
+static const uint32_t VERTEX_CHUNK = 1024;
+
+// Packed vertices decoded at a time, 4 KB of SimpleVertex
+static const uint32_t UNPACK_BLOCK = 128;
+
+// Function to transform a vector by a matrix stored as in the constant buffer
+static void Transform(const float m[4][4], const float v[4], float out[4]) {
+	for (int i = 0; i < 4; ++i) {
+		out[i] = m[i][0] * v[0] + m[i][1] * v[1] + m[i][2] * v[2] + m[i][3] * v[3];
+	}
+}
+
+// Function to run the vertex shader on a single vertex
+static void ShadeVertex(const SimpleVertex& input, const VertexShaderConstants& constants, ShadedVertex& output) {
+	float position[4] = { input.pos[0], input.pos[1], input.pos[2], 1.0f };
+	Transform(constants.worldMatrix, position, output.worldPosition);
+	Transform(constants.viewProjectionMatrix, output.worldPosition, output.position);
+
+	// The shader transforms the normal with w = 1 and drops w afterwards, mirror that exactly
+	float normal[4] = { input.rgb[0], input.rgb[1], input.rgb[2], 1.0f };
+	float worldNormal[4];
+	Transform(constants.worldMatrix, normal, worldNormal);
+	float length = std::sqrt(worldNormal[0] * worldNormal[0] + worldNormal[1] * worldNormal[1] + worldNormal[2] * worldNormal[2]);
+	float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+	output.normal[0] = worldNormal[0] * invLength;
+	output.normal[1] = worldNormal[1] * invLength;
+	output.normal[2] = worldNormal[2] * invLength;
+	output.normal[3] = 0.0f;
+
+	output.uv[0] = input.uv[0];
+	output.uv[1] = input.uv[1];
+	output.padding[0] = 0.0f;
+	output.padding[1] = 0.0f;
+}
+
+// Function to shade vertices one at a time
+void ShadeVerticesScalar(const SimpleVertex* input, uint32_t count, const VertexShaderConstants& constants, ShadedVertex* output) {
+	for (uint32_t i = 0; i < count; ++i) {
+		ShadeVertex(input[i], constants, output[i]);
+	}
+}
+
+#ifdef SIMD_X86
+// SimpleVertex is exactly one 8-float row and ShadedVertex two, which the transposes below rely on
+static_assert(sizeof(SimpleVertex) == 8 * sizeof(float), "SimpleVertex must hold 8 floats");
+static_assert(sizeof(ShadedVertex) == 16 * sizeof(float), "ShadedVertex must hold 16 floats");
+
+// Function to transpose eight rows of eight floats in place
+SIMD_TARGET_AVX2 static inline void Transpose8x8(__m256 rows[8]) {
+	__m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+	__m256 t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+	__m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]);
+	__m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+	__m256 t4 = _mm256_unpacklo_ps(rows[4], rows[5]);
+	__m256 t5 = _mm256_unpackhi_ps(rows[4], rows[5]);
+	__m256 t6 = _mm256_unpacklo_ps(rows[6], rows[7]);
+	__m256 t7 = _mm256_unpackhi_ps(rows[6], rows[7]);
+
+	__m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+	rows[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+	rows[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+	rows[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+	rows[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+	rows[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+	rows[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+	rows[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+	rows[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+// Function to load 8 vertices as structure of arrays: pos xyz, normal xyz, uv
+SIMD_TARGET_AVX2 static inline void LoadVerticesAVX2(const SimpleVertex* input, __m256 attributes[8]) {
+	const float* source = reinterpret_cast<const float*>(input);
+	for (int i = 0; i < 8; ++i) {
+		attributes[i] = _mm256_loadu_ps(source + i * 8);
+	}
+	Transpose8x8(attributes);
+}
+
+// Function to store 8 vertices from structure of arrays, in ShadedVertex float order
+SIMD_TARGET_AVX2 static inline void StoreVerticesAVX2(__m256 attributes[16], ShadedVertex* output) {
+	float* destination = reinterpret_cast<float*>(output);
+	Transpose8x8(attributes);
+	Transpose8x8(attributes + 8);
+	for (int i = 0; i < 8; ++i) {
+		_mm256_storeu_ps(destination + i * 16, attributes[i]);
+		_mm256_storeu_ps(destination + i * 16 + 8, attributes[i + 8]);
+	}
+}
+
+// Function to compute one row of a matrix product, same operation order as Transform()
+SIMD_TARGET_AVX2 static inline __m256 TransformRowAVX2(const float row[4], __m256 x, __m256 y, __m256 z, __m256 w) {
+	__m256 sum = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(row[0]), x), _mm256_mul_ps(_mm256_set1_ps(row[1]), y));
+	sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(row[2]), z));
+	return _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(row[3]), w));
+}
+
+// Function to run the vertex shader on 8 vertices in structure-of-arrays form
+SIMD_TARGET_AVX2 static inline void ShadeBlockAVX2(const __m256 in[8], const VertexShaderConstants& constants, __m256 out[16]) {
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	__m256* position = out;
+	__m256* worldPosition = out + 4;
+	for (int i = 0; i < 4; ++i) {
+		worldPosition[i] = TransformRowAVX2(constants.worldMatrix[i], in[0], in[1], in[2], one);
+	}
+	for (int i = 0; i < 4; ++i) {
+		position[i] = TransformRowAVX2(constants.viewProjectionMatrix[i], worldPosition[0], worldPosition[1], worldPosition[2], worldPosition[3]);
+	}
+
+	// The shader transforms the normal with w = 1 and drops w afterwards
+	__m256 normal[3];
+	for (int i = 0; i < 3; ++i) {
+		normal[i] = TransformRowAVX2(constants.worldMatrix[i], in[3], in[4], in[5], one);
+	}
+	__m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normal[0], normal[0]), _mm256_mul_ps(normal[1], normal[1])), _mm256_mul_ps(normal[2], normal[2]));
+	__m256 length = _mm256_sqrt_ps(lengthSquared);
+	__m256 invLength = _mm256_and_ps(_mm256_div_ps(one, length), _mm256_cmp_ps(length, zero, _CMP_GT_OQ));
+	for (int i = 0; i < 3; ++i) {
+		out[8 + i] = _mm256_mul_ps(normal[i], invLength);
+	}
+	out[11] = zero;
+
+	out[12] = in[6];
+	out[13] = in[7];
+	out[14] = zero;
+	out[15] = zero;
+}
+
+// Function to shade vertices in blocks of 8
+SIMD_TARGET_AVX2 void ShadeVerticesAVX2(const SimpleVertex* input, uint32_t count, const VertexShaderConstants& constants, ShadedVertex* output) {
+	uint32_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 in[8], out[16];
+		LoadVerticesAVX2(input + i, in);
+		ShadeBlockAVX2(in, constants, out);
+		StoreVerticesAVX2(out, output + i);
+	}
+
+	// Remaining vertices
+	ShadeVerticesScalar(input + i, count - i, constants, output + i);
+}
+
+// Function to join two 8-lane vectors into one 16-lane vector
+SIMD_TARGET_AVX512 static inline __m512 Combine(__m256 low, __m256 high) {
+	return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_castps_pd(low)), _mm256_castps_pd(high), 1));
+}
+
+SIMD_TARGET_AVX512 static inline __m512 TransformRowAVX512(const float row[4], __m512 x, __m512 y, __m512 z, __m512 w) {
+	__m512 sum = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(row[0]), x), _mm512_mul_ps(_mm512_set1_ps(row[1]), y));
+	sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_set1_ps(row[2]), z));
+	return _mm512_add_ps(sum, _mm512_mul_ps(_mm512_set1_ps(row[3]), w));
+}
+
+// Function to shade vertices in blocks of 16, the transposes are done in 8-lane halves
+SIMD_TARGET_AVX512 void ShadeVerticesAVX512(const SimpleVertex* input, uint32_t count, const VertexShaderConstants& constants, ShadedVertex* output) {
+	const __m512 one = _mm512_set1_ps(1.0f);
+	const __m512 zero = _mm512_setzero_ps();
+
+	uint32_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256 low[8], high[8];
+		LoadVerticesAVX2(input + i, low);
+		LoadVerticesAVX2(input + i + 8, high);
+		__m512 in[8];
+		for (int a = 0; a < 8; ++a) {
+			in[a] = Combine(low[a], high[a]);
+		}
+
+		__m512 out[16];
+		for (int r = 0; r < 4; ++r) {
+			out[4 + r] = TransformRowAVX512(constants.worldMatrix[r], in[0], in[1], in[2], one);
+		}
+		for (int r = 0; r < 4; ++r) {
+			out[r] = TransformRowAVX512(constants.viewProjectionMatrix[r], out[4], out[5], out[6], out[7]);
+		}
+
+		// The shader transforms the normal with w = 1 and drops w afterwards
+		__m512 normal[3];
+		for (int r = 0; r < 3; ++r) {
+			normal[r] = TransformRowAVX512(constants.worldMatrix[r], in[3], in[4], in[5], one);
+		}
+		__m512 lengthSquared = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(normal[0], normal[0]), _mm512_mul_ps(normal[1], normal[1])), _mm512_mul_ps(normal[2], normal[2]));
+		__m512 length = _mm512_sqrt_ps(lengthSquared);
+		__m512 invLength = _mm512_maskz_div_ps(_mm512_cmp_ps_mask(length, zero, _CMP_GT_OQ), one, length);
+		for (int r = 0; r < 3; ++r) {
+			out[8 + r] = _mm512_mul_ps(normal[r], invLength);
+		}
+		out[11] = zero;
+		out[12] = in[6];
+		out[13] = in[7];
+		out[14] = zero;
+		out[15] = zero;
+
+		for (int a = 0; a < 16; ++a) {
+			low[a % 8] = _mm512_castps512_ps256(out[a]);
+			high[a % 8] = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(out[a]), 1));
+			if (a % 8 == 7) {
+				// Store floats [a - 7, a] of every vertex
+				Transpose8x8(low);
+				Transpose8x8(high);
+				float* destination = reinterpret_cast<float*>(output + i) + (a - 7);
+				for (int v = 0; v < 8; ++v) {
+					_mm256_storeu_ps(destination + v * 16, low[v]);
+					_mm256_storeu_ps(destination + (v + 8) * 16, high[v]);
+				}
+			}
+		}
+	}
+
+	// Remaining vertices
+	ShadeVerticesAVX2(input + i, count - i, constants, output + i);
+}
+#endif
+
+// Function to pick the vertex kernel
+ShadeVerticesFunction SelectShadeVertices(SimdLevel level) {
+#ifdef SIMD_X86
+	SimdLevel available = DetectSimdLevel();
+	if (level > available) {
+		level = available;
+	}
+
+	switch (level) {
+	case SimdLevel::AVX512: return ShadeVerticesAVX512;
+	case SimdLevel::AVX2: return ShadeVerticesAVX2;
+	default: return ShadeVerticesScalar;
+	}
+#else
+	(void)level;
+	return ShadeVerticesScalar;
+#endif
+}
+
+// Function to run the vertex stage across the thread pool
+void ProcessVertices(ThreadPool& pool, ShadeVerticesFunction kernel, const SimpleVertex* input, uint32_t count,
+	const VertexShaderConstants& constants, ShadedVertex* output) {
+	pool.ParallelFor((count + VERTEX_CHUNK - 1) / VERTEX_CHUNK, [&](uint32_t chunk, uint32_t) {
+		uint32_t first = chunk * VERTEX_CHUNK;
+		uint32_t end = std::min(count, first + VERTEX_CHUNK);
+		kernel(input + first, end - first, constants, output + first);
+	});
+}
+
+// Function to run a loaded vertex shader across the thread pool
+void ProcessVertices(ThreadPool& pool, const SoftwareShader& shader, const SimpleVertex* input, uint32_t count,
+	const VertexShaderConstants& constants, ShadedVertex* output) {
+	pool.ParallelFor((count + VERTEX_CHUNK - 1) / VERTEX_CHUNK, [&](uint32_t chunk, uint32_t) {
+		uint32_t first = chunk * VERTEX_CHUNK;
+		uint32_t end = std::min(count, first + VERTEX_CHUNK);
+		shader.ShadeVertices(input + first, end - first, constants, output + first);
+	});
+}
+
+// Function to run the vertex stage on packed vertices across the thread pool
+void ProcessPackedVertices(ThreadPool& pool, UnpackVerticesFunction unpack, ShadeVerticesFunction kernel, const PackedVertex* input, uint32_t count,
+	const PackedVertexBounds& bounds, const VertexShaderConstants& constants, ShadedVertex* output) {
+	pool.ParallelFor((count + VERTEX_CHUNK - 1) / VERTEX_CHUNK, [&](uint32_t chunk, uint32_t) {
+		thread_local std::vector<SimpleVertex> decoded(UNPACK_BLOCK, SimpleVertex({ 0, 0, 0 }, { 0, 0, 0 }, { 0, 0 }));
+		uint32_t end = std::min(count, (chunk + 1) * VERTEX_CHUNK);
+		for (uint32_t first = chunk * VERTEX_CHUNK; first < end; first += UNPACK_BLOCK) {
+			uint32_t blockCount = std::min(UNPACK_BLOCK, end - first);
+			unpack(input + first, blockCount, bounds, decoded.data());
+			kernel(decoded.data(), blockCount, constants, output + first);
+		}
+	});
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+#include "CpuFeatures.h"
+#include "Geometry.h"
+#include "PackedVertex.h"
+#include "PixelShading.h"
+#include "ShaderConstants.h"
+#include "ThreadPool.h"
+
+class SoftwareShader;
+
+// Runs VertexShader.hlsl on count vertices, writing one ShadedVertex per input vertex in the same order.
+// Every kernel uses the same operation order without fused multiply-add, so their outputs are bit-identical.
+typedef void (*ShadeVerticesFunction)(const SimpleVertex* input, uint32_t count, const VertexShaderConstants& constants, ShadedVertex* output);
+
+/// <summary>
+/// Portable vertex kernel, one vertex at a time.
+/// </summary>
+void ShadeVerticesScalar(const SimpleVertex* input, uint32_t count, const VertexShaderConstants& constants, ShadedVertex* output);
+
+#ifdef SIMD_X86
+/// <summary>
+/// AVX2 vertex kernel, transposes blocks of 8 vertices to structure-of-arrays form and back.
+/// </summary>
+void ShadeVerticesAVX2(const SimpleVertex* input, uint32_t count, const VertexShaderConstants& constants, ShadedVertex* output);
+
+/// <summary>
+/// AVX-512 vertex kernel, transforms blocks of 16 vertices at once.
+/// </summary>
+void ShadeVerticesAVX512(const SimpleVertex* input, uint32_t count, const VertexShaderConstants& constants, ShadedVertex* output);
+#endif
+
+/// <summary>
+/// Picks the vertex kernel for a SIMD level, lowered to what the CPU supports.
+/// </summary>
+/// <param name="level">- The requested SIMD level.</param>
+/// <returns>The vertex kernel.</returns>
+ShadeVerticesFunction SelectShadeVertices(SimdLevel level);
+
+/// <summary>
+/// Runs a vertex kernel over a vertex buffer in chunks spread across the thread pool.
+/// </summary>
+/// <param name="pool">- The threads running the chunks.</param>
+/// <param name="kernel">- The vertex kernel, see SelectShadeVertices().</param>
+/// <param name="input">- The vertices to transform.</param>
+/// <param name="count">- Number of vertices.</param>
+/// <param name="constants">- Vertex shader constants.</param>
+/// <param name="output">- Receives count shaded vertices.</param>
+void ProcessVertices(ThreadPool& pool, ShadeVerticesFunction kernel, const SimpleVertex* input, uint32_t count,
+	const VertexShaderConstants& constants, ShadedVertex* output);
+
+/// <summary>
+/// Runs a vertex shader loaded at runtime over a vertex buffer in chunks spread across the thread pool.
+/// </summary>
+/// <param name="pool">- The threads running the chunks.</param>
+/// <param name="shader">- A loaded vertex shader.</param>
+/// <param name="input">- The vertices to transform.</param>
+/// <param name="count">- Number of vertices.</param>
+/// <param name="constants">- Vertex shader constants.</param>
+/// <param name="output">- Receives count shaded vertices.</param>
+void ProcessVertices(ThreadPool& pool, const SoftwareShader& shader, const SimpleVertex* input, uint32_t count,
+	const VertexShaderConstants& constants, ShadedVertex* output);
+
+/// <summary>
+/// Runs a vertex kernel over a packed vertex buffer. Each chunk is decoded in small blocks that stay in the L1 cache
+/// and transformed right away, so the full-size vertices never travel through memory.
+/// </summary>
+/// <param name="pool">- The threads running the chunks.</param>
+/// <param name="unpack">- The decode kernel, see SelectUnpackVertices().</param>
+/// <param name="kernel">- The vertex kernel, see SelectShadeVertices().</param>
+/// <param name="input">- The packed vertices to transform.</param>
+/// <param name="count">- Number of vertices.</param>
+/// <param name="bounds">- Bounds of the packed positions.</param>
+/// <param name="constants">- Vertex shader constants.</param>
+/// <param name="output">- Receives count shaded vertices.</param>
+void ProcessPackedVertices(ThreadPool& pool, UnpackVerticesFunction unpack, ShadeVerticesFunction kernel, const PackedVertex* input, uint32_t count,
+	const PackedVertexBounds& bounds, const VertexShaderConstants& constants, ShadedVertex* output);
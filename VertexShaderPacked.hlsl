@@ -0,0 +1,47 @@
+cbuffer ConstantBuffer : register(b0)
+{
+    float4x4 worldMatrix;
+    float4x4 viewProjectionMatrix;
+};
+
+cbuffer PackedBounds : register(b1)
+{
+    float4 positionMinimum;
+    float4 positionExtent;
+};
+
+struct VertexShaderInput
+{
+    float4 position : POSITION;
+    float2 normal : NORMAL;
+    float2 uv : UV;
+};
+
+struct VertexShaderOutput
+{
+    float4 position : SV_POSITION;
+    float4 worldPosition : WORLD_POSITION;
+    float4 normal : NORMAL;
+    float2 uv : UV;
+};
+
+float3 DecodeOctahedral(float2 encoded)
+{
+    float3 normal = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float fold = saturate(-normal.z);
+    normal.xy += (normal.xy >= 0.0f) ? -fold : fold;
+    return normalize(normal);
+}
+
+VertexShaderOutput main(VertexShaderInput input)
+{
+    float3 position = positionMinimum.xyz + input.position.xyz * positionExtent.xyz;
+    float3 normal = DecodeOctahedral(input.normal);
+
+    VertexShaderOutput output;
+    output.worldPosition = mul(float4(position, 1.0f), worldMatrix);
+    output.position = mul(output.worldPosition, viewProjectionMatrix);
+    output.normal = normalize(float4(mul(float4(normal, 1.0f), worldMatrix).xyz, 0.0f));
+    output.uv = input.uv;
+    return output;
+}
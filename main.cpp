@@ -1,8 +1,11 @@
 #include <Windows.h>
+#include <shellapi.h>
 #include <iostream>
 #include <d3d11.h>
 #include <DirectXMath.h>
 #include <chrono>
+#include <fstream>
+#include <string>
 
 #include "WindowHelper.h"
 #include "D3D11Helper.h"
@@ -14,22 +17,32 @@ namespace DX = DirectX;
 // Render function to draw the scene
 static void Render(ID3D11DeviceContext* immediateContext, ID3D11RenderTargetView* rtv,
 	ID3D11DepthStencilView* dsView, D3D11_VIEWPORT& viewport, ID3D11VertexShader* vShader,
-	ID3D11PixelShader* pShader, ID3D11InputLayout* inputLayout, ID3D11Buffer* vertexBuffer,
-	ID3D11ShaderResourceView* srv, ID3D11SamplerState* samplerState) {
+	ID3D11PixelShader* pShader, ID3D11InputLayout* inputLayout, const Mesh& mesh, VertexFormat vertexFormat, ID3D11Buffer* vertexBuffer,
+	ID3D11Buffer* indexBuffer, ID3D11ShaderResourceView* srv, ID3D11SamplerState* samplerState) {
 
 	// Clear the render target and depth stencil views
 	float clearColor[4] = { 0, 0, 0, 0 };
 	immediateContext->ClearRenderTargetView(rtv, clearColor);
 	immediateContext->ClearDepthStencilView(dsView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1, 0);
 
+	// Nothing is drawn until the shaders have loaded
+	if (vShader == nullptr || pShader == nullptr) {
+		return;
+	}
+
 	// Set the vertex buffer
-	UINT stride = sizeof(SimpleVertex);
+	UINT stride = GetVertexStride(vertexFormat);
 	UINT offset = 0;
 	immediateContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
 
+	// Set the index buffer
+	if (indexBuffer != nullptr) {
+		immediateContext->IASetIndexBuffer(indexBuffer, ToDXGIFormat(mesh.indexFormat), 0);
+	}
+
 	// Set the input layout and primitive topology
 	immediateContext->IASetInputLayout(inputLayout);
-	immediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	immediateContext->IASetPrimitiveTopology(ToD3D11Topology(mesh.topology));
 
 	// Set the vertex and pixel shaders
 	immediateContext->VSSetShader(vShader, nullptr, 0);
@@ -43,8 +56,13 @@ static void Render(ID3D11DeviceContext* immediateContext, ID3D11RenderTargetView
 	immediateContext->RSSetViewports(1, &viewport);
 	immediateContext->OMSetRenderTargets(1, &rtv, dsView);
 
-	// Draw the vertices
-	immediateContext->Draw(4, 0);
+	// Draw the mesh
+	if (indexBuffer != nullptr) {
+		immediateContext->DrawIndexed(mesh.indexCount, 0, 0);
+	}
+	else {
+		immediateContext->Draw(static_cast<UINT>(mesh.vertices.size()), 0);
+	}
 }
 
 // Update rotation based on elapsed time
@@ -58,9 +76,43 @@ static void UpdateRotation(float& rotation) {
 	if (rotation > 360) rotation = 0;
 }
 
+// Function to read the command line options, the texture stays RGBA8 unless --texture-format picks a block compressed format
+static bool ParseCommandLine(TexelFormat& textureFormat) {
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	if (argv == nullptr) {
+		return false;
+	}
+
+	bool parsed = true;
+	for (int i = 1; i < argc && parsed; ++i) {
+		char option[64] = {};
+		char value[64] = {};
+		WideCharToMultiByte(CP_UTF8, 0, argv[i], -1, option, sizeof(option) - 1, nullptr, nullptr);
+		if (i + 1 < argc) {
+			WideCharToMultiByte(CP_UTF8, 0, argv[i + 1], -1, value, sizeof(value) - 1, nullptr, nullptr);
+		}
+		if (std::string(option) == "--texture-format" && i + 1 < argc && ParseTexelFormat(value, textureFormat)) {
+			++i;
+		}
+		else {
+			std::cerr << "Usage: Rasterizer [--texture-format rgba8|bc1|bc3|bc7]" << std::endl;
+			parsed = false;
+		}
+	}
+	LocalFree(argv);
+	return parsed;
+}
+
 // Main entry point for the application
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow) {
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+	auto startupTime = std::chrono::high_resolution_clock::now();
+
+	TexelFormat textureFormat = TexelFormat::RGBA8;
+	if (!ParseCommandLine(textureFormat)) {
+		return -1;
+	}
 
 	// Window Setup
 	const UINT WIDTH = 1024;
@@ -85,6 +137,8 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 	ID3D11PixelShader* pShader;
 
 	ID3D11Buffer* vertexBuffer;
+	ID3D11Buffer* indexBuffer;
+	ID3D11Buffer* boundsBuffer;
 
 	ID3D11Buffer* vConstBuffer;
 	ID3D11Buffer* pConstBuffer;
@@ -97,16 +151,26 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 
 	D3D11_VIEWPORT viewport;
 
-	unsigned char* imageData;
-
 	// D3D11 Setup
 	if (!SetupD3D11(WIDTH, HEIGHT, window, device, immediateContext, swapChain, rtv, dsTexture, dsView, viewport)) {
 		std::cerr << "Failed to setup d3d11!" << std::endl;
 		return -1;
 	}
 
-	// Pipeline Setup
-	if (!SetupPipeline(device, vertexBuffer, vShader, pShader, inputLayout, texture, srv, samplerState, imageData)) {
+	// Pipeline Setup, VertexFormat::Packed halves the vertex buffer
+	const VertexFormat VERTEX_FORMAT = VertexFormat::Float;
+	// The shaders and the texture load in the background, the loader outlives the pending loads.
+	// They come from assets.pack when it is deployed, otherwise from the loose files.
+	Mesh mesh;
+	CreateQuadMesh(mesh);
+	AssetLoader loader;
+	if (std::ifstream("assets.pack").good() && !loader.OpenArchive("assets.pack")) {
+		std::cerr << "Failed to open asset archive!" << std::endl;
+		return -1;
+	}
+	loader.EnableTextureCache("TextureCache");
+	PendingAssets pending;
+	if (!SetupPipeline(device, loader, mesh, VERTEX_FORMAT, textureFormat, vertexBuffer, indexBuffer, boundsBuffer, vShader, pShader, inputLayout, texture, srv, samplerState, pending)) {
 		std::cerr << "Failed to setup pipeline!" << std::endl;
 		return -1;
 	}
@@ -120,15 +184,32 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 	}
 	immediateContext->VSSetConstantBuffers(0, 1, &vConstBuffer);
 	immediateContext->PSSetConstantBuffers(0, 1, &pConstBuffer);
+	if (boundsBuffer != nullptr) {
+		immediateContext->VSSetConstantBuffers(1, 1, &boundsBuffer);
+	}
 
 	// Window Loop
 	MSG msg = {};
+	bool firstFrame = true;
 	while (msg.message != WM_QUIT) {
 		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
 		}
 
+		// Pick up the assets that finished loading
+		if (IsLoading(pending)) {
+			if (!UpdatePipeline(device, VERTEX_FORMAT, pending, vShader, pShader, inputLayout, texture, srv)) {
+				std::cerr << "Failed to load assets!" << std::endl;
+				return -1;
+			}
+			if (!IsLoading(pending)) {
+				std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - startupTime;
+				TextureCacheStats cacheStats = loader.GetTextureCacheStats();
+				std::cout << "Assets loaded after " << loadTime.count() << " ms, texture cache " << cacheStats.hits << " hits " << cacheStats.misses << " misses" << std::endl;
+			}
+		}
+
 		UpdateRotation(rotation);
 
 		D3D11_MAPPED_SUBRESOURCE mappedResource;
@@ -139,20 +220,28 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 		memcpy(mappedResource.pData, matrixArray, sizeof(matrixArray));
 		immediateContext->Unmap(vConstBuffer, 0);
 
-		Render(immediateContext, rtv, dsView, viewport, vShader, pShader, inputLayout, vertexBuffer, srv, samplerState);
+		Render(immediateContext, rtv, dsView, viewport, vShader, pShader, inputLayout, mesh, VERTEX_FORMAT, vertexBuffer, indexBuffer, srv, samplerState);
 		swapChain->Present(0, 0);
+
+		if (firstFrame) {
+			std::chrono::duration<double, std::milli> firstFrameTime = std::chrono::high_resolution_clock::now() - startupTime;
+			std::cout << "First frame after " << firstFrameTime.count() << " ms" << std::endl;
+			firstFrame = false;
+		}
 	}
 
 	// Release resources
 	samplerState->Release();
 	srv->Release();
 	texture->Release();
+	if (boundsBuffer != nullptr) boundsBuffer->Release();
+	if (indexBuffer != nullptr) indexBuffer->Release();
 	vertexBuffer->Release();
-	inputLayout->Release();
+	if (inputLayout != nullptr) inputLayout->Release();
 	pConstBuffer->Release();
 	vConstBuffer->Release();
-	pShader->Release();
-	vShader->Release();
+	if (pShader != nullptr) pShader->Release();
+	if (vShader != nullptr) vShader->Release();
 	dsView->Release();
 	dsTexture->Release();
 	rtv->Release();
@@ -428,6 +428,36 @@ STBIDEF stbi_uc *stbi_load_from_file  (FILE *f, int *x, int *y, int *channels_in
 // for stbi_load_from_file, file pointer is left pointing immediately after image
 #endif
 
+// Decode into caller-provided memory of at least x*y*desired_channels bytes (get the size
+// with stbi_info first). desired_channels must be 1..4. JPEG writes straight into the buffer,
+// with desired_channels == 4 the color conversion fills in alpha; other formats are decoded
+// as usual and copied. Returns 1 on success, 0 on failure (see stbi_failure_reason).
+STBIDEF int stbi_load_from_memory_into(stbi_uc const *data, int len, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *channels_in_file, int desired_channels);
+#ifndef STBI_NO_STDIO
+STBIDEF int stbi_load_into(char const *filename, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *channels_in_file, int desired_channels);
+#endif
+
+// Multithreaded variants of the above. parallel_for(pool, count, task, task_context) must call
+// task(task_context, i) for every i in [0,count), on any threads, and return once all calls finished.
+// Baseline JPEGs with restart markers are entropy decoded one restart interval per task; the
+// progressive IDCT and the upsampling/color conversion of every JPEG run in bands of rows. Scans
+// that can't be split, and other formats, decode serially. The output is identical to stbi_load_into.
+typedef void (*stbi_parallel_task)(void *task_context, int index);
+typedef void (*stbi_parallel_for)(void *pool, int count, stbi_parallel_task task, void *task_context);
+STBIDEF int stbi_load_from_memory_into_parallel(stbi_uc const *data, int len, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *channels_in_file, int desired_channels, stbi_parallel_for parallel_for, void *pool);
+#ifndef STBI_NO_STDIO
+STBIDEF int stbi_load_into_parallel(char const *filename, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *channels_in_file, int desired_channels, stbi_parallel_for parallel_for, void *pool);
+#endif
+
+// Reduced-size variants: decode at 1/(1<<scale_shift) of the size, scale_shift 0..3 for 1/1, 1/2,
+// 1/4 and 1/8. The result is ceil(x/scale) by ceil(y/scale), the buffer must hold that many pixels.
+// Every 8x8 JPEG block goes through a 4x4, 2x2 or 1x1 IDCT of its low frequencies, so upsampling
+// and color conversion only touch the small image. JPEG only; other formats fail unless scale_shift is 0.
+STBIDEF int stbi_load_from_memory_into_scaled(stbi_uc const *data, int len, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *channels_in_file, int desired_channels, int scale_shift);
+#ifndef STBI_NO_STDIO
+STBIDEF int stbi_load_into_scaled(char const *filename, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *channels_in_file, int desired_channels, int scale_shift);
+#endif
+
 #ifndef STBI_NO_GIF
 STBIDEF stbi_uc *stbi_load_gif_from_memory(stbi_uc const *buffer, int len, int **delays, int *x, int *y, int *z, int *comp, int req_comp);
 #endif
@@ -516,6 +546,10 @@ STBIDEF void stbi_convert_iphone_png_to_rgb(int flag_true_if_should_convert);
 // flip the image vertically, so the first pixel in the output array is the bottom left
 STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 
+// highest instruction set the JPEG kernels may use, for testing and benchmarking:
+// 0 = plain C, 1 = SSE2/NEON, 2 = AVX2 (default). Lowered to what the CPU supports.
+STBIDEF void stbi_set_jpeg_simd_level(int level);
+
 // as above, but only applies to images loaded on the thread that calls the function
 // this function is only available if your compiler supports thread-local variables;
 // calling it will fail to link if your compiler doesn't
@@ -773,6 +807,33 @@ static int stbi__sse2_available(void)
 #endif
 #endif
 
+// AVX2 kernels are compiled alongside SSE2 and picked at runtime
+#if defined(STBI_SSE2) && !defined(STBI_NO_AVX2) && !defined(STBI_NO_JPEG) && \
+    ((defined(_MSC_VER) && _MSC_VER >= 1700) || (defined(__GNUC__) && __GNUC__ >= 5) || defined(__clang__))
+#define STBI_AVX2
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#define STBI__AVX2_TARGET
+static int stbi__avx2_available(void)
+{
+   int info[4];
+   __cpuid(info,1);
+   // OSXSAVE and AVX, then the OS must save ymm state
+   if ((info[2] & (3 << 27)) != (3 << 27) || (_xgetbv(0) & 6) != 6) return 0;
+   __cpuidex(info,7,0);
+   return ((info[1] >> 5) & 1) != 0;
+}
+#else
+#define STBI__AVX2_TARGET __attribute__((target("avx2")))
+static int stbi__avx2_available(void)
+{
+   // checks OS support for ymm state as well
+   return __builtin_cpu_supports("avx2");
+}
+#endif
+#endif
+
 // ARM NEON
 #if defined(STBI_NO_SIMD) && defined(STBI_NEON)
 #undef STBI_NEON
@@ -816,6 +877,17 @@ typedef struct
 
    stbi_uc *img_buffer, *img_buffer_end;
    stbi_uc *img_buffer_original, *img_buffer_original_end;
+
+   // optional caller-provided output for the 8-bit result, see stbi_load_into
+   stbi_uc *out_buffer;
+   size_t out_buffer_size;
+
+   // optional task runner for the JPEG decoder, see stbi_load_into_parallel
+   stbi_parallel_for parallel_for;
+   void *parallel_pool;
+
+   // reduced-size JPEG decode at 1/(1<<scale_shift), see stbi_load_into_scaled
+   int scale_shift;
 } stbi__context;
 
 
@@ -827,6 +899,11 @@ static void stbi__start_mem(stbi__context *s, stbi_uc const *buffer, int len)
    s->io.read = NULL;
    s->read_from_callbacks = 0;
    s->callback_already_read = 0;
+   s->out_buffer = NULL;
+   s->out_buffer_size = 0;
+   s->parallel_for = NULL;
+   s->parallel_pool = NULL;
+   s->scale_shift = 0;
    s->img_buffer = s->img_buffer_original = (stbi_uc *) buffer;
    s->img_buffer_end = s->img_buffer_original_end = (stbi_uc *) buffer+len;
 }
@@ -839,6 +916,11 @@ static void stbi__start_callbacks(stbi__context *s, stbi_io_callbacks *c, void *
    s->buflen = sizeof(s->buffer_start);
    s->read_from_callbacks = 1;
    s->callback_already_read = 0;
+   s->out_buffer = NULL;
+   s->out_buffer_size = 0;
+   s->parallel_for = NULL;
+   s->parallel_pool = NULL;
+   s->scale_shift = 0;
    s->img_buffer = s->img_buffer_original = s->buffer_start;
    stbi__refill_buffer(s);
    s->img_buffer_original_end = s->img_buffer_end;
@@ -1117,6 +1199,13 @@ STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip)
    stbi__vertically_flip_on_load_global = flag_true_if_should_flip;
 }
 
+static int stbi__jpeg_simd_level = 2;
+
+STBIDEF void stbi_set_jpeg_simd_level(int level)
+{
+   stbi__jpeg_simd_level = level;
+}
+
 #ifndef STBI_THREAD_LOCAL
 #define stbi__vertically_flip_on_load  stbi__vertically_flip_on_load_global
 #else
@@ -1282,6 +1371,43 @@ static unsigned char *stbi__load_and_postprocess_8bit(stbi__context *s, int *x,
    return (unsigned char *) result;
 }
 
+static int stbi__load_into(stbi__context *s, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *comp, int req_comp)
+{
+   stbi_uc *result;
+   size_t size;
+   if (req_comp < 1 || req_comp > 4) return stbi__err("bad req_comp", "Internal error");
+
+   s->out_buffer = buffer;
+   s->out_buffer_size = buffer_size;
+   result = stbi__load_and_postprocess_8bit(s, x, y, comp, req_comp);
+   s->out_buffer = NULL;
+   if (result == NULL) return 0;
+   if (result == buffer) return 1;
+
+   // the loader did not decode in place, copy its result
+   size = (size_t) *x * (size_t) *y * (size_t) req_comp;
+   if (size > buffer_size) {
+      STBI_FREE(result);
+      return stbi__err("buffer too small", "Output buffer too small");
+   }
+   memcpy(buffer, result, size);
+   STBI_FREE(result);
+   return 1;
+}
+
+static int stbi__load_into_scaled(stbi__context *s, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *comp, int req_comp, int scale_shift)
+{
+   if (scale_shift < 0 || scale_shift > 3) return stbi__err("bad scale", "Scale must be 1/1, 1/2, 1/4 or 1/8");
+   if (scale_shift > 0) {
+      #ifndef STBI_NO_JPEG
+      if (!stbi__jpeg_test(s))
+      #endif
+         return stbi__err("scaled non-jpeg", "Reduced-size decoding is JPEG only");
+   }
+   s->scale_shift = scale_shift;
+   return stbi__load_into(s, buffer, buffer_size, x, y, comp, req_comp);
+}
+
 static stbi__uint16 *stbi__load_and_postprocess_16bit(stbi__context *s, int *x, int *y, int *comp, int req_comp)
 {
    stbi__result_info ri;
@@ -1385,6 +1511,55 @@ STBIDEF stbi_uc *stbi_load_from_file(FILE *f, int *x, int *y, int *comp, int req
    return result;
 }
 
+STBIDEF int stbi_load_into(char const *filename, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *comp, int req_comp)
+{
+   FILE *f = stbi__fopen(filename, "rb");
+   stbi__context s;
+   int result;
+   if (!f) return stbi__err("can't fopen", "Unable to open file");
+   stbi__start_file(&s,f);
+   result = stbi__load_into(&s,buffer,buffer_size,x,y,comp,req_comp);
+   fclose(f);
+   return result;
+}
+
+STBIDEF int stbi_load_into_parallel(char const *filename, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *comp, int req_comp, stbi_parallel_for parallel_for, void *pool)
+{
+   // splitting a scan needs random access, so read the whole file
+   FILE *f = stbi__fopen(filename, "rb");
+   stbi_uc *data;
+   long len;
+   int result;
+   if (!f) return stbi__err("can't fopen", "Unable to open file");
+   if (fseek(f, 0, SEEK_END) != 0 || (len = ftell(f)) < 0 || len > INT_MAX || fseek(f, 0, SEEK_SET) != 0) {
+      fclose(f);
+      return stbi__err("can't fseek", "Unable to read file");
+   }
+   data = (stbi_uc *) stbi__malloc(len ? len : 1);
+   if (!data) { fclose(f); return stbi__err("outofmem", "Out of memory"); }
+   if (fread(data, 1, len, f) != (size_t) len) {
+      STBI_FREE(data);
+      fclose(f);
+      return stbi__err("can't fread", "Unable to read file");
+   }
+   fclose(f);
+   result = stbi_load_from_memory_into_parallel(data, (int) len, buffer, buffer_size, x, y, comp, req_comp, parallel_for, pool);
+   STBI_FREE(data);
+   return result;
+}
+
+STBIDEF int stbi_load_into_scaled(char const *filename, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *comp, int req_comp, int scale_shift)
+{
+   FILE *f = stbi__fopen(filename, "rb");
+   stbi__context s;
+   int result;
+   if (!f) return stbi__err("can't fopen", "Unable to open file");
+   stbi__start_file(&s,f);
+   result = stbi__load_into_scaled(&s,buffer,buffer_size,x,y,comp,req_comp,scale_shift);
+   fclose(f);
+   return result;
+}
+
 STBIDEF stbi__uint16 *stbi_load_from_file_16(FILE *f, int *x, int *y, int *comp, int req_comp)
 {
    stbi__uint16 *result;
@@ -1432,6 +1607,29 @@ STBIDEF stbi_uc *stbi_load_from_memory(stbi_uc const *buffer, int len, int *x, i
    return stbi__load_and_postprocess_8bit(&s,x,y,comp,req_comp);
 }
 
+STBIDEF int stbi_load_from_memory_into(stbi_uc const *data, int len, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *comp, int req_comp)
+{
+   stbi__context s;
+   stbi__start_mem(&s,data,len);
+   return stbi__load_into(&s,buffer,buffer_size,x,y,comp,req_comp);
+}
+
+STBIDEF int stbi_load_from_memory_into_scaled(stbi_uc const *data, int len, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *comp, int req_comp, int scale_shift)
+{
+   stbi__context s;
+   stbi__start_mem(&s,data,len);
+   return stbi__load_into_scaled(&s,buffer,buffer_size,x,y,comp,req_comp,scale_shift);
+}
+
+STBIDEF int stbi_load_from_memory_into_parallel(stbi_uc const *data, int len, stbi_uc *buffer, size_t buffer_size, int *x, int *y, int *comp, int req_comp, stbi_parallel_for parallel_for, void *pool)
+{
+   stbi__context s;
+   stbi__start_mem(&s,data,len);
+   s.parallel_for = parallel_for;
+   s.parallel_pool = pool;
+   return stbi__load_into(&s,buffer,buffer_size,x,y,comp,req_comp);
+}
+
 STBIDEF stbi_uc *stbi_load_from_callbacks(stbi_io_callbacks const *clbk, void *user, int *x, int *y, int *comp, int req_comp)
 {
    stbi__context s;
@@ -1995,6 +2193,8 @@ typedef struct
 
 // kernels
    void (*idct_block_kernel)(stbi_uc *out, int out_stride, short data[64]);
+   void (*idct_block2_kernel)(stbi_uc *out, int out_stride, short data[128]);
+   int idct_size; // pixels per block side, 8 >> scale_shift
    void (*YCbCr_to_RGB_kernel)(stbi_uc *out, const stbi_uc *y, const stbi_uc *pcb, const stbi_uc *pcr, int count, int step);
    stbi_uc *(*resample_row_hv_2_kernel)(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs);
 } stbi__jpeg;
@@ -2522,6 +2722,100 @@ static void stbi__idct_block(stbi_uc *out, int out_stride, short data[64])
    }
 }
 
+// idct of two horizontally adjacent blocks, the second one is written at out+8.
+// data holds both blocks, 64 coefficients each
+static void stbi__idct_block2(stbi_uc *out, int out_stride, short data[128])
+{
+   stbi__idct_block(out, out_stride, data);
+   stbi__idct_block(out+8, out_stride, data+64);
+}
+
+// reduced-size idct for scaled decoding: an NxN idct of the top-left NxN coefficients
+// gives the block downscaled to NxN pixels, with the dc term scaled like the full idct.
+// 1d weights are C(u)/2 * cos((2x+1)*u*pi/(2N)), C(0) = 1/sqrt(2), in 12-bit fixed point,
+// applied as even/odd butterflies. the column pass keeps 2 fractional bits, so both
+// passes stay within 32 bits.
+#define STBI__IDCT4_C0  1448 // 0.5/sqrt(2)
+#define STBI__IDCT4_C1  1892 // 0.5*cos(pi/8)
+#define STBI__IDCT4_C3   784 // 0.5*cos(3pi/8)
+
+// 4-point idct of s0..s3 (stride apart in d), into o0..o3
+#define STBI__IDCT4_1D(o0,o1,o2,o3, s0,s1,s2,s3) \
+   { \
+      int e0 = STBI__IDCT4_C0 * ((s0) + (s2)); \
+      int e1 = STBI__IDCT4_C0 * ((s0) - (s2)); \
+      int d0 = STBI__IDCT4_C1 * (s1) + STBI__IDCT4_C3 * (s3); \
+      int d1 = STBI__IDCT4_C3 * (s1) - STBI__IDCT4_C1 * (s3); \
+      o0 = e0 + d0; \
+      o1 = e1 + d1; \
+      o2 = e1 - d1; \
+      o3 = e0 - d0; \
+   }
+
+static void stbi__idct_block_4x4(stbi_uc *out, int out_stride, short data[64])
+{
+   int i, tmp[16];
+   // columns
+   for (i=0; i < 4; ++i) {
+      int t0,t1,t2,t3;
+      STBI__IDCT4_1D(t0,t1,t2,t3, data[i], data[8+i], data[16+i], data[24+i]);
+      tmp[     i] = (t0 + (1 << 9)) >> 10;
+      tmp[ 4 + i] = (t1 + (1 << 9)) >> 10;
+      tmp[ 8 + i] = (t2 + (1 << 9)) >> 10;
+      tmp[12 + i] = (t3 + (1 << 9)) >> 10;
+   }
+   // rows, plus the level shift and rounding
+   for (i=0; i < 4; ++i, out += out_stride) {
+      int *r = tmp + i*4;
+      int t0,t1,t2,t3;
+      STBI__IDCT4_1D(t0,t1,t2,t3, r[0], r[1], r[2], r[3]);
+      out[0] = stbi__clamp((t0 + (128 << 14) + (1 << 13)) >> 14);
+      out[1] = stbi__clamp((t1 + (128 << 14) + (1 << 13)) >> 14);
+      out[2] = stbi__clamp((t2 + (128 << 14) + (1 << 13)) >> 14);
+      out[3] = stbi__clamp((t3 + (128 << 14) + (1 << 13)) >> 14);
+   }
+}
+
+static void stbi__idct_block_2x2(stbi_uc *out, int out_stride, short data[64])
+{
+   // 2-point idct: C0 * (s0 +- s1)
+   int c0 = (STBI__IDCT4_C0 * (data[0] + data[8]) + (1 << 9)) >> 10;
+   int c1 = (STBI__IDCT4_C0 * (data[1] + data[9]) + (1 << 9)) >> 10;
+   int c2 = (STBI__IDCT4_C0 * (data[0] - data[8]) + (1 << 9)) >> 10;
+   int c3 = (STBI__IDCT4_C0 * (data[1] - data[9]) + (1 << 9)) >> 10;
+   int bias = (128 << 14) + (1 << 13);
+   out[0] = stbi__clamp((STBI__IDCT4_C0 * (c0 + c1) + bias) >> 14);
+   out[1] = stbi__clamp((STBI__IDCT4_C0 * (c0 - c1) + bias) >> 14);
+   out += out_stride;
+   out[0] = stbi__clamp((STBI__IDCT4_C0 * (c2 + c3) + bias) >> 14);
+   out[1] = stbi__clamp((STBI__IDCT4_C0 * (c2 - c3) + bias) >> 14);
+}
+
+static void stbi__idct_block_1x1(stbi_uc *out, int out_stride, short data[64])
+{
+   // dc only: F(0,0)/8 + 128
+   STBI_NOTUSED(out_stride);
+   out[0] = stbi__clamp(((data[0] + 4) >> 3) + 128);
+}
+
+static void stbi__idct_block2_4x4(stbi_uc *out, int out_stride, short data[128])
+{
+   stbi__idct_block_4x4(out, out_stride, data);
+   stbi__idct_block_4x4(out+4, out_stride, data+64);
+}
+
+static void stbi__idct_block2_2x2(stbi_uc *out, int out_stride, short data[128])
+{
+   stbi__idct_block_2x2(out, out_stride, data);
+   stbi__idct_block_2x2(out+2, out_stride, data+64);
+}
+
+static void stbi__idct_block2_1x1(stbi_uc *out, int out_stride, short data[128])
+{
+   stbi__idct_block_1x1(out, out_stride, data);
+   stbi__idct_block_1x1(out+1, out_stride, data+64);
+}
+
 #ifdef STBI_SSE2
 // sse2 integer IDCT. not the fastest possible implementation but it
 // produces bit-identical results to the generic C version so it's
@@ -2911,6 +3205,201 @@ static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
 
 #endif // STBI_NEON
 
+#if defined(STBI_SSE2) || defined(STBI_NEON)
+static void stbi__idct_simd2(stbi_uc *out, int out_stride, short data[128])
+{
+   stbi__idct_simd(out, out_stride, data);
+   stbi__idct_simd(out+8, out_stride, data+64);
+}
+#endif
+
+#ifdef STBI_AVX2
+// avx2 integer IDCT of two horizontally adjacent blocks, one per 128-bit lane. it is the
+// sse2 IDCT step for step; none of the steps cross lanes, so it is bit-identical as well.
+static STBI__AVX2_TARGET void stbi__idct_avx2(stbi_uc *out, int out_stride, short data[128])
+{
+   __m256i row0, row1, row2, row3, row4, row5, row6, row7;
+   __m256i tmp;
+
+   // dot product constant: even elems=x, odd elems=y
+   #define dct_const(x,y)  _mm256_setr_epi16((x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y))
+
+   // out(0) = c0[even]*x + c0[odd]*y   (c0, x, y 16-bit, out 32-bit)
+   // out(1) = c1[even]*x + c1[odd]*y
+   #define dct_rot(out0,out1, x,y,c0,c1) \
+      __m256i c0##lo = _mm256_unpacklo_epi16((x),(y)); \
+      __m256i c0##hi = _mm256_unpackhi_epi16((x),(y)); \
+      __m256i out0##_l = _mm256_madd_epi16(c0##lo, c0); \
+      __m256i out0##_h = _mm256_madd_epi16(c0##hi, c0); \
+      __m256i out1##_l = _mm256_madd_epi16(c0##lo, c1); \
+      __m256i out1##_h = _mm256_madd_epi16(c0##hi, c1)
+
+   // out = in << 12  (in 16-bit, out 32-bit)
+   #define dct_widen(out, in) \
+      __m256i out##_l = _mm256_srai_epi32(_mm256_unpacklo_epi16(_mm256_setzero_si256(), (in)), 4); \
+      __m256i out##_h = _mm256_srai_epi32(_mm256_unpackhi_epi16(_mm256_setzero_si256(), (in)), 4)
+
+   // wide add
+   #define dct_wadd(out, a, b) \
+      __m256i out##_l = _mm256_add_epi32(a##_l, b##_l); \
+      __m256i out##_h = _mm256_add_epi32(a##_h, b##_h)
+
+   // wide sub
+   #define dct_wsub(out, a, b) \
+      __m256i out##_l = _mm256_sub_epi32(a##_l, b##_l); \
+      __m256i out##_h = _mm256_sub_epi32(a##_h, b##_h)
+
+   // butterfly a/b, add bias, then shift by "s" and pack
+   #define dct_bfly32o(out0, out1, a,b,bias,s) \
+      { \
+         __m256i abiased_l = _mm256_add_epi32(a##_l, bias); \
+         __m256i abiased_h = _mm256_add_epi32(a##_h, bias); \
+         dct_wadd(sum, abiased, b); \
+         dct_wsub(dif, abiased, b); \
+         out0 = _mm256_packs_epi32(_mm256_srai_epi32(sum_l, s), _mm256_srai_epi32(sum_h, s)); \
+         out1 = _mm256_packs_epi32(_mm256_srai_epi32(dif_l, s), _mm256_srai_epi32(dif_h, s)); \
+      }
+
+   // 8-bit interleave step (for transposes)
+   #define dct_interleave8(a, b) \
+      tmp = a; \
+      a = _mm256_unpacklo_epi8(a, b); \
+      b = _mm256_unpackhi_epi8(tmp, b)
+
+   // 16-bit interleave step (for transposes)
+   #define dct_interleave16(a, b) \
+      tmp = a; \
+      a = _mm256_unpacklo_epi16(a, b); \
+      b = _mm256_unpackhi_epi16(tmp, b)
+
+   #define dct_pass(bias,shift) \
+      { \
+         /* even part */ \
+         dct_rot(t2e,t3e, row2,row6, rot0_0,rot0_1); \
+         __m256i sum04 = _mm256_add_epi16(row0, row4); \
+         __m256i dif04 = _mm256_sub_epi16(row0, row4); \
+         dct_widen(t0e, sum04); \
+         dct_widen(t1e, dif04); \
+         dct_wadd(x0, t0e, t3e); \
+         dct_wsub(x3, t0e, t3e); \
+         dct_wadd(x1, t1e, t2e); \
+         dct_wsub(x2, t1e, t2e); \
+         /* odd part */ \
+         dct_rot(y0o,y2o, row7,row3, rot2_0,rot2_1); \
+         dct_rot(y1o,y3o, row5,row1, rot3_0,rot3_1); \
+         __m256i sum17 = _mm256_add_epi16(row1, row7); \
+         __m256i sum35 = _mm256_add_epi16(row3, row5); \
+         dct_rot(y4o,y5o, sum17,sum35, rot1_0,rot1_1); \
+         dct_wadd(x4, y0o, y4o); \
+         dct_wadd(x5, y1o, y5o); \
+         dct_wadd(x6, y2o, y5o); \
+         dct_wadd(x7, y3o, y4o); \
+         dct_bfly32o(row0,row7, x0,x7,bias,shift); \
+         dct_bfly32o(row1,row6, x1,x6,bias,shift); \
+         dct_bfly32o(row2,row5, x2,x5,bias,shift); \
+         dct_bfly32o(row3,row4, x3,x4,bias,shift); \
+      }
+
+   // row r of the first block in the low lane, of the second block in the high lane
+   #define dct_load(r) \
+      _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) (data + (r)*8))), \
+                              _mm_loadu_si128((const __m128i *) (data + 64 + (r)*8)), 1)
+
+   // p holds rows r and r+1 of both blocks; each output row is 8 pixels of either block
+   #define dct_store2(p) \
+      tmp = _mm256_permute4x64_epi64(p, 0xd8); \
+      _mm_storeu_si128((__m128i *) out, _mm256_castsi256_si128(tmp)); out += out_stride; \
+      _mm_storeu_si128((__m128i *) out, _mm256_extracti128_si256(tmp, 1)); out += out_stride
+
+   __m256i rot0_0 = dct_const(stbi__f2f(0.5411961f), stbi__f2f(0.5411961f) + stbi__f2f(-1.847759065f));
+   __m256i rot0_1 = dct_const(stbi__f2f(0.5411961f) + stbi__f2f( 0.765366865f), stbi__f2f(0.5411961f));
+   __m256i rot1_0 = dct_const(stbi__f2f(1.175875602f) + stbi__f2f(-0.899976223f), stbi__f2f(1.175875602f));
+   __m256i rot1_1 = dct_const(stbi__f2f(1.175875602f), stbi__f2f(1.175875602f) + stbi__f2f(-2.562915447f));
+   __m256i rot2_0 = dct_const(stbi__f2f(-1.961570560f) + stbi__f2f( 0.298631336f), stbi__f2f(-1.961570560f));
+   __m256i rot2_1 = dct_const(stbi__f2f(-1.961570560f), stbi__f2f(-1.961570560f) + stbi__f2f( 3.072711026f));
+   __m256i rot3_0 = dct_const(stbi__f2f(-0.390180644f) + stbi__f2f( 2.053119869f), stbi__f2f(-0.390180644f));
+   __m256i rot3_1 = dct_const(stbi__f2f(-0.390180644f), stbi__f2f(-0.390180644f) + stbi__f2f( 1.501321110f));
+
+   // rounding biases in column/row passes, see stbi__idct_block for explanation.
+   __m256i bias_0 = _mm256_set1_epi32(512);
+   __m256i bias_1 = _mm256_set1_epi32(65536 + (128<<17));
+
+   // load
+   row0 = dct_load(0);
+   row1 = dct_load(1);
+   row2 = dct_load(2);
+   row3 = dct_load(3);
+   row4 = dct_load(4);
+   row5 = dct_load(5);
+   row6 = dct_load(6);
+   row7 = dct_load(7);
+
+   // column pass
+   dct_pass(bias_0, 10);
+
+   {
+      // 16bit 8x8 transpose pass 1
+      dct_interleave16(row0, row4);
+      dct_interleave16(row1, row5);
+      dct_interleave16(row2, row6);
+      dct_interleave16(row3, row7);
+
+      // transpose pass 2
+      dct_interleave16(row0, row2);
+      dct_interleave16(row1, row3);
+      dct_interleave16(row4, row6);
+      dct_interleave16(row5, row7);
+
+      // transpose pass 3
+      dct_interleave16(row0, row1);
+      dct_interleave16(row2, row3);
+      dct_interleave16(row4, row5);
+      dct_interleave16(row6, row7);
+   }
+
+   // row pass
+   dct_pass(bias_1, 17);
+
+   {
+      // pack
+      __m256i p0 = _mm256_packus_epi16(row0, row1); // a0a1a2a3...a7b0b1b2b3...b7
+      __m256i p1 = _mm256_packus_epi16(row2, row3);
+      __m256i p2 = _mm256_packus_epi16(row4, row5);
+      __m256i p3 = _mm256_packus_epi16(row6, row7);
+
+      // 8bit 8x8 transpose pass 1
+      dct_interleave8(p0, p2); // a0e0a1e1...
+      dct_interleave8(p1, p3); // c0g0c1g1...
+
+      // transpose pass 2
+      dct_interleave8(p0, p1); // a0c0e0g0...
+      dct_interleave8(p2, p3); // b0d0f0h0...
+
+      // transpose pass 3
+      dct_interleave8(p0, p2); // a0b0c0d0...
+      dct_interleave8(p1, p3); // a4b4c4d4...
+
+      // store
+      dct_store2(p0);
+      dct_store2(p2);
+      dct_store2(p1);
+      dct_store2(p3);
+   }
+
+#undef dct_const
+#undef dct_rot
+#undef dct_widen
+#undef dct_wadd
+#undef dct_wsub
+#undef dct_bfly32o
+#undef dct_interleave8
+#undef dct_interleave16
+#undef dct_pass
+#undef dct_load
+#undef dct_store2
+}
+#endif // STBI_AVX2
+
 #define STBI__MARKER_none  0xff
 // if there's a pending marker from the entropy stream, return that
 // otherwise, fetch from the stream and get a marker. if there's no
@@ -2945,6 +3434,34 @@ static void stbi__jpeg_reset(stbi__jpeg *j)
    // since we don't even allow 1<<30 pixels
 }
 
+// scan an interleaved baseline mcu... process scan_n components in order.
+// horizontally adjacent blocks of a component are transformed two at a time
+static int stbi__jpeg_decode_interleaved_mcu(stbi__jpeg *z, int i, int j, short data[128])
+{
+   int k,x,y;
+   for (k=0; k < z->scan_n; ++k) {
+      int n = z->order[k];
+      int ha = z->img_comp[n].ha;
+      // scan out an mcu's worth of this component; that's just determined
+      // by the basic H and V specified for the component
+      for (y=0; y < z->img_comp[n].v; ++y) {
+         int y2 = (j*z->img_comp[n].v + y)*z->idct_size;
+         for (x=0; x+1 < z->img_comp[n].h; x += 2) {
+            int x2 = (i*z->img_comp[n].h + x)*z->idct_size;
+            if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+            if (!stbi__jpeg_decode_block(z, data+64, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+            z->idct_block2_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
+         }
+         if (x < z->img_comp[n].h) {
+            int x2 = (i*z->img_comp[n].h + x)*z->idct_size;
+            if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+            z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
+         }
+      }
+   }
+   return 1;
+}
+
 static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
 {
    stbi__jpeg_reset(z);
@@ -2963,7 +3480,7 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
             for (i=0; i < w; ++i) {
                int ha = z->img_comp[n].ha;
                if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               z->idct_block_kernel(z->img_comp[n].data+(z->img_comp[n].w2*j+i)*z->idct_size, z->img_comp[n].w2, data);
                // every data block is an MCU, so countdown the restart interval
                if (--z->todo <= 0) {
                   if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
@@ -2976,25 +3493,11 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
          }
          return 1;
       } else { // interleaved
-         int i,j,k,x,y;
-         STBI_SIMD_ALIGN(short, data[64]);
+         int i,j;
+         STBI_SIMD_ALIGN(short, data[128]);
          for (j=0; j < z->img_mcu_y; ++j) {
             for (i=0; i < z->img_mcu_x; ++i) {
-               // scan an interleaved mcu... process scan_n components in order
-               for (k=0; k < z->scan_n; ++k) {
-                  int n = z->order[k];
-                  // scan out an mcu's worth of this component; that's just determined
-                  // by the basic H and V specified for the component
-                  for (y=0; y < z->img_comp[n].v; ++y) {
-                     for (x=0; x < z->img_comp[n].h; ++x) {
-                        int x2 = (i*z->img_comp[n].h + x)*8;
-                        int y2 = (j*z->img_comp[n].v + y)*8;
-                        int ha = z->img_comp[n].ha;
-                        if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
-                     }
-                  }
-               }
+               if (!stbi__jpeg_decode_interleaved_mcu(z, i, j, data)) return 0;
                // after all interleaved components, that's an interleaved MCU,
                // so now count down the restart interval
                if (--z->todo <= 0) {
@@ -3069,6 +3572,121 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
    }
 }
 
+// parallel baseline decoding: every restart interval starts byte aligned with a fresh dc
+// prediction, so the intervals of a scan can be located up front and decoded independently
+typedef struct
+{
+   stbi__jpeg *z;
+   stbi_uc **segments; // start of every interval, plus the end of the scan
+   int mcu_count;
+   int *ok;
+} stbi__jpeg_parallel_scan;
+
+// decode one MCU of a baseline scan; for non-interleaved scans every block is an MCU
+static int stbi__jpeg_decode_baseline_mcu(stbi__jpeg *z, int mcu, short data[128])
+{
+   if (z->scan_n == 1) {
+      int n = z->order[0];
+      int w = (z->img_comp[n].x+7) >> 3;
+      int i = mcu % w, j = mcu / w;
+      int ha = z->img_comp[n].ha;
+      if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+      z->idct_block_kernel(z->img_comp[n].data+(z->img_comp[n].w2*j+i)*z->idct_size, z->img_comp[n].w2, data);
+      return 1;
+   }
+   return stbi__jpeg_decode_interleaved_mcu(z, mcu % z->img_mcu_x, mcu / z->img_mcu_x, data);
+}
+
+static void stbi__jpeg_decode_interval(void *task_context, int index)
+{
+   stbi__jpeg_parallel_scan *scan = (stbi__jpeg_parallel_scan *) task_context;
+   STBI_SIMD_ALIGN(short, data[128]);
+   stbi__context s;
+   int first = index * scan->z->restart_interval;
+   int last = first + scan->z->restart_interval < scan->mcu_count ? first + scan->z->restart_interval : scan->mcu_count;
+   int mcu;
+   // the tables are shared, the bit reader and dc predictions are per interval
+   stbi__jpeg *z = (stbi__jpeg *) stbi__malloc(sizeof(stbi__jpeg));
+   scan->ok[index] = 0;
+   if (!z) return;
+   memcpy(z, scan->z, sizeof(stbi__jpeg));
+   stbi__start_mem(&s, scan->segments[index], (int) (scan->segments[index+1] - scan->segments[index]));
+   z->s = &s;
+   stbi__jpeg_reset(z);
+   for (mcu = first; mcu < last; ++mcu)
+      if (!stbi__jpeg_decode_baseline_mcu(z, mcu, data)) break;
+   scan->ok[index] = mcu == last;
+   STBI_FREE(z);
+}
+
+// returns 1 or 0 like stbi__parse_entropy_coded_data, or -1 if the scan can't be split
+static int stbi__parse_entropy_coded_data_parallel(stbi__jpeg *z)
+{
+   stbi__context *s = z->s;
+   stbi__jpeg_parallel_scan scan;
+   stbi_uc *p, *end;
+   int count, found, i, result;
+
+   if (!s->parallel_for || z->progressive || z->restart_interval <= 0 || s->read_from_callbacks)
+      return -1;
+   if (z->scan_n == 1) {
+      int n = z->order[0];
+      scan.mcu_count = ((z->img_comp[n].x+7) >> 3) * ((z->img_comp[n].y+7) >> 3);
+   } else {
+      scan.mcu_count = z->img_mcu_x * z->img_mcu_y;
+   }
+   count = (scan.mcu_count + z->restart_interval - 1) / z->restart_interval;
+   if (count < 2) return -1;
+
+   scan.segments = (stbi_uc **) stbi__malloc_mad2(count + 1, sizeof(stbi_uc *), 0);
+   scan.ok = (int *) stbi__malloc_mad2(count, sizeof(int), 0);
+   if (!scan.segments || !scan.ok) {
+      STBI_FREE(scan.segments);
+      STBI_FREE(scan.ok);
+      return stbi__err("outofmem", "Out of memory");
+   }
+
+   // find the RST markers; stuffed zeros and fill bytes are skipped, any other marker ends the scan
+   p = s->img_buffer;
+   end = s->img_buffer_end;
+   scan.segments[0] = p;
+   found = 1;
+   while ((p = (stbi_uc *) memchr(p, 0xff, end - p)) != NULL && p+1 < end) {
+      if (p[1] == 0x00) {
+         p += 2;
+      } else if (p[1] == 0xff) {
+         p += 1;
+      } else if (STBI__RESTART(p[1]) && found < count) {
+         p += 2;
+         scan.segments[found++] = p;
+      } else {
+         break;
+      }
+   }
+   if (!p) p = end;
+
+   // a missing or extra interval is left to the serial decoder, which tolerates it
+   if (found != count) {
+      STBI_FREE(scan.segments);
+      STBI_FREE(scan.ok);
+      return -1;
+   }
+   scan.segments[count] = p;
+   scan.z = z;
+   s->parallel_for(s->parallel_pool, count, stbi__jpeg_decode_interval, &scan);
+
+   result = 1;
+   for (i=0; i < count; ++i)
+      if (!scan.ok[i]) result = stbi__err("bad restart interval", "Corrupt JPEG");
+   STBI_FREE(scan.segments);
+   STBI_FREE(scan.ok);
+
+   // continue after the scan, the marker ending it is read next
+   s->img_buffer = p;
+   stbi__jpeg_reset(z);
+   return result;
+}
+
 static void stbi__jpeg_dequantize(short *data, stbi__uint16 *dequant)
 {
    int i;
@@ -3076,21 +3694,52 @@ static void stbi__jpeg_dequantize(short *data, stbi__uint16 *dequant)
       data[i] *= dequant[i];
 }
 
+// dequantize and idct one row of blocks of a progressive component
+static void stbi__jpeg_finish_row(stbi__jpeg *z, int n, int j)
+{
+   int i;
+   int w = (z->img_comp[n].x+7) >> 3;
+   // the blocks of a row are contiguous, so they are transformed two at a time
+   for (i=0; i+1 < w; i += 2) {
+      short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
+      stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
+      stbi__jpeg_dequantize(data+64, z->dequant[z->img_comp[n].tq]);
+      z->idct_block2_kernel(z->img_comp[n].data+(z->img_comp[n].w2*j+i)*z->idct_size, z->img_comp[n].w2, data);
+   }
+   if (i < w) {
+      short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
+      stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
+      z->idct_block_kernel(z->img_comp[n].data+(z->img_comp[n].w2*j+i)*z->idct_size, z->img_comp[n].w2, data);
+   }
+}
+
+// task index runs over the block rows of all components
+static void stbi__jpeg_finish_task(void *task_context, int index)
+{
+   stbi__jpeg *z = (stbi__jpeg *) task_context;
+   int n;
+   for (n=0; n < z->s->img_n; ++n) {
+      int h = (z->img_comp[n].y+7) >> 3;
+      if (index < h) {
+         stbi__jpeg_finish_row(z, n, index);
+         return;
+      }
+      index -= h;
+   }
+}
+
 static void stbi__jpeg_finish(stbi__jpeg *z)
 {
    if (z->progressive) {
       // dequantize and idct the data
-      int i,j,n;
-      for (n=0; n < z->s->img_n; ++n) {
-         int w = (z->img_comp[n].x+7) >> 3;
-         int h = (z->img_comp[n].y+7) >> 3;
-         for (j=0; j < h; ++j) {
-            for (i=0; i < w; ++i) {
-               short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
-               stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
-            }
-         }
+      int j,n,rows=0;
+      for (n=0; n < z->s->img_n; ++n)
+         rows += (z->img_comp[n].y+7) >> 3;
+      if (z->s->parallel_for) {
+         z->s->parallel_for(z->s->parallel_pool, rows, stbi__jpeg_finish_task, z);
+      } else {
+         for (j=0; j < rows; ++j)
+            stbi__jpeg_finish_task(z, j);
       }
    }
 }
@@ -3328,8 +3977,9 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       //
       // img_mcu_x, img_mcu_y: <=17 bits; comp[i].h and .v are <=4 (checked earlier)
       // so these muls can't overflow with 32-bit ints (which we require)
-      z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h * 8;
-      z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v * 8;
+      // a reduced-size decode stores idct_size instead of 8 pixels per block
+      z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h * z->idct_size;
+      z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v * z->idct_size;
       z->img_comp[i].coeff = 0;
       z->img_comp[i].raw_coeff = 0;
       z->img_comp[i].linebuf = NULL;
@@ -3339,10 +3989,10 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       // align blocks for idct using mmx/sse
       z->img_comp[i].data = (stbi_uc*) (((size_t) z->img_comp[i].raw_data + 15) & ~15);
       if (z->progressive) {
-         // w2, h2 are multiples of 8 (see above)
-         z->img_comp[i].coeff_w = z->img_comp[i].w2 / 8;
-         z->img_comp[i].coeff_h = z->img_comp[i].h2 / 8;
-         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].w2, z->img_comp[i].h2, sizeof(short), 15);
+         // coefficients are kept for every block, whatever the output size
+         z->img_comp[i].coeff_w = z->img_mcu_x * z->img_comp[i].h;
+         z->img_comp[i].coeff_h = z->img_mcu_y * z->img_comp[i].v;
+         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].coeff_w * 8, z->img_comp[i].coeff_h * 8, sizeof(short), 15);
          if (z->img_comp[i].raw_coeff == NULL)
             return stbi__free_jpeg_components(z, i+1, stbi__err("outofmem", "Out of memory"));
          z->img_comp[i].coeff = (short*) (((size_t) z->img_comp[i].raw_coeff + 15) & ~15);
@@ -3410,7 +4060,7 @@ static stbi_uc stbi__skip_jpeg_junk_at_end(stbi__jpeg *j)
 // decode image to YCbCr format
 static int stbi__decode_jpeg_image(stbi__jpeg *j)
 {
-   int m;
+   int m, ok;
    for (m = 0; m < 4; m++) {
       j->img_comp[m].raw_data = NULL;
       j->img_comp[m].raw_coeff = NULL;
@@ -3421,7 +4071,9 @@ static int stbi__decode_jpeg_image(stbi__jpeg *j)
    while (!stbi__EOI(m)) {
       if (stbi__SOS(m)) {
          if (!stbi__process_scan_header(j)) return 0;
-         if (!stbi__parse_entropy_coded_data(j)) return 0;
+         ok = stbi__parse_entropy_coded_data_parallel(j);
+         if (ok < 0) ok = stbi__parse_entropy_coded_data(j);
+         if (!ok) return 0;
          if (j->marker == STBI__MARKER_none ) {
          j->marker = stbi__skip_jpeg_junk_at_end(j);
             // if we reach eof without hitting a marker, stbi__get_marker() below will fail and we'll eventually return 0
@@ -3642,6 +4294,85 @@ static stbi_uc *stbi__resample_row_hv_2_simd(stbi_uc *out, stbi_uc *in_near, stb
 }
 #endif
 
+#ifdef STBI_AVX2
+// the sse2 kernel on 16 pixels per iteration
+static STBI__AVX2_TARGET stbi_uc *stbi__resample_row_hv_2_avx2(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
+{
+   // need to generate 2x2 samples for every one in input
+   int i=0,t0,t1;
+
+   if (w == 1) {
+      out[0] = out[1] = stbi__div4(3*in_near[0] + in_far[0] + 2);
+      return out;
+   }
+
+   t1 = 3*in_near[0] + in_far[0];
+   // process groups of 16 pixels for as long as we can.
+   // note we can't handle the last pixel in a row in this loop
+   // because we need to handle the filter boundary conditions.
+   for (; i < ((w-1) & ~15); i += 16) {
+      // load and perform the vertical filtering pass
+      // this uses 3*x + y = 4*x + (y - x)
+      __m256i farw  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i)));
+      __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i)));
+      __m256i diff  = _mm256_sub_epi16(farw, nearw);
+      __m256i nears = _mm256_slli_epi16(nearw, 2);
+      __m256i curr  = _mm256_add_epi16(nears, diff); // current row
+
+      // "prev" is current row shifted right by 1 pixel with t1 inserted,
+      // "next" is current row shifted left by 1 pixel with the first pixel
+      // of the next block of 16 added in; both shifts cross the 128-bit lanes.
+      __m256i prv0 = _mm256_alignr_epi8(curr, _mm256_permute2x128_si256(curr, curr, 0x08), 14);
+      __m256i nxt0 = _mm256_alignr_epi8(_mm256_permute2x128_si256(curr, curr, 0x81), curr, 2);
+      __m256i prev = _mm256_insert_epi16(prv0, t1, 0);
+      __m256i next = _mm256_insert_epi16(nxt0, 3*in_near[i+16] + in_far[i+16], 15);
+
+      // horizontal filter, polyphase implementation since it's convenient:
+      // even pixels = 3*cur + prev = cur*4 + (prev - cur)
+      // odd  pixels = 3*cur + next = cur*4 + (next - cur)
+      // note the shared term.
+      __m256i bias  = _mm256_set1_epi16(8);
+      __m256i curs = _mm256_slli_epi16(curr, 2);
+      __m256i prvd = _mm256_sub_epi16(prev, curr);
+      __m256i nxtd = _mm256_sub_epi16(next, curr);
+      __m256i curb = _mm256_add_epi16(curs, bias);
+      __m256i even = _mm256_add_epi16(prvd, curb);
+      __m256i odd  = _mm256_add_epi16(nxtd, curb);
+
+      // interleave even and odd pixels, then undo scaling. the in-lane
+      // interleave and pack leave the low lane with pixels 0..7 and the
+      // high lane with pixels 8..15, already in output order.
+      __m256i int0 = _mm256_unpacklo_epi16(even, odd);
+      __m256i int1 = _mm256_unpackhi_epi16(even, odd);
+      __m256i de0  = _mm256_srli_epi16(int0, 4);
+      __m256i de1  = _mm256_srli_epi16(int1, 4);
+
+      // pack and write output
+      __m256i outv = _mm256_packus_epi16(de0, de1);
+      _mm256_storeu_si256((__m256i *) (out + i*2), outv);
+
+      // "previous" value for next iter
+      t1 = 3*in_near[i+15] + in_far[i+15];
+   }
+
+   t0 = t1;
+   t1 = 3*in_near[i] + in_far[i];
+   out[i*2] = stbi__div16(3*t1 + t0 + 8);
+
+   for (++i; i < w; ++i) {
+      t0 = t1;
+      t1 = 3*in_near[i]+in_far[i];
+      out[i*2-1] = stbi__div16(3*t0 + t1 + 8);
+      out[i*2  ] = stbi__div16(3*t1 + t0 + 8);
+   }
+   out[w*2-1] = stbi__div4(t1+2);
+
+   STBI_NOTUSED(hs);
+
+   return out;
+}
+#endif
+
 static stbi_uc *stbi__resample_row_generic(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
 {
    // resample with nearest-neighbor
@@ -3816,28 +4547,137 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 }
 #endif
 
+#ifdef STBI_AVX2
+// the sse2 kernel on 16 pixels per iteration
+static STBI__AVX2_TARGET void stbi__YCbCr_to_RGB_avx2(stbi_uc *out, stbi_uc const *y, stbi_uc const *pcb, stbi_uc const *pcr, int count, int step)
+{
+   int i = 0;
+
+   if (step == 4) {
+      __m256i signflip  = _mm256_set1_epi16(-0x8000); // -128 in the high byte
+      __m256i cr_const0 = _mm256_set1_epi16(   (short) ( 1.40200f*4096.0f+0.5f));
+      __m256i cr_const1 = _mm256_set1_epi16( - (short) ( 0.71414f*4096.0f+0.5f));
+      __m256i cb_const0 = _mm256_set1_epi16( - (short) ( 0.34414f*4096.0f+0.5f));
+      __m256i cb_const1 = _mm256_set1_epi16(   (short) ( 1.77200f*4096.0f+0.5f));
+      __m256i y_bias = _mm256_set1_epi16(128);
+      __m256i xw = _mm256_set1_epi16(255); // alpha channel
+
+      for (; i+15 < count; i += 16) {
+         // load, widen to short and left-shift by 8 (cr, cb biased by -128 first)
+         __m256i y_bytes = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (y+i)));
+         __m256i cr_bytes = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (pcr+i)));
+         __m256i cb_bytes = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (pcb+i)));
+         __m256i yw  = _mm256_or_si256(_mm256_slli_epi16(y_bytes, 8), y_bias);
+         __m256i crw = _mm256_xor_si256(_mm256_slli_epi16(cr_bytes, 8), signflip);
+         __m256i cbw = _mm256_xor_si256(_mm256_slli_epi16(cb_bytes, 8), signflip);
+
+         // color transform
+         __m256i yws = _mm256_srli_epi16(yw, 4);
+         __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+         __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+         __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+         __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+         __m256i rws = _mm256_add_epi16(cr0, yws);
+         __m256i gwt = _mm256_add_epi16(cb0, yws);
+         __m256i bws = _mm256_add_epi16(yws, cb1);
+         __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+         // descale
+         __m256i rw = _mm256_srai_epi16(rws, 4);
+         __m256i bw = _mm256_srai_epi16(bws, 4);
+         __m256i gw = _mm256_srai_epi16(gws, 4);
+
+         // back to byte, set up for transpose
+         __m256i brb = _mm256_packus_epi16(rw, bw);
+         __m256i gxb = _mm256_packus_epi16(gw, xw);
+
+         // transpose to interleave channels, in-lane: o0 holds pixels 0..3
+         // and 8..11, o1 holds pixels 4..7 and 12..15
+         __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+         __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+         __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+         __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+
+         // store
+         _mm256_storeu_si256((__m256i *) (out + 0), _mm256_permute2x128_si256(o0, o1, 0x20));
+         _mm256_storeu_si256((__m256i *) (out + 32), _mm256_permute2x128_si256(o0, o1, 0x31));
+         out += 64;
+      }
+   }
+
+   for (; i < count; ++i) {
+      int y_fixed = (y[i] << 20) + (1<<19); // rounding
+      int r,g,b;
+      int cr = pcr[i] - 128;
+      int cb = pcb[i] - 128;
+      r = y_fixed + cr* stbi__float2fixed(1.40200f);
+      g = y_fixed + cr*-stbi__float2fixed(0.71414f) + ((cb*-stbi__float2fixed(0.34414f)) & 0xffff0000);
+      b = y_fixed                                   +   cb* stbi__float2fixed(1.77200f);
+      r >>= 20;
+      g >>= 20;
+      b >>= 20;
+      if ((unsigned) r > 255) { if (r < 0) r = 0; else r = 255; }
+      if ((unsigned) g > 255) { if (g < 0) g = 0; else g = 255; }
+      if ((unsigned) b > 255) { if (b < 0) b = 0; else b = 255; }
+      out[0] = (stbi_uc)r;
+      out[1] = (stbi_uc)g;
+      out[2] = (stbi_uc)b;
+      out[3] = 255;
+      out += step;
+   }
+}
+#endif
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
    j->idct_block_kernel = stbi__idct_block;
+   j->idct_block2_kernel = stbi__idct_block2;
+   j->idct_size = 8;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_row;
    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
+   if (stbi__jpeg_simd_level < 1) return;
 
 #ifdef STBI_SSE2
    if (stbi__sse2_available()) {
       j->idct_block_kernel = stbi__idct_simd;
+      j->idct_block2_kernel = stbi__idct_simd2;
       j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
       j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
    }
 #endif
 
+#ifdef STBI_AVX2
+   // single blocks stay on sse2, they are a lane's worth of work
+   if (stbi__jpeg_simd_level >= 2 && stbi__avx2_available()) {
+      j->idct_block2_kernel = stbi__idct_avx2;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_avx2;
+   }
+#endif
+
 #ifdef STBI_NEON
    j->idct_block_kernel = stbi__idct_simd;
+   j->idct_block2_kernel = stbi__idct_simd2;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
 #endif
 }
 
+// reduced-size decoding swaps in the smaller idct, everything after it just sees smaller planes
+static int stbi__setup_jpeg_scale(stbi__jpeg *j, int scale_shift)
+{
+   switch (scale_shift) {
+      case 0: return 1;
+      case 1: j->idct_block_kernel = stbi__idct_block_4x4; j->idct_block2_kernel = stbi__idct_block2_4x4; break;
+      case 2: j->idct_block_kernel = stbi__idct_block_2x2; j->idct_block2_kernel = stbi__idct_block2_2x2; break;
+      case 3: j->idct_block_kernel = stbi__idct_block_1x1; j->idct_block2_kernel = stbi__idct_block2_1x1; break;
+      default: return stbi__err("bad scale", "Scale must be 1/1, 1/2, 1/4 or 1/8");
+   }
+   j->idct_size = 8 >> scale_shift;
+   return 1;
+}
+
 // clean up the temporary component buffers
 static void stbi__cleanup_jpeg(stbi__jpeg *j)
 {
@@ -3861,6 +4701,150 @@ static stbi_uc stbi__blinn_8x8(stbi_uc x, stbi_uc y)
    return (stbi_uc) ((t + (t >>8)) >> 8);
 }
 
+// advance a resampler by rows output rows without producing them
+static void stbi__resample_skip_rows(stbi__resample *r, int comp_y, int w2, unsigned int rows)
+{
+   for (; rows > 0; --rows) {
+      if (++r->ystep >= r->vs) {
+         r->ystep = 0;
+         r->line0 = r->line1;
+         if (++r->ypos < comp_y)
+            r->line1 += w2;
+      }
+   }
+}
+
+// resample and color-convert output rows [j0,j1); res_comp must be positioned at row j0
+static void stbi__jpeg_convert_rows(stbi__jpeg *z, stbi__resample *res_comp, stbi_uc **linebuf, stbi_uc *output,
+                                    int n, int decode_n, int is_rgb, unsigned int j0, unsigned int j1)
+{
+   int k;
+   unsigned int i,j;
+   stbi_uc *coutput[4] = { NULL, NULL, NULL, NULL };
+   for (j=j0; j < j1; ++j) {
+      stbi_uc *out = output + n * z->s->img_x * j;
+      for (k=0; k < decode_n; ++k) {
+         stbi__resample *r = &res_comp[k];
+         int y_bot = r->ystep >= (r->vs >> 1);
+         coutput[k] = r->resample(linebuf[k],
+                                  y_bot ? r->line1 : r->line0,
+                                  y_bot ? r->line0 : r->line1,
+                                  r->w_lores, r->hs);
+         if (++r->ystep >= r->vs) {
+            r->ystep = 0;
+            r->line0 = r->line1;
+            if (++r->ypos < z->img_comp[k].y)
+               r->line1 += z->img_comp[k].w2;
+         }
+      }
+      if (n >= 3) {
+         stbi_uc *y = coutput[0];
+         if (z->s->img_n == 3) {
+            if (is_rgb) {
+               for (i=0; i < z->s->img_x; ++i) {
+                  out[0] = y[i];
+                  out[1] = coutput[1][i];
+                  out[2] = coutput[2][i];
+                  out[3] = 255;
+                  out += n;
+               }
+            } else {
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+            }
+         } else if (z->s->img_n == 4) {
+            if (z->app14_color_transform == 0) { // CMYK
+               for (i=0; i < z->s->img_x; ++i) {
+                  stbi_uc m = coutput[3][i];
+                  out[0] = stbi__blinn_8x8(coutput[0][i], m);
+                  out[1] = stbi__blinn_8x8(coutput[1][i], m);
+                  out[2] = stbi__blinn_8x8(coutput[2][i], m);
+                  out[3] = 255;
+                  out += n;
+               }
+            } else if (z->app14_color_transform == 2) { // YCCK
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+               for (i=0; i < z->s->img_x; ++i) {
+                  stbi_uc m = coutput[3][i];
+                  out[0] = stbi__blinn_8x8(255 - out[0], m);
+                  out[1] = stbi__blinn_8x8(255 - out[1], m);
+                  out[2] = stbi__blinn_8x8(255 - out[2], m);
+                  out += n;
+               }
+            } else { // YCbCr + alpha?  Ignore the fourth channel for now
+               z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+            }
+         } else
+            for (i=0; i < z->s->img_x; ++i) {
+               out[0] = out[1] = out[2] = y[i];
+               out[3] = 255; // not used if n==3
+               out += n;
+            }
+      } else {
+         if (is_rgb) {
+            if (n == 1)
+               for (i=0; i < z->s->img_x; ++i)
+                  *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+            else {
+               for (i=0; i < z->s->img_x; ++i, out += 2) {
+                  out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
+                  out[1] = 255;
+               }
+            }
+         } else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
+            for (i=0; i < z->s->img_x; ++i) {
+               stbi_uc m = coutput[3][i];
+               stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
+               stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
+               stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
+               out[0] = stbi__compute_y(r, g, b);
+               out[1] = 255;
+               out += n;
+            }
+         } else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
+            for (i=0; i < z->s->img_x; ++i) {
+               out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
+               out[1] = 255;
+               out += n;
+            }
+         } else {
+            stbi_uc *y = coutput[0];
+            if (n == 1)
+               for (i=0; i < z->s->img_x; ++i) out[i] = y[i];
+            else
+               for (i=0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
+         }
+      }
+   }
+}
+
+// parallel color conversion works in bands of output rows, each with its own line buffers
+#define STBI__JPEG_BAND_ROWS 64
+
+typedef struct
+{
+   stbi__jpeg *z;
+   stbi__resample *res_comp; // positioned at row 0
+   stbi_uc *output;
+   int n, decode_n, is_rgb;
+} stbi__jpeg_convert_job;
+
+static void stbi__jpeg_convert_band(void *task_context, int index)
+{
+   stbi__jpeg_convert_job *job = (stbi__jpeg_convert_job *) task_context;
+   stbi__jpeg *z = job->z;
+   stbi__resample res_comp[4];
+   stbi_uc *linebuf[4];
+   unsigned int j0 = (unsigned int) index * STBI__JPEG_BAND_ROWS;
+   unsigned int j1 = j0 + STBI__JPEG_BAND_ROWS < z->s->img_y ? j0 + STBI__JPEG_BAND_ROWS : z->s->img_y;
+   int k;
+   for (k=0; k < job->decode_n; ++k) {
+      res_comp[k] = job->res_comp[k];
+      stbi__resample_skip_rows(&res_comp[k], z->img_comp[k].y, z->img_comp[k].w2, j0);
+      linebuf[k] = z->img_comp[k].linebuf + (size_t) index * (z->s->img_x + 3);
+   }
+   stbi__jpeg_convert_rows(z, res_comp, linebuf, job->output, job->n, job->decode_n, job->is_rgb, j0, j1);
+}
+
 static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
 {
    int n, decode_n, is_rgb;
@@ -3886,12 +4870,23 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
    // accessing uninitialized coutput[0] later
    if (decode_n <= 0) { stbi__cleanup_jpeg(z); return NULL; }
 
+   // a reduced-size decode left smaller planes, resample them to the reduced image size
+   if (z->idct_size < 8) {
+      int k, scale = 8 / z->idct_size;
+      for (k=0; k < z->s->img_n; ++k) {
+         z->img_comp[k].x = (z->img_comp[k].x + scale-1) / scale;
+         z->img_comp[k].y = (z->img_comp[k].y + scale-1) / scale;
+      }
+      z->s->img_x = (z->s->img_x + scale-1) / scale;
+      z->s->img_y = (z->s->img_y + scale-1) / scale;
+   }
+
    // resample and color-convert
    {
       int k;
-      unsigned int i,j;
       stbi_uc *output;
-      stbi_uc *coutput[4] = { NULL, NULL, NULL, NULL };
+      stbi_uc *linebuf[4] = { NULL, NULL, NULL, NULL };
+      int bands = z->s->parallel_for ? (int) ((z->s->img_y + STBI__JPEG_BAND_ROWS - 1) / STBI__JPEG_BAND_ROWS) : 1;
 
       stbi__resample res_comp[4];
 
@@ -3899,9 +4894,10 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
          stbi__resample *r = &res_comp[k];
 
          // allocate line buffer big enough for upsampling off the edges
-         // with upsample factor of 4
-         z->img_comp[k].linebuf = (stbi_uc *) stbi__malloc(z->s->img_x + 3);
+         // with upsample factor of 4, one per band
+         z->img_comp[k].linebuf = (stbi_uc *) stbi__malloc_mad2(bands, z->s->img_x + 3, 0);
          if (!z->img_comp[k].linebuf) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
+         linebuf[k] = z->img_comp[k].linebuf;
 
          r->hs      = z->img_h_max / z->img_comp[k].h;
          r->vs      = z->img_v_max / z->img_comp[k].v;
@@ -3918,103 +4914,26 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
       }
 
       // can't error after this so, this is safe
-      output = (stbi_uc *) stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
+      // decode in place when the caller provided a large enough buffer (stbi_load_into)
+      if (z->s->out_buffer && stbi__mad3sizes_valid(n, z->s->img_x, z->s->img_y, 0) &&
+          (size_t) n * z->s->img_x * z->s->img_y <= z->s->out_buffer_size)
+         output = z->s->out_buffer;
+      else
+         output = (stbi_uc *) stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
       if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
 
       // now go ahead and resample
-      for (j=0; j < z->s->img_y; ++j) {
-         stbi_uc *out = output + n * z->s->img_x * j;
-         for (k=0; k < decode_n; ++k) {
-            stbi__resample *r = &res_comp[k];
-            int y_bot = r->ystep >= (r->vs >> 1);
-            coutput[k] = r->resample(z->img_comp[k].linebuf,
-                                     y_bot ? r->line1 : r->line0,
-                                     y_bot ? r->line0 : r->line1,
-                                     r->w_lores, r->hs);
-            if (++r->ystep >= r->vs) {
-               r->ystep = 0;
-               r->line0 = r->line1;
-               if (++r->ypos < z->img_comp[k].y)
-                  r->line1 += z->img_comp[k].w2;
-            }
-         }
-         if (n >= 3) {
-            stbi_uc *y = coutput[0];
-            if (z->s->img_n == 3) {
-               if (is_rgb) {
-                  for (i=0; i < z->s->img_x; ++i) {
-                     out[0] = y[i];
-                     out[1] = coutput[1][i];
-                     out[2] = coutput[2][i];
-                     out[3] = 255;
-                     out += n;
-                  }
-               } else {
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-               }
-            } else if (z->s->img_n == 4) {
-               if (z->app14_color_transform == 0) { // CMYK
-                  for (i=0; i < z->s->img_x; ++i) {
-                     stbi_uc m = coutput[3][i];
-                     out[0] = stbi__blinn_8x8(coutput[0][i], m);
-                     out[1] = stbi__blinn_8x8(coutput[1][i], m);
-                     out[2] = stbi__blinn_8x8(coutput[2][i], m);
-                     out[3] = 255;
-                     out += n;
-                  }
-               } else if (z->app14_color_transform == 2) { // YCCK
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                  for (i=0; i < z->s->img_x; ++i) {
-                     stbi_uc m = coutput[3][i];
-                     out[0] = stbi__blinn_8x8(255 - out[0], m);
-                     out[1] = stbi__blinn_8x8(255 - out[1], m);
-                     out[2] = stbi__blinn_8x8(255 - out[2], m);
-                     out += n;
-                  }
-               } else { // YCbCr + alpha?  Ignore the fourth channel for now
-                  z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-               }
-            } else
-               for (i=0; i < z->s->img_x; ++i) {
-                  out[0] = out[1] = out[2] = y[i];
-                  out[3] = 255; // not used if n==3
-                  out += n;
-               }
-         } else {
-            if (is_rgb) {
-               if (n == 1)
-                  for (i=0; i < z->s->img_x; ++i)
-                     *out++ = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-               else {
-                  for (i=0; i < z->s->img_x; ++i, out += 2) {
-                     out[0] = stbi__compute_y(coutput[0][i], coutput[1][i], coutput[2][i]);
-                     out[1] = 255;
-                  }
-               }
-            } else if (z->s->img_n == 4 && z->app14_color_transform == 0) {
-               for (i=0; i < z->s->img_x; ++i) {
-                  stbi_uc m = coutput[3][i];
-                  stbi_uc r = stbi__blinn_8x8(coutput[0][i], m);
-                  stbi_uc g = stbi__blinn_8x8(coutput[1][i], m);
-                  stbi_uc b = stbi__blinn_8x8(coutput[2][i], m);
-                  out[0] = stbi__compute_y(r, g, b);
-                  out[1] = 255;
-                  out += n;
-               }
-            } else if (z->s->img_n == 4 && z->app14_color_transform == 2) {
-               for (i=0; i < z->s->img_x; ++i) {
-                  out[0] = stbi__blinn_8x8(255 - coutput[0][i], coutput[3][i]);
-                  out[1] = 255;
-                  out += n;
-               }
-            } else {
-               stbi_uc *y = coutput[0];
-               if (n == 1)
-                  for (i=0; i < z->s->img_x; ++i) out[i] = y[i];
-               else
-                  for (i=0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
-            }
-         }
+      if (bands > 1) {
+         stbi__jpeg_convert_job job;
+         job.z = z;
+         job.res_comp = res_comp;
+         job.output = output;
+         job.n = n;
+         job.decode_n = decode_n;
+         job.is_rgb = is_rgb;
+         z->s->parallel_for(z->s->parallel_pool, bands, stbi__jpeg_convert_band, &job);
+      } else {
+         stbi__jpeg_convert_rows(z, res_comp, linebuf, output, n, decode_n, is_rgb, 0, z->s->img_y);
       }
       stbi__cleanup_jpeg(z);
       *out_x = z->s->img_x;
@@ -4033,6 +4952,7 @@ static void *stbi__jpeg_load(stbi__context *s, int *x, int *y, int *comp, int re
    STBI_NOTUSED(ri);
    j->s = s;
    stbi__setup_jpeg(j);
+   if (!stbi__setup_jpeg_scale(j, s->scale_shift)) { STBI_FREE(j); return NULL; }
    result = load_jpeg_image(j, x,y,comp,req_comp);
    STBI_FREE(j);
    return result;